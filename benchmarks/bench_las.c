@@ -0,0 +1,314 @@
+/**
+ * @file bench_las.c
+ * @author Ryan Wicks
+ * @brief Microbenchmarks of the LAS record and time conversion functions, printed as JSON.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_aggregate.h"
+#include "las_2g_python.h"
+#include "las_2g_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ITEMS 1000000
+#define DEFAULT_REPETITIONS 7
+#define FIRST_UTC_TIME 1585756253000000ULL // 2020-04-01, in us
+
+/**
+ * @brief Result of one benchmark, times are per item.
+ *
+ */
+typedef struct {
+    const char * name;
+    size_t items; /// items processed per repetition
+    double min_ns;
+    double median_ns;
+} BenchResult;
+
+typedef double (*BenchFunction)(size_t items, void * context); /// runs once, returns elapsed ns
+
+static volatile uint64_t sink; /// keeps the compiler from removing the benchmarked work
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1E9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void * a, const void * b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static BenchResult run_benchmark(const char * name, BenchFunction function, size_t items, int repetitions, void * context) {
+    double * times = (double *)malloc(repetitions * sizeof(double));
+    BenchResult result = {name, items, 0.0, 0.0};
+
+    function(items, context); // warm up caches and the page cache
+    for (int i = 0; i < repetitions; ++i) {
+        times[i] = function(items, context) / (double)items;
+    }
+    qsort(times, repetitions, sizeof(double), compare_double);
+    result.min_ns = times[0];
+    result.median_ns = times[repetitions / 2];
+    free(times);
+    return result;
+}
+
+//-----------------------------------------------------------------
+// Benchmark Definitions
+//-----------------------------------------------------------------
+
+static double bench_read_header(size_t items, void * context) {
+    FILE * fid = (FILE *)context;
+    LASHeader header;
+    uint64_t total = 0;
+
+    rewind(fid);
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        total += read_header(fid, &header);
+        total += header.number_of_point_records;
+    }
+    double elapsed = now_ns() - start;
+    sink = total;
+    return elapsed;
+}
+
+static double bench_read_entry_single(size_t items, void * context) {
+    FILE * fid = (FILE *)context;
+    LASEntry entry;
+    uint64_t total = 0;
+
+    rewind(fid);
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        total += read_entry(fid, &entry, 1);
+        total += (uint64_t)entry.x;
+    }
+    double elapsed = now_ns() - start;
+    sink = total;
+    return elapsed;
+}
+
+static double bench_read_entry_block(size_t items, void * context) {
+    FILE * fid = (FILE *)context;
+    LASEntry * entries = (LASEntry *)malloc(items * sizeof(LASEntry));
+    uint64_t total = 0;
+
+    rewind(fid);
+    double start = now_ns();
+    total += read_entry(fid, entries, items);
+    double elapsed = now_ns() - start;
+    total += (uint64_t)entries[items - 1].x;
+    sink = total;
+    free(entries);
+    return elapsed;
+}
+
+static double bench_initLASEntry(size_t items, void * context) {
+    uint64_t total = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        double position = (double)i * 1E-3;
+        LASEntry entry = initLASEntry(FIRST_UTC_TIME + i, position, position + 1.0, position + 2.0, (uint16_t)i, (uint8_t)i);
+        total += (uint64_t)entry.z;
+    }
+    double elapsed = now_ns() - start;
+    sink = total;
+    return elapsed;
+}
+
+static double bench_UTCTimeusToAdjustedGPSTime(size_t items, void * context) {
+    double total = 0.0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        total += UTCTimeusToAdjustedGPSTime(FIRST_UTC_TIME + i * 997);
+    }
+    double elapsed = now_ns() - start;
+    sink = (uint64_t)total;
+    return elapsed;
+}
+
+static double bench_UTCTimeusToAdjustedGPSTimeus(size_t items, void * context) {
+    uint64_t total = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        total += UTCTimeusToAdjustedGPSTimeus(FIRST_UTC_TIME + i * 997);
+    }
+    double elapsed = now_ns() - start;
+    sink = total;
+    return elapsed;
+}
+
+static double bench_AdjustedGPSTimeusToUTCTimeus(size_t items, void * context) {
+    uint64_t first = UTCTimeusToAdjustedGPSTimeus(FIRST_UTC_TIME);
+    uint64_t total = 0;
+
+    double start = now_ns();
+    for (size_t i = 0; i < items; ++i) {
+        total += AdjustedGPSTimeusToUTCTimeus(first + i * 997);
+    }
+    double elapsed = now_ns() - start;
+    sink = total;
+    return elapsed;
+}
+
+static double bench_find_las_signature(size_t items, void * context) {
+    const uint8_t * garbage = (const uint8_t *)context;
+
+    double start = now_ns();
+    size_t found = find_las_signature(garbage, items);
+    double elapsed = now_ns() - start;
+    sink = found;
+    return elapsed;
+}
+
+static double bench_reduce_entries(size_t items, void * context) {
+    const LASEntry * entries = (const LASEntry *)context;
+    uint32_t intensity_histogram[16] = {0};
+    uint32_t quality_histogram[16] = {0};
+    LASEntryReduction reduction;
+
+    double start = now_ns();
+    reduce_entries(entries, items, 12, 4, intensity_histogram, quality_histogram, &reduction);
+    double elapsed = now_ns() - start;
+    sink = (uint64_t)reduction.sum_z + intensity_histogram[0];
+    return elapsed;
+}
+
+//-----------------------------------------------------------------
+// Fixture Definitions
+//-----------------------------------------------------------------
+
+static FILE * headers_file(size_t items) {
+    FILE * fid = tmpfile();
+    if (fid == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < items; ++i) {
+        LASHeader header;
+        fillLASHeader(&header, FIRST_UTC_TIME + i * 1000, 0);
+        if (write_header(fid, &header) != 1) {
+            fclose(fid);
+            return NULL;
+        }
+    }
+    return fid;
+}
+
+static FILE * entries_file(size_t items) {
+    FILE * fid = tmpfile();
+    if (fid == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < items; ++i) {
+        double position = (double)i * 1E-3;
+        LASEntry entry = initLASEntry(FIRST_UTC_TIME + i, position, position, position, (uint16_t)i, (uint8_t)i);
+        if (write_entries(fid, &entry, 1) != 1) {
+            fclose(fid);
+            return NULL;
+        }
+    }
+    return fid;
+}
+
+static LASEntry * entries_block(size_t items) {
+    LASEntry * entries = (LASEntry *)malloc(items * sizeof(LASEntry));
+    if (entries == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < items; ++i) {
+        double position = (double)i * 1E-3;
+        entries[i] = initLASEntry(FIRST_UTC_TIME + i, position, position, position, (uint16_t)i, (uint8_t)i);
+    }
+    return entries;
+}
+
+static uint8_t * garbage_block(size_t items) {
+    uint8_t * garbage = (uint8_t *)malloc(items);
+    uint32_t state = 2020;
+    if (garbage == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < items; ++i) {
+        state = state * 1664525u + 1013904223u;
+        garbage[i] = (i & 1) ? 'L' : (uint8_t)(state >> 24); // many false starts, no signature
+        if (garbage[i] == 'A') {
+            garbage[i] = 'B';
+        }
+    }
+    return garbage;
+}
+
+static void print_result(const BenchResult * result, int last) {
+    printf("    {\"name\": \"%s\", \"items\": %zu, \"ns_per_item_min\": %.3f, \"ns_per_item_median\": %.3f, "
+           "\"items_per_second\": %.0f}%s\n",
+           result->name, result->items, result->min_ns, result->median_ns,
+           result->min_ns > 0.0 ? 1E9 / result->min_ns : 0.0, last ? "" : ",");
+}
+
+int main(int argc, char ** argv) {
+    size_t items = DEFAULT_ITEMS;
+    int repetitions = DEFAULT_REPETITIONS;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            items = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--items N] [--repetitions N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (items == 0 || repetitions <= 0) {
+        fprintf(stderr, "--items and --repetitions must be positive.\n");
+        return 2;
+    }
+
+    FILE * headers = headers_file(items);
+    FILE * entries = entries_file(items);
+    uint8_t * garbage = garbage_block(items * ENTRY_SIZE);
+    LASEntry * records = entries_block(items);
+    if (headers == NULL || entries == NULL || garbage == NULL || records == NULL) {
+        fprintf(stderr, "Failed to create the benchmark files.\n");
+        return 1;
+    }
+
+    BenchResult results[] = {
+        run_benchmark("read_header", bench_read_header, items, repetitions, headers),
+        run_benchmark("read_entry_single", bench_read_entry_single, items, repetitions, entries),
+        run_benchmark("read_entry_block", bench_read_entry_block, items, repetitions, entries),
+        run_benchmark("initLASEntry", bench_initLASEntry, items, repetitions, NULL),
+        run_benchmark("UTCTimeusToAdjustedGPSTime", bench_UTCTimeusToAdjustedGPSTime, items, repetitions, NULL),
+        run_benchmark("UTCTimeusToAdjustedGPSTimeus", bench_UTCTimeusToAdjustedGPSTimeus, items, repetitions, NULL),
+        run_benchmark("AdjustedGPSTimeusToUTCTimeus", bench_AdjustedGPSTimeusToUTCTimeus, items, repetitions, NULL),
+        run_benchmark("find_las_signature_per_byte", bench_find_las_signature, items * ENTRY_SIZE, repetitions, garbage),
+        run_benchmark("reduce_entries", bench_reduce_entries, items, repetitions, records),
+    };
+    size_t number_of_results = sizeof(results) / sizeof(results[0]);
+
+    printf("{\n  \"suite\": \"c_micro\",\n  \"timestamp\": %lld,\n  \"repetitions\": %d,\n  \"results\": [\n",
+           (long long)time(NULL), repetitions);
+    for (size_t i = 0; i < number_of_results; ++i) {
+        print_result(&results[i], i + 1 == number_of_results);
+    }
+    printf("  ]\n}\n");
+
+    fclose(headers);
+    fclose(entries);
+    free(garbage);
+    free(records);
+    return 0;
+}
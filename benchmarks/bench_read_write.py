@@ -0,0 +1,144 @@
+"""Read and write throughput of the las_2g module on a survey, printed as JSON.
+
+Every case runs in its own interpreter so its peak RSS is not inflated by the others.
+
+    python3 bench_read_write.py survey.las --output throughput.json
+    python3 bench_read_write.py survey.las --baseline old.json
+"""
+import argparse
+import json
+import os
+import platform
+import resource
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+import las_2g
+
+CASES = ["read_las", "read_las_columns", "iter_las", "write_las", "write_las_columns"]
+
+
+def peak_rss_mb():
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    return peak / (1 << 20) if sys.platform == "darwin" else peak / (1 << 10)
+
+
+def prepare(case, filename):
+    """Untimed set up of a case, returns (operation, points, profiles)."""
+    output = tempfile.NamedTemporaryFile(suffix=".las", delete=False).name
+
+    if case == "read_las":
+        def operation():
+            return las_2g.read_las(filename)
+    elif case == "read_las_columns":
+        def operation():
+            return las_2g.read_las_columns(filename)
+    elif case == "iter_las":
+        def operation():
+            for _ in las_2g.iter_las(filename):
+                pass
+    elif case == "write_las":
+        data = las_2g.read_las(filename)
+
+        def operation():
+            las_2g.write_las(output, data)
+    elif case == "write_las_columns":
+        c = las_2g.read_las_columns(filename)
+
+        def operation():
+            las_2g.write_las_columns(output, c.x, c.y, c.z, c.intensity, c.quality, c.utc_time,
+                                     offsets=c.offsets, profile_time=c.profile_time)
+    else:
+        raise ValueError("unknown case " + case)
+
+    columns = las_2g.read_las_columns(filename, fields=[])
+    return operation, output, columns.number_of_points, columns.number_of_profiles
+
+
+def run_case(case, filename, repeat):
+    baseline_rss = peak_rss_mb()
+    operation, output, points, profiles = prepare(case, filename)
+    times = []
+    try:
+        for _ in range(repeat):
+            start = time.perf_counter()
+            operation()
+            times.append(time.perf_counter() - start)
+    finally:
+        os.remove(output)
+
+    best = min(times)
+    size = os.path.getsize(filename)
+    return {"case": case,
+            "points": points,
+            "profiles": profiles,
+            "seconds_min": best,
+            "seconds_median": statistics.median(times),
+            "mb_per_second": size / best / 1e6,
+            "ns_per_point": best * 1e9 / points if points else 0.0,
+            "baseline_rss_mb": baseline_rss,
+            "peak_rss_mb": peak_rss_mb()}
+
+
+def compare(results, baseline_filename):
+    with open(baseline_filename) as fid:
+        baseline = {r["case"]: r for r in json.load(fid)["results"]}
+    for result in results:
+        old = baseline.get(result["case"])
+        if old and old["ns_per_point"] > 0:
+            change = 100.0 * (result["ns_per_point"] / old["ns_per_point"] - 1.0)
+            print("%-20s %8.1f ns/point  %+6.1f%%  peak %.0f MB (was %.0f MB)"
+                  % (result["case"], result["ns_per_point"], change, result["peak_rss_mb"], old["peak_rss_mb"]),
+                  file=sys.stderr)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("survey")
+    parser.add_argument("--cases", default=",".join(CASES), help="comma separated subset of " + ", ".join(CASES))
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--output", help="write the results to this file as well as stdout")
+    parser.add_argument("--baseline", help="results of an earlier run to compare with")
+    parser.add_argument("--case", help=argparse.SUPPRESS)  # worker mode, runs one case
+    args = parser.parse_args(argv)
+
+    if args.case:
+        print(json.dumps(run_case(args.case, args.survey, args.repeat)))
+        return
+
+    cases = [case for case in args.cases.split(",") if case]
+    for case in cases:
+        if case not in CASES:
+            parser.error("unknown case " + case)
+
+    results = []
+    for case in cases:
+        worker = subprocess.run([sys.executable, os.path.abspath(__file__), args.survey,
+                                 "--case", case, "--repeat", str(args.repeat)],
+                                stdout=subprocess.PIPE, check=True)
+        results.append(json.loads(worker.stdout))
+
+    report = {"suite": "throughput",
+              "timestamp": int(time.time()),
+              "python": platform.python_version(),
+              "platform": platform.platform(),
+              "cpu_count": os.cpu_count(),
+              "survey": os.path.abspath(args.survey),
+              "survey_bytes": os.path.getsize(args.survey),
+              "repeat": args.repeat,
+              "results": results}
+    text = json.dumps(report, indent=2)
+    print(text)
+    if args.output:
+        with open(args.output, "w") as fid:
+            fid.write(text + "\n")
+    if args.baseline:
+        compare(results, args.baseline)
+
+
+if __name__ == "__main__":
+    main()
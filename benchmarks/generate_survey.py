@@ -0,0 +1,103 @@
+"""Generate a synthetic 2G survey: concatenated LAS profiles of a seabed scanned along track.
+
+    python3 generate_survey.py survey.las --size 2G
+    python3 generate_survey.py survey.las --profiles 10000 --points 2048 --profile-spacing 50000
+"""
+import argparse
+import array
+import math
+import os
+import random
+import sys
+
+import las_2g
+
+HEADER_SIZE = 227
+ENTRY_SIZE = 28
+FIRST_UTC_TIME = 1585756253000000  # 2020-04-01, in us
+CHUNK_POINTS = 1 << 22  # points written per call to write_las_columns
+TEMPLATES = 16  # distinct across track shapes, reused so generation stays fast
+
+
+def parse_size(text):
+    units = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30, "T": 1 << 40}
+    text = text.strip().upper().rstrip("B")
+    if text and text[-1] in units:
+        return int(float(text[:-1]) * units[text[-1]])
+    return int(text)
+
+
+def profile_templates(points, swath, seed):
+    """Across track x, depth z, intensity and quality of a few noisy profiles."""
+    rng = random.Random(seed)
+    templates = []
+    for t in range(TEMPLATES):
+        step = swath / max(points - 1, 1)
+        x = array.array("d", [-swath / 2 + i * step for i in range(points)])
+        z = array.array("d", [-20.0 + 0.5 * math.sin(0.3 * t + 6.0 * i / points) + rng.gauss(0, 0.005)
+                              for i in range(points)])
+        intensity = array.array("H", [min(65535, max(0, int(rng.gauss(2000, 300)))) for _ in range(points)])
+        quality = array.array("B", [rng.choice((1, 2, 2, 3, 3, 3)) for _ in range(points)])
+        templates.append((x, z, intensity, quality))
+    return templates
+
+
+def generate(filename, profiles, points, profile_spacing, point_spacing, speed, swath, seed):
+    templates = profile_templates(points, swath, seed)
+    profiles_per_chunk = max(1, CHUNK_POINTS // points)
+    part = filename + ".part"
+
+    with open(filename, "wb") as out:
+        for first in range(0, profiles, profiles_per_chunk):
+            count = min(profiles_per_chunk, profiles - first)
+            x, y, z = array.array("d"), array.array("d"), array.array("d")
+            intensity, quality, utc_time = array.array("H"), array.array("B"), array.array("Q")
+            for p in range(first, first + count):
+                template = templates[p % TEMPLATES]
+                start = FIRST_UTC_TIME + p * profile_spacing
+                x.extend(template[0])
+                y.extend(array.array("d", [p * speed * profile_spacing * 1e-6]) * points)
+                z.extend(template[1])
+                intensity.extend(template[2])
+                quality.extend(template[3])
+                utc_time.extend(array.array("Q", range(start, start + points * point_spacing, point_spacing)))
+
+            las_2g.write_las_columns(part, x, y, z, intensity, quality, utc_time,
+                                     counts=array.array("I", [points]) * count)
+            with open(part, "rb") as fid:
+                while True:
+                    block = fid.read(1 << 24)
+                    if not block:
+                        break
+                    out.write(block)
+    os.remove(part)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output")
+    parser.add_argument("--size", help="approximate file size, e.g. 512M or 2G; overrides --profiles")
+    parser.add_argument("--profiles", type=int, default=1000)
+    parser.add_argument("--points", type=int, default=2048, help="points per profile")
+    parser.add_argument("--profile-spacing", type=int, default=50000, help="time between profiles in us")
+    parser.add_argument("--point-spacing", type=int, default=1, help="time between points of a profile in us")
+    parser.add_argument("--speed", type=float, default=1.5, help="along track speed in m/s")
+    parser.add_argument("--swath", type=float, default=10.0, help="across track width in m")
+    parser.add_argument("--seed", type=int, default=2020)
+    args = parser.parse_args(argv)
+
+    if args.points <= 0 or args.profiles < 0 or args.point_spacing <= 0 or args.profile_spacing < 0:
+        parser.error("--points and --point-spacing must be positive, --profiles and --profile-spacing not negative.")
+    profiles = args.profiles
+    if args.size:
+        profiles = max(1, parse_size(args.size) // (HEADER_SIZE + args.points * ENTRY_SIZE))
+
+    generate(args.output, profiles, args.points, args.profile_spacing, args.point_spacing,
+             args.speed, args.swath, args.seed)
+    size = os.path.getsize(args.output)
+    print("%s: %d profiles of %d points, %.1f MB" % (args.output, profiles, args.points, size / 1e6),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
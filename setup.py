@@ -4,30 +4,60 @@ from sys import platform
 with open("README.md", "r") as fh:
     long_description = fh.read()
 
+sources = ["src/las_2g_python_module.c",
+           "src/las_2g_aggregate_module.c",
+           "src/las_2g_arrow_module.c",
+           "src/las_2g_async_module.c",
+           "src/las_2g_columns_module.c",
+           "src/las_2g_compress_module.c",
+           "src/las_2g_copy_module.c",
+           "src/las_2g_dataset_module.c",
+           "src/las_2g_entries_module.c",
+           "src/las_2g_grid_module.c",
+           "src/las_2g_iter_module.c",
+           "src/las_2g_scan_module.c",
+           "src/las_2g_shared_module.c",
+           "src/las_2g_stats_module.c",
+           "src/las_2g_writer_module.c",
+           "src/las_2g_python.c",
+           "src/las_2g_aggregate.c",
+           "src/las_2g_compress.c",
+           "src/las_2g_copy.c",
+           "src/las_2g_grid.c",
+           "src/las_2g_index.c",
+           "src/las_2g_scan.c",
+           "src/las_2g_shared.c",
+           "src/las_2g_simd.c",
+           "src/las_2g_stats.c",
+           "src/las_2g_thread.c",
+           "src/las_2g_writer.c"]
+
 if "linux" in platform:
     extension_mod = setuptools.Extension(
         "las_2g.las_2g_python",
-        ["src/las_2g_python_module.c", "src/las_2g_python.c"],
-        extra_compile_args=["-D_CRT_SECURE_NO_WARNINGS"]
+        sources,
+        extra_compile_args=["-D_CRT_SECURE_NO_WARNINGS"],
+        libraries=["rt"] # shm_open before glibc 2.34
     )
 
     debug_extension_mod = setuptools.Extension(
         "las_2g.las_2g_python",
-        ["src/las_2g_python_module.c", "src/las_2g_python.c"],
+        sources,
         extra_compile_args=["-D_CRT_SECURE_NO_WARNINGS",
                             "-O0", "-g", "-DDEBUG", "-fno-inline"],
-        extra_link_args=['-DEBUG']
+        extra_link_args=['-DEBUG'],
+        libraries=["rt"]
     )
 elif "win" in platform:
     extension_mod = setuptools.Extension(
         "las_2g.las_2g_python",
-        ["src/las_2g_python_module.c", "src/las_2g_python.c"],
+        sources,
         extra_compile_args=["-D_CRT_SECURE_NO_WARNINGS"]
     )
 
     debug_extension_mod = setuptools.Extension(
         "las_2g.las_2g_python",
-        ["src/las_2g_python_module.c", "src/las_2g_python.c"],
+        sources,
         extra_compile_args=["/D_CRT_SECURE_NO_WARNINGS /Zi /0d"],
         extra_link_args=['/DEBUG']
     )
@@ -0,0 +1,170 @@
+/**
+ * @file las_2g_aggregate.c
+ * @author Ryan Wicks
+ * @brief Per profile and whole survey statistics computed from the raw point records.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_aggregate.h"
+#include "las_2g_simd.h"
+#include "las_2g_stats.h"
+#include "las_2g_thread.h"
+#include <math.h>
+#include <string.h>
+
+void reduce_entries(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                    uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    uint64_t start = las_stats_clock();
+    switch (las_simd_level()) {
+        case LAS_SIMD_AVX2:
+            reduce_entries_avx2(entries, number_of_entries, intensity_shift, quality_shift,
+                                intensity_histogram, quality_histogram, reduction);
+            break;
+        case LAS_SIMD_SSE41:
+            reduce_entries_sse41(entries, number_of_entries, intensity_shift, quality_shift,
+                                 intensity_histogram, quality_histogram, reduction);
+            break;
+        default:
+            reduce_entries_scalar(entries, number_of_entries, intensity_shift, quality_shift,
+                                  intensity_histogram, quality_histogram, reduction);
+            break;
+    }
+    las_stats_phase(LAS_PHASE_DECODE, start);
+}
+
+void reduce_entries_scalar(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                           uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    int32_t min_z = INT32_MAX;
+    int32_t max_z = INT32_MIN;
+    int64_t sum_z = 0;
+    double min_gps_time = HUGE_VAL;
+    double max_gps_time = -HUGE_VAL;
+
+    // written as the vector min and max instructions behave, so NaN times are skipped alike.
+    for (size_t point = 0; point < number_of_entries; ++point) {
+        int32_t z = entries[point].z;
+        double gps_time = entries[point].gps_time;
+        min_z = z < min_z ? z : min_z;
+        max_z = z > max_z ? z : max_z;
+        sum_z += z;
+        min_gps_time = gps_time < min_gps_time ? gps_time : min_gps_time;
+        max_gps_time = gps_time > max_gps_time ? gps_time : max_gps_time;
+        intensity_histogram[entries[point].intensity >> intensity_shift] += 1;
+        quality_histogram[entries[point].user_data >> quality_shift] += 1;
+    }
+
+    reduction->min_z = min_z;
+    reduction->max_z = max_z;
+    reduction->sum_z = sum_z;
+    reduction->min_gps_time = min_gps_time;
+    reduction->max_gps_time = max_gps_time;
+}
+
+static unsigned bin_shift(unsigned bins, unsigned bits) {
+    unsigned shift = bits;
+    while (bins > 1) {
+        bins >>= 1;
+        shift -= 1;
+    }
+    return shift;
+}
+
+typedef struct {
+    const uint8_t * data;
+    const LASProfileTable * table;
+    const LASProfileStatsArrays * stats;
+    unsigned intensity_shift;
+    unsigned quality_shift;
+} ProfileStatsRun;
+
+static void profile_stats_item(void * context, size_t profile) {
+    ProfileStatsRun * run = (ProfileStatsRun *)context;
+    const LASProfileStatsArrays * stats = run->stats;
+    const uint8_t * record = run->data + run->table->offsets[profile];
+    uint32_t number_of_entries = run->table->point_counts[profile];
+    uint32_t * intensity_histogram = stats->intensity_histogram + profile * stats->intensity_bins;
+    uint32_t * quality_histogram = stats->quality_histogram + profile * stats->quality_bins;
+    LASEntryReduction reduction;
+    LASHeader header;
+
+    memcpy(&header, record, sizeof(LASHeader));
+    memset(intensity_histogram, 0, stats->intensity_bins * sizeof(uint32_t));
+    memset(quality_histogram, 0, stats->quality_bins * sizeof(uint32_t));
+    reduce_entries((const LASEntry *)(record + sizeof(LASHeader)), number_of_entries, run->intensity_shift, run->quality_shift,
+                   intensity_histogram, quality_histogram, &reduction);
+
+    stats->points[profile] = number_of_entries;
+    if (number_of_entries == 0) {
+        stats->min_z[profile] = stats->max_z[profile] = stats->mean_z[profile] = NAN;
+    } else {
+        // z is decoded as z_scale_factor * z, so the raw extremes give the decoded ones.
+        double low = header.z_scale_factor * (double)reduction.min_z;
+        double high = header.z_scale_factor * (double)reduction.max_z;
+        stats->min_z[profile] = low < high ? low : high;
+        stats->max_z[profile] = low < high ? high : low;
+        stats->mean_z[profile] = header.z_scale_factor * (double)reduction.sum_z / (double)number_of_entries;
+    }
+    if (reduction.min_gps_time <= reduction.max_gps_time) {
+        stats->start_time[profile] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(reduction.min_gps_time*1E6));
+        stats->end_time[profile] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(reduction.max_gps_time*1E6));
+    } else {
+        stats->start_time[profile] = stats->end_time[profile] = 0;
+    }
+
+    las_stats_add(LAS_COUNTER_BYTES_READ, sizeof(LASHeader) + (uint64_t)number_of_entries * sizeof(LASEntry));
+    las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+    las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+}
+
+void profile_stats_mapped(const uint8_t * data, const LASProfileTable * table, const LASProfileStatsArrays * stats, int threads) {
+    ProfileStatsRun run;
+    run.data = data;
+    run.table = table;
+    run.stats = stats;
+    run.intensity_shift = bin_shift(stats->intensity_bins, 16);
+    run.quality_shift = bin_shift(stats->quality_bins, 8);
+    las_parallel_for(table->number_of_profiles, threads, profile_stats_item, &run);
+}
+
+void summarise_profile_stats(const LASProfileStatsArrays * stats, size_t number_of_profiles, LASSurveyStats * survey) {
+    double sum_z = 0.0;
+
+    survey->points = 0;
+    survey->min_z = survey->max_z = NAN;
+    survey->start_time = survey->end_time = 0;
+    memset(survey->intensity_histogram, 0, stats->intensity_bins * sizeof(uint64_t));
+    memset(survey->quality_histogram, 0, stats->quality_bins * sizeof(uint64_t));
+
+    for (size_t profile = 0; profile < number_of_profiles; ++profile) {
+        uint32_t points = stats->points[profile];
+        for (unsigned bin = 0; bin < stats->intensity_bins; ++bin) {
+            survey->intensity_histogram[bin] += stats->intensity_histogram[profile * stats->intensity_bins + bin];
+        }
+        for (unsigned bin = 0; bin < stats->quality_bins; ++bin) {
+            survey->quality_histogram[bin] += stats->quality_histogram[profile * stats->quality_bins + bin];
+        }
+        if (points == 0) {
+            continue;
+        }
+
+        if (survey->points == 0 || stats->min_z[profile] < survey->min_z) {
+            survey->min_z = stats->min_z[profile];
+        }
+        if (survey->points == 0 || stats->max_z[profile] > survey->max_z) {
+            survey->max_z = stats->max_z[profile];
+        }
+        if (stats->start_time[profile] != 0 && (survey->start_time == 0 || stats->start_time[profile] < survey->start_time)) {
+            survey->start_time = stats->start_time[profile];
+        }
+        if (stats->end_time[profile] > survey->end_time) {
+            survey->end_time = stats->end_time[profile];
+        }
+        sum_z += stats->mean_z[profile] * (double)points;
+        survey->points += points;
+    }
+    survey->mean_z = survey->points > 0 ? sum_z / (double)survey->points : NAN;
+}
@@ -0,0 +1,99 @@
+#ifndef LAS_2G_AGGREGATE_H
+#define LAS_2G_AGGREGATE_H
+
+/**
+ * @brief Per profile and whole survey reductions computed straight from the raw point
+ * records: point count, z range and mean, time span, and intensity and quality histograms.
+ * Every record is read once, by a vectorised kernel picked at run time, and the profiles
+ * are shared between threads.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define AGGREGATE_MAX_INTENSITY_BINS 65536 // one bin per intensity value
+#define AGGREGATE_MAX_QUALITY_BINS 256 // one bin per quality value
+
+/**
+ * @brief Reductions over the raw records of one profile, before scaling.
+ *
+ */
+typedef struct {
+    int32_t min_z;
+    int32_t max_z;
+    int64_t sum_z;
+    double min_gps_time; /// +inf when there are no records with a time
+    double max_gps_time; /// -inf when there are no records with a time
+} LASEntryReduction;
+
+/**
+ * @brief Destination arrays of profile_stats_mapped, one element per profile and one
+ * histogram row per profile.
+ *
+ */
+typedef struct {
+    uint32_t * points;
+    double * min_z; /// NaN for an empty profile
+    double * max_z;
+    double * mean_z;
+    uint64_t * start_time; /// utc time in us from the Unix epoch, 0 for an empty profile
+    uint64_t * end_time;
+    uint32_t * intensity_histogram; /// intensity_bins counts per profile
+    uint32_t * quality_histogram; /// quality_bins counts per profile
+    unsigned intensity_bins; /// power of two, at most AGGREGATE_MAX_INTENSITY_BINS
+    unsigned quality_bins; /// power of two, at most AGGREGATE_MAX_QUALITY_BINS
+} LASProfileStatsArrays;
+
+/**
+ * @brief The reductions of every profile of a survey combined.
+ *
+ */
+typedef struct {
+    uint64_t points;
+    double min_z; /// NaN for a survey without points
+    double max_z;
+    double mean_z;
+    uint64_t start_time; /// 0 for a survey without points
+    uint64_t end_time;
+    uint64_t * intensity_histogram; /// intensity_bins counts, supplied by the caller
+    uint64_t * quality_histogram; /// quality_bins counts, supplied by the caller
+} LASSurveyStats;
+
+/**
+ * @brief Reduce the records of a profile, adding every record to the histograms.
+ *
+ * @param entries
+ * @param number_of_entries
+ * @param intensity_shift a record goes in intensity bin intensity >> intensity_shift
+ * @param quality_shift a record goes in quality bin user_data >> quality_shift
+ * @param intensity_histogram counts added to
+ * @param quality_histogram counts added to
+ * @param reduction
+ */
+void reduce_entries(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                    uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction);
+
+void reduce_entries_scalar(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                           uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction);
+
+/**
+ * @brief Compute the statistics of every profile of a memory mapped survey with
+ * las_parallel_for, one profile per work item.
+ *
+ * @param data start of the mapping
+ * @param table result of scan_profiles_mapped on data
+ * @param stats arrays sized for table->number_of_profiles profiles
+ * @param threads number of workers, 0 for las_cpu_count()
+ */
+void profile_stats_mapped(const uint8_t * data, const LASProfileTable * table, const LASProfileStatsArrays * stats, int threads);
+
+/**
+ * @brief Combine the statistics of every profile.
+ *
+ * @param stats filled by profile_stats_mapped
+ * @param number_of_profiles
+ * @param survey filled, with its histograms summed over the profiles
+ */
+void summarise_profile_stats(const LASProfileStatsArrays * stats, size_t number_of_profiles, LASSurveyStats * survey);
+
+#endif
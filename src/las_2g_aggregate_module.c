@@ -0,0 +1,216 @@
+/**
+ * @file las_2g_aggregate_module.c
+ * @author Ryan Wicks
+ * @brief Python access to the per profile and whole survey statistics.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_aggregate.h"
+
+//-----------------------------------------------------------------
+// Profile Stats Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Check a number of histogram bins is a power of two no larger than maximum.
+ */
+static int LASProfileStats_CheckBins(long bins, long maximum, const char * name) {
+    if (bins < 1 || bins > maximum || (bins & (bins - 1)) != 0) {
+        PyErr_Format(PyExc_ValueError, "%s must be a power of two from 1 to %ld.", name, maximum);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Convert survey histogram counts to a list of ints.
+ */
+static PyObject * LASProfileStats_HistogramList(const uint64_t * counts, unsigned bins) {
+    PyObject * list = PyList_New(bins);
+    for (unsigned bin = 0; list && bin < bins; ++bin) {
+        PyObject * count = PyLong_FromUnsignedLongLong(counts[bin]);
+        if (!count) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, bin, count);
+    }
+    return list;
+}
+
+/**
+ * @brief Combine the profile statistics into the "survey" dictionary.
+ */
+static PyObject * LASProfileStats_Survey(const LASProfileStatsArrays * stats, size_t number_of_profiles) {
+    LASSurveyStats survey;
+    survey.intensity_histogram = (uint64_t *)malloc(stats->intensity_bins * sizeof(uint64_t));
+    survey.quality_histogram = (uint64_t *)malloc(stats->quality_bins * sizeof(uint64_t));
+    if (!survey.intensity_histogram || !survey.quality_histogram) {
+        free(survey.intensity_histogram);
+        free(survey.quality_histogram);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the histograms.");
+        return NULL;
+    }
+    summarise_profile_stats(stats, number_of_profiles, &survey);
+
+    PyObject * dict = NULL;
+    PyObject * intensity_histogram = LASProfileStats_HistogramList(survey.intensity_histogram, stats->intensity_bins);
+    PyObject * quality_histogram = LASProfileStats_HistogramList(survey.quality_histogram, stats->quality_bins);
+    if (intensity_histogram && quality_histogram) {
+        dict = Py_BuildValue("{s:K,s:d,s:d,s:d,s:K,s:K,s:O,s:O}",
+                             "points", (unsigned long long)survey.points,
+                             "min_z", survey.min_z,
+                             "max_z", survey.max_z,
+                             "mean_z", survey.mean_z,
+                             "start_time", (unsigned long long)survey.start_time,
+                             "end_time", (unsigned long long)survey.end_time,
+                             "intensity_histogram", intensity_histogram,
+                             "quality_histogram", quality_histogram);
+    }
+    Py_XDECREF(intensity_histogram);
+    Py_XDECREF(quality_histogram);
+    free(survey.intensity_histogram);
+    free(survey.quality_histogram);
+    return dict;
+}
+
+/**
+ * @brief Compute the statistics of every profile of a table into new columns.
+ *
+ * @return PyObject* the profile_stats dictionary, or NULL with an exception set.
+ */
+static PyObject * LASProfileStats_Compute(const uint8_t * data, const LASProfileTable * table,
+                                          unsigned intensity_bins, unsigned quality_bins, int threads) {
+    Py_ssize_t number_of_profiles = (Py_ssize_t)table->number_of_profiles;
+    LASColumnPython * points = LASColumn_New('I', number_of_profiles);
+    LASColumnPython * min_z = LASColumn_New('d', number_of_profiles);
+    LASColumnPython * max_z = LASColumn_New('d', number_of_profiles);
+    LASColumnPython * mean_z = LASColumn_New('d', number_of_profiles);
+    LASColumnPython * start_time = LASColumn_New('Q', number_of_profiles);
+    LASColumnPython * end_time = LASColumn_New('Q', number_of_profiles);
+    LASColumnPython * intensity_histogram = LASColumn_New('I', number_of_profiles * (Py_ssize_t)intensity_bins);
+    LASColumnPython * quality_histogram = LASColumn_New('I', number_of_profiles * (Py_ssize_t)quality_bins);
+    PyObject * dict = NULL;
+
+    if (points && min_z && max_z && mean_z && start_time && end_time && intensity_histogram && quality_histogram) {
+        LASProfileStatsArrays stats;
+        stats.points = (uint32_t *)points->data;
+        stats.min_z = (double *)min_z->data;
+        stats.max_z = (double *)max_z->data;
+        stats.mean_z = (double *)mean_z->data;
+        stats.start_time = (uint64_t *)start_time->data;
+        stats.end_time = (uint64_t *)end_time->data;
+        stats.intensity_histogram = (uint32_t *)intensity_histogram->data;
+        stats.quality_histogram = (uint32_t *)quality_histogram->data;
+        stats.intensity_bins = intensity_bins;
+        stats.quality_bins = quality_bins;
+
+        Py_BEGIN_ALLOW_THREADS
+        profile_stats_mapped(data, table, &stats, threads);
+        Py_END_ALLOW_THREADS
+
+        PyObject * survey = LASProfileStats_Survey(&stats, table->number_of_profiles);
+        if (survey) {
+            dict = Py_BuildValue("{s:O,s:O,s:O,s:O,s:O,s:O,s:O,s:O,s:O}",
+                                 "points", points,
+                                 "min_z", min_z,
+                                 "max_z", max_z,
+                                 "mean_z", mean_z,
+                                 "start_time", start_time,
+                                 "end_time", end_time,
+                                 "intensity_histogram", intensity_histogram,
+                                 "quality_histogram", quality_histogram,
+                                 "survey", survey);
+            Py_DECREF(survey);
+        }
+    }
+
+    Py_XDECREF(points);
+    Py_XDECREF(min_z);
+    Py_XDECREF(max_z);
+    Py_XDECREF(mean_z);
+    Py_XDECREF(start_time);
+    Py_XDECREF(end_time);
+    Py_XDECREF(intensity_histogram);
+    Py_XDECREF(quality_histogram);
+    return dict;
+}
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * profile_stats_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"source", "intensity_bins", "quality_bins", "threads", NULL};
+    PyObject * source;
+    long intensity_bins = 16;
+    long quality_bins = 16;
+    int threads = 0;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|lli", keywords, &source, &intensity_bins, &quality_bins, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+    if (LASProfileStats_CheckBins(intensity_bins, AGGREGATE_MAX_INTENSITY_BINS, "intensity_bins") < 0 ||
+        LASProfileStats_CheckBins(quality_bins, AGGREGATE_MAX_QUALITY_BINS, "quality_bins") < 0) {
+        return NULL;
+    }
+
+    // an open dataset is reduced in place, without mapping the file again.
+    if (PyObject_TypeCheck(source, &LASDatasetPythonType)) {
+        LASDatasetPython * dataset = (LASDatasetPython *) source;
+        if (LASDataset_Acquire(dataset) < 0) {
+            return NULL;
+        }
+        PyObject * dict = LASProfileStats_Compute(dataset->mapped.data, &dataset->table,
+                                                  (unsigned)intensity_bins, (unsigned)quality_bins, threads);
+        LASDataset_Release(dataset);
+        return dict;
+    }
+
+    PyObject * encoded = NULL;
+    if (!PyUnicode_FSConverter(source, &encoded)) {
+        return NULL;
+    }
+    const char * filename = PyBytes_AS_STRING(encoded);
+
+    LASMappedFile mapped;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, &mapped);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(encoded);
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return NULL;
+    }
+
+    LASProfileTable table;
+    Py_BEGIN_ALLOW_THREADS
+    ret = scan_profiles_mapped(mapped.data, mapped.size, &table);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+        unmap_file(&mapped);
+        return NULL;
+    }
+
+    PyObject * dict = LASProfileStats_Compute(mapped.data, &table, (unsigned)intensity_bins, (unsigned)quality_bins, threads);
+    free_profile_table(&table);
+    unmap_file(&mapped);
+    return dict;
+}
+
+PyObject * profile_stats_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "profile_stats", profile_stats_call(self, args, kwargs));
+}
@@ -0,0 +1,421 @@
+/**
+ * @file las_2g_arrow_module.c
+ * @author Ryan Wicks
+ * @brief Export of LASColumns through the Arrow C data and C stream interfaces.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_arrow.h"
+#include <errno.h>
+#include <string.h>
+
+#define ARROW_MAX_FIELDS 7
+
+/**
+ * @brief One exported column.
+ *
+ */
+typedef struct {
+    const char * name;
+    const char * format; /// Arrow format string
+    PyObject * column; /// borrowed LASColumnPython
+} ArrowField;
+
+/**
+ * @brief Storage behind an exported struct schema.
+ *
+ */
+typedef struct {
+    struct ArrowSchema * children[ARROW_MAX_FIELDS];
+    struct ArrowSchema child_schemas[ARROW_MAX_FIELDS];
+} ArrowSchemaPrivate;
+
+/**
+ * @brief Storage behind one exported column array, it keeps the column alive.
+ *
+ */
+typedef struct {
+    PyObject * column;
+    const void * buffers[2]; /// validity (none) and values
+} ArrowChildPrivate;
+
+/**
+ * @brief Storage behind an exported struct array.
+ *
+ */
+typedef struct {
+    struct ArrowArray * children[ARROW_MAX_FIELDS];
+    struct ArrowArray child_arrays[ARROW_MAX_FIELDS];
+    const void * buffers[1]; /// validity (none)
+} ArrowArrayPrivate;
+
+/**
+ * @brief Position of a stream in the profiles of its columns.
+ *
+ */
+typedef struct {
+    LASColumnsPython * columns;
+    Py_ssize_t next_profile;
+    const char * error; /// message of the last failed call, NULL if none failed
+} ArrowStreamPrivate;
+
+//-----------------------------------------------------------------
+// Export Definitions
+//-----------------------------------------------------------------
+
+static int collect_fields(LASColumnsPython * self, ArrowField * fields) {
+    const ArrowField point_fields[] = {
+        {"x", "g", self->x},
+        {"y", "g", self->y},
+        {"z", "g", self->z},
+        {"intensity", "S", self->intensity},
+        {"quality", "C", self->quality},
+        {"utc_time", "tsu:UTC", self->utc_time},
+    };
+    int number_of_fields = 0;
+
+    for (size_t i = 0; i < sizeof(point_fields) / sizeof(point_fields[0]); ++i) {
+        if (point_fields[i].column != Py_None) {
+            fields[number_of_fields++] = point_fields[i];
+        }
+    }
+
+    // the columns keep the profile ids once built, so a borrowed reference is enough.
+    PyObject * profile_id = LASColumns_GetProfileId(self);
+    if (!profile_id) {
+        return -1;
+    }
+    Py_DECREF(profile_id);
+    fields[number_of_fields].name = "profile_id";
+    fields[number_of_fields].format = "I";
+    fields[number_of_fields].column = profile_id;
+    return number_of_fields + 1;
+}
+
+static void release_child_schema(struct ArrowSchema * schema) {
+    schema->release = NULL;
+}
+
+static void release_schema(struct ArrowSchema * schema) {
+    for (int64_t i = 0; i < schema->n_children; ++i) {
+        struct ArrowSchema * child = schema->children[i];
+        if (child->release != NULL) {
+            child->release(child);
+        }
+    }
+    free(schema->private_data);
+    schema->release = NULL;
+}
+
+static int export_schema(const ArrowField * fields, int number_of_fields, struct ArrowSchema * out) {
+    ArrowSchemaPrivate * private_data = (ArrowSchemaPrivate *)calloc(1, sizeof(ArrowSchemaPrivate));
+    if (!private_data) {
+        return -1;
+    }
+
+    for (int i = 0; i < number_of_fields; ++i) {
+        struct ArrowSchema * child = &private_data->child_schemas[i];
+        child->format = fields[i].format;
+        child->name = fields[i].name;
+        child->release = release_child_schema;
+        private_data->children[i] = child;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->format = "+s";
+    out->name = "";
+    out->n_children = number_of_fields;
+    out->children = private_data->children;
+    out->release = release_schema;
+    out->private_data = private_data;
+    return 0;
+}
+
+static void release_child_array(struct ArrowArray * array) {
+    ArrowChildPrivate * private_data = (ArrowChildPrivate *) array->private_data;
+
+    // consumers may release arrays from any thread.
+    PyGILState_STATE state = PyGILState_Ensure();
+    Py_DECREF(private_data->column);
+    PyGILState_Release(state);
+
+    free(private_data);
+    array->release = NULL;
+}
+
+static void release_array(struct ArrowArray * array) {
+    for (int64_t i = 0; i < array->n_children; ++i) {
+        struct ArrowArray * child = array->children[i];
+        if (child->release != NULL) {
+            child->release(child);
+        }
+    }
+    free(array->private_data);
+    array->release = NULL;
+}
+
+/**
+ * @brief Export a range of points as a struct array over the column storage. Needs the GIL.
+ *
+ * @param fields
+ * @param number_of_fields
+ * @param first index of the first point
+ * @param length number of points
+ * @param out
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+static int export_array(const ArrowField * fields, int number_of_fields, int64_t first, int64_t length, struct ArrowArray * out) {
+    ArrowArrayPrivate * private_data = (ArrowArrayPrivate *)calloc(1, sizeof(ArrowArrayPrivate));
+    if (!private_data) {
+        return -1;
+    }
+
+    // every child owns a reference to its column, so a consumer can keep one without the others.
+    for (int i = 0; i < number_of_fields; ++i) {
+        ArrowChildPrivate * child_data = (ArrowChildPrivate *)malloc(sizeof(ArrowChildPrivate));
+        if (!child_data) {
+            for (int j = 0; j < i; ++j) {
+                release_child_array(&private_data->child_arrays[j]);
+            }
+            free(private_data);
+            return -1;
+        }
+        child_data->column = fields[i].column;
+        Py_INCREF(child_data->column);
+        child_data->buffers[0] = NULL;
+        child_data->buffers[1] = ((LASColumnPython *) fields[i].column)->data;
+
+        struct ArrowArray * child = &private_data->child_arrays[i];
+        child->length = length;
+        child->offset = first;
+        child->n_buffers = 2;
+        child->buffers = child_data->buffers;
+        child->release = release_child_array;
+        child->private_data = child_data;
+        private_data->children[i] = child;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->length = length;
+    out->n_buffers = 1;
+    out->n_children = number_of_fields;
+    out->buffers = private_data->buffers;
+    out->children = private_data->children;
+    out->release = release_array;
+    out->private_data = private_data;
+    return 0;
+}
+
+//-----------------------------------------------------------------
+// Stream Definitions
+//-----------------------------------------------------------------
+
+static int stream_get_schema(struct ArrowArrayStream * stream, struct ArrowSchema * out) {
+    ArrowStreamPrivate * private_data = (ArrowStreamPrivate *) stream->private_data;
+    ArrowField fields[ARROW_MAX_FIELDS];
+    int ret = 0;
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    int number_of_fields = collect_fields(private_data->columns, fields);
+    if (number_of_fields < 0 || export_schema(fields, number_of_fields, out) < 0) {
+        PyErr_Clear();
+        private_data->error = "Failed to allocate memory for the schema.";
+        ret = ENOMEM;
+    }
+    PyGILState_Release(state);
+    return ret;
+}
+
+static int stream_get_next(struct ArrowArrayStream * stream, struct ArrowArray * out) {
+    ArrowStreamPrivate * private_data = (ArrowStreamPrivate *) stream->private_data;
+    LASColumnPython * offsets_column = (LASColumnPython *) private_data->columns->offsets;
+    const uint64_t * offsets = (const uint64_t *) offsets_column->data;
+    Py_ssize_t number_of_profiles = offsets_column->length - 1;
+    ArrowField fields[ARROW_MAX_FIELDS];
+    int ret = 0;
+
+    if (private_data->next_profile >= number_of_profiles) {
+        // end of stream
+        memset(out, 0, sizeof(*out));
+        return 0;
+    }
+
+    // whole profiles are grouped until the batch holds ARROW_BATCH_POINTS points.
+    Py_ssize_t first_profile = private_data->next_profile;
+    Py_ssize_t end_profile = first_profile + 1;
+    while (end_profile < number_of_profiles && offsets[end_profile] - offsets[first_profile] < ARROW_BATCH_POINTS) {
+        end_profile++;
+    }
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    int number_of_fields = collect_fields(private_data->columns, fields);
+    if (number_of_fields < 0 ||
+        export_array(fields, number_of_fields, (int64_t) offsets[first_profile],
+                     (int64_t)(offsets[end_profile] - offsets[first_profile]), out) < 0) {
+        PyErr_Clear();
+        private_data->error = "Failed to allocate memory for the record batch.";
+        ret = ENOMEM;
+    } else {
+        private_data->next_profile = end_profile;
+    }
+    PyGILState_Release(state);
+    return ret;
+}
+
+static const char * stream_get_last_error(struct ArrowArrayStream * stream) {
+    return ((ArrowStreamPrivate *) stream->private_data)->error;
+}
+
+static void stream_release(struct ArrowArrayStream * stream) {
+    ArrowStreamPrivate * private_data = (ArrowStreamPrivate *) stream->private_data;
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    Py_DECREF(private_data->columns);
+    PyGILState_Release(state);
+
+    free(private_data);
+    stream->release = NULL;
+}
+
+//-----------------------------------------------------------------
+// Capsule Definitions
+//-----------------------------------------------------------------
+
+static void schema_capsule_destructor(PyObject * capsule) {
+    struct ArrowSchema * schema = (struct ArrowSchema *) PyCapsule_GetPointer(capsule, "arrow_schema");
+    if (schema->release != NULL) {
+        schema->release(schema);
+    }
+    free(schema);
+}
+
+static void array_capsule_destructor(PyObject * capsule) {
+    struct ArrowArray * array = (struct ArrowArray *) PyCapsule_GetPointer(capsule, "arrow_array");
+    if (array->release != NULL) {
+        array->release(array);
+    }
+    free(array);
+}
+
+static void stream_capsule_destructor(PyObject * capsule) {
+    struct ArrowArrayStream * stream = (struct ArrowArrayStream *) PyCapsule_GetPointer(capsule, "arrow_array_stream");
+    if (stream->release != NULL) {
+        stream->release(stream);
+    }
+    free(stream);
+}
+
+static PyObject * schema_capsule(LASColumnsPython * self) {
+    ArrowField fields[ARROW_MAX_FIELDS];
+    int number_of_fields = collect_fields(self, fields);
+    if (number_of_fields < 0) {
+        return NULL;
+    }
+
+    struct ArrowSchema * schema = (struct ArrowSchema *)malloc(sizeof(struct ArrowSchema));
+    if (!schema || export_schema(fields, number_of_fields, schema) < 0) {
+        free(schema);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the schema.");
+        return NULL;
+    }
+
+    PyObject * capsule = PyCapsule_New(schema, "arrow_schema", schema_capsule_destructor);
+    if (!capsule) {
+        schema->release(schema);
+        free(schema);
+    }
+    return capsule;
+}
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+PyObject * LASColumns_ArrowSchema(LASColumnsPython * self, PyObject * unused) {
+    return schema_capsule(self);
+}
+
+PyObject * LASColumns_ArrowArray(LASColumnsPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"requested_schema", NULL};
+    PyObject * requested_schema = Py_None;
+
+    // the columns have a single layout, a requested schema is not negotiated.
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", keywords, &requested_schema)) {
+        return NULL;
+    }
+
+    PyObject * schema = schema_capsule(self);
+    if (!schema) {
+        return NULL;
+    }
+
+    ArrowField fields[ARROW_MAX_FIELDS];
+    int number_of_fields = collect_fields(self, fields);
+    if (number_of_fields < 0) {
+        Py_DECREF(schema);
+        return NULL;
+    }
+
+    LASColumnPython * offsets = (LASColumnPython *) self->offsets;
+    int64_t number_of_points = (int64_t)((uint64_t *) offsets->data)[offsets->length - 1];
+    struct ArrowArray * array = (struct ArrowArray *)malloc(sizeof(struct ArrowArray));
+    if (!array || export_array(fields, number_of_fields, 0, number_of_points, array) < 0) {
+        free(array);
+        Py_DECREF(schema);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the array.");
+        return NULL;
+    }
+
+    PyObject * array_object = PyCapsule_New(array, "arrow_array", array_capsule_destructor);
+    if (!array_object) {
+        array->release(array);
+        free(array);
+        Py_DECREF(schema);
+        return NULL;
+    }
+
+    PyObject * result = PyTuple_Pack(2, schema, array_object);
+    Py_DECREF(schema);
+    Py_DECREF(array_object);
+    return result;
+}
+
+PyObject * LASColumns_ArrowStream(LASColumnsPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"requested_schema", NULL};
+    PyObject * requested_schema = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", keywords, &requested_schema)) {
+        return NULL;
+    }
+
+    struct ArrowArrayStream * stream = (struct ArrowArrayStream *)malloc(sizeof(struct ArrowArrayStream));
+    ArrowStreamPrivate * private_data = (ArrowStreamPrivate *)malloc(sizeof(ArrowStreamPrivate));
+    if (!stream || !private_data) {
+        free(stream);
+        free(private_data);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the stream.");
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    private_data->columns = self;
+    private_data->next_profile = 0;
+    private_data->error = NULL;
+
+    stream->get_schema = stream_get_schema;
+    stream->get_next = stream_get_next;
+    stream->get_last_error = stream_get_last_error;
+    stream->release = stream_release;
+    stream->private_data = private_data;
+
+    PyObject * capsule = PyCapsule_New(stream, "arrow_array_stream", stream_capsule_destructor);
+    if (!capsule) {
+        stream->release(stream);
+        free(stream);
+    }
+    return capsule;
+}
@@ -0,0 +1,820 @@
+/**
+ * @file las_2g_async_module.c
+ * @author Ryan Wicks
+ * @brief asyncio versions of the readers and writers. The file work runs on the native
+ * thread pool and the results are handed back to the event loop with call_soon_threadsafe.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_compress.h"
+#include "las_2g_thread.h"
+
+#define ASYNC_PREFETCH 16 // profiles the async iterator reads ahead by default
+
+//-----------------------------------------------------------------
+// Future Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Set the result or exception of a future, run on its event loop. A future that was
+ * cancelled in the meantime is left alone.
+ */
+static PyObject * LASAsync_resolve(PyObject * self, PyObject * args) {
+    PyObject * future;
+    PyObject * value;
+    int failed;
+
+    if (!PyArg_ParseTuple(args, "OOp", &future, &value, &failed)) {
+        return NULL;
+    }
+    PyObject * done = PyObject_CallMethod(future, "done", NULL);
+    if (!done) {
+        return NULL;
+    }
+    int is_done = PyObject_IsTrue(done);
+    Py_DECREF(done);
+    if (is_done < 0) {
+        return NULL;
+    }
+    if (is_done) {
+        Py_RETURN_NONE;
+    }
+    return PyObject_CallMethod(future, failed ? "set_exception" : "set_result", "O", value);
+}
+
+static PyMethodDef LASAsync_resolve_method = {"_resolve", (PyCFunction) LASAsync_resolve, METH_VARARGS, NULL};
+
+/**
+ * @brief Create a future on the running event loop.
+ *
+ * @return int 0 on success, -1 with an exception set, e.g. when no event loop is running.
+ */
+static int LASAsync_NewFuture(PyObject ** loop, PyObject ** future) {
+    PyObject * asyncio = PyImport_ImportModule("asyncio");
+    if (!asyncio) {
+        return -1;
+    }
+    *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (!*loop) {
+        return -1;
+    }
+    *future = PyObject_CallMethod(*loop, "create_future", NULL);
+    if (!*future) {
+        Py_CLEAR(*loop);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Report a failure to schedule a callback on a loop, which is expected once the
+ * loop has been closed and is then dropped silently.
+ */
+static void LASAsync_ScheduleFailed(PyObject * loop, PyObject * object) {
+    PyObject * type, * value, * traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+
+    PyObject * closed = PyObject_CallMethod(loop, "is_closed", NULL);
+    int is_closed = closed ? PyObject_IsTrue(closed) : 0;
+    Py_XDECREF(closed);
+    PyErr_Clear();
+
+    if (is_closed > 0) {
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(traceback);
+    } else {
+        PyErr_Restore(type, value, traceback);
+        PyErr_WriteUnraisable(object);
+    }
+}
+
+/**
+ * @brief Hand the outcome of a call to the event loop of a future, from any thread holding
+ * the GIL.
+ *
+ * @param loop
+ * @param future
+ * @param result new reference to the result, stolen, or NULL with the exception to raise set
+ */
+static void LASAsync_Complete(PyObject * loop, PyObject * future, PyObject * result) {
+    PyObject * value = result;
+    int failed = 0;
+
+    if (!result) {
+        PyObject * type, * traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        PyErr_NormalizeException(&type, &value, &traceback);
+        if (value && traceback) {
+            PyException_SetTraceback(value, traceback);
+        }
+        Py_XDECREF(type);
+        Py_XDECREF(traceback);
+        failed = 1;
+    }
+
+    PyObject * resolve = PyCFunction_New(&LASAsync_resolve_method, NULL);
+    PyObject * ret = NULL;
+    if (resolve && value) {
+        ret = PyObject_CallMethod(loop, "call_soon_threadsafe", "OOOi", resolve, future, value, failed);
+    }
+    if (!ret) {
+        LASAsync_ScheduleFailed(loop, future);
+    }
+    Py_XDECREF(ret);
+    Py_XDECREF(resolve);
+    Py_XDECREF(value);
+}
+
+/**
+ * @brief Queue a task on the pool, the task owns context from here on if this succeeds.
+ *
+ * @return int 0 on success, -1 with an exception set.
+ */
+static int LASAsync_Submit(void (*work)(void * context), void * context) {
+    if (las_pool_submit(work, context) < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to start the thread pool.");
+        return -1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------
+// Read and Write Definitions
+//-----------------------------------------------------------------
+
+typedef struct {
+    PyObject * loop;
+    PyObject * future;
+    char * filename;
+    LASProfileFilter filter;
+    int fields;
+} ReadTask;
+
+typedef struct {
+    PyObject * loop;
+    PyObject * future;
+    char * filename;
+    int compress;
+    LASDataset dataset; /// snapshot of the profiles, encoded on the calling thread
+} WriteTask;
+
+static char * copy_string(const char * text) {
+    size_t length = strlen(text) + 1;
+    char * copy = (char *)malloc(length);
+    if (copy) {
+        memcpy(copy, text, length);
+    }
+    return copy;
+}
+
+/**
+ * @brief Read every profile of a LAS file that passes a filter into a dataset.
+ *
+ * @return int 0 on success, -1 if the records could not be read, -2 if memory could not be
+ * allocated, -3 if the file could not be opened.
+ */
+static int read_filtered_dataset(const char * filename, const LASProfileFilter * filter, LASDataset * dataset) {
+    LASPreadFile file;
+    LASHeader header;
+    LASProfileBuffer buffer = {0};
+    uint64_t offset = 0;
+    int ret;
+
+    if (open_pread_file(filename, &file) < 0) {
+        return -3;
+    }
+    const LASProfileFilter * active = (filter->has_bbox || filter->has_time) ? filter : NULL;
+    while ((ret = read_profile_at(&file, &offset, active, &header, &buffer)) == 0) {
+        if (append_las_profile(dataset, &header, buffer.entries, header.number_of_point_records) < 0) {
+            ret = -2;
+            break;
+        }
+    }
+    free_profile_buffer(&buffer);
+    close_pread_file(&file);
+    return ret == 1 ? 0 : ret;
+}
+
+static void read_task_run(void * context) {
+    ReadTask * task = (ReadTask *)context;
+    LASDataset dataset;
+    int ret = 0;
+
+    init_las_dataset(&dataset);
+    int compressed = LASCompressed_Check(task->filename);
+    if (!compressed) {
+        ret = read_filtered_dataset(task->filename, &task->filter, &dataset);
+    }
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    PyObject * result = NULL;
+    if (compressed) {
+        result = LASCompressed_ReadFiles(task->filename, &task->filter, task->fields);
+    } else if (ret == -3) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+    } else if (ret == -2) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for entries.");
+    } else if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+    } else {
+        result = PyList_New((Py_ssize_t)dataset.number_of_profiles);
+        for (size_t i = 0; result && i < dataset.number_of_profiles; ++i) {
+            PyObject * file_entry = LASFile_FromRecords(&dataset.headers[i], dataset.entries + dataset.offsets[i], task->fields);
+            if (!file_entry) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, (Py_ssize_t)i, file_entry);
+        }
+    }
+    LASAsync_Complete(task->loop, task->future, result);
+    Py_DECREF(task->loop);
+    Py_DECREF(task->future);
+    PyGILState_Release(state);
+
+    free_las_dataset(&dataset);
+    free(task->filename);
+    free(task);
+}
+
+static void write_task_run(void * context) {
+    WriteTask * task = (WriteTask *)context;
+    const LASDataset * dataset = &task->dataset;
+    int ret = 0;
+
+    if (task->compress) {
+        LASCompressedWriter writer;
+        if (open_compressed_writer(&writer, task->filename) < 0) {
+            ret = -3;
+        } else {
+            for (size_t i = 0; i < dataset->number_of_profiles && ret == 0; ++i) {
+                uint32_t number_of_entries = (uint32_t)(dataset->offsets[i + 1] - dataset->offsets[i]);
+                if (compressed_writer_append(&writer, &dataset->headers[i], dataset->entries + dataset->offsets[i], number_of_entries) < 0) {
+                    ret = -1;
+                }
+            }
+            if (close_compressed_writer(&writer) < 0 && ret == 0) {
+                ret = -1;
+            }
+        }
+    } else {
+        ret = write_las_dataset(task->filename, dataset);
+    }
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    PyObject * result = NULL;
+    if (ret == -3) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open output file.\n");
+    } else if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to save LASEntry.");
+    } else {
+        result = Py_None;
+        Py_INCREF(result);
+    }
+    LASAsync_Complete(task->loop, task->future, result);
+    Py_DECREF(task->loop);
+    Py_DECREF(task->future);
+    PyGILState_Release(state);
+
+    free_las_dataset(&task->dataset);
+    free(task->filename);
+    free(task);
+}
+
+/**
+ * @brief Encode a list of LASFiles into a dataset the same way as write_las.
+ *
+ * @return int 0 on success, -1 with an exception set.
+ */
+static int LASAsync_EncodeFiles(PyObject * las_files, LASDataset * dataset) {
+    LASProfileBuffer buffer = {0};
+    int ret = 0;
+
+    if (!PyList_Check(las_files)) {
+        PyErr_SetString(PyExc_TypeError, "write_las requires a list of LASFiles as input.");
+        return -1;
+    }
+    Py_ssize_t num_of_files = PyList_GET_SIZE(las_files);
+    if (num_of_files <= 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Require at least on LASFile to write.");
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < num_of_files && ret == 0; ++i) {
+        PyObject * item = PyList_GET_ITEM(las_files, i);
+        if (!PyObject_TypeCheck(item, &LASFilePythonType)) {
+            PyErr_SetString(PyExc_TypeError, "write_las requires a list of LASFiles as input.");
+            ret = -1;
+            break;
+        }
+        LASFilePython * las_file = (LASFilePython *)item;
+        uint64_t utc_time = ((LASHeaderPython *)las_file->header)->utc_time;
+        Py_ssize_t number_of_entries = LASEntries_Encode(las_file->entries, &buffer);
+        if (number_of_entries < 0) {
+            ret = -1;
+            break;
+        }
+
+        LASHeader header;
+        fillLASHeader(&header, utc_time, (uint32_t)number_of_entries);
+        set_header_bounds(&header, buffer.entries, (size_t)number_of_entries);
+        if (append_las_profile(dataset, &header, buffer.entries, (uint32_t)number_of_entries) < 0) {
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for entries.");
+            ret = -1;
+        }
+    }
+    free_profile_buffer(&buffer);
+    return ret;
+}
+
+//-----------------------------------------------------------------
+// LAS Async Iterator Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief One profile read ahead by the producer.
+ *
+ */
+typedef struct {
+    LASHeader header;
+    LASProfileBuffer buffer;
+} PrefetchSlot;
+
+/**
+ * @brief Asynchronous iterator over the profiles of a file. A producer task on the thread
+ * pool reads up to prefetch profiles ahead into a ring of slots and stops when the ring is
+ * full, __anext__ takes the oldest slot and restarts the producer.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject * loop;
+    PyObject * waiter; /// future of an __anext__ waiting for the producer, NULL when none
+    LASPreadFile file;
+    uint64_t offset; /// of the next header the producer reads
+    LASProfileFilter filter;
+    int fields;
+    PrefetchSlot * slots;
+    size_t prefetch; /// number of slots
+    size_t head; /// oldest filled slot
+    size_t count; /// filled slots
+    int status; /// 0 while reading, 1 at the end of the file, or the read_profile_at error
+    int producing; /// a producer task is queued or running, it holds a reference to the iterator
+    int delivering; /// a delivery of the waiter is scheduled on the loop
+    int closed;
+    las_mutex mutex; /// protects the ring and the flags shared with the producer
+} LASAsyncIteratorPython;
+
+static void LASAsyncIterator_produce(void * context);
+
+/**
+ * @brief Queue the producer unless it is running or has nothing left to do. Called with
+ * the GIL and the mutex held.
+ */
+static void LASAsyncIterator_start_producer(LASAsyncIteratorPython * self) {
+    if (self->producing || self->status != 0 || self->closed || self->count == self->prefetch) {
+        return;
+    }
+    Py_INCREF(self);
+    self->producing = 1;
+    if (las_pool_submit(LASAsyncIterator_produce, self) < 0) {
+        self->producing = 0;
+        self->status = -3;
+        Py_DECREF(self);
+    }
+}
+
+/**
+ * @brief Resolve a future with the oldest profile, the end of the iteration or the read
+ * error, or return 0 if the producer has not got that far yet. Called on the loop thread.
+ *
+ * @return int 1 if the future was resolved, 0 if not, -1 with an exception set.
+ */
+static int LASAsyncIterator_take(LASAsyncIteratorPython * self, PyObject * future) {
+    PyObject * result = NULL;
+    const char * method = "set_result";
+
+    las_mutex_lock(&self->mutex);
+    if (self->closed) {
+        method = "set_exception";
+        result = PyObject_CallFunctionObjArgs(PyExc_StopAsyncIteration, NULL);
+    } else if (self->count > 0) {
+        // the producer never touches a filled slot, so the records can be copied unlocked.
+        PrefetchSlot * slot = &self->slots[self->head];
+        las_mutex_unlock(&self->mutex);
+        result = LASFile_FromRecords(&slot->header, slot->buffer.entries, self->fields);
+        if (!result) {
+            return -1;
+        }
+        las_mutex_lock(&self->mutex);
+        self->head = (self->head + 1) % self->prefetch;
+        self->count -= 1;
+        LASAsyncIterator_start_producer(self);
+    } else if (self->status == 0) {
+        las_mutex_unlock(&self->mutex);
+        return 0;
+    } else {
+        method = "set_exception";
+        if (self->status == 1) {
+            result = PyObject_CallFunctionObjArgs(PyExc_StopAsyncIteration, NULL);
+        } else if (self->status == -2) {
+            result = PyObject_CallFunction(PyExc_MemoryError, "s", "Failed to allocate memory for entries.");
+        } else if (self->status == -3) {
+            result = PyObject_CallFunction(PyExc_RuntimeError, "s", "Failed to start the thread pool.");
+        } else {
+            result = PyObject_CallFunction(PyExc_RuntimeError, "s", "Could not load entry from file.");
+        }
+    }
+    las_mutex_unlock(&self->mutex);
+    if (!result) {
+        return -1;
+    }
+
+    PyObject * ret = PyObject_CallMethod(future, method, "O", result);
+    Py_DECREF(result);
+    if (!ret) {
+        return -1;
+    }
+    Py_DECREF(ret);
+    return 1;
+}
+
+/**
+ * @brief Resolve the waiting future once the producer made progress, scheduled on the loop
+ * by the producer.
+ */
+static PyObject * LASAsyncIterator_deliver(LASAsyncIteratorPython * self, PyObject * Py_UNUSED(ignored)) {
+    las_mutex_lock(&self->mutex);
+    PyObject * future = self->waiter;
+    self->waiter = NULL;
+    self->delivering = 0;
+    las_mutex_unlock(&self->mutex);
+    if (!future) {
+        Py_RETURN_NONE;
+    }
+
+    PyObject * done = PyObject_CallMethod(future, "done", NULL);
+    int is_done = done ? PyObject_IsTrue(done) : -1;
+    Py_XDECREF(done);
+    int ret = is_done ? is_done : LASAsyncIterator_take(self, future);
+    if (ret == 0) {
+        las_mutex_lock(&self->mutex);
+        self->waiter = future; // woken too early, keep waiting.
+        las_mutex_unlock(&self->mutex);
+        Py_RETURN_NONE;
+    }
+    Py_DECREF(future);
+    if (ret < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef LASAsyncIterator_deliver_method = {"_deliver", (PyCFunction) LASAsyncIterator_deliver, METH_NOARGS, NULL};
+
+/**
+ * @brief Ask the loop to run LASAsyncIterator_deliver.
+ *
+ * @param self
+ * @param method "call_soon" on the loop thread, "call_soon_threadsafe" from any other
+ * @return int 0 on success, -1 with an exception set.
+ */
+static int LASAsyncIterator_schedule(LASAsyncIteratorPython * self, const char * method) {
+    PyObject * deliver = PyCFunction_New(&LASAsyncIterator_deliver_method, (PyObject *)self);
+    if (!deliver) {
+        return -1;
+    }
+    PyObject * ret = PyObject_CallMethod(self->loop, method, "O", deliver);
+    Py_DECREF(deliver);
+    if (!ret) {
+        return -1;
+    }
+    Py_DECREF(ret);
+    return 0;
+}
+
+/**
+ * @brief Wake the loop from the producer thread.
+ */
+static void LASAsyncIterator_wake(LASAsyncIteratorPython * self) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    if (LASAsyncIterator_schedule(self, "call_soon_threadsafe") < 0) {
+        LASAsync_ScheduleFailed(self->loop, (PyObject *)self);
+    }
+    PyGILState_Release(state);
+}
+
+static void LASAsyncIterator_produce(void * context) {
+    LASAsyncIteratorPython * self = (LASAsyncIteratorPython *)context;
+    const LASProfileFilter * filter = (self->filter.has_bbox || self->filter.has_time) ? &self->filter : NULL;
+
+    for (;;) {
+        las_mutex_lock(&self->mutex);
+        if (self->count == self->prefetch || self->status != 0 || self->closed) {
+            self->producing = 0;
+            las_mutex_unlock(&self->mutex);
+            break;
+        }
+        PrefetchSlot * slot = &self->slots[(self->head + self->count) % self->prefetch];
+        uint64_t offset = self->offset;
+        las_mutex_unlock(&self->mutex);
+
+        int ret = read_profile_at(&self->file, &offset, filter, &slot->header, &slot->buffer);
+
+        las_mutex_lock(&self->mutex);
+        self->offset = offset;
+        if (ret == 0) {
+            self->count += 1;
+        } else {
+            self->status = ret;
+        }
+        int wake = self->waiter != NULL && !self->delivering;
+        if (wake) {
+            self->delivering = 1;
+        }
+        las_mutex_unlock(&self->mutex);
+
+        if (wake) {
+            LASAsyncIterator_wake(self);
+        }
+    }
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    Py_DECREF(self);
+    PyGILState_Release(state);
+}
+
+static PyObject * LASAsyncIterator_anext(LASAsyncIteratorPython * self) {
+    PyObject * future = PyObject_CallMethod(self->loop, "create_future", NULL);
+    if (!future) {
+        return NULL;
+    }
+
+    // a waiter that was cancelled is replaced, one still pending is an error.
+    las_mutex_lock(&self->mutex);
+    PyObject * waiter = self->waiter;
+    Py_XINCREF(waiter);
+    las_mutex_unlock(&self->mutex);
+    int busy = 0;
+    if (waiter) {
+        PyObject * done = PyObject_CallMethod(waiter, "done", NULL);
+        busy = done ? !PyObject_IsTrue(done) : -1;
+        Py_XDECREF(done);
+        las_mutex_lock(&self->mutex);
+        if (!busy && self->waiter == waiter) {
+            self->waiter = NULL;
+            Py_DECREF(waiter);
+        }
+        las_mutex_unlock(&self->mutex);
+        Py_DECREF(waiter);
+    }
+    if (busy < 0) {
+        Py_DECREF(future);
+        return NULL;
+    }
+    if (busy) {
+        PyErr_SetString(PyExc_RuntimeError, "anext(): the previous profile has not arrived yet.");
+        Py_DECREF(future);
+        return NULL;
+    }
+
+    int ret = LASAsyncIterator_take(self, future);
+    if (ret < 0) {
+        Py_DECREF(future);
+        return NULL;
+    }
+    if (ret == 0) {
+        las_mutex_lock(&self->mutex);
+        Py_INCREF(future);
+        self->waiter = future;
+        // the producer may have finished between take and here, then nobody else wakes the waiter.
+        int wake = (self->count > 0 || self->status != 0) && !self->delivering;
+        if (wake) {
+            self->delivering = 1;
+        }
+        LASAsyncIterator_start_producer(self);
+        las_mutex_unlock(&self->mutex);
+        if (wake && LASAsyncIterator_schedule(self, "call_soon") < 0) {
+            Py_DECREF(future);
+            return NULL;
+        }
+    }
+    return future;
+}
+
+static PyObject * LASAsyncIterator_aiter(PyObject * self) {
+    Py_INCREF(self);
+    return self;
+}
+
+static PyObject * LASAsyncIterator_close(LASAsyncIteratorPython * self, PyObject * Py_UNUSED(ignored)) {
+    las_mutex_lock(&self->mutex);
+    self->closed = 1;
+    las_mutex_unlock(&self->mutex);
+    Py_RETURN_NONE;
+}
+
+static void LASAsyncIterator_dealloc(LASAsyncIteratorPython * self) {
+    // a running producer holds a reference, so it has finished by now.
+    for (size_t i = 0; self->slots && i < self->prefetch; ++i) {
+        free_profile_buffer(&self->slots[i].buffer);
+    }
+    free(self->slots);
+    close_pread_file(&self->file);
+    las_mutex_destroy(&self->mutex);
+    Py_XDECREF(self->waiter);
+    Py_XDECREF(self->loop);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyAsyncMethods LASAsyncIterator_async = {
+    .am_aiter = LASAsyncIterator_aiter,
+    .am_anext = (unaryfunc) LASAsyncIterator_anext,
+};
+
+static PyMethodDef LASAsyncIterator_methods[] = {
+    {"close", (PyCFunction) LASAsyncIterator_close, METH_NOARGS, "Stop reading ahead, ending the iteration."},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASAsyncIteratorPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASAsyncIterator",
+    .tp_doc = "Asynchronous iterator over the profiles of a LAS file, created by iter_las_async.",
+    .tp_basicsize = sizeof(LASAsyncIteratorPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) LASAsyncIterator_dealloc,
+    .tp_as_async = &LASAsyncIterator_async,
+    .tp_methods = LASAsyncIterator_methods,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+PyObject * read_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "bbox", "time_range", "fields", NULL};
+    char * filename;
+    PyObject * bbox = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * fields_object = Py_None;
+    ReadTask * task;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|OOO", keywords, &filename, &bbox, &time_range, &fields_object)) {
+        return NULL;
+    }
+
+    task = (ReadTask *)calloc(1, sizeof(ReadTask));
+    if (!task || !(task->filename = copy_string(filename))) {
+        free(task);
+        return PyErr_NoMemory();
+    }
+    if (LASProfileFilter_FromPython(bbox, time_range, &task->filter) < 0 ||
+        LASFields_FromPython(fields_object, &task->fields) < 0 ||
+        LASAsync_NewFuture(&task->loop, &task->future) < 0) {
+        free(task->filename);
+        free(task);
+        return NULL;
+    }
+
+    PyObject * future = task->future;
+    Py_INCREF(future);
+    if (LASAsync_Submit(read_task_run, task) < 0) {
+        Py_DECREF(task->loop);
+        Py_DECREF(task->future);
+        free(task->filename);
+        free(task);
+        Py_DECREF(future);
+        return NULL;
+    }
+    return future;
+}
+
+PyObject * write_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "las_files", "compress", NULL};
+    char * filename;
+    PyObject * las_files = NULL;
+    PyObject * compress_object = Py_None;
+    WriteTask * task;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|O", keywords, &filename, &las_files, &compress_object)) {
+        return NULL;
+    }
+
+    int compress = LASCompressed_ExtensionMatches(filename);
+    if (compress_object != Py_None) {
+        compress = PyObject_IsTrue(compress_object);
+        if (compress < 0) {
+            return NULL;
+        }
+    }
+
+    task = (WriteTask *)calloc(1, sizeof(WriteTask));
+    if (!task || !(task->filename = copy_string(filename))) {
+        free(task);
+        return PyErr_NoMemory();
+    }
+    task->compress = compress;
+    init_las_dataset(&task->dataset);
+
+    // the profiles are encoded now, so the caller may change them while the file is written.
+    if (LASAsync_EncodeFiles(las_files, &task->dataset) < 0 ||
+        LASAsync_NewFuture(&task->loop, &task->future) < 0) {
+        free_las_dataset(&task->dataset);
+        free(task->filename);
+        free(task);
+        return NULL;
+    }
+
+    PyObject * future = task->future;
+    Py_INCREF(future);
+    if (LASAsync_Submit(write_task_run, task) < 0) {
+        Py_DECREF(task->loop);
+        Py_DECREF(task->future);
+        free_las_dataset(&task->dataset);
+        free(task->filename);
+        free(task);
+        Py_DECREF(future);
+        return NULL;
+    }
+    return future;
+}
+
+PyObject * iter_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "prefetch", "bbox", "time_range", "fields", NULL};
+    char * filename;
+    Py_ssize_t prefetch = ASYNC_PREFETCH;
+    PyObject * bbox = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * fields_object = Py_None;
+    LASProfileFilter filter;
+    int fields;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|nOOO", keywords, &filename, &prefetch, &bbox, &time_range, &fields_object)) {
+        return NULL;
+    }
+    if (prefetch < 1) {
+        PyErr_SetString(PyExc_ValueError, "prefetch must be at least 1.");
+        return NULL;
+    }
+    if (LASProfileFilter_FromPython(bbox, time_range, &filter) < 0 ||
+        LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+
+    PyObject * asyncio = PyImport_ImportModule("asyncio");
+    if (!asyncio) {
+        return NULL;
+    }
+    PyObject * loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (!loop) {
+        return NULL;
+    }
+
+    LASAsyncIteratorPython * iterator = (LASAsyncIteratorPython *) LASAsyncIteratorPythonType.tp_alloc(&LASAsyncIteratorPythonType, 0);
+    if (!iterator) {
+        Py_DECREF(loop);
+        return NULL;
+    }
+    las_mutex_init(&iterator->mutex);
+    iterator->loop = loop;
+    iterator->filter = filter;
+    iterator->fields = fields;
+    iterator->prefetch = (size_t)prefetch;
+#ifndef _WIN32
+    iterator->file.fd = -1;
+#endif
+
+    iterator->slots = (PrefetchSlot *)calloc((size_t)prefetch, sizeof(PrefetchSlot));
+    if (!iterator->slots) {
+        Py_DECREF(iterator);
+        return PyErr_NoMemory();
+    }
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = open_pread_file(filename, &iterator->file);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        Py_DECREF(iterator);
+        return NULL;
+    }
+
+    // start reading ahead straight away, before the first profile is asked for.
+    las_mutex_lock(&iterator->mutex);
+    LASAsyncIterator_start_producer(iterator);
+    las_mutex_unlock(&iterator->mutex);
+    return (PyObject *) iterator;
+}
@@ -0,0 +1,811 @@
+/**
+ * @file las_2g_columns_module.c
+ * @author Ryan Wicks
+ * @brief Columnar access to LAS surveys through the buffer protocol.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_thread.h"
+#include <ctype.h>
+#include <string.h>
+
+//-----------------------------------------------------------------
+// LAS Column Definitions
+//-----------------------------------------------------------------
+
+static Py_ssize_t LASColumn_itemsize(char format) {
+    switch (format) {
+        case 'd':
+        case 'Q':
+            return 8;
+        case 'I':
+            return 4;
+        case 'H':
+            return 2;
+        case 'B':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+LASColumnPython * LASColumn_New(char format, Py_ssize_t length) {
+    Py_ssize_t itemsize = LASColumn_itemsize(format);
+    if (itemsize == 0) {
+        PyErr_SetString(PyExc_ValueError, "Unsupported column format.");
+        return NULL;
+    }
+    if (length < 0 || length > PY_SSIZE_T_MAX / itemsize) {
+        PyErr_SetString(PyExc_OverflowError, "Column too large.");
+        return NULL;
+    }
+
+    LASColumnPython * self = (LASColumnPython *) LASColumnPythonType.tp_alloc(&LASColumnPythonType, 0);
+    if (!self) {
+        return NULL;
+    }
+
+    // always allocate at least one element so an empty column still has a valid pointer.
+    self->data = (char *) malloc(length > 0 ? length * itemsize : itemsize);
+    if (!self->data) {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for column.");
+        return NULL;
+    }
+    las_stats_allocation(length > 0 ? length * itemsize : itemsize);
+    self->length = length;
+    self->itemsize = itemsize;
+    self->format[0] = format;
+    self->format[1] = '\0';
+
+    return self;
+}
+
+LASColumnPython * LASColumn_FromData(char format, void * data, Py_ssize_t length, PyObject * owner) {
+    Py_ssize_t itemsize = LASColumn_itemsize(format);
+    if (itemsize == 0) {
+        PyErr_SetString(PyExc_ValueError, "Unsupported column format.");
+        return NULL;
+    }
+
+    LASColumnPython * self = (LASColumnPython *) LASColumnPythonType.tp_alloc(&LASColumnPythonType, 0);
+    if (!self) {
+        return NULL;
+    }
+    self->data = (char *) data;
+    self->length = length;
+    self->itemsize = itemsize;
+    self->format[0] = format;
+    self->format[1] = '\0';
+    Py_INCREF(owner);
+    self->owner = owner;
+    self->readonly = 1;
+
+    return self;
+}
+
+static void LASColumn_dealloc(LASColumnPython * self) {
+    if (self->owner) {
+        Py_DECREF(self->owner);
+    } else {
+        free(self->data);
+    }
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int LASColumn_getbuffer(LASColumnPython * self, Py_buffer * view, int flags) {
+    if (self->readonly && (flags & PyBUF_WRITABLE)) {
+        PyErr_SetString(PyExc_BufferError, "Column is read only.");
+        view->obj = NULL;
+        return -1;
+    }
+    view->buf = self->data;
+    view->obj = (PyObject *) self;
+    Py_INCREF(self);
+    view->len = self->length * self->itemsize;
+    view->itemsize = self->itemsize;
+    view->readonly = self->readonly;
+    view->ndim = 1;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+    view->shape = (flags & PyBUF_ND) ? &self->length : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static Py_ssize_t LASColumn_length(LASColumnPython * self) {
+    return self->length;
+}
+
+static PyObject * LASColumn_item(LASColumnPython * self, Py_ssize_t i) {
+    if (i < 0 || i >= self->length) {
+        PyErr_SetString(PyExc_IndexError, "Column index out of range.");
+        return NULL;
+    }
+
+    switch (self->format[0]) {
+        case 'd':
+            return PyFloat_FromDouble(((double *)self->data)[i]);
+        case 'Q':
+            return PyLong_FromUnsignedLongLong(((uint64_t *)self->data)[i]);
+        case 'I':
+            return PyLong_FromUnsignedLong(((uint32_t *)self->data)[i]);
+        case 'H':
+            return PyLong_FromUnsignedLong(((uint16_t *)self->data)[i]);
+        default:
+            return PyLong_FromUnsignedLong(((uint8_t *)self->data)[i]);
+    }
+}
+
+static PyBufferProcs LASColumn_as_buffer = {
+    .bf_getbuffer = (getbufferproc) LASColumn_getbuffer,
+    .bf_releasebuffer = NULL,
+};
+
+static PySequenceMethods LASColumn_as_sequence = {
+    .sq_length = (lenfunc) LASColumn_length,
+    .sq_item = (ssizeargfunc) LASColumn_item,
+};
+
+PyTypeObject LASColumnPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASColumn",
+    .tp_doc = "A contiguous array of one point field, readable through the buffer protocol (memoryview, numpy.frombuffer).",
+    .tp_basicsize = sizeof(LASColumnPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) LASColumn_dealloc,
+    .tp_as_buffer = &LASColumn_as_buffer,
+    .tp_as_sequence = &LASColumn_as_sequence,
+};
+
+static int LASColumn_format_matches(char format, const char * buffer_format, Py_ssize_t itemsize) {
+    if (buffer_format == NULL) {
+        buffer_format = "B";
+    }
+    // native or little endian standard sizes only, the records are little endian.
+    if (buffer_format[0] == '@' || buffer_format[0] == '=' || buffer_format[0] == '<') {
+        buffer_format++;
+    }
+    if (buffer_format[0] == '\0' || buffer_format[1] != '\0' || itemsize != LASColumn_itemsize(format)) {
+        return 0;
+    }
+
+    switch (format) {
+        case 'Q':
+            return buffer_format[0] == 'Q' || buffer_format[0] == 'L';
+        default:
+            return buffer_format[0] == format;
+    }
+}
+
+int LASColumn_GetBuffer(PyObject * obj, char format, Py_buffer * view, const char * name) {
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        return -1;
+    }
+    if (view->ndim != 1 || !LASColumn_format_matches(format, view->format, view->itemsize)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a one dimensional array with format '%c'.", name, format);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t * LASColumn_AsIndexArray(PyObject * obj, Py_ssize_t * length, const char * name) {
+    Py_buffer view;
+
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        return NULL;
+    }
+
+    const char * format = view.format ? view.format : "B";
+    if (format[0] == '@' || format[0] == '=' || format[0] == '<') {
+        format++;
+    }
+    if (view.ndim != 1 || format[0] == '\0' || format[1] != '\0' || strchr("bBhHiIlLqQ", format[0]) == NULL) {
+        PyErr_Format(PyExc_TypeError, "%s must be a one dimensional array of integers.", name);
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    *length = view.shape ? view.shape[0] : view.len / view.itemsize;
+    uint64_t * values = (uint64_t *)malloc((*length > 0 ? *length : 1) * sizeof(uint64_t));
+    if (!values) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for index array.");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    int is_signed = islower((unsigned char)format[0]);
+    for (Py_ssize_t i = 0; i < *length; ++i) {
+        const char * item = (const char *)view.buf + i * view.itemsize;
+        int64_t signed_value = 0;
+        uint64_t value = 0;
+        switch (view.itemsize) {
+            case 1: signed_value = *(const int8_t *)item; value = *(const uint8_t *)item; break;
+            case 2: signed_value = *(const int16_t *)item; value = *(const uint16_t *)item; break;
+            case 4: signed_value = *(const int32_t *)item; value = *(const uint32_t *)item; break;
+            default: signed_value = *(const int64_t *)item; value = *(const uint64_t *)item; break;
+        }
+        if (is_signed && signed_value < 0) {
+            PyErr_Format(PyExc_ValueError, "%s must not contain negative values.", name);
+            free(values);
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        values[i] = value;
+    }
+
+    PyBuffer_Release(&view);
+    return values;
+}
+
+//-----------------------------------------------------------------
+// LAS Columns Definitions
+//-----------------------------------------------------------------
+
+static PyObject * LASColumns_new_field(char format, Py_ssize_t length, int fields, int field) {
+    if (!(fields & field)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return (PyObject *) LASColumn_New(format, length);
+}
+
+LASColumnsPython * LASColumns_New(Py_ssize_t number_of_points, Py_ssize_t number_of_profiles, int fields) {
+    LASColumnsPython * self = (LASColumnsPython *) LASColumnsPythonType.tp_alloc(&LASColumnsPythonType, 0);
+    if (!self) {
+        return NULL;
+    }
+
+    if (!(self->x = LASColumns_new_field('d', number_of_points, fields, LAS_FIELD_X)) ||
+        !(self->y = LASColumns_new_field('d', number_of_points, fields, LAS_FIELD_Y)) ||
+        !(self->z = LASColumns_new_field('d', number_of_points, fields, LAS_FIELD_Z)) ||
+        !(self->intensity = LASColumns_new_field('H', number_of_points, fields, LAS_FIELD_INTENSITY)) ||
+        !(self->quality = LASColumns_new_field('B', number_of_points, fields, LAS_FIELD_QUALITY)) ||
+        !(self->utc_time = LASColumns_new_field('Q', number_of_points, fields, LAS_FIELD_UTC_TIME)) ||
+        !(self->offsets = (PyObject *) LASColumn_New('Q', number_of_profiles + 1)) ||
+        !(self->profile_time = (PyObject *) LASColumn_New('Q', number_of_profiles))) {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static void * LASColumns_data(PyObject * column) {
+    return column == Py_None ? NULL : ((LASColumnPython *) column)->data;
+}
+
+void LASColumns_GetArrays(LASColumnsPython * self, LASColumnArrays * arrays) {
+    arrays->x = (double *) LASColumns_data(self->x);
+    arrays->y = (double *) LASColumns_data(self->y);
+    arrays->z = (double *) LASColumns_data(self->z);
+    arrays->intensity = (uint16_t *) LASColumns_data(self->intensity);
+    arrays->quality = (uint8_t *) LASColumns_data(self->quality);
+    arrays->utc_time = (uint64_t *) LASColumns_data(self->utc_time);
+    arrays->offsets = (uint64_t *) LASColumns_data(self->offsets);
+    arrays->profile_time = (uint64_t *) LASColumns_data(self->profile_time);
+}
+
+static void LASColumns_dealloc(LASColumnsPython * self) {
+    Py_XDECREF(self->x);
+    Py_XDECREF(self->y);
+    Py_XDECREF(self->z);
+    Py_XDECREF(self->intensity);
+    Py_XDECREF(self->quality);
+    Py_XDECREF(self->utc_time);
+    Py_XDECREF(self->offsets);
+    Py_XDECREF(self->profile_time);
+    Py_XDECREF(self->profile_id);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject * LASColumns_get_number_of_points(LASColumnsPython * self, void * closure) {
+    LASColumnPython * offsets = (LASColumnPython *) self->offsets;
+    return PyLong_FromUnsignedLongLong(((uint64_t *) offsets->data)[offsets->length - 1]);
+}
+
+static PyObject * LASColumns_get_number_of_profiles(LASColumnsPython * self, void * closure) {
+    return PyLong_FromSsize_t(((LASColumnPython *) self->profile_time)->length);
+}
+
+PyObject * LASColumns_GetProfileId(LASColumnsPython * self) {
+    if (self->profile_id == NULL) {
+        LASColumnPython * offsets = (LASColumnPython *) self->offsets;
+        const uint64_t * point_offsets = (const uint64_t *) offsets->data;
+        Py_ssize_t number_of_profiles = offsets->length - 1;
+
+        if (number_of_profiles > UINT32_MAX) {
+            PyErr_SetString(PyExc_OverflowError, "Too many profiles for a uint32 profile id.");
+            return NULL;
+        }
+        LASColumnPython * profile_id = LASColumn_New('I', (Py_ssize_t) point_offsets[number_of_profiles]);
+        if (!profile_id) {
+            return NULL;
+        }
+
+        uint32_t * ids = (uint32_t *) profile_id->data;
+        Py_BEGIN_ALLOW_THREADS
+        for (Py_ssize_t i = 0; i < number_of_profiles; ++i) {
+            for (uint64_t j = point_offsets[i]; j < point_offsets[i+1]; ++j) {
+                ids[j] = (uint32_t) i;
+            }
+        }
+        Py_END_ALLOW_THREADS
+        self->profile_id = (PyObject *) profile_id;
+    }
+
+    Py_INCREF(self->profile_id);
+    return self->profile_id;
+}
+
+static PyObject * LASColumns_get_profile_id(LASColumnsPython * self, void * closure) {
+    return LASColumns_GetProfileId(self);
+}
+
+static PyMemberDef LASColumns_members[] = {
+    {"x", T_OBJECT_EX, offsetof(LASColumnsPython, x), READONLY, "x co-ordinates in m (float64), None if not read."},
+    {"y", T_OBJECT_EX, offsetof(LASColumnsPython, y), READONLY, "y co-ordinates in m (float64), None if not read."},
+    {"z", T_OBJECT_EX, offsetof(LASColumnsPython, z), READONLY, "z co-ordinates in m (float64), None if not read."},
+    {"intensity", T_OBJECT_EX, offsetof(LASColumnsPython, intensity), READONLY, "intensity (uint16), None if not read."},
+    {"quality", T_OBJECT_EX, offsetof(LASColumnsPython, quality), READONLY, "quality (uint8), None if not read."},
+    {"utc_time", T_OBJECT_EX, offsetof(LASColumnsPython, utc_time), READONLY, "utc time in microseconds from the unix epoch (uint64), None if not read."},
+    {"offsets", T_OBJECT_EX, offsetof(LASColumnsPython, offsets), READONLY, "Index of the first point of every profile, plus the total number of points (uint64)."},
+    {"profile_time", T_OBJECT_EX, offsetof(LASColumnsPython, profile_time), READONLY, "Header utc time of every profile in microseconds from the unix epoch, whole seconds (uint64)."},
+    {NULL} //sentinel
+};
+
+static PyGetSetDef LASColumns_getset[] = {
+    {"number_of_points", (getter) LASColumns_get_number_of_points, NULL, "Number of points in the survey.", NULL},
+    {"number_of_profiles", (getter) LASColumns_get_number_of_profiles, NULL, "Number of profiles in the survey.", NULL},
+    {"profile_id", (getter) LASColumns_get_profile_id, NULL, "Index of the profile of every point (uint32), built on first access.", NULL},
+    {NULL} //sentinel
+};
+
+static PyMethodDef LASColumns_methods[] = {
+    {"__arrow_c_schema__", (PyCFunction) LASColumns_ArrowSchema, METH_NOARGS,
+     "Export the schema of the columns as an Arrow C data interface PyCapsule."},
+    {"__arrow_c_array__", (PyCFunction) LASColumns_ArrowArray, METH_VARARGS | METH_KEYWORDS,
+     "Export the survey as one Arrow struct array, returned as (schema, array) PyCapsules sharing the column storage."},
+    {"__arrow_c_stream__", (PyCFunction) LASColumns_ArrowStream, METH_VARARGS | METH_KEYWORDS,
+     "Export the survey as an Arrow C stream PyCapsule yielding one record batch per group of whole profiles."},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASColumnsPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASColumns",
+    .tp_doc = "A LAS survey stored as one contiguous column per point field.",
+    .tp_basicsize = sizeof(LASColumnsPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) LASColumns_dealloc,
+    .tp_members = LASColumns_members,
+    .tp_getset = LASColumns_getset,
+    .tp_methods = LASColumns_methods,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * read_las_columns_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "threads", "bbox", "time_range", "fields", NULL};
+    char * filename;
+    int threads = 0;
+    PyObject * bbox = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * fields_object = Py_None;
+    LASProfileFilter filter;
+    int fields;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iOOO", keywords, &filename, &threads, &bbox, &time_range, &fields_object)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+    if (LASProfileFilter_FromPython(bbox, time_range, &filter) < 0 ||
+        LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+
+    LASMappedFile mapped;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, &mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return NULL;
+    }
+
+    LASProfileTable table;
+    Py_BEGIN_ALLOW_THREADS
+    ret = scan_profiles_mapped(mapped.data, mapped.size, &table);
+    if (ret >= 0 && (filter.has_bbox || filter.has_time)) {
+        filter_profile_table_mapped(mapped.data, &table, &filter);
+    }
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+        unmap_file(&mapped);
+        return NULL;
+    }
+
+    LASColumnsPython * columns = LASColumns_New((Py_ssize_t)table.number_of_points, (Py_ssize_t)table.number_of_profiles, fields);
+    if (columns) {
+        LASColumnArrays arrays;
+        LASColumns_GetArrays(columns, &arrays);
+
+        Py_BEGIN_ALLOW_THREADS
+        read_columns_mapped(mapped.data, &table, &arrays, threads);
+        Py_END_ALLOW_THREADS
+    }
+
+    free_profile_table(&table);
+    unmap_file(&mapped);
+
+    return (PyObject *) columns;
+}
+
+PyObject * read_las_columns_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "read_las_columns", read_las_columns_call(self, args, kwargs));
+}
+
+static PyObject * write_las_columns_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "x", "y", "z", "intensity", "quality", "utc_time",
+                                "offsets", "counts", "profile_time", NULL};
+    static const char * point_names[] = {"x", "y", "z", "intensity", "quality", "utc_time"};
+    static const char point_formats[] = {'d', 'd', 'd', 'H', 'B', 'Q'};
+    char * filename;
+    PyObject * point_objects[6];
+    PyObject * offsets_object = Py_None;
+    PyObject * counts_object = Py_None;
+    PyObject * profile_time_object = Py_None;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sOOOOOO|OOO", keywords, &filename,
+                                     &point_objects[0], &point_objects[1], &point_objects[2],
+                                     &point_objects[3], &point_objects[4], &point_objects[5],
+                                     &offsets_object, &counts_object, &profile_time_object)) {
+        return NULL;
+    }
+    if ((offsets_object == Py_None) == (counts_object == Py_None)) {
+        PyErr_SetString(PyExc_TypeError, "write_las_columns requires exactly one of offsets or counts.");
+        return NULL;
+    }
+
+    Py_buffer views[7];
+    int number_of_views = 0;
+    uint64_t * offsets = NULL;
+    uint64_t * profile_time = NULL;
+    PyObject * result = NULL;
+
+    for (; number_of_views < 6; ++number_of_views) {
+        if (LASColumn_GetBuffer(point_objects[number_of_views], point_formats[number_of_views],
+                                &views[number_of_views], point_names[number_of_views]) < 0) {
+            goto cleanup;
+        }
+    }
+
+    Py_ssize_t number_of_points = views[0].shape[0];
+    for (int i = 1; i < 6; ++i) {
+        if (views[i].shape[0] != number_of_points) {
+            PyErr_SetString(PyExc_ValueError, "All point columns must have the same length.");
+            goto cleanup;
+        }
+    }
+
+    Py_ssize_t number_of_profiles;
+    if (offsets_object != Py_None) {
+        Py_ssize_t length;
+        offsets = LASColumn_AsIndexArray(offsets_object, &length, "offsets");
+        if (!offsets) {
+            goto cleanup;
+        }
+        number_of_profiles = length - 1;
+        if (length < 1 || offsets[0] != 0 || offsets[number_of_profiles] != (uint64_t)number_of_points) {
+            PyErr_SetString(PyExc_ValueError, "offsets must start at 0 and end at the number of points.");
+            goto cleanup;
+        }
+    } else {
+        Py_ssize_t length;
+        uint64_t * counts = LASColumn_AsIndexArray(counts_object, &length, "counts");
+        if (!counts) {
+            goto cleanup;
+        }
+        number_of_profiles = length;
+        offsets = (uint64_t *)malloc((number_of_profiles + 1) * sizeof(uint64_t));
+        if (!offsets) {
+            free(counts);
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for offsets.");
+            goto cleanup;
+        }
+        offsets[0] = 0;
+        for (Py_ssize_t i = 0; i < number_of_profiles; ++i) {
+            offsets[i+1] = offsets[i] + counts[i];
+        }
+        free(counts);
+        if (offsets[number_of_profiles] != (uint64_t)number_of_points) {
+            PyErr_SetString(PyExc_ValueError, "counts must add up to the number of points.");
+            goto cleanup;
+        }
+    }
+    for (Py_ssize_t i = 0; i < number_of_profiles; ++i) {
+        if (offsets[i+1] < offsets[i] || offsets[i+1] - offsets[i] > UINT32_MAX) {
+            PyErr_SetString(PyExc_ValueError, "Profile point counts must be between 0 and 2^32-1.");
+            goto cleanup;
+        }
+    }
+
+    if (profile_time_object != Py_None) {
+        if (LASColumn_GetBuffer(profile_time_object, 'Q', &views[number_of_views], "profile_time") < 0) {
+            goto cleanup;
+        }
+        number_of_views++;
+        if (views[6].shape[0] != number_of_profiles) {
+            PyErr_SetString(PyExc_ValueError, "profile_time must have one entry per profile.");
+            goto cleanup;
+        }
+        profile_time = (uint64_t *)views[6].buf;
+    } else {
+        // without header times, stamp each profile with the time of its first point.
+        profile_time = (uint64_t *)malloc((number_of_profiles > 0 ? number_of_profiles : 1) * sizeof(uint64_t));
+        if (!profile_time) {
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for profile times.");
+            goto cleanup;
+        }
+        for (Py_ssize_t i = 0; i < number_of_profiles; ++i) {
+            profile_time[i] = offsets[i+1] > offsets[i] ? ((uint64_t *)views[5].buf)[offsets[i]] : 0;
+        }
+    }
+
+    LASColumnArrays arrays;
+    arrays.x = (double *)views[0].buf;
+    arrays.y = (double *)views[1].buf;
+    arrays.z = (double *)views[2].buf;
+    arrays.intensity = (uint16_t *)views[3].buf;
+    arrays.quality = (uint8_t *)views[4].buf;
+    arrays.utc_time = (uint64_t *)views[5].buf;
+    arrays.offsets = offsets;
+    arrays.profile_time = profile_time;
+
+    FILE * fid;
+    fid = fopen(filename, "wb");
+    if (fid == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open output file.\n");
+        goto cleanup;
+    }
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = write_columns(fid, &arrays, (size_t)number_of_profiles);
+    if (fclose(fid) != 0) {
+        ret = -1;
+    }
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to save LAS file.");
+        goto cleanup;
+    }
+
+    Py_INCREF(Py_None);
+    result = Py_None;
+
+cleanup:
+    if (profile_time_object == Py_None) {
+        free(profile_time);
+    }
+    free(offsets);
+    for (int i = 0; i < number_of_views; ++i) {
+        PyBuffer_Release(&views[i]);
+    }
+    return result;
+}
+
+PyObject * write_las_columns_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "write_las_columns", write_las_columns_call(self, args, kwargs));
+}
+
+/**
+ * @brief State of one file of read_many, shared between the scan and decode passes.
+ * 
+ */
+typedef struct {
+    const char * filename;
+    LASProfileTable table;
+    uint64_t first_point; /// position of the file's points and profiles in the shared result
+    uint64_t first_profile;
+    const char * error; /// NULL while the file is readable
+} ManyFile;
+
+typedef struct {
+    ManyFile * files;
+    LASColumnArrays arrays;
+} ManyRead;
+
+static void read_many_scan(void * context, size_t item) {
+    ManyFile * file = &((ManyRead *)context)->files[item];
+
+    FILE * fid = fopen(file->filename, "rb");
+    if (fid == NULL) {
+        file->error = "Failed to open LAS file.";
+        return;
+    }
+    if (scan_profiles(fid, &file->table) < 0) {
+        file->error = "Could not load entry from file.";
+    }
+    fclose(fid);
+}
+
+static void read_many_decode(void * context, size_t item) {
+    ManyRead * read = (ManyRead *)context;
+    ManyFile * file = &read->files[item];
+
+    if (file->error || file->table.number_of_profiles == 0) {
+        return;
+    }
+
+    LASColumnArrays slice = read->arrays;
+    slice.x += file->first_point;
+    slice.y += file->first_point;
+    slice.z += file->first_point;
+    slice.intensity += file->first_point;
+    slice.quality += file->first_point;
+    slice.utc_time += file->first_point;
+    slice.offsets += file->first_profile;
+    slice.profile_time += file->first_profile;
+
+    FILE * fid = fopen(file->filename, "rb");
+    if (fid == NULL) {
+        file->error = "Failed to open LAS file.";
+    } else {
+        if (read_columns_at(fid, &file->table, &slice, file->first_point) < 0) {
+            file->error = "Could not load entry from file.";
+        }
+        fclose(fid);
+    }
+
+    if (file->error) {
+        // the file changed since it was scanned, leave its points zeroed rather than half read.
+        uint64_t number_of_points = file->table.number_of_points;
+        memset(slice.x, 0, number_of_points * sizeof(double));
+        memset(slice.y, 0, number_of_points * sizeof(double));
+        memset(slice.z, 0, number_of_points * sizeof(double));
+        memset(slice.intensity, 0, number_of_points * sizeof(uint16_t));
+        memset(slice.quality, 0, number_of_points * sizeof(uint8_t));
+        memset(slice.utc_time, 0, number_of_points * sizeof(uint64_t));
+        uint64_t point_offset = file->first_point;
+        for (size_t i = 0; i < file->table.number_of_profiles; ++i) {
+            slice.offsets[i] = point_offset;
+            slice.profile_time[i] = 0;
+            point_offset += file->table.point_counts[i];
+        }
+    }
+}
+
+static PyObject * read_many_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filenames", "threads", NULL};
+    PyObject * filenames_object;
+    int threads = 0;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", keywords, &filenames_object, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+
+    PyObject * sequence = PySequence_Fast(filenames_object, "filenames must be a sequence of file names.");
+    if (!sequence) {
+        return NULL;
+    }
+    Py_ssize_t number_of_files = PySequence_Fast_GET_SIZE(sequence);
+
+    PyObject * encoded = PyList_New(number_of_files);
+    ManyFile * files = (ManyFile *)calloc(number_of_files > 0 ? number_of_files : 1, sizeof(ManyFile));
+    LASColumnsPython * columns = NULL;
+    LASColumnPython * file_offsets = NULL;
+    PyObject * errors = NULL;
+    PyObject * result = NULL;
+
+    if (!encoded || !files) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for files.");
+        }
+        goto cleanup;
+    }
+
+    // the encoded names stay referenced by the list while the workers use them without the GIL.
+    for (Py_ssize_t i = 0; i < number_of_files; ++i) {
+        PyObject * name = NULL;
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(sequence, i), &name)) {
+            goto cleanup;
+        }
+        PyList_SET_ITEM(encoded, i, name);
+        files[i].filename = PyBytes_AS_STRING(name);
+    }
+
+    ManyRead read;
+    read.files = files;
+
+    Py_BEGIN_ALLOW_THREADS
+    las_parallel_for((size_t)number_of_files, threads, read_many_scan, &read);
+    Py_END_ALLOW_THREADS
+
+    uint64_t number_of_points = 0;
+    uint64_t number_of_profiles = 0;
+    for (Py_ssize_t i = 0; i < number_of_files; ++i) {
+        files[i].first_point = number_of_points;
+        files[i].first_profile = number_of_profiles;
+        if (!files[i].error) {
+            number_of_points += files[i].table.number_of_points;
+            number_of_profiles += files[i].table.number_of_profiles;
+        }
+    }
+
+    columns = LASColumns_New((Py_ssize_t)number_of_points, (Py_ssize_t)number_of_profiles, LAS_FIELDS_ALL);
+    file_offsets = LASColumn_New('Q', number_of_files + 1);
+    errors = PyDict_New();
+    if (!columns || !file_offsets || !errors) {
+        goto cleanup;
+    }
+    LASColumns_GetArrays(columns, &read.arrays);
+    read.arrays.offsets[number_of_profiles] = number_of_points;
+
+    Py_BEGIN_ALLOW_THREADS
+    las_parallel_for((size_t)number_of_files, threads, read_many_decode, &read);
+    Py_END_ALLOW_THREADS
+
+    for (Py_ssize_t i = 0; i < number_of_files; ++i) {
+        ((uint64_t *)file_offsets->data)[i] = files[i].first_profile;
+        if (files[i].error) {
+            PyObject * index = PyLong_FromSsize_t(i);
+            PyObject * message = PyUnicode_FromString(files[i].error);
+            int ret = (index && message) ? PyDict_SetItem(errors, index, message) : -1;
+            Py_XDECREF(index);
+            Py_XDECREF(message);
+            if (ret < 0) {
+                goto cleanup;
+            }
+        }
+    }
+    ((uint64_t *)file_offsets->data)[number_of_files] = number_of_profiles;
+
+    result = PyTuple_Pack(3, (PyObject *)columns, (PyObject *)file_offsets, errors);
+
+cleanup:
+    if (files) {
+        for (Py_ssize_t i = 0; i < number_of_files; ++i) {
+            free_profile_table(&files[i].table);
+        }
+        free(files);
+    }
+    Py_XDECREF(columns);
+    Py_XDECREF(file_offsets);
+    Py_XDECREF(errors);
+    Py_XDECREF(encoded);
+    Py_DECREF(sequence);
+    return result;
+}
+
+PyObject * read_many_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "read_many", read_many_call(self, args, kwargs));
+}
@@ -0,0 +1,860 @@
+/**
+ * @file las_2g_compress.c
+ * @author Ryan Wicks
+ * @brief Compressed container for 2G surveys.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_compress.h"
+#include "las_2g_stats.h"
+#include "las_2g_thread.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//-----------------------------------------------------------------
+// Range coder Definitions
+//-----------------------------------------------------------------
+
+#define PROBABILITY_BITS 11
+#define PROBABILITY_ONE (1 << PROBABILITY_BITS)
+#define ADAPT_SHIFT 5
+#define RANGE_TOP (1u << 24)
+
+#define NUMBER_OF_PLANES ((int)sizeof(LASEntry)) // one byte plane per byte of a record
+
+/**
+ * @brief Adaptive probabilities of the 8 bit decisions of a byte, as a binary tree.
+ *
+ */
+typedef struct {
+    uint16_t probabilities[256];
+} ByteModel;
+
+/**
+ * @brief Every model of a chunk, reset at the start of each chunk so chunks decode independently.
+ *
+ */
+typedef struct {
+    ByteModel header;
+    ByteModel planes[NUMBER_OF_PLANES];
+    uint16_t constant[NUMBER_OF_PLANES]; /// plane holds a single repeated byte
+} ChunkModels;
+
+typedef struct {
+    LASByteBuffer * out;
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;
+    uint64_t cache_size;
+    int error; /// memory could not be allocated
+} RangeEncoder;
+
+typedef struct {
+    const uint8_t * data;
+    size_t size;
+    size_t position; /// may run past size on a corrupt chunk, reads there return 0
+    uint32_t range;
+    uint32_t code;
+} RangeDecoder;
+
+static void init_models(ChunkModels * models) {
+    for (int i = 0; i < 256; ++i) {
+        models->header.probabilities[i] = PROBABILITY_ONE / 2;
+    }
+    for (int plane = 0; plane < NUMBER_OF_PLANES; ++plane) {
+        models->planes[plane] = models->header;
+        models->constant[plane] = PROBABILITY_ONE / 2;
+    }
+}
+
+static int reserve_byte_buffer(LASByteBuffer * buffer, size_t size) {
+    if (size <= buffer->capacity) {
+        return 0;
+    }
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    uint8_t * data = (uint8_t *)realloc(buffer->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    las_stats_allocation(capacity);
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+void free_byte_buffer(LASByteBuffer * buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+static void put_byte(RangeEncoder * encoder, uint8_t byte) {
+    LASByteBuffer * out = encoder->out;
+    if (out->size == out->capacity && reserve_byte_buffer(out, out->size + 1) < 0) {
+        encoder->error = 1;
+        return;
+    }
+    out->data[out->size++] = byte;
+}
+
+static void shift_low(RangeEncoder * encoder) {
+    if ((uint32_t)encoder->low < 0xFF000000u || (encoder->low >> 32) != 0) {
+        uint8_t carry = (uint8_t)(encoder->low >> 32);
+        uint8_t byte = encoder->cache;
+        do {
+            put_byte(encoder, (uint8_t)(byte + carry));
+            byte = 0xFF;
+        } while (--encoder->cache_size != 0);
+        encoder->cache = (uint8_t)((uint32_t)encoder->low >> 24);
+    }
+    encoder->cache_size++;
+    encoder->low = (encoder->low & 0x00FFFFFFu) << 8;
+}
+
+static void init_encoder(RangeEncoder * encoder, LASByteBuffer * out) {
+    encoder->out = out;
+    encoder->low = 0;
+    encoder->range = 0xFFFFFFFFu;
+    encoder->cache = 0;
+    encoder->cache_size = 1;
+    encoder->error = 0;
+}
+
+static void flush_encoder(RangeEncoder * encoder) {
+    for (int i = 0; i < 5; ++i) {
+        shift_low(encoder);
+    }
+}
+
+static void encode_bit(RangeEncoder * encoder, uint16_t * probability, int bit) {
+    uint32_t bound = (encoder->range >> PROBABILITY_BITS) * *probability;
+    if (bit == 0) {
+        encoder->range = bound;
+        *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+    } else {
+        encoder->low += bound;
+        encoder->range -= bound;
+        *probability -= *probability >> ADAPT_SHIFT;
+    }
+    while (encoder->range < RANGE_TOP) {
+        encoder->range <<= 8;
+        shift_low(encoder);
+    }
+}
+
+static void encode_byte(RangeEncoder * encoder, ByteModel * model, uint8_t byte) {
+    unsigned int node = 1;
+    for (int i = 7; i >= 0; --i) {
+        int bit = (byte >> i) & 1;
+        encode_bit(encoder, &model->probabilities[node], bit);
+        node = (node << 1) | (unsigned int)bit;
+    }
+}
+
+static uint8_t next_byte(RangeDecoder * decoder) {
+    uint8_t byte = decoder->position < decoder->size ? decoder->data[decoder->position] : 0;
+    decoder->position++;
+    return byte;
+}
+
+static void init_decoder(RangeDecoder * decoder, const uint8_t * data, size_t size) {
+    decoder->data = data;
+    decoder->size = size;
+    decoder->position = 0;
+    decoder->range = 0xFFFFFFFFu;
+    decoder->code = 0;
+    for (int i = 0; i < 5; ++i) {
+        decoder->code = (decoder->code << 8) | next_byte(decoder);
+    }
+}
+
+static int decode_bit(RangeDecoder * decoder, uint16_t * probability) {
+    uint32_t bound = (decoder->range >> PROBABILITY_BITS) * *probability;
+    int bit;
+    if (decoder->code < bound) {
+        decoder->range = bound;
+        *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+        bit = 0;
+    } else {
+        decoder->code -= bound;
+        decoder->range -= bound;
+        *probability -= *probability >> ADAPT_SHIFT;
+        bit = 1;
+    }
+    while (decoder->range < RANGE_TOP) {
+        decoder->range <<= 8;
+        decoder->code = (decoder->code << 8) | next_byte(decoder);
+    }
+    return bit;
+}
+
+static uint8_t decode_byte(RangeDecoder * decoder, ByteModel * model) {
+    unsigned int node = 1;
+    for (int i = 0; i < 8; ++i) {
+        node = (node << 1) | (unsigned int)decode_bit(decoder, &model->probabilities[node]);
+    }
+    return (uint8_t)node;
+}
+
+//-----------------------------------------------------------------
+// Field transform Definitions
+//-----------------------------------------------------------------
+
+static uint32_t zigzag32(uint32_t value) {
+    return (value << 1) ^ (uint32_t)((int32_t)value >> 31);
+}
+
+static uint32_t unzigzag32(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+static uint64_t zigzag64(uint64_t value) {
+    return (value << 1) ^ (uint64_t)((int64_t)value >> 63);
+}
+
+static uint64_t unzigzag64(uint64_t value) {
+    return (value >> 1) ^ (0ull - (value & 1));
+}
+
+/**
+ * @brief Linear prediction from the two previous values, which is exact for points moving
+ * at a constant rate. Wraps around the same way on both sides.
+ *
+ */
+static uint64_t predict(uint64_t previous, uint64_t before_previous, size_t point) {
+    if (point == 0) {
+        return 0;
+    }
+    if (point == 1) {
+        return previous;
+    }
+    return 2 * previous - before_previous;
+}
+
+/**
+ * @brief Split records into byte planes of prediction residuals.
+ *
+ * Planes: 0-3 x, 4-7 y, 8-11 z (linear prediction), 12-13 intensity (delta), 14 bit_field,
+ * 15 classification, 16 scan_angle, 17 user_data, 18-19 point_source_id (as is), 20-27
+ * gps_time bits (linear prediction).
+ *
+ * @param planes NUMBER_OF_PLANES * number_of_entries bytes, plane p of point i at p * number_of_entries + i
+ */
+static void split_planes(const LASEntry * entries, size_t number_of_entries, uint8_t * planes) {
+    uint32_t previous[3] = {0, 0, 0};
+    uint32_t before_previous[3] = {0, 0, 0};
+    uint16_t previous_intensity = 0;
+    uint64_t previous_time = 0;
+    uint64_t before_previous_time = 0;
+    const size_t n = number_of_entries;
+
+    for (size_t i = 0; i < n; ++i) {
+        const LASEntry * entry = entries + i;
+        uint32_t coordinates[3] = {(uint32_t)entry->x, (uint32_t)entry->y, (uint32_t)entry->z};
+
+        for (int axis = 0; axis < 3; ++axis) {
+            uint32_t residual = zigzag32(coordinates[axis] - (uint32_t)predict(previous[axis], before_previous[axis], i));
+            for (int byte = 0; byte < 4; ++byte) {
+                planes[(size_t)(axis * 4 + byte) * n + i] = (uint8_t)(residual >> (8 * byte));
+            }
+            before_previous[axis] = previous[axis];
+            previous[axis] = coordinates[axis];
+        }
+
+        uint16_t intensity = entry->intensity;
+        uint16_t delta = (uint16_t)(intensity - previous_intensity);
+        delta = (uint16_t)((delta << 1) ^ (uint16_t)((int16_t)delta >> 15));
+        planes[12 * n + i] = (uint8_t)delta;
+        planes[13 * n + i] = (uint8_t)(delta >> 8);
+        previous_intensity = intensity;
+
+        planes[14 * n + i] = entry->bit_field;
+        planes[15 * n + i] = entry->classification;
+        planes[16 * n + i] = entry->scan_angle;
+        planes[17 * n + i] = entry->user_data;
+        uint16_t point_source_id = entry->point_source_id;
+        planes[18 * n + i] = (uint8_t)point_source_id;
+        planes[19 * n + i] = (uint8_t)(point_source_id >> 8);
+
+        double gps_time = entry->gps_time;
+        uint64_t time_bits;
+        memcpy(&time_bits, &gps_time, sizeof(time_bits));
+        uint64_t residual = zigzag64(time_bits - predict(previous_time, before_previous_time, i));
+        for (int byte = 0; byte < 8; ++byte) {
+            planes[(size_t)(20 + byte) * n + i] = (uint8_t)(residual >> (8 * byte));
+        }
+        before_previous_time = previous_time;
+        previous_time = time_bits;
+    }
+}
+
+/**
+ * @brief Rebuild records from the byte planes of split_planes.
+ *
+ */
+static void join_planes(const uint8_t * planes, size_t number_of_entries, LASEntry * entries) {
+    uint32_t previous[3] = {0, 0, 0};
+    uint32_t before_previous[3] = {0, 0, 0};
+    uint16_t previous_intensity = 0;
+    uint64_t previous_time = 0;
+    uint64_t before_previous_time = 0;
+    const size_t n = number_of_entries;
+
+    for (size_t i = 0; i < n; ++i) {
+        LASEntry * entry = entries + i;
+        uint32_t coordinates[3];
+
+        for (int axis = 0; axis < 3; ++axis) {
+            uint32_t residual = 0;
+            for (int byte = 0; byte < 4; ++byte) {
+                residual |= (uint32_t)planes[(size_t)(axis * 4 + byte) * n + i] << (8 * byte);
+            }
+            coordinates[axis] = unzigzag32(residual) + (uint32_t)predict(previous[axis], before_previous[axis], i);
+            before_previous[axis] = previous[axis];
+            previous[axis] = coordinates[axis];
+        }
+        entry->x = (int32_t)coordinates[0];
+        entry->y = (int32_t)coordinates[1];
+        entry->z = (int32_t)coordinates[2];
+
+        uint16_t delta = (uint16_t)(planes[12 * n + i] | (planes[13 * n + i] << 8));
+        delta = (uint16_t)((delta >> 1) ^ (uint16_t)(0u - (delta & 1)));
+        previous_intensity = (uint16_t)(previous_intensity + delta);
+        entry->intensity = previous_intensity;
+
+        entry->bit_field = planes[14 * n + i];
+        entry->classification = planes[15 * n + i];
+        entry->scan_angle = planes[16 * n + i];
+        entry->user_data = planes[17 * n + i];
+        entry->point_source_id = (uint16_t)(planes[18 * n + i] | (planes[19 * n + i] << 8));
+
+        uint64_t residual = 0;
+        for (int byte = 0; byte < 8; ++byte) {
+            residual |= (uint64_t)planes[(size_t)(20 + byte) * n + i] << (8 * byte);
+        }
+        uint64_t time_bits = unzigzag64(residual) + predict(previous_time, before_previous_time, i);
+        double gps_time;
+        memcpy(&gps_time, &time_bits, sizeof(gps_time));
+        entry->gps_time = gps_time;
+        before_previous_time = previous_time;
+        previous_time = time_bits;
+    }
+}
+
+//-----------------------------------------------------------------
+// Chunk Definitions
+//-----------------------------------------------------------------
+
+uint32_t profile_checksum(const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries) {
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t * bytes = (const uint8_t *)header;
+    for (size_t i = 0; i < sizeof(LASHeader); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    bytes = (const uint8_t *)entries;
+    for (size_t i = 0; i < (size_t)number_of_entries * sizeof(LASEntry); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+int is_compressed_las(const uint8_t * data, uint64_t size) {
+    return size >= sizeof(LASCompressedHeader) && memcmp(data, COMPRESSED_SIGNATURE, 8) == 0;
+}
+
+int compress_profile(const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries, LASByteBuffer * chunk) {
+    const size_t n = number_of_entries;
+    uint64_t start = las_stats_clock();
+    uint8_t * planes = (uint8_t *)malloc(n > 0 ? n * NUMBER_OF_PLANES : 1);
+    ChunkModels * models = (ChunkModels *)malloc(sizeof(ChunkModels));
+    RangeEncoder encoder;
+
+    chunk->size = 0;
+    if (!planes || !models || reserve_byte_buffer(chunk, n * NUMBER_OF_PLANES / 4 + 256) < 0) {
+        free(planes);
+        free(models);
+        las_stats_phase(LAS_PHASE_COMPRESS, start);
+        return -1;
+    }
+
+    init_models(models);
+    init_encoder(&encoder, chunk);
+    split_planes(entries, n, planes);
+
+    const uint8_t * header_bytes = (const uint8_t *)header;
+    for (size_t i = 0; i < sizeof(LASHeader); ++i) {
+        encode_byte(&encoder, &models->header, header_bytes[i]);
+    }
+
+    for (int plane = 0; plane < NUMBER_OF_PLANES; ++plane) {
+        const uint8_t * bytes = planes + (size_t)plane * n;
+        int constant = 1;
+        for (size_t i = 1; i < n && constant; ++i) {
+            constant = bytes[i] == bytes[0];
+        }
+
+        // planes that never change, e.g. unused fields or high residual bytes, cost a few bits.
+        encode_bit(&encoder, &models->constant[plane], constant);
+        if (constant) {
+            if (n > 0) {
+                encode_byte(&encoder, &models->planes[plane], bytes[0]);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            encode_byte(&encoder, &models->planes[plane], bytes[i]);
+        }
+    }
+    flush_encoder(&encoder);
+
+    free(planes);
+    free(models);
+    las_stats_phase(LAS_PHASE_COMPRESS, start);
+    return encoder.error ? -1 : 0;
+}
+
+int decompress_profile_header(const uint8_t * chunk, size_t size, LASHeader * header) {
+    ChunkModels * models = (ChunkModels *)malloc(sizeof(ChunkModels));
+    RangeDecoder decoder;
+
+    if (!models) {
+        return -1;
+    }
+    init_models(models);
+    init_decoder(&decoder, chunk, size);
+
+    uint8_t * header_bytes = (uint8_t *)header;
+    for (size_t i = 0; i < sizeof(LASHeader); ++i) {
+        header_bytes[i] = decode_byte(&decoder, &models->header);
+    }
+    free(models);
+    return decoder.position <= size ? 0 : -1;
+}
+
+int decompress_profile(const uint8_t * chunk, size_t size, uint32_t number_of_entries, LASHeader * header, LASProfileBuffer * buffer) {
+    const size_t n = number_of_entries;
+    RangeDecoder decoder;
+
+    if (reserve_profile_buffer(buffer, n) < 0) {
+        return -2;
+    }
+    uint64_t start = las_stats_clock();
+    uint8_t * planes = (uint8_t *)malloc(n > 0 ? n * NUMBER_OF_PLANES : 1);
+    ChunkModels * models = (ChunkModels *)malloc(sizeof(ChunkModels));
+    if (!planes || !models) {
+        free(planes);
+        free(models);
+        las_stats_phase(LAS_PHASE_COMPRESS, start);
+        return -2;
+    }
+
+    init_models(models);
+    init_decoder(&decoder, chunk, size);
+
+    uint8_t * header_bytes = (uint8_t *)header;
+    for (size_t i = 0; i < sizeof(LASHeader); ++i) {
+        header_bytes[i] = decode_byte(&decoder, &models->header);
+    }
+
+    for (int plane = 0; plane < NUMBER_OF_PLANES && decoder.position <= size; ++plane) {
+        uint8_t * bytes = planes + (size_t)plane * n;
+        if (decode_bit(&decoder, &models->constant[plane])) {
+            if (n > 0) {
+                memset(bytes, decode_byte(&decoder, &models->planes[plane]), n);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            bytes[i] = decode_byte(&decoder, &models->planes[plane]);
+        }
+    }
+
+    int ret = 0;
+    if (decoder.position > size) {
+        ret = -1; // ran out of input, the chunk is truncated or corrupt.
+    } else {
+        join_planes(planes, n, buffer->entries);
+    }
+    free(planes);
+    free(models);
+    las_stats_phase(LAS_PHASE_COMPRESS, start);
+    return ret;
+}
+
+//-----------------------------------------------------------------
+// Container Definitions
+//-----------------------------------------------------------------
+
+int64_t open_compressed(const char * filename, LASCompressedFile * file) {
+    LASCompressedHeader header;
+    LASCompressedFooter footer;
+
+    file->chunks = NULL;
+    file->number_of_profiles = 0;
+    file->number_of_points = 0;
+    if (map_file(filename, &file->mapped) < 0) {
+        return -1;
+    }
+
+    const uint8_t * data = file->mapped.data;
+    uint64_t size = file->mapped.size;
+    if (!is_compressed_las(data, size) || size < sizeof(LASCompressedHeader) + sizeof(LASCompressedFooter)) {
+        unmap_file(&file->mapped);
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+
+    uint64_t index_end = size - sizeof(footer);
+    if (header.version != COMPRESSED_VERSION || header.entry_size != sizeof(LASChunkEntry) ||
+        memcmp(footer.signature, COMPRESSED_SIGNATURE, 8) != 0 ||
+        footer.index_offset < sizeof(header) || footer.index_offset > index_end ||
+        footer.number_of_profiles != (index_end - footer.index_offset) / sizeof(LASChunkEntry) ||
+        (index_end - footer.index_offset) % sizeof(LASChunkEntry) != 0) {
+        unmap_file(&file->mapped);
+        return -1;
+    }
+
+    file->chunks = (LASChunkEntry *)malloc(footer.number_of_profiles > 0 ? footer.number_of_profiles * sizeof(LASChunkEntry) : 1);
+    if (!file->chunks) {
+        unmap_file(&file->mapped);
+        return -2;
+    }
+    memcpy(file->chunks, data + footer.index_offset, footer.number_of_profiles * sizeof(LASChunkEntry));
+
+    uint64_t number_of_points = 0;
+    for (uint64_t i = 0; i < footer.number_of_profiles; ++i) {
+        const LASChunkEntry * chunk = file->chunks + i;
+        if (chunk->offset < sizeof(header) || chunk->offset > footer.index_offset ||
+            chunk->size > footer.index_offset - chunk->offset) {
+            close_compressed(file);
+            return -1;
+        }
+        number_of_points += chunk->number_of_points;
+    }
+    if (number_of_points != footer.number_of_points) {
+        close_compressed(file);
+        return -1;
+    }
+
+    file->number_of_profiles = footer.number_of_profiles;
+    file->number_of_points = number_of_points;
+    return (int64_t)file->number_of_profiles;
+}
+
+int read_compressed_profile(const LASCompressedFile * file, uint64_t profile, LASHeader * header, LASProfileBuffer * buffer) {
+    const LASChunkEntry * chunk = file->chunks + profile;
+    int ret = decompress_profile(file->mapped.data + chunk->offset, chunk->size, chunk->number_of_points, header, buffer);
+    if (ret == 0 && profile_checksum(header, buffer->entries, chunk->number_of_points) != chunk->checksum) {
+        ret = -1;
+    }
+    if (ret == 0) {
+        las_stats_add(LAS_COUNTER_BYTES_READ, chunk->size);
+        las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+        las_stats_add(LAS_COUNTER_POINTS_READ, chunk->number_of_points);
+    }
+    return ret;
+}
+
+void close_compressed(LASCompressedFile * file) {
+    free(file->chunks);
+    file->chunks = NULL;
+    file->number_of_profiles = 0;
+    file->number_of_points = 0;
+    unmap_file(&file->mapped);
+}
+
+int open_compressed_writer(LASCompressedWriter * writer, const char * filename) {
+    LASCompressedHeader header;
+
+    memset(writer, 0, sizeof(LASCompressedWriter));
+    writer->fid = fopen(filename, "wb");
+    if (writer->fid == NULL) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, COMPRESSED_SIGNATURE, 8);
+    header.version = COMPRESSED_VERSION;
+    header.entry_size = sizeof(LASChunkEntry);
+    if (fwrite(&header, sizeof(header), 1, writer->fid) != 1) {
+        fclose(writer->fid);
+        writer->fid = NULL;
+        return -1;
+    }
+    writer->offset = sizeof(header);
+    return 0;
+}
+
+int compressed_writer_append_chunk(LASCompressedWriter * writer, const uint8_t * chunk, size_t size, uint32_t number_of_entries, uint32_t checksum) {
+    if (size > UINT32_MAX) {
+        return -1;
+    }
+    if (writer->number_of_profiles == writer->capacity) {
+        uint64_t capacity = writer->capacity > 0 ? writer->capacity * 2 : 1024;
+        LASChunkEntry * chunks = (LASChunkEntry *)realloc(writer->chunks, capacity * sizeof(LASChunkEntry));
+        if (!chunks) {
+            return -1;
+        }
+        las_stats_allocation(capacity * sizeof(LASChunkEntry));
+        writer->chunks = chunks;
+        writer->capacity = capacity;
+    }
+    uint64_t start = las_stats_clock();
+    size_t written = fwrite(chunk, 1, size, writer->fid);
+    las_stats_phase(LAS_PHASE_WRITE, start);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, written);
+    if (written != size) {
+        return -1;
+    }
+    las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, 1);
+    las_stats_add(LAS_COUNTER_POINTS_WRITTEN, number_of_entries);
+
+    LASChunkEntry * entry = writer->chunks + writer->number_of_profiles;
+    entry->offset = writer->offset;
+    entry->size = (uint32_t)size;
+    entry->number_of_points = number_of_entries;
+    entry->checksum = checksum;
+    entry->reserved = 0;
+    writer->offset += size;
+    writer->number_of_points += number_of_entries;
+    writer->number_of_profiles += 1;
+    return 0;
+}
+
+int compressed_writer_append(LASCompressedWriter * writer, const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries) {
+    if (compress_profile(header, entries, number_of_entries, &writer->chunk) < 0) {
+        return -1;
+    }
+    return compressed_writer_append_chunk(writer, writer->chunk.data, writer->chunk.size, number_of_entries,
+                                          profile_checksum(header, entries, number_of_entries));
+}
+
+int close_compressed_writer(LASCompressedWriter * writer) {
+    LASCompressedFooter footer;
+    int ret = 0;
+
+    if (writer->fid == NULL) {
+        return -1;
+    }
+
+    memset(&footer, 0, sizeof(footer));
+    footer.index_offset = writer->offset;
+    footer.number_of_profiles = writer->number_of_profiles;
+    footer.number_of_points = writer->number_of_points;
+    memcpy(footer.signature, COMPRESSED_SIGNATURE, 8);
+
+    if ((writer->number_of_profiles > 0 &&
+         fwrite(writer->chunks, sizeof(LASChunkEntry), writer->number_of_profiles, writer->fid) != writer->number_of_profiles) ||
+        fwrite(&footer, sizeof(footer), 1, writer->fid) != 1) {
+        ret = -1;
+    }
+    if (fclose(writer->fid) != 0) {
+        ret = -1;
+    }
+
+    free(writer->chunks);
+    free_byte_buffer(&writer->chunk);
+    memset(writer, 0, sizeof(LASCompressedWriter));
+    return ret;
+}
+
+//-----------------------------------------------------------------
+// Converter Definitions
+//-----------------------------------------------------------------
+
+// the workers of a batch report errors through these, the caller reads them once the batch is done.
+#ifdef _MSC_VER
+static void atomic_store_error(long * target, long value) {
+    InterlockedExchange((volatile long *)target, value);
+}
+
+static long atomic_load_error(long * target) {
+    return InterlockedCompareExchange((volatile long *)target, 0, 0);
+}
+#else
+static void atomic_store_error(long * target, long value) {
+    __atomic_store_n(target, value, __ATOMIC_RELAXED);
+}
+
+static long atomic_load_error(long * target) {
+    return __atomic_load_n(target, __ATOMIC_RELAXED);
+}
+#endif
+
+typedef struct {
+    const uint8_t * data;
+    const LASProfileTable * table;
+    uint64_t first_profile; /// first profile of the batch
+    LASByteBuffer * chunks; /// one per profile of the batch
+    uint32_t * checksums;
+    long error;
+} CompressBatch;
+
+static void compress_batch_profile(void * context, size_t item) {
+    CompressBatch * batch = (CompressBatch *)context;
+    uint64_t profile = batch->first_profile + item;
+    const uint8_t * start = batch->data + batch->table->offsets[profile];
+    LASHeader header;
+
+    const LASEntry * entries = (const LASEntry *)(start + sizeof(LASHeader));
+    uint32_t number_of_entries = batch->table->point_counts[profile];
+
+    memcpy(&header, start, sizeof(LASHeader));
+    batch->checksums[item] = profile_checksum(&header, entries, number_of_entries);
+    if (compress_profile(&header, entries, number_of_entries, &batch->chunks[item]) < 0) {
+        atomic_store_error(&batch->error, 1);
+    }
+}
+
+int64_t compress_las_file(const char * source, const char * destination, int threads) {
+    LASMappedFile mapped;
+    LASProfileTable table;
+    LASCompressedWriter writer;
+    LASByteBuffer chunks[COMPRESS_BATCH_PROFILES];
+    uint32_t checksums[COMPRESS_BATCH_PROFILES];
+
+    if (map_file(source, &mapped) < 0) {
+        return -1;
+    }
+    if (scan_profiles_mapped(mapped.data, mapped.size, &table) < 0) {
+        unmap_file(&mapped);
+        return -1;
+    }
+    if (open_compressed_writer(&writer, destination) < 0) {
+        free_profile_table(&table);
+        unmap_file(&mapped);
+        return -1;
+    }
+
+    memset(chunks, 0, sizeof(chunks));
+    int ret = 0;
+    for (uint64_t first = 0; first < table.number_of_profiles && ret == 0; first += COMPRESS_BATCH_PROFILES) {
+        uint64_t remaining = table.number_of_profiles - first;
+        size_t count = remaining < COMPRESS_BATCH_PROFILES ? (size_t)remaining : COMPRESS_BATCH_PROFILES;
+        CompressBatch batch = {mapped.data, &table, first, chunks, checksums, 0};
+
+        las_parallel_for(count, threads, compress_batch_profile, &batch);
+        if (atomic_load_error(&batch.error)) {
+            ret = -1;
+            break;
+        }
+        for (size_t i = 0; i < count && ret == 0; ++i) {
+            ret = compressed_writer_append_chunk(&writer, chunks[i].data, chunks[i].size, table.point_counts[first + i], checksums[i]);
+        }
+    }
+
+    if (close_compressed_writer(&writer) < 0) {
+        ret = -1;
+    }
+    for (int i = 0; i < COMPRESS_BATCH_PROFILES; ++i) {
+        free_byte_buffer(&chunks[i]);
+    }
+    int64_t number_of_profiles = (int64_t)table.number_of_profiles;
+    free_profile_table(&table);
+    unmap_file(&mapped);
+    return ret < 0 ? -1 : number_of_profiles;
+}
+
+typedef struct {
+    const LASCompressedFile * file;
+    const LASProfileFilter * filter; /// NULL to keep every profile
+    uint64_t first_profile;
+    LASHeader * headers; /// one per profile of the batch
+    LASProfileBuffer * buffers;
+    int * keep;
+    long error; /// an error seen by a worker, 0 for none
+} DecompressBatch;
+
+static void decompress_batch_profile(void * context, size_t item) {
+    DecompressBatch * batch = (DecompressBatch *)context;
+    uint64_t profile = batch->first_profile + item;
+    const LASChunkEntry * chunk = batch->file->chunks + profile;
+    const LASProfileFilter * filter = batch->filter;
+    LASHeader * header = &batch->headers[item];
+    int keep = 1;
+    int ret = 0;
+
+    // the header is decoded on its own first, so profiles the filter rules out are never
+    // decompressed.
+    if (filter && (filter->has_bbox || filter->has_time)) {
+        ret = decompress_profile_header(batch->file->mapped.data + chunk->offset, chunk->size, header);
+        keep = ret < 0 ? 1 : filter_profile_header(filter, header);
+    }
+    if (keep != 0) {
+        ret = read_compressed_profile(batch->file, profile, header, &batch->buffers[item]);
+    }
+    if (ret == 0 && keep < 0) {
+        keep = filter_profile_entries(filter, header, batch->buffers[item].entries, chunk->number_of_points);
+    }
+
+    if (ret < 0) {
+        atomic_store_error(&batch->error, ret); // a batch with both errors may report either.
+    }
+    batch->keep[item] = ret == 0 && keep != 0;
+}
+
+int read_compressed_batch(const LASCompressedFile * file, uint64_t first, size_t count, const LASProfileFilter * filter,
+                          int threads, LASHeader * headers, LASProfileBuffer * buffers, int * keep) {
+    DecompressBatch batch = {file, filter, first, headers, buffers, keep, 0};
+    las_parallel_for(count, threads, decompress_batch_profile, &batch);
+    return (int)atomic_load_error(&batch.error);
+}
+
+int64_t decompress_las_file(const char * source, const char * destination, int threads) {
+    LASCompressedFile file;
+    LASHeader headers[COMPRESS_BATCH_PROFILES];
+    LASProfileBuffer buffers[COMPRESS_BATCH_PROFILES];
+    int keep[COMPRESS_BATCH_PROFILES];
+
+    if (open_compressed(source, &file) < 0) {
+        return -1;
+    }
+    FILE * fid = fopen(destination, "wb");
+    if (fid == NULL) {
+        close_compressed(&file);
+        return -1;
+    }
+
+    memset(buffers, 0, sizeof(buffers));
+    int ret = 0;
+    for (uint64_t first = 0; first < file.number_of_profiles && ret == 0; first += COMPRESS_BATCH_PROFILES) {
+        uint64_t remaining = file.number_of_profiles - first;
+        size_t count = remaining < COMPRESS_BATCH_PROFILES ? (size_t)remaining : COMPRESS_BATCH_PROFILES;
+
+        if (read_compressed_batch(&file, first, count, NULL, threads, headers, buffers, keep) < 0) {
+            ret = -1;
+            break;
+        }
+        for (size_t i = 0; i < count && ret == 0; ++i) {
+            size_t number_of_entries = file.chunks[first + i].number_of_points;
+            uint64_t start = las_stats_clock();
+            if (!write_header(fid, &headers[i]) ||
+                (number_of_entries > 0 && write_entries(fid, buffers[i].entries, number_of_entries) != number_of_entries)) {
+                ret = -1;
+            }
+            las_stats_phase(LAS_PHASE_WRITE, start);
+        }
+    }
+
+    if (fclose(fid) != 0) {
+        ret = -1;
+    }
+    for (int i = 0; i < COMPRESS_BATCH_PROFILES; ++i) {
+        free_profile_buffer(&buffers[i]);
+    }
+    int64_t number_of_profiles = (int64_t)file.number_of_profiles;
+    close_compressed(&file);
+    return ret < 0 ? -1 : number_of_profiles;
+}
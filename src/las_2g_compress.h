@@ -0,0 +1,258 @@
+#ifndef LAS_2G_COMPRESS_H
+#define LAS_2G_COMPRESS_H
+
+/**
+ * @brief Compressed container for 2G surveys. Every profile is stored as one independently
+ * decodable chunk: the point fields are split into byte planes after delta or linear
+ * prediction, and each plane is coded with an adaptive binary range coder. A chunk index
+ * and a footer at the end of the file give random access to the profiles.
+ *
+ * Layout: LASCompressedHeader, the chunks, one LASChunkEntry per profile, LASCompressedFooter.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define COMPRESSED_EXTENSION ".las2gz" // write_las compresses files with this extension
+#define COMPRESSED_SIGNATURE "LAS2GCMP"
+#define COMPRESSED_VERSION 1
+#define COMPRESS_BATCH_PROFILES 256 // profiles converted per parallel batch by the file converters
+
+/**
+ * @brief Fixed header at the start of a compressed file.
+ *
+ */
+typedef struct {
+    char signature[8];
+    uint32_t version;
+    uint32_t entry_size; /// sizeof(LASChunkEntry) when the file was written
+} LASCompressedHeader;
+
+/**
+ * @brief Location of one compressed profile.
+ *
+ */
+typedef struct {
+    uint64_t offset; /// byte offset of the chunk in the file
+    uint32_t size; /// bytes in the chunk
+    uint32_t number_of_points;
+    uint32_t checksum; /// FNV-1a of the header and records, folded to 32 bits
+    uint32_t reserved;
+} LASChunkEntry;
+
+/**
+ * @brief Fixed footer at the end of a compressed file.
+ *
+ */
+typedef struct {
+    uint64_t index_offset; /// byte offset of the first LASChunkEntry
+    uint64_t number_of_profiles;
+    uint64_t number_of_points;
+    char signature[8];
+} LASCompressedFooter;
+
+/**
+ * @brief Growable byte array.
+ *
+ */
+typedef struct {
+    uint8_t * data;
+    size_t size;
+    size_t capacity;
+} LASByteBuffer;
+
+/**
+ * @brief A compressed file opened for random access.
+ *
+ */
+typedef struct {
+    LASMappedFile mapped;
+    LASChunkEntry * chunks;
+    uint64_t number_of_profiles;
+    uint64_t number_of_points;
+} LASCompressedFile;
+
+/**
+ * @brief Writes a compressed file one profile at a time.
+ *
+ */
+typedef struct {
+    FILE * fid;
+    LASChunkEntry * chunks;
+    uint64_t number_of_profiles;
+    uint64_t capacity; /// entries chunks has room for
+    uint64_t number_of_points;
+    uint64_t offset; /// bytes written so far
+    LASByteBuffer chunk; /// reused for every profile
+} LASCompressedWriter;
+
+/**
+ * @brief Check whether data starts like a compressed file.
+ *
+ * @param data
+ * @param size bytes available at data
+ * @return int 1 if it does, 0 otherwise.
+ */
+int is_compressed_las(const uint8_t * data, uint64_t size);
+
+/**
+ * @brief Compress one profile into a chunk.
+ *
+ * @param header
+ * @param entries
+ * @param number_of_entries
+ * @param chunk zero initialised before first use, replaced by the chunk. Release with free_byte_buffer.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int compress_profile(const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries, LASByteBuffer * chunk);
+
+/**
+ * @brief Checksum of a profile stored in its LASChunkEntry, to detect corrupt chunks.
+ *
+ * @param header
+ * @param entries
+ * @param number_of_entries
+ * @return uint32_t
+ */
+uint32_t profile_checksum(const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries);
+
+/**
+ * @brief Decode only the header of a chunk.
+ *
+ * @param chunk
+ * @param size
+ * @param header
+ * @return int 0 on success, -1 if the chunk is corrupt.
+ */
+int decompress_profile_header(const uint8_t * chunk, size_t size, LASHeader * header);
+
+/**
+ * @brief Decode a chunk.
+ *
+ * @param chunk
+ * @param size
+ * @param number_of_entries points in the chunk, from its LASChunkEntry
+ * @param header
+ * @param buffer receives the records in buffer->entries
+ * @return int 0 on success, -1 if the chunk is corrupt, -2 if memory could not be allocated.
+ */
+int decompress_profile(const uint8_t * chunk, size_t size, uint32_t number_of_entries, LASHeader * header, LASProfileBuffer * buffer);
+
+/**
+ * @brief Release a byte buffer.
+ *
+ * @param buffer
+ */
+void free_byte_buffer(LASByteBuffer * buffer);
+
+/**
+ * @brief Map a compressed file and load its chunk index.
+ *
+ * @param filename
+ * @param file filled on success, release with close_compressed.
+ * @return int64_t number of profiles, or -1 if the file could not be mapped, is not a compressed
+ * file or its index is damaged, -2 if memory could not be allocated.
+ */
+int64_t open_compressed(const char * filename, LASCompressedFile * file);
+
+/**
+ * @brief Decode one profile of an open compressed file and check it against its checksum.
+ *
+ * @param file
+ * @param profile index of the profile
+ * @param header
+ * @param buffer receives the records in buffer->entries
+ * @return int 0 on success, -1 if the chunk is corrupt, -2 if memory could not be allocated.
+ */
+int read_compressed_profile(const LASCompressedFile * file, uint64_t profile, LASHeader * header, LASProfileBuffer * buffer);
+
+/**
+ * @brief Decode a batch of consecutive profiles of an open compressed file with
+ * las_parallel_for. With a filter, each header is checked before its profile is decoded
+ * and the records after, as read_next_profile does.
+ *
+ * @param file
+ * @param first index of the first profile of the batch
+ * @param count number of profiles in the batch
+ * @param filter NULL to keep every profile
+ * @param threads number of workers, 0 for one per processor
+ * @param headers count headers, number_of_point_records is left as stored in the chunk
+ * @param buffers count buffers, reused between batches and released with free_profile_buffer
+ * @param keep set to 1 for every profile decoded and kept by the filter, 0 otherwise
+ * @return int 0 on success, -1 if a chunk is corrupt, -2 if memory could not be allocated.
+ */
+int read_compressed_batch(const LASCompressedFile * file, uint64_t first, size_t count, const LASProfileFilter * filter,
+                          int threads, LASHeader * headers, LASProfileBuffer * buffers, int * keep);
+
+/**
+ * @brief Unmap a compressed file and release its index.
+ *
+ * @param file
+ */
+void close_compressed(LASCompressedFile * file);
+
+/**
+ * @brief Create a compressed file and write its header.
+ *
+ * @param writer
+ * @param filename
+ * @return int 0 on success, -1 if the file could not be created.
+ */
+int open_compressed_writer(LASCompressedWriter * writer, const char * filename);
+
+/**
+ * @brief Compress and write one profile.
+ *
+ * @param writer
+ * @param header written as is
+ * @param entries
+ * @param number_of_entries
+ * @return int 0 on success, -1 if the write failed or memory could not be allocated.
+ */
+int compressed_writer_append(LASCompressedWriter * writer, const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries);
+
+/**
+ * @brief Write a chunk that was already compressed with compress_profile.
+ *
+ * @param writer
+ * @param chunk
+ * @param size
+ * @param number_of_entries
+ * @param checksum profile_checksum of the profile
+ * @return int 0 on success, -1 if the write failed or memory could not be allocated.
+ */
+int compressed_writer_append_chunk(LASCompressedWriter * writer, const uint8_t * chunk, size_t size, uint32_t number_of_entries, uint32_t checksum);
+
+/**
+ * @brief Write the chunk index and footer, close the file and release the writer.
+ *
+ * @param writer
+ * @return int 0 on success, -1 if the file could not be completed.
+ */
+int close_compressed_writer(LASCompressedWriter * writer);
+
+/**
+ * @brief Convert a plain LAS file into a compressed file, compressing the profiles in
+ * parallel batches.
+ *
+ * @param source plain LAS filename
+ * @param destination compressed filename, replaced
+ * @param threads number of workers, 0 for one per processor
+ * @return int64_t number of profiles, or -1 if the source could not be read or the
+ * destination could not be written.
+ */
+int64_t compress_las_file(const char * source, const char * destination, int threads);
+
+/**
+ * @brief Convert a compressed file back into a plain LAS file, byte for byte the file it
+ * was made from.
+ *
+ * @param source compressed filename
+ * @param destination plain LAS filename, replaced
+ * @param threads number of workers, 0 for one per processor
+ * @return int64_t number of profiles, or -1 if the source could not be read or is
+ * corrupt or the destination could not be written.
+ */
+int64_t decompress_las_file(const char * source, const char * destination, int threads);
+
+#endif
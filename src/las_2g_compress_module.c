@@ -0,0 +1,136 @@
+/**
+ * @file las_2g_compress_module.c
+ * @author Ryan Wicks
+ * @brief Python access to the compressed survey container.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_compress.h"
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+int LASCompressed_Check(const char * filename) {
+    LASCompressedHeader header;
+    int compressed = 0;
+
+    FILE * fid = fopen(filename, "rb");
+    if (fid != NULL) {
+        size_t size = fread(&header, 1, sizeof(header), fid);
+        compressed = is_compressed_las((const uint8_t *)&header, size);
+        fclose(fid);
+    }
+    return compressed;
+}
+
+int LASCompressed_ExtensionMatches(const char * filename) {
+    size_t length = strlen(filename);
+    size_t extension_length = strlen(COMPRESSED_EXTENSION);
+    return length >= extension_length && strcmp(filename + length - extension_length, COMPRESSED_EXTENSION) == 0;
+}
+
+PyObject * LASCompressed_ReadFiles(const char * filename, const LASProfileFilter * filter, int fields) {
+    LASCompressedFile file;
+    LASHeader headers[COMPRESS_BATCH_PROFILES];
+    LASProfileBuffer buffers[COMPRESS_BATCH_PROFILES];
+    int keep[COMPRESS_BATCH_PROFILES];
+    int64_t number_of_profiles;
+
+    Py_BEGIN_ALLOW_THREADS
+    number_of_profiles = open_compressed(filename, &file);
+    Py_END_ALLOW_THREADS
+    if (number_of_profiles < 0) {
+        PyErr_SetString(PyExc_RuntimeError, number_of_profiles == -1 ? "Failed to open LAS file.\n" : "Failed to allocate memory for entries.");
+        return NULL;
+    }
+
+    PyObject * data_list = PyList_New(0);
+    if (!data_list) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create list for LAS file entries.");
+        close_compressed(&file);
+        return NULL;
+    }
+
+    // batches are decoded on every processor without the GIL, then turned into LASFiles.
+    memset(buffers, 0, sizeof(buffers));
+    int ret = 0;
+    for (uint64_t first = 0; first < file.number_of_profiles && ret == 0; first += COMPRESS_BATCH_PROFILES) {
+        uint64_t remaining = file.number_of_profiles - first;
+        size_t count = remaining < COMPRESS_BATCH_PROFILES ? (size_t)remaining : COMPRESS_BATCH_PROFILES;
+
+        Py_BEGIN_ALLOW_THREADS
+        ret = read_compressed_batch(&file, first, count, filter, 0, headers, buffers, keep);
+        Py_END_ALLOW_THREADS
+        if (ret < 0) {
+            PyErr_SetString(PyExc_RuntimeError, ret == -1 ? "Could not load entry from file." : "Failed to allocate memory for entries.");
+            break;
+        }
+
+        for (size_t i = 0; i < count && ret == 0; ++i) {
+            if (!keep[i]) {
+                continue;
+            }
+            // the reader trusts the chunk index for the number of points.
+            headers[i].number_of_point_records = file.chunks[first + i].number_of_points;
+            PyObject * file_entry = LASFile_FromRecords(&headers[i], buffers[i].entries, fields);
+            if (!file_entry || PyList_Append(data_list, file_entry) < 0) {
+                ret = -1;
+            }
+            Py_XDECREF(file_entry);
+        }
+    }
+
+    for (int i = 0; i < COMPRESS_BATCH_PROFILES; ++i) {
+        free_profile_buffer(&buffers[i]);
+    }
+    close_compressed(&file);
+    if (ret < 0) {
+        Py_DECREF(data_list);
+        return NULL;
+    }
+    return data_list;
+}
+
+static PyObject * convert_wrapper(PyObject * args, PyObject * kwargs, int64_t (*convert)(const char *, const char *, int)) {
+    static char * keywords[] = {"source", "destination", "threads", NULL};
+    char * source;
+    char * destination;
+    int threads = 0;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|i", keywords, &source, &destination, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+
+    int64_t number_of_profiles;
+    Py_BEGIN_ALLOW_THREADS
+    number_of_profiles = convert(source, destination, threads);
+    Py_END_ALLOW_THREADS
+
+    if (number_of_profiles < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to convert LAS file.");
+        return NULL;
+    }
+    return PyLong_FromLongLong(number_of_profiles);
+}
+
+PyObject * compress_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "compress_las", convert_wrapper(args, kwargs, compress_las_file));
+}
+
+PyObject * decompress_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "decompress_las", convert_wrapper(args, kwargs, decompress_las_file));
+}
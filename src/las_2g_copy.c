@@ -0,0 +1,356 @@
+/**
+ * @file las_2g_copy.c
+ * @author Ryan Wicks
+ * @brief Concatenation and extraction of profiles without decoding them.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // copy_file_range
+#endif
+
+#include "las_2g_copy.h"
+#include "las_2g_compress.h"
+#include "las_2g_stats.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE
+#endif
+
+#define COPY_METHOD_FILE_RANGE 0 /// copy_file_range, which may share the blocks on CoW file systems
+#define COPY_METHOD_SENDFILE 1
+#define COPY_METHOD_BUFFERED 2
+
+#define COPY_CHUNK_SIZE 0x40000000 // largest request passed to one system call
+
+/**
+ * @brief The file profiles are copied to.
+ *
+ */
+typedef struct {
+#ifdef _WIN32
+    FILE * fid;
+#else
+    int fd;
+#endif
+    int method; /// fastest COPY_METHOD_ still worth trying, lowered when the OS refuses one
+    uint8_t * buffer; /// staging area of the buffered copy, allocated on first use
+} CopyDestination;
+
+static int open_destination(CopyDestination * out, const char * filename) {
+    out->buffer = NULL;
+#ifdef _WIN32
+    out->method = COPY_METHOD_BUFFERED;
+    out->fid = fopen(filename, "wb");
+    return out->fid != NULL ? 0 : -1;
+#else
+#if defined(HAVE_COPY_FILE_RANGE)
+    out->method = COPY_METHOD_FILE_RANGE;
+#elif defined(__linux__)
+    out->method = COPY_METHOD_SENDFILE;
+#else
+    out->method = COPY_METHOD_BUFFERED;
+#endif
+    out->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    return out->fd >= 0 ? 0 : -1;
+#endif
+}
+
+/**
+ * @return int 0 on success, -1 if the last of the data could not be written.
+ */
+static int close_destination(CopyDestination * out) {
+    int ret;
+    free(out->buffer);
+    out->buffer = NULL;
+#ifdef _WIN32
+    ret = fclose(out->fid) == 0 ? 0 : -1;
+#else
+    ret = close(out->fd) == 0 ? 0 : -1;
+#endif
+    return ret;
+}
+
+static int write_destination(CopyDestination * out, const uint8_t * data, size_t size) {
+#ifdef _WIN32
+    return fwrite(data, 1, size, out->fid) == size ? 0 : -1;
+#else
+    while (size > 0) {
+        ssize_t done = write(out->fd, data, size);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return -1;
+        }
+        data += done;
+        size -= (size_t)done;
+    }
+    return 0;
+#endif
+}
+
+/**
+ * @brief Append a byte range of a source to the destination, with the fastest method the
+ * OS accepts.
+ *
+ * @return int 0 on success, or one of the COPY_ERROR_ values.
+ */
+static int copy_bytes(CopyDestination * out, const LASPreadFile * source, uint64_t offset, uint64_t size) {
+    uint64_t start = las_stats_clock();
+    uint64_t total = size;
+    int ret = 0;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    while (size > 0 && out->method == COPY_METHOD_FILE_RANGE) {
+        loff_t source_offset = (loff_t)offset;
+        ssize_t done = copy_file_range(source->fd, &source_offset, out->fd, NULL,
+                                       size > COPY_CHUNK_SIZE ? COPY_CHUNK_SIZE : (size_t)size, 0);
+        if (done < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EPERM)) {
+            out->method = COPY_METHOD_SENDFILE; // e.g. across file systems before Linux 5.3
+        } else if (done < 0 && errno == EINTR) {
+            continue;
+        } else if (done <= 0) {
+            ret = done == 0 ? COPY_ERROR_SOURCE : COPY_ERROR_DESTINATION;
+            goto done;
+        } else {
+            offset += (uint64_t)done;
+            size -= (uint64_t)done;
+        }
+    }
+#endif
+#ifdef __linux__
+    while (size > 0 && out->method == COPY_METHOD_SENDFILE) {
+        off_t source_offset = (off_t)offset;
+        ssize_t done = sendfile(out->fd, source->fd, &source_offset, size > COPY_CHUNK_SIZE ? COPY_CHUNK_SIZE : (size_t)size);
+        if (done < 0 && (errno == ENOSYS || errno == EINVAL)) {
+            out->method = COPY_METHOD_BUFFERED;
+        } else if (done < 0 && errno == EINTR) {
+            continue;
+        } else if (done <= 0) {
+            ret = done == 0 ? COPY_ERROR_SOURCE : COPY_ERROR_DESTINATION;
+            goto done;
+        } else {
+            offset += (uint64_t)done;
+            size -= (uint64_t)done;
+        }
+    }
+#endif
+
+    if (size > 0 && out->buffer == NULL) {
+        out->buffer = (uint8_t *)malloc(COPY_BUFFER_SIZE);
+        if (!out->buffer) {
+            ret = COPY_ERROR_MEMORY;
+            goto done;
+        }
+        las_stats_allocation(COPY_BUFFER_SIZE);
+    }
+    while (size > 0) {
+        size_t chunk = size > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)size;
+        if (pread_file(source, out->buffer, chunk, offset) < 0) {
+            ret = COPY_ERROR_SOURCE;
+            goto done;
+        }
+        if (write_destination(out, out->buffer, chunk) < 0) {
+            ret = COPY_ERROR_DESTINATION;
+            goto done;
+        }
+        offset += chunk;
+        size -= chunk;
+    }
+
+done:
+    las_stats_add(LAS_COUNTER_BYTES_READ, total - size);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, total - size);
+    las_stats_phase(LAS_PHASE_WRITE, start);
+    return ret;
+}
+
+static int same_file(const char * a, const char * b) {
+    struct stat a_stat;
+    struct stat b_stat;
+    if (stat(a, &a_stat) != 0 || stat(b, &b_stat) != 0) {
+        return 0;
+    }
+    // st_ino is always 0 on Windows, where the check is skipped.
+    return a_stat.st_ino != 0 && a_stat.st_dev == b_stat.st_dev && a_stat.st_ino == b_stat.st_ino;
+}
+
+static uint64_t profile_end(const LASProfileTable * table, size_t profile) {
+    return table->offsets[profile] + sizeof(LASHeader) + (uint64_t)table->point_counts[profile] * sizeof(LASEntry);
+}
+
+/**
+ * @brief Map a source and walk its header chain.
+ *
+ * @return int 0 on success, with the mapping and table released by the caller, or one of
+ * the COPY_ERROR_ values.
+ */
+static int scan_source(const char * filename, LASMappedFile * mapped, LASProfileTable * table) {
+    if (map_file(filename, mapped) < 0) {
+        return COPY_ERROR_SOURCE;
+    }
+    if (is_compressed_las(mapped->data, mapped->size)) {
+        unmap_file(mapped);
+        return COPY_ERROR_COMPRESSED;
+    }
+    if (scan_profiles_mapped(mapped->data, mapped->size, table) < 0) {
+        unmap_file(mapped);
+        return COPY_ERROR_SOURCE;
+    }
+    return 0;
+}
+
+int64_t concat_las_files(const char * const * sources, size_t number_of_sources, const char * destination, size_t * failed) {
+    CopyDestination out;
+    uint64_t number_of_profiles = 0;
+    uint64_t number_of_points = 0;
+    int ret = 0;
+
+    uint64_t * ends = (uint64_t *)calloc(number_of_sources > 0 ? number_of_sources : 1, sizeof(uint64_t));
+    if (!ends) {
+        return COPY_ERROR_MEMORY;
+    }
+
+    // every source is checked before the destination is touched.
+    for (size_t i = 0; i < number_of_sources && ret == 0; ++i) {
+        LASMappedFile mapped;
+        LASProfileTable table;
+
+        *failed = i;
+        if (same_file(sources[i], destination)) {
+            ret = COPY_ERROR_SAME_FILE;
+            break;
+        }
+        ret = scan_source(sources[i], &mapped, &table);
+        if (ret < 0) {
+            break;
+        }
+        // bytes after the last complete header are left behind, as every reader ignores them.
+        ends[i] = table.number_of_profiles > 0 ? profile_end(&table, table.number_of_profiles - 1) : 0;
+        number_of_profiles += table.number_of_profiles;
+        number_of_points += table.number_of_points;
+        free_profile_table(&table);
+        unmap_file(&mapped);
+    }
+    if (ret < 0) {
+        free(ends);
+        return ret;
+    }
+
+    if (open_destination(&out, destination) < 0) {
+        free(ends);
+        return COPY_ERROR_DESTINATION;
+    }
+    for (size_t i = 0; i < number_of_sources && ret == 0; ++i) {
+        LASPreadFile file;
+
+        *failed = i;
+        if (open_pread_file(sources[i], &file) < 0) {
+            ret = COPY_ERROR_SOURCE;
+            break;
+        }
+        ret = copy_bytes(&out, &file, 0, ends[i]);
+        close_pread_file(&file);
+    }
+    if (close_destination(&out) < 0 && ret == 0) {
+        ret = COPY_ERROR_DESTINATION;
+    }
+    free(ends);
+
+    if (ret < 0) {
+        return ret;
+    }
+    las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, number_of_profiles);
+    las_stats_add(LAS_COUNTER_POINTS_WRITTEN, number_of_points);
+    return (int64_t)number_of_profiles;
+}
+
+int64_t extract_las_profiles(const char * source, const char * destination,
+                             const uint64_t * profiles, size_t number_of_profiles, const LASProfileFilter * filter) {
+    LASMappedFile mapped;
+    LASProfileTable table;
+    LASProfileTable selected;
+    LASPreadFile file;
+    CopyDestination out;
+    int ret;
+
+    if (same_file(source, destination)) {
+        return COPY_ERROR_SAME_FILE;
+    }
+    ret = scan_source(source, &mapped, &table);
+    if (ret < 0) {
+        return ret;
+    }
+
+    init_profile_table(&selected);
+    if (profiles) {
+        for (size_t i = 0; i < number_of_profiles && ret == 0; ++i) {
+            if (profiles[i] >= table.number_of_profiles) {
+                ret = COPY_ERROR_PROFILE;
+            } else if (append_profile(&selected, table.offsets[profiles[i]], table.point_counts[profiles[i]]) < 0) {
+                ret = COPY_ERROR_MEMORY;
+            }
+        }
+        free_profile_table(&table);
+    } else {
+        selected = table;
+    }
+    if (ret == 0 && filter) {
+        filter_profile_table_mapped(mapped.data, &selected, filter);
+    }
+    unmap_file(&mapped);
+    if (ret < 0) {
+        free_profile_table(&selected);
+        return ret;
+    }
+
+    if (open_pread_file(source, &file) < 0) {
+        free_profile_table(&selected);
+        return COPY_ERROR_SOURCE;
+    }
+    if (open_destination(&out, destination) < 0) {
+        close_pread_file(&file);
+        free_profile_table(&selected);
+        return COPY_ERROR_DESTINATION;
+    }
+
+    // profiles that follow each other in the source go out in one copy.
+    size_t i = 0;
+    while (i < selected.number_of_profiles && ret == 0) {
+        uint64_t start = selected.offsets[i];
+        uint64_t end = profile_end(&selected, i);
+        for (++i; i < selected.number_of_profiles && selected.offsets[i] == end; ++i) {
+            end = profile_end(&selected, i);
+        }
+        ret = copy_bytes(&out, &file, start, end - start);
+    }
+    if (close_destination(&out) < 0 && ret == 0) {
+        ret = COPY_ERROR_DESTINATION;
+    }
+    close_pread_file(&file);
+
+    int64_t written = (int64_t)selected.number_of_profiles;
+    if (ret == 0) {
+        las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, selected.number_of_profiles);
+        las_stats_add(LAS_COUNTER_POINTS_WRITTEN, selected.number_of_points);
+    }
+    free_profile_table(&selected);
+    return ret < 0 ? ret : written;
+}
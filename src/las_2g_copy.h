@@ -0,0 +1,50 @@
+#ifndef LAS_2G_COPY_H
+#define LAS_2G_COPY_H
+
+/**
+ * @brief Passthrough copies of whole profiles between LAS files. The profiles are located from
+ * the header chain and their bytes are moved with copy_file_range or sendfile where the OS
+ * has them, falling back to buffered reads and writes, so no point is decoded and the
+ * records are copied bit for bit.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define COPY_BUFFER_SIZE (4 * 1024 * 1024) // bytes per read and write of the buffered fallback
+
+// errors of concat_las_files and extract_las_profiles
+#define COPY_ERROR_SOURCE -1 /// a source could not be opened, or a profile runs past its end
+#define COPY_ERROR_DESTINATION -2 /// the destination could not be created or written
+#define COPY_ERROR_PROFILE -3 /// a profile index is past the last profile of the source
+#define COPY_ERROR_SAME_FILE -4 /// the destination is one of the sources
+#define COPY_ERROR_MEMORY -5
+#define COPY_ERROR_COMPRESSED -6 /// a source is a compressed survey, which has to be decoded
+
+/**
+ * @brief Write every profile of several LAS files, in order, to one file.
+ *
+ * @param sources
+ * @param number_of_sources
+ * @param destination created, or truncated if it exists
+ * @param failed set to the index of the source that caused a COPY_ERROR_SOURCE,
+ * COPY_ERROR_SAME_FILE or COPY_ERROR_COMPRESSED
+ * @return int64_t number of profiles written, or one of the COPY_ERROR_ values.
+ */
+int64_t concat_las_files(const char * const * sources, size_t number_of_sources, const char * destination, size_t * failed);
+
+/**
+ * @brief Write selected profiles of a LAS file to a new file. Runs of profiles that are
+ * next to each other in the source are copied with one call.
+ *
+ * @param source
+ * @param destination created, or truncated if it exists
+ * @param profiles indices of the profiles to copy in the order given, NULL for every profile
+ * @param number_of_profiles number of indices in profiles
+ * @param filter applied to the selected profiles, NULL to keep them all
+ * @return int64_t number of profiles written, or one of the COPY_ERROR_ values.
+ */
+int64_t extract_las_profiles(const char * source, const char * destination,
+                             const uint64_t * profiles, size_t number_of_profiles, const LASProfileFilter * filter);
+
+#endif
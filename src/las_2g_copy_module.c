@@ -0,0 +1,193 @@
+/**
+ * @file las_2g_copy_module.c
+ * @author Ryan Wicks
+ * @brief Python access to the passthrough concat and extract.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_copy.h"
+
+//-----------------------------------------------------------------
+// Copy Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Raise the exception matching a COPY_ERROR_ value.
+ *
+ * @param error
+ * @param source file the error refers to, for the source errors
+ * @param destination
+ */
+static void LASCopy_SetError(int64_t error, const char * source, const char * destination) {
+    switch (error) {
+        case COPY_ERROR_SOURCE:
+            PyErr_Format(PyExc_RuntimeError, "Failed to read LAS file %s.", source);
+            break;
+        case COPY_ERROR_DESTINATION:
+            PyErr_Format(PyExc_RuntimeError, "Failed to write output file %s.", destination);
+            break;
+        case COPY_ERROR_PROFILE:
+            PyErr_SetString(PyExc_IndexError, "profile index out of range.");
+            break;
+        case COPY_ERROR_SAME_FILE:
+            PyErr_Format(PyExc_ValueError, "%s is both a source and the output.", source);
+            break;
+        case COPY_ERROR_COMPRESSED:
+            PyErr_Format(PyExc_ValueError, "%s is compressed, use decompress_las first.", source);
+            break;
+        default:
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the copy.");
+            break;
+    }
+}
+
+/**
+ * @brief Convert the profiles argument of extract to an array of indices.
+ *
+ * @param obj a buffer of integers or a sequence of ints
+ * @param length
+ * @return uint64_t* array owned by the caller (free), or NULL with an exception set.
+ */
+static uint64_t * LASCopy_ProfileIndices(PyObject * obj, Py_ssize_t * length) {
+    if (PyObject_CheckBuffer(obj)) {
+        return LASColumn_AsIndexArray(obj, length, "profiles");
+    }
+
+    PyObject * sequence = PySequence_Fast(obj, "profiles must be a sequence of ints.");
+    if (!sequence) {
+        return NULL;
+    }
+    *length = PySequence_Fast_GET_SIZE(sequence);
+    uint64_t * indices = (uint64_t *)malloc((*length > 0 ? *length : 1) * sizeof(uint64_t));
+    if (!indices) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for index array.");
+        Py_DECREF(sequence);
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < *length; ++i) {
+        indices[i] = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(sequence, i));
+        if (indices[i] == (uint64_t)-1 && PyErr_Occurred()) {
+            free(indices);
+            Py_DECREF(sequence);
+            return NULL;
+        }
+    }
+    Py_DECREF(sequence);
+    return indices;
+}
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * concat_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"paths", "out", NULL};
+    PyObject * paths;
+    char * destination;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Os", keywords, &paths, &destination)) {
+        return NULL;
+    }
+
+    PyObject * sequence = PySequence_Fast(paths, "paths must be a sequence of file names.");
+    if (!sequence) {
+        return NULL;
+    }
+    Py_ssize_t number_of_files = PySequence_Fast_GET_SIZE(sequence);
+    PyObject * encoded = PyList_New(number_of_files);
+    const char ** sources = (const char **)malloc((number_of_files > 0 ? number_of_files : 1) * sizeof(char *));
+    PyObject * result = NULL;
+    if (!encoded || !sources) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the file names.");
+        }
+        goto cleanup;
+    }
+
+    // the encoded names stay referenced by the list while the copy runs without the GIL.
+    for (Py_ssize_t i = 0; i < number_of_files; ++i) {
+        PyObject * name = NULL;
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(sequence, i), &name)) {
+            goto cleanup;
+        }
+        PyList_SET_ITEM(encoded, i, name);
+        sources[i] = PyBytes_AS_STRING(name);
+    }
+
+    int64_t written;
+    size_t failed = 0;
+    Py_BEGIN_ALLOW_THREADS
+    written = concat_las_files(sources, (size_t)number_of_files, destination, &failed);
+    Py_END_ALLOW_THREADS
+
+    if (written < 0) {
+        LASCopy_SetError(written, number_of_files > 0 ? sources[failed] : "", destination);
+    } else {
+        result = PyLong_FromLongLong(written);
+    }
+
+cleanup:
+    free(sources);
+    Py_XDECREF(encoded);
+    Py_DECREF(sequence);
+    return result;
+}
+
+PyObject * concat_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "concat", concat_call(self, args, kwargs));
+}
+
+static PyObject * extract_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"path", "out", "profiles", "time_range", "bbox", NULL};
+    char * source;
+    char * destination;
+    PyObject * profiles_object = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * bbox = Py_None;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|OOO", keywords, &source, &destination,
+                                     &profiles_object, &time_range, &bbox)) {
+        return NULL;
+    }
+
+    LASProfileFilter filter;
+    if (LASProfileFilter_FromPython(bbox, time_range, &filter) < 0) {
+        return NULL;
+    }
+
+    uint64_t * profiles = NULL;
+    Py_ssize_t number_of_profiles = 0;
+    if (profiles_object != Py_None) {
+        profiles = LASCopy_ProfileIndices(profiles_object, &number_of_profiles);
+        if (!profiles) {
+            return NULL;
+        }
+    }
+
+    int64_t written;
+    Py_BEGIN_ALLOW_THREADS
+    written = extract_las_profiles(source, destination, profiles, (size_t)number_of_profiles,
+                                   filter.has_bbox || filter.has_time ? &filter : NULL);
+    Py_END_ALLOW_THREADS
+    free(profiles);
+
+    if (written < 0) {
+        LASCopy_SetError(written, source, destination);
+        return NULL;
+    }
+    return PyLong_FromLongLong(written);
+}
+
+PyObject * extract_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "extract", extract_call(self, args, kwargs));
+}
@@ -0,0 +1,479 @@
+/**
+ * @file las_2g_dataset_module.c
+ * @author Ryan Wicks
+ * @brief Memory mapped, lazily decoded access to a concatenated LAS survey.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include <string.h>
+
+//-----------------------------------------------------------------
+// LAS Dataset Definitions
+//-----------------------------------------------------------------
+
+static void LASDataset_close_mapping(LASDatasetPython * self) {
+    if (self->is_open) {
+        unmap_file(&self->mapped);
+        self->is_open = 0;
+    }
+    self->close_pending = 0;
+    free_profile_table(&self->table);
+    self->indexed = 0;
+    if (self->has_index) {
+        free_index(&self->index);
+        self->has_index = 0;
+    }
+}
+
+static void LASDataset_dealloc(LASDatasetPython * self) {
+    LASDataset_close_mapping(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Close the dataset now, or once the last operation reading the mapping without
+ * the GIL has finished.
+ *
+ */
+static void LASDataset_close_deferred(LASDatasetPython * self) {
+    if (self->exports > 0) {
+        self->close_pending = 1;
+    } else {
+        LASDataset_close_mapping(self);
+    }
+}
+
+static int LASDataset_init(LASDatasetPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "use_index", "fields", NULL};
+    char * filename;
+    int use_index = 0;
+    PyObject * fields_object = Py_None;
+    int fields;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|pO", keywords, &filename, &use_index, &fields_object)) {
+        return -1;
+    }
+    if (LASFields_FromPython(fields_object, &fields) < 0) {
+        return -1;
+    }
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "Cannot reopen a LASDataset while another thread is reading it.");
+        return -1;
+    }
+
+    LASDataset_close_mapping(self);
+    self->fields = fields;
+
+    // the file is mapped and indexed into locals, published once the GIL is held again.
+    LASMappedFile mapped;
+    LASIndex index;
+    LASProfileTable table;
+    init_profile_table(&table);
+    int ret;
+    self->exports += 1;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, &mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        LASDataset_Release(self);
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return -1;
+    }
+
+    if (use_index) {
+        Py_BEGIN_ALLOW_THREADS
+        ret = open_index(filename, &mapped, &index, 0);
+        if (ret >= 0 && index_to_profile_table(&index, &table) < 0) {
+            free_index(&index);
+            ret = -1;
+        }
+        Py_END_ALLOW_THREADS
+    }
+    if (ret < 0) {
+        LASDataset_Release(self);
+        unmap_file(&mapped);
+        PyErr_SetString(PyExc_RuntimeError, "Could not index LAS file.");
+        return -1;
+    }
+
+    self->mapped = mapped;
+    self->is_open = 1;
+    if (use_index) {
+        self->index = index;
+        self->table = table;
+        self->has_index = 1;
+        self->indexed = 1;
+    }
+    LASDataset_Release(self);
+
+    return 0;
+}
+
+int LASDataset_EnsureIndex(LASDatasetPython * self) {
+    if (!self->is_open || self->close_pending) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed LASDataset.");
+        return -1;
+    }
+    if (self->indexed) {
+        return 0;
+    }
+
+    // another thread may publish its table while this one scans, the first one is kept.
+    const uint8_t * data = self->mapped.data;
+    uint64_t size = self->mapped.size;
+    LASProfileTable table;
+    init_profile_table(&table);
+    int ret;
+    self->exports += 1;
+    Py_BEGIN_ALLOW_THREADS
+    ret = scan_profiles_mapped(data, size, &table);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        LASDataset_Release(self);
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+        return -1;
+    }
+    if (self->indexed) {
+        free_profile_table(&table);
+    } else {
+        self->table = table;
+        self->indexed = 1;
+    }
+    LASDataset_Release(self);
+
+    return 0;
+}
+
+int LASDataset_Acquire(LASDatasetPython * self) {
+    if (LASDataset_EnsureIndex(self) < 0) {
+        return -1;
+    }
+    self->exports += 1;
+    return 0;
+}
+
+void LASDataset_Release(LASDatasetPython * self) {
+    self->exports -= 1;
+    if (self->exports == 0 && self->close_pending) {
+        LASDataset_close_mapping(self);
+    }
+}
+
+static int LASDataset_ensure_summaries(LASDatasetPython * self) {
+    if (LASDataset_Acquire(self) < 0) {
+        return -1;
+    }
+    if (self->has_index) {
+        LASDataset_Release(self);
+        return 0;
+    }
+
+    const uint8_t * data = self->mapped.data;
+    uint64_t size = self->mapped.size;
+    LASIndex index;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = build_index(data, size, &index);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        LASDataset_Release(self);
+        PyErr_SetString(PyExc_RuntimeError, "Could not index LAS file.");
+        return -1;
+    }
+    if (self->has_index) {
+        free_index(&index);
+    } else {
+        self->index = index;
+        self->has_index = 1;
+    }
+    LASDataset_Release(self);
+
+    return 0;
+}
+
+static PyObject * LASDataset_profile(LASDatasetPython * self, Py_ssize_t i) {
+    LASHeader header;
+    const uint8_t * profile = self->mapped.data + self->table.offsets[i];
+
+    memcpy(&header, profile, sizeof(LASHeader));
+    return LASFile_FromRecords(&header, (const LASEntry *)(profile + sizeof(LASHeader)), self->fields);
+}
+
+static Py_ssize_t LASDataset_length(LASDatasetPython * self) {
+    if (LASDataset_EnsureIndex(self) < 0) {
+        return -1;
+    }
+    return (Py_ssize_t)self->table.number_of_profiles;
+}
+
+static PyObject * LASDataset_subscript(LASDatasetPython * self, PyObject * key) {
+    if (LASDataset_EnsureIndex(self) < 0) {
+        return NULL;
+    }
+    Py_ssize_t number_of_profiles = (Py_ssize_t)self->table.number_of_profiles;
+
+    if (PyIndex_Check(key)) {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (i < 0) {
+            i += number_of_profiles;
+        }
+        if (i < 0 || i >= number_of_profiles) {
+            PyErr_SetString(PyExc_IndexError, "LASDataset index out of range.");
+            return NULL;
+        }
+        return LASDataset_profile(self, i);
+    }
+
+    if (PySlice_Check(key)) {
+        Py_ssize_t start, stop, step;
+        if (PySlice_Unpack(key, &start, &stop, &step) < 0) {
+            return NULL;
+        }
+        Py_ssize_t length = PySlice_AdjustIndices(number_of_profiles, &start, &stop, step);
+
+        PyObject * data_list = PyList_New(length);
+        if (!data_list) {
+            return NULL;
+        }
+        for (Py_ssize_t i = 0; i < length; ++i) {
+            PyObject * file_entry = LASDataset_profile(self, start + i * step);
+            if (!file_entry) {
+                Py_DECREF(data_list);
+                return NULL;
+            }
+            PyList_SET_ITEM(data_list, i, file_entry);
+        }
+        return data_list;
+    }
+
+    PyErr_SetString(PyExc_TypeError, "LASDataset indices must be integers or slices.");
+    return NULL;
+}
+
+static PyObject * LASDataset_get_number_of_points(LASDatasetPython * self, void * closure) {
+    if (LASDataset_EnsureIndex(self) < 0) {
+        return NULL;
+    }
+    return PyLong_FromUnsignedLongLong(self->table.number_of_points);
+}
+
+static PyObject * LASDataset_profiles_between(LASDatasetPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"start_time", "end_time", NULL};
+    unsigned long long start_time;
+    unsigned long long end_time;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "KK", keywords, &start_time, &end_time)) {
+        return NULL;
+    }
+    if (LASDataset_ensure_summaries(self) < 0) {
+        return NULL;
+    }
+
+    size_t number_of_profiles = (size_t)self->index.header.number_of_profiles;
+    uint64_t * profiles = (uint64_t *)malloc((number_of_profiles > 0 ? number_of_profiles : 1) * sizeof(uint64_t));
+    if (!profiles) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for profile list.");
+        return NULL;
+    }
+    size_t count = index_find_time_range(&self->index, start_time, end_time, profiles);
+
+    PyObject * profile_list = PyList_New((Py_ssize_t)count);
+    if (!profile_list) {
+        free(profiles);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        PyObject * profile = PyLong_FromUnsignedLongLong(profiles[i]);
+        if (!profile) {
+            Py_DECREF(profile_list);
+            free(profiles);
+            return NULL;
+        }
+        PyList_SET_ITEM(profile_list, (Py_ssize_t)i, profile);
+    }
+
+    free(profiles);
+    return profile_list;
+}
+
+static PyObject * LASDataset_columns(LASDatasetPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"start", "stop", "fields", "threads", NULL};
+    Py_ssize_t start = 0;
+    PyObject * stop_object = Py_None;
+    PyObject * fields_object = Py_None;
+    int threads = 0;
+    int fields;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|nOOi", keywords, &start, &stop_object, &fields_object, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+    if (fields_object == Py_None) {
+        fields = self->fields;
+    } else if (LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+    Py_ssize_t stop = PY_SSIZE_T_MAX;
+    if (stop_object != Py_None) {
+        stop = PyNumber_AsSsize_t(stop_object, PyExc_OverflowError);
+        if (stop == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+    if (LASDataset_Acquire(self) < 0) {
+        return NULL;
+    }
+
+    Py_ssize_t number_of_profiles = (Py_ssize_t)self->table.number_of_profiles;
+    PySlice_AdjustIndices(number_of_profiles, &start, &stop, 1);
+
+    // a view of the profiles [start, stop) of the table.
+    LASProfileTable range;
+    range.offsets = self->table.offsets + start;
+    range.point_counts = self->table.point_counts + start;
+    range.number_of_profiles = (size_t)(stop - start);
+    range.capacity = range.number_of_profiles;
+    range.number_of_points = 0;
+    for (size_t i = 0; i < range.number_of_profiles; ++i) {
+        range.number_of_points += range.point_counts[i];
+    }
+
+    LASColumnsPython * columns = LASColumns_New((Py_ssize_t)range.number_of_points, (Py_ssize_t)range.number_of_profiles, fields);
+    if (!columns) {
+        LASDataset_Release(self);
+        return NULL;
+    }
+    LASColumnArrays arrays;
+    LASColumns_GetArrays(columns, &arrays);
+
+    const uint8_t * data = self->mapped.data;
+    Py_BEGIN_ALLOW_THREADS
+    read_columns_mapped(data, &range, &arrays, threads);
+    Py_END_ALLOW_THREADS
+    LASDataset_Release(self);
+
+    return (PyObject *) columns;
+}
+
+static PyObject * LASDataset_close(LASDatasetPython * self, PyObject * Py_UNUSED(ignored)) {
+    LASDataset_close_deferred(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASDataset_enter(LASDatasetPython * self, PyObject * Py_UNUSED(ignored)) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject * LASDataset_exit(LASDatasetPython * self, PyObject * args) {
+    LASDataset_close_deferred(self);
+    Py_RETURN_FALSE;
+}
+
+static PyMethodDef LASDataset_methods[] = {
+    {"profiles_between", (PyCFunction) LASDataset_profiles_between, METH_VARARGS | METH_KEYWORDS,
+        "profiles_between(start_time, end_time) -> list of profile indices\n\n"
+        "Indices of the profiles with points between the two utc times (us from the unix epoch)."},
+    {"columns", (PyCFunction) LASDataset_columns, METH_VARARGS | METH_KEYWORDS,
+        "columns(start=0, stop=None, fields=None, threads=0) -> LASColumns\n\n"
+        "Decode the profiles [start, stop) into columns, only the named fields when fields is given."},
+    {"close", (PyCFunction) LASDataset_close, METH_NOARGS, "Release the memory mapping. Profiles already returned stay valid. A call on another thread\n"
+        "still reading the mapping finishes first."},
+    {"__enter__", (PyCFunction) LASDataset_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction) LASDataset_exit, METH_VARARGS, NULL},
+    {NULL} //sentinel
+};
+
+static PyGetSetDef LASDataset_getset[] = {
+    {"number_of_points", (getter) LASDataset_get_number_of_points, NULL, "Number of points in the survey.", NULL},
+    {NULL} //sentinel
+};
+
+static PySequenceMethods LASDataset_as_sequence = {
+    .sq_length = (lenfunc) LASDataset_length,
+};
+
+static PyMappingMethods LASDataset_as_mapping = {
+    .mp_length = (lenfunc) LASDataset_length,
+    .mp_subscript = (binaryfunc) LASDataset_subscript,
+};
+
+PyTypeObject LASDatasetPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASDataset",
+    .tp_doc = "LASDataset(filename, use_index=False, fields=None)\n\n"
+              "A memory mapped LAS survey. The profile offsets are found on first use by hopping\n"
+              "from header to header, and profiles are only decoded into LASFiles when indexed.\n"
+              "With use_index the offsets, times and bounds come from the sidecar filename.lasidx,\n"
+              "which is rebuilt when it is missing or stale. fields limits the point fields decoded,\n"
+              "as in read_las.",
+    .tp_basicsize = sizeof(LASDatasetPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) LASDataset_init,
+    .tp_dealloc = (destructor) LASDataset_dealloc,
+    .tp_methods = LASDataset_methods,
+    .tp_getset = LASDataset_getset,
+    .tp_as_sequence = &LASDataset_as_sequence,
+    .tp_as_mapping = &LASDataset_as_mapping,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * build_index_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", NULL};
+    char * filename;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords, &filename)) {
+        return NULL;
+    }
+
+    LASMappedFile mapped;
+    LASIndex index;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, &mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = open_index(filename, &mapped, &index, 1);
+    unmap_file(&mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not index LAS file.");
+        return NULL;
+    }
+
+    uint64_t number_of_profiles = index.header.number_of_profiles;
+    free_index(&index);
+    if (ret != 1) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to write LAS index file.");
+        return NULL;
+    }
+
+    return PyLong_FromUnsignedLongLong(number_of_profiles);
+}
+
+PyObject * build_index_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "build_index", build_index_call(self, args, kwargs));
+}
@@ -0,0 +1,782 @@
+/**
+ * @file las_2g_entries_module.c
+ * @author Ryan Wicks
+ * @brief Points of a profile, kept as packed records and decoded on access.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+
+/**
+ * @brief Quantise a co-ordinate the way the writers do, or with the scale of a file that was
+ * written with another one.
+ *
+ */
+static int32_t encode_coordinate(double value, double scale) {
+    if (scale == header_scale) {
+        return initLASEntry(0, value, 0.0, 0.0, 0, 0).x;
+    }
+    return (int32_t)(value / scale);
+}
+
+// LAS Entry Definitions
+//-----------------------------------------------------------------
+
+static void LASEntry_dealloc(LASEntryPython * self) {
+    Py_XDECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int LASEntry_init (LASEntryPython * self, PyObject * args, PyObject *kwargs) {
+
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    uint16_t intensity = 0;
+    uint8_t quality = 0;
+    uint64_t utc_time = 0;
+
+    if (!PyArg_ParseTuple (args, "dddHbK", &x, &y, &z, &intensity, &quality, &utc_time)) {
+        return -1;
+    }
+
+    Py_CLEAR(self->owner);
+    self->x = x;
+    self->y = y;
+    self->z = z;
+    self->intensity = intensity;
+    self->quality = quality;
+    self->utc_time = utc_time;
+    return 0;
+}
+
+void LASEntry_GetValues(LASEntryPython * self, double * x, double * y, double * z,
+                        uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    LASEntryListPython * owner = (LASEntryListPython *)self->owner;
+    if (!owner) {
+        *x = self->x;
+        *y = self->y;
+        *z = self->z;
+        *intensity = self->intensity;
+        *quality = self->quality;
+        *utc_time = self->utc_time;
+        return;
+    }
+
+    // fields that were not read, and entries left past the end of the list, stay 0.
+    if (self->index >= owner->length) {
+        *x = *y = *z = 0.0;
+        *intensity = 0;
+        *quality = 0;
+        *utc_time = 0;
+        return;
+    }
+    const LASEntry * record = owner->records + self->index;
+    *x = (owner->fields & LAS_FIELD_X) ? owner->x_scale * (double)record->x : 0.0;
+    *y = (owner->fields & LAS_FIELD_Y) ? owner->y_scale * (double)record->y : 0.0;
+    *z = (owner->fields & LAS_FIELD_Z) ? owner->z_scale * (double)record->z : 0.0;
+    *intensity = (owner->fields & LAS_FIELD_INTENSITY) ? record->intensity : 0;
+    *quality = (owner->fields & LAS_FIELD_QUALITY) ? record->user_data : 0;
+    *utc_time = (owner->fields & LAS_FIELD_UTC_TIME) ? AdjustedGPSTimeusToUTCTimeus((uint64_t)(record->gps_time*1E6)) : 0;
+}
+
+/**
+ * @brief Check an attribute assignment.
+ *
+ * @return LASEntry* the record to write, NULL for a standalone entry, or NULL with an
+ * exception set.
+ */
+static LASEntry * LASEntry_record_for_set(LASEntryPython * self, PyObject * value, int field, const char * name) {
+    if (value == NULL) {
+        PyErr_Format(PyExc_TypeError, "Cannot delete the %s attribute.", name);
+        return NULL;
+    }
+    LASEntryListPython * owner = (LASEntryListPython *)self->owner;
+    if (!owner) {
+        return NULL;
+    }
+    if (!(owner->fields & field)) {
+        PyErr_Format(PyExc_AttributeError, "The %s field was not read, see the fields argument of the reader.", name);
+        return NULL;
+    }
+    if (self->index >= owner->length) {
+        PyErr_SetString(PyExc_IndexError, "The LASEntry is past the end of its LASEntryList.");
+        return NULL;
+    }
+    return owner->records + self->index;
+}
+
+static PyObject * LASEntry_get_x(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyFloat_FromDouble(x);
+}
+
+static PyObject * LASEntry_get_y(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyFloat_FromDouble(y);
+}
+
+static PyObject * LASEntry_get_z(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyFloat_FromDouble(z);
+}
+
+static PyObject * LASEntry_get_intensity(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyLong_FromUnsignedLong(intensity);
+}
+
+static PyObject * LASEntry_get_quality(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyLong_FromUnsignedLong(quality);
+}
+
+static PyObject * LASEntry_get_utc_time(LASEntryPython * self, void * closure) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return PyLong_FromUnsignedLongLong(utc_time);
+}
+
+static int LASEntry_set_coordinate(LASEntryPython * self, PyObject * value, int field, const char * name) {
+    LASEntry * record = LASEntry_record_for_set(self, value, field, name);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    double coordinate = PyFloat_AsDouble(value);
+    if (coordinate == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    LASEntryListPython * owner = (LASEntryListPython *)self->owner;
+    if (field == LAS_FIELD_X) {
+        if (record) {
+            record->x = encode_coordinate(coordinate, owner->x_scale);
+        } else {
+            self->x = coordinate;
+        }
+    } else if (field == LAS_FIELD_Y) {
+        if (record) {
+            record->y = encode_coordinate(coordinate, owner->y_scale);
+        } else {
+            self->y = coordinate;
+        }
+    } else {
+        if (record) {
+            record->z = encode_coordinate(coordinate, owner->z_scale);
+        } else {
+            self->z = coordinate;
+        }
+    }
+    return 0;
+}
+
+static int LASEntry_set_x(LASEntryPython * self, PyObject * value, void * closure) {
+    return LASEntry_set_coordinate(self, value, LAS_FIELD_X, "x");
+}
+
+static int LASEntry_set_y(LASEntryPython * self, PyObject * value, void * closure) {
+    return LASEntry_set_coordinate(self, value, LAS_FIELD_Y, "y");
+}
+
+static int LASEntry_set_z(LASEntryPython * self, PyObject * value, void * closure) {
+    return LASEntry_set_coordinate(self, value, LAS_FIELD_Z, "z");
+}
+
+static int LASEntry_set_intensity(LASEntryPython * self, PyObject * value, void * closure) {
+    LASEntry * record = LASEntry_record_for_set(self, value, LAS_FIELD_INTENSITY, "intensity");
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    unsigned long intensity = PyLong_AsUnsignedLong(value);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    if (intensity > UINT16_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "intensity must be between 0 and 65535.");
+        return -1;
+    }
+
+    if (record) {
+        record->intensity = (uint16_t)intensity;
+    } else {
+        self->intensity = (uint16_t)intensity;
+    }
+    return 0;
+}
+
+static int LASEntry_set_quality(LASEntryPython * self, PyObject * value, void * closure) {
+    LASEntry * record = LASEntry_record_for_set(self, value, LAS_FIELD_QUALITY, "quality");
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    unsigned long quality = PyLong_AsUnsignedLong(value);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    if (quality > UINT8_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "quality must be between 0 and 255.");
+        return -1;
+    }
+
+    if (record) {
+        record->user_data = (uint8_t)quality;
+    } else {
+        self->quality = (uint8_t)quality;
+    }
+    return 0;
+}
+
+static int LASEntry_set_utc_time(LASEntryPython * self, PyObject * value, void * closure) {
+    LASEntry * record = LASEntry_record_for_set(self, value, LAS_FIELD_UTC_TIME, "utc_time");
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    uint64_t utc_time = PyLong_AsUnsignedLongLong(value);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (record) {
+        record->gps_time = UTCTimeusToAdjustedGPSTime(utc_time);
+    } else {
+        self->utc_time = utc_time;
+    }
+    return 0;
+}
+
+static PyGetSetDef LASEntry_getset[] = {
+    {"x", (getter) LASEntry_get_x, (setter) LASEntry_set_x, "x co-ordinate in m.", NULL},
+    {"y", (getter) LASEntry_get_y, (setter) LASEntry_set_y, "y co-ordinate in m.", NULL},
+    {"z", (getter) LASEntry_get_z, (setter) LASEntry_set_z, "z co-ordinate in m.", NULL},
+    {"intensity", (getter) LASEntry_get_intensity, (setter) LASEntry_set_intensity, "intensity", NULL},
+    {"quality", (getter) LASEntry_get_quality, (setter) LASEntry_set_quality, "quality", NULL},
+    {"utc_time", (getter) LASEntry_get_utc_time, (setter) LASEntry_set_utc_time, "utc time in microseconds from the unix epoch epoch", NULL},
+    {NULL} //sentinel
+};
+
+static PyObject * LASEntry_reduce(LASEntryPython * self, PyObject * Py_UNUSED(ignored)) {
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    // an entry of a LASEntryList unpickles as a standalone entry holding its values.
+    LASEntry_GetValues(self, &x, &y, &z, &intensity, &quality, &utc_time);
+    return Py_BuildValue("(O(dddHbK))", &LASEntryPythonType, x, y, z, intensity, quality, (unsigned long long) utc_time);
+}
+
+static PyMethodDef LASEntry_methods[] = {
+    {"__reduce__", (PyCFunction) LASEntry_reduce, METH_NOARGS, NULL},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASEntryPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASEntry",
+    .tp_doc = "A single LAS entry/point. Entries of a LASEntryList read and write the\n"
+              "point record they belong to.",
+    .tp_basicsize = sizeof(LASEntryPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) LASEntry_init,
+    .tp_dealloc = (destructor) LASEntry_dealloc,
+    .tp_getset = LASEntry_getset,
+    .tp_methods = LASEntry_methods,
+};
+
+// LAS Entry List Definitions
+//-----------------------------------------------------------------
+
+LASEntryListPython * LASEntryList_New(const LASHeader * header, const LASEntry * entries, Py_ssize_t number_of_entries, int fields) {
+    LASEntryListPython * self = (LASEntryListPython *) LASEntryListPythonType.tp_alloc(&LASEntryListPythonType, 0);
+    if (!self) {
+        return NULL;
+    }
+
+    self->records = (LASEntry *) malloc ((number_of_entries > 0 ? number_of_entries : 1) * sizeof (LASEntry));
+    if (!self->records) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for entries.");
+        Py_DECREF(self);
+        return NULL;
+    }
+    las_stats_allocation((number_of_entries > 0 ? number_of_entries : 1) * sizeof (LASEntry));
+    if (number_of_entries > 0) {
+        Py_BEGIN_ALLOW_THREADS
+        memcpy(self->records, entries, (size_t)number_of_entries * sizeof(LASEntry));
+        Py_END_ALLOW_THREADS
+    }
+    self->length = number_of_entries;
+    self->capacity = number_of_entries > 0 ? number_of_entries : 1;
+    self->x_scale = header->x_scale_factor;
+    self->y_scale = header->y_scale_factor;
+    self->z_scale = header->z_scale_factor;
+    self->fields = fields;
+    return self;
+}
+
+static PyObject * LASEntryList_new(PyTypeObject * type, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"records", "x_scale", "y_scale", "z_scale", "fields", NULL};
+    Py_buffer records;
+    LASHeader header;
+    PyObject * fields_object = Py_None;
+    int fields;
+
+    memset(&header, 0, sizeof(LASHeader));
+    header.x_scale_factor = header_scale;
+    header.y_scale_factor = header_scale;
+    header.z_scale_factor = header_scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|dddO", keywords, &records, &header.x_scale_factor,
+                                     &header.y_scale_factor, &header.z_scale_factor, &fields_object)) {
+        return NULL;
+    }
+    if (LASFields_FromPython(fields_object, &fields) < 0) {
+        PyBuffer_Release(&records);
+        return NULL;
+    }
+    if (records.len % (Py_ssize_t) sizeof(LASEntry) != 0) {
+        PyErr_Format(PyExc_ValueError, "records must hold whole %d byte point records.", (int) sizeof(LASEntry));
+        PyBuffer_Release(&records);
+        return NULL;
+    }
+
+    LASEntryListPython * self = LASEntryList_New(&header, (const LASEntry *) records.buf,
+                                                 records.len / (Py_ssize_t) sizeof(LASEntry), fields);
+    PyBuffer_Release(&records);
+    return (PyObject *) self;
+}
+
+static void LASEntryList_dealloc(LASEntryListPython * self) {
+    free(self->records);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static Py_ssize_t LASEntryList_length(LASEntryListPython * self) {
+    return self->length;
+}
+
+static PyObject * LASEntryList_item(LASEntryListPython * self, Py_ssize_t i) {
+    if (i < 0 || i >= self->length) {
+        PyErr_SetString(PyExc_IndexError, "LASEntryList index out of range.");
+        return NULL;
+    }
+
+    LASEntryPython * entry = (LASEntryPython *) LASEntryPythonType.tp_alloc(&LASEntryPythonType, 0);
+    if (!entry) {
+        return NULL;
+    }
+    Py_INCREF(self);
+    entry->owner = (PyObject *) self;
+    entry->index = i;
+    return (PyObject *) entry;
+}
+
+/**
+ * @brief Encode a LASEntry into a record of the list. The values are taken before anything
+ * is written, so the entry may be a view of this list.
+ *
+ */
+static int LASEntryList_encode(LASEntryListPython * self, PyObject * value, LASEntry * record) {
+    if (!PyObject_TypeCheck(value, &LASEntryPythonType)) {
+        PyErr_SetString(PyExc_TypeError, "LASEntryList items must be LASEntry.");
+        return -1;
+    }
+    if (self->fields != LAS_FIELDS_ALL) {
+        PyErr_SetString(PyExc_AttributeError, "Not every field was read, see the fields argument of the reader.");
+        return -1;
+    }
+
+    double x, y, z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+    LASEntry_GetValues((LASEntryPython *) value, &x, &y, &z, &intensity, &quality, &utc_time);
+
+    *record = initLASEntry(utc_time, x, y, z, intensity, quality);
+    record->x = encode_coordinate(x, self->x_scale);
+    record->y = encode_coordinate(y, self->y_scale);
+    record->z = encode_coordinate(z, self->z_scale);
+    return 0;
+}
+
+/**
+ * @brief Make room for length records. Like bytearray, the list cannot change size while
+ * its records are exported.
+ *
+ */
+static int LASEntryList_resize(LASEntryListPython * self, Py_ssize_t length) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "Cannot resize a LASEntryList while its records are exported.");
+        return -1;
+    }
+    if (length <= self->capacity) {
+        return 0;
+    }
+
+    Py_ssize_t capacity = 2 * self->capacity > length ? 2 * self->capacity : length;
+    if (capacity > PY_SSIZE_T_MAX / (Py_ssize_t) sizeof(LASEntry)) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    LASEntry * records = (LASEntry *) realloc(self->records, (size_t)capacity * sizeof(LASEntry));
+    if (!records) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for entries.");
+        return -1;
+    }
+    las_stats_allocation((size_t)capacity * sizeof(LASEntry));
+    self->records = records;
+    self->capacity = capacity;
+    return 0;
+}
+
+static int LASEntryList_insert_at(LASEntryListPython * self, Py_ssize_t i, PyObject * value) {
+    LASEntry record;
+    if (LASEntryList_encode(self, value, &record) < 0 || LASEntryList_resize(self, self->length + 1) < 0) {
+        return -1;
+    }
+    memmove(self->records + i + 1, self->records + i, (size_t)(self->length - i) * sizeof(LASEntry));
+    self->records[i] = record;
+    self->length += 1;
+    return 0;
+}
+
+static int LASEntryList_remove_at(LASEntryListPython * self, Py_ssize_t i) {
+    if (LASEntryList_resize(self, self->length - 1) < 0) {
+        return -1;
+    }
+    memmove(self->records + i, self->records + i + 1, (size_t)(self->length - i - 1) * sizeof(LASEntry));
+    self->length -= 1;
+    return 0;
+}
+
+static int LASEntryList_ass_item(LASEntryListPython * self, Py_ssize_t i, PyObject * value) {
+    if (i < 0 || i >= self->length) {
+        PyErr_SetString(PyExc_IndexError, "LASEntryList assignment index out of range.");
+        return -1;
+    }
+    if (value == NULL) {
+        return LASEntryList_remove_at(self, i);
+    }
+    return LASEntryList_encode(self, value, self->records + i);
+}
+
+static PyObject * LASEntryList_subscript(LASEntryListPython * self, PyObject * key) {
+    if (PySlice_Check(key)) {
+        Py_ssize_t start, stop, step;
+        if (PySlice_Unpack(key, &start, &stop, &step) < 0) {
+            return NULL;
+        }
+        Py_ssize_t length = PySlice_AdjustIndices(self->length, &start, &stop, step);
+
+        PyObject * entries = PyList_New(length);
+        if (!entries) {
+            return NULL;
+        }
+        for (Py_ssize_t i = 0; i < length; ++i) {
+            PyObject * entry = LASEntryList_item(self, start + i * step);
+            if (!entry) {
+                Py_DECREF(entries);
+                return NULL;
+            }
+            PyList_SET_ITEM(entries, i, entry);
+        }
+        return entries;
+    }
+
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    if (i < 0) {
+        i += self->length;
+    }
+    return LASEntryList_item(self, i);
+}
+
+static int LASEntryList_ass_subscript(LASEntryListPython * self, PyObject * key, PyObject * value) {
+    if (PySlice_Check(key)) {
+        PyErr_SetString(PyExc_TypeError, "LASEntryList does not support slice assignment.");
+        return -1;
+    }
+
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (i < 0) {
+        i += self->length;
+    }
+    return LASEntryList_ass_item(self, i, value);
+}
+
+static int LASEntryList_getbuffer(LASEntryListPython * self, Py_buffer * view, int flags) {
+    if (PyBuffer_FillInfo(view, (PyObject *) self, self->records, self->length * (Py_ssize_t) sizeof(LASEntry), 0, flags) < 0) {
+        return -1;
+    }
+    self->exports += 1;
+    return 0;
+}
+
+static void LASEntryList_releasebuffer(LASEntryListPython * self, Py_buffer * view) {
+    self->exports -= 1;
+}
+
+static PyObject * LASEntryList_append(LASEntryListPython * self, PyObject * value) {
+    if (LASEntryList_insert_at(self, self->length, value) < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASEntryList_extend(LASEntryListPython * self, PyObject * iterable) {
+    PyObject * items = PySequence_Fast(iterable, "LASEntryList.extend() argument must be iterable.");
+    if (!items) {
+        return NULL;
+    }
+
+    // items may be this list, its length is taken before anything is appended.
+    Py_ssize_t number_of_items = PySequence_Fast_GET_SIZE(items);
+    if (LASEntryList_resize(self, self->length + number_of_items) < 0) {
+        Py_DECREF(items);
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < number_of_items; ++i) {
+        if (LASEntryList_insert_at(self, self->length, PySequence_Fast_GET_ITEM(items, i)) < 0) {
+            Py_DECREF(items);
+            return NULL;
+        }
+    }
+    Py_DECREF(items);
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASEntryList_insert(LASEntryListPython * self, PyObject * args) {
+    Py_ssize_t i;
+    PyObject * value;
+    if (!PyArg_ParseTuple(args, "nO", &i, &value)) {
+        return NULL;
+    }
+
+    // clamped like list.insert.
+    if (i < 0) {
+        i = i + self->length > 0 ? i + self->length : 0;
+    }
+    if (i > self->length) {
+        i = self->length;
+    }
+    if (LASEntryList_insert_at(self, i, value) < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASEntryList_pop(LASEntryListPython * self, PyObject * args) {
+    Py_ssize_t i = -1;
+    if (!PyArg_ParseTuple(args, "|n", &i)) {
+        return NULL;
+    }
+    if (self->length == 0) {
+        PyErr_SetString(PyExc_IndexError, "pop from empty LASEntryList.");
+        return NULL;
+    }
+    if (i < 0) {
+        i += self->length;
+    }
+    if (i < 0 || i >= self->length) {
+        PyErr_SetString(PyExc_IndexError, "LASEntryList pop index out of range.");
+        return NULL;
+    }
+
+    // the popped entry keeps its values, it no longer refers to a record of the list.
+    LASEntryPython * entry = (LASEntryPython *) LASEntryList_item(self, i);
+    if (!entry) {
+        return NULL;
+    }
+    LASEntry_GetValues(entry, &entry->x, &entry->y, &entry->z, &entry->intensity, &entry->quality, &entry->utc_time);
+    Py_CLEAR(entry->owner);
+    if (LASEntryList_remove_at(self, i) < 0) {
+        Py_DECREF(entry);
+        return NULL;
+    }
+    return (PyObject *) entry;
+}
+
+static PyObject * LASEntryList_reduce_ex(LASEntryListPython * self, PyObject * args) {
+    int protocol;
+    if (!PyArg_ParseTuple(args, "i", &protocol)) {
+        return NULL;
+    }
+
+    // protocol 5 hands the records over as one buffer, out of band if the pickler
+    // has a buffer_callback, instead of copying them into the pickle.
+    PyObject * records;
+#if PY_VERSION_HEX >= 0x03080000
+    if (protocol >= 5) {
+        records = PyPickleBuffer_FromObject((PyObject *) self);
+    } else
+#endif
+    {
+        records = PyBytes_FromStringAndSize((const char *) self->records, self->length * (Py_ssize_t) sizeof(LASEntry));
+    }
+    if (!records) {
+        return NULL;
+    }
+    PyObject * fields = LASFields_ToPython(self->fields);
+    if (!fields) {
+        Py_DECREF(records);
+        return NULL;
+    }
+    return Py_BuildValue("(O(NdddN))", Py_TYPE(self), records, self->x_scale, self->y_scale, self->z_scale, fields);
+}
+
+static PyMethodDef LASEntryList_methods[] = {
+    {"append", (PyCFunction) LASEntryList_append, METH_O, "append(entry)\n\nAdd the values of a LASEntry at the end."},
+    {"extend", (PyCFunction) LASEntryList_extend, METH_O, "extend(entries)\n\nAppend the values of every LASEntry of an iterable."},
+    {"insert", (PyCFunction) LASEntryList_insert, METH_VARARGS, "insert(index, entry)\n\nAdd the values of a LASEntry before index."},
+    {"pop", (PyCFunction) LASEntryList_pop, METH_VARARGS, "pop(index=-1)\n\nRemove the entry at index and return it as a standalone LASEntry."},
+    {"__reduce_ex__", (PyCFunction) LASEntryList_reduce_ex, METH_VARARGS, NULL},
+    {NULL} //sentinel
+};
+
+static PyBufferProcs LASEntryList_as_buffer = {
+    .bf_getbuffer = (getbufferproc) LASEntryList_getbuffer,
+    .bf_releasebuffer = (releasebufferproc) LASEntryList_releasebuffer,
+};
+
+static PySequenceMethods LASEntryList_sequence = {
+    .sq_length = (lenfunc) LASEntryList_length,
+    .sq_item = (ssizeargfunc) LASEntryList_item,
+    .sq_ass_item = (ssizeobjargproc) LASEntryList_ass_item,
+};
+
+static PyMappingMethods LASEntryList_mapping = {
+    .mp_length = (lenfunc) LASEntryList_length,
+    .mp_subscript = (binaryfunc) LASEntryList_subscript,
+    .mp_ass_subscript = (objobjargproc) LASEntryList_ass_subscript,
+};
+
+PyTypeObject LASEntryListPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASEntryList",
+    .tp_doc = "LASEntryList(records, x_scale=1e-6, y_scale=1e-6, z_scale=1e-6, fields=None)\n\n"
+              "The points of a profile, kept as the packed records of the file. Indexing\n"
+              "returns a LASEntry that reads and writes its record, so points that are never\n"
+              "accessed are never decoded. append, extend, insert, pop and del copy values in\n"
+              "and out of the records, an entry refers to a position rather than a point.\n"
+              "The records are exported through the buffer protocol as bytes, and a list is\n"
+              "made from a copy of such bytes.",
+    .tp_basicsize = sizeof(LASEntryListPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = LASEntryList_new,
+    .tp_dealloc = (destructor) LASEntryList_dealloc,
+    .tp_methods = LASEntryList_methods,
+    .tp_as_buffer = &LASEntryList_as_buffer,
+    .tp_as_sequence = &LASEntryList_sequence,
+    .tp_as_mapping = &LASEntryList_mapping,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+Py_ssize_t LASEntries_Encode(PyObject * entries, LASProfileBuffer * buffer) {
+    Py_ssize_t number_of_entries;
+    int ret = 0;
+
+    if (PyObject_TypeCheck(entries, &LASEntryListPythonType)) {
+        LASEntryListPython * list = (LASEntryListPython *) entries;
+        number_of_entries = list->length;
+
+        // held like a buffer view so no other thread resizes the records meanwhile.
+        list->exports += 1;
+        Py_BEGIN_ALLOW_THREADS
+        ret = reserve_profile_buffer(buffer, (size_t)number_of_entries);
+        if (ret == 0) {
+            if (list->fields == LAS_FIELDS_ALL && list->x_scale == header_scale &&
+                list->y_scale == header_scale && list->z_scale == header_scale) {
+                // already encoded the way the writers would.
+                memcpy(buffer->entries, list->records, (size_t)number_of_entries * sizeof(LASEntry));
+            } else {
+                LASHeader header;
+                LASColumnArrays columns = buffer->columns;
+                memset(&header, 0, sizeof(LASHeader));
+                header.x_scale_factor = list->x_scale;
+                header.y_scale_factor = list->y_scale;
+                header.z_scale_factor = list->z_scale;
+
+                // fields that were not read are written as 0, the way they read.
+                memset(columns.x, 0, (size_t)number_of_entries * sizeof(double));
+                memset(columns.y, 0, (size_t)number_of_entries * sizeof(double));
+                memset(columns.z, 0, (size_t)number_of_entries * sizeof(double));
+                memset(columns.intensity, 0, (size_t)number_of_entries * sizeof(uint16_t));
+                memset(columns.quality, 0, (size_t)number_of_entries * sizeof(uint8_t));
+                memset(columns.utc_time, 0, (size_t)number_of_entries * sizeof(uint64_t));
+                select_fields(&columns, list->fields);
+                decode_profile(&header, list->records, (size_t)number_of_entries, &columns, 0);
+                encode_entries(buffer->columns.x, buffer->columns.y, buffer->columns.z,
+                               buffer->columns.intensity, buffer->columns.quality, buffer->columns.utc_time,
+                               (size_t)number_of_entries, buffer->entries);
+            }
+        }
+        Py_END_ALLOW_THREADS
+        list->exports -= 1;
+    } else if (PyList_Check(entries)) {
+        number_of_entries = PyList_GET_SIZE(entries);
+        ret = reserve_profile_buffer(buffer, (size_t)number_of_entries);
+        if (ret == 0) {
+            // copy the point values out of the Python objects, the encoding then runs
+            // without the GIL.
+            for (Py_ssize_t point = 0; point < number_of_entries; ++point) {
+                LASEntryPython * entry = (LASEntryPython *)PyList_GET_ITEM(entries, point);
+                if (!PyObject_TypeCheck(entry, &LASEntryPythonType)) {
+                    PyErr_SetString(PyExc_TypeError, "LASFile entries must be a list of LASEntry.");
+                    return -1;
+                }
+                LASEntry_GetValues(entry, buffer->columns.x + point, buffer->columns.y + point, buffer->columns.z + point,
+                                   buffer->columns.intensity + point, buffer->columns.quality + point,
+                                   buffer->columns.utc_time + point);
+            }
+
+            Py_BEGIN_ALLOW_THREADS
+            encode_entries(buffer->columns.x, buffer->columns.y, buffer->columns.z,
+                           buffer->columns.intensity, buffer->columns.quality, buffer->columns.utc_time,
+                           (size_t)number_of_entries, buffer->entries);
+            Py_END_ALLOW_THREADS
+        }
+    } else {
+        PyErr_SetString(PyExc_TypeError, "LASFile entries must be a LASEntryList or a list of LASEntry.");
+        return -1;
+    }
+
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for entries.");
+        return -1;
+    }
+    return number_of_entries;
+}
@@ -0,0 +1,880 @@
+/**
+ * @file las_2g_grid.c
+ * @author Ryan Wicks
+ * @brief Morton ordered spatial grid over the points of a survey.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_grid.h"
+#include "las_2g_stats.h"
+#include "las_2g_thread.h"
+#include <math.h>
+#include <string.h>
+
+#define GRID_CHUNK_POINTS 65536 // points per work item of the parallel build
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+//-----------------------------------------------------------------
+// Cell Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Spread the low 21 bits of a value so there are two zero bits between each of them.
+ */
+static uint64_t spread_bits(uint64_t value) {
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffffull;
+    value = (value | value << 16) & 0x1f0000ff0000ffull;
+    value = (value | value << 8) & 0x100f00f00f00f00full;
+    value = (value | value << 4) & 0x10c30c30c30c30c3ull;
+    value = (value | value << 2) & 0x1249249249249249ull;
+    return value;
+}
+
+static uint32_t compact_bits(uint64_t value) {
+    value &= 0x1249249249249249ull;
+    value = (value ^ (value >> 2)) & 0x10c30c30c30c30c3ull;
+    value = (value ^ (value >> 4)) & 0x100f00f00f00f00full;
+    value = (value ^ (value >> 8)) & 0x1f0000ff0000ffull;
+    value = (value ^ (value >> 16)) & 0x1f00000000ffffull;
+    value = (value ^ (value >> 32)) & 0x1fffffull;
+    return (uint32_t)value;
+}
+
+static uint64_t morton_code(const uint32_t cell[3]) {
+    return spread_bits(cell[0]) | (spread_bits(cell[1]) << 1) | (spread_bits(cell[2]) << 2);
+}
+
+static void morton_decode(uint64_t code, uint32_t cell[3]) {
+    cell[0] = compact_bits(code);
+    cell[1] = compact_bits(code >> 1);
+    cell[2] = compact_bits(code >> 2);
+}
+
+/**
+ * @brief Cell holding a coordinate along an axis, clamped to the grid. NaN goes to cell 0.
+ */
+static uint32_t grid_cell(const LASGridHeader * header, int axis, double value) {
+    double cell = floor((value - header->origin[axis]) / header->cell_size);
+    if (!(cell > 0.0)) {
+        return 0;
+    }
+    if (cell >= (double)header->dimensions[axis]) {
+        return header->dimensions[axis] - 1;
+    }
+    return (uint32_t)cell;
+}
+
+/**
+ * @brief Index of an occupied cell, or number_of_cells if the cell is empty.
+ */
+static size_t find_cell(const LASGrid * grid, uint64_t code) {
+    size_t low = 0;
+    size_t high = (size_t)grid->header.number_of_cells;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (grid->cell_codes[middle] < code) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < grid->header.number_of_cells && grid->cell_codes[low] == code ? low : (size_t)grid->header.number_of_cells;
+}
+
+static uint64_t grid_block_size(const LASGridHeader * header) {
+    return header->number_of_cells * sizeof(uint64_t) +
+           (header->number_of_cells + 1) * sizeof(uint64_t) +
+           header->number_of_points * sizeof(LASGridPoint) +
+           (header->number_of_profiles + 1) * sizeof(uint64_t);
+}
+
+/**
+ * @brief Point the arrays of a grid into its block.
+ */
+static void set_grid_arrays(LASGrid * grid, const uint8_t * block) {
+    grid->cell_codes = (const uint64_t *)block;
+    grid->cell_starts = grid->cell_codes + grid->header.number_of_cells;
+    grid->points = (const LASGridPoint *)(grid->cell_starts + grid->header.number_of_cells + 1);
+    grid->profile_offsets = (const uint64_t *)(grid->points + grid->header.number_of_points);
+}
+
+//-----------------------------------------------------------------
+// Build Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief State shared by the workers of build_grid. Every pass works on chunks of
+ * GRID_CHUNK_POINTS points, each chunk owning its slice of bounds and histograms.
+ *
+ */
+typedef struct {
+    const double * coordinates[3];
+    const uint64_t * offsets;
+    size_t number_of_profiles;
+    uint64_t number_of_points;
+    const LASGridHeader * header;
+    double * bounds; /// min x, y, z and max x, y, z of each chunk
+    uint64_t * keys; /// Morton code of each point, sorted by the radix passes
+    uint64_t * values; /// index of each point in the survey, moved with its key
+    uint64_t * keys_out;
+    uint64_t * values_out;
+    uint64_t * histograms; /// RADIX_BUCKETS counts, then positions, per chunk
+    unsigned shift; /// first key bit of the current radix digit
+    LASGridPoint * points;
+} GridBuild;
+
+static void chunk_range(const GridBuild * build, size_t chunk, uint64_t * start, uint64_t * end) {
+    *start = (uint64_t)chunk * GRID_CHUNK_POINTS;
+    *end = *start + GRID_CHUNK_POINTS < build->number_of_points ? *start + GRID_CHUNK_POINTS : build->number_of_points;
+}
+
+static void grid_bounds_chunk(void * context, size_t chunk) {
+    GridBuild * build = (GridBuild *)context;
+    double * bounds = build->bounds + chunk * 6;
+    uint64_t start, end;
+    chunk_range(build, chunk, &start, &end);
+
+    for (int axis = 0; axis < 3; ++axis) {
+        double low = HUGE_VAL;
+        double high = -HUGE_VAL;
+        for (uint64_t i = start; i < end; ++i) {
+            double value = build->coordinates[axis][i];
+            if (isfinite(value)) {
+                low = value < low ? value : low;
+                high = value > high ? value : high;
+            }
+        }
+        bounds[axis] = low;
+        bounds[axis + 3] = high;
+    }
+}
+
+static void grid_code_chunk(void * context, size_t chunk) {
+    GridBuild * build = (GridBuild *)context;
+    uint64_t start, end;
+    chunk_range(build, chunk, &start, &end);
+
+    for (uint64_t i = start; i < end; ++i) {
+        uint32_t cell[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            cell[axis] = grid_cell(build->header, axis, build->coordinates[axis][i]);
+        }
+        build->keys[i] = morton_code(cell);
+        build->values[i] = i;
+    }
+}
+
+static void grid_histogram_chunk(void * context, size_t chunk) {
+    GridBuild * build = (GridBuild *)context;
+    uint64_t * histogram = build->histograms + chunk * RADIX_BUCKETS;
+    uint64_t start, end;
+    chunk_range(build, chunk, &start, &end);
+
+    memset(histogram, 0, RADIX_BUCKETS * sizeof(uint64_t));
+    for (uint64_t i = start; i < end; ++i) {
+        histogram[(build->keys[i] >> build->shift) & (RADIX_BUCKETS - 1)] += 1;
+    }
+}
+
+static void grid_scatter_chunk(void * context, size_t chunk) {
+    GridBuild * build = (GridBuild *)context;
+    uint64_t * positions = build->histograms + chunk * RADIX_BUCKETS;
+    uint64_t start, end;
+    chunk_range(build, chunk, &start, &end);
+
+    // chunks are scattered in order into their own ranges of each bucket, so the sort is stable.
+    for (uint64_t i = start; i < end; ++i) {
+        uint64_t position = positions[(build->keys[i] >> build->shift) & (RADIX_BUCKETS - 1)]++;
+        build->keys_out[position] = build->keys[i];
+        build->values_out[position] = build->values[i];
+    }
+}
+
+static void grid_fill_chunk(void * context, size_t chunk) {
+    GridBuild * build = (GridBuild *)context;
+    uint64_t start, end;
+    chunk_range(build, chunk, &start, &end);
+
+    for (uint64_t i = start; i < end; ++i) {
+        uint64_t index = build->values[i];
+
+        // last profile starting at or before the point, skipping empty profiles.
+        size_t low = 0;
+        size_t high = build->number_of_profiles;
+        while (high - low > 1) {
+            size_t middle = low + (high - low) / 2;
+            if (build->offsets[middle] <= index) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+
+        LASGridPoint * point = &build->points[i];
+        point->x = build->coordinates[0][index];
+        point->y = build->coordinates[1][index];
+        point->z = build->coordinates[2][index];
+        point->profile = (uint32_t)low;
+        point->point = (uint32_t)(index - build->offsets[low]);
+    }
+}
+
+/**
+ * @brief Sort the keys and values with least significant digit first radix passes over
+ * the bits used by the codes.
+ */
+static void grid_radix_sort(GridBuild * build, unsigned bits, size_t number_of_chunks, int threads) {
+    for (unsigned shift = 0; shift < bits; shift += RADIX_BITS) {
+        build->shift = shift;
+        las_parallel_for(number_of_chunks, threads, grid_histogram_chunk, build);
+
+        // turn the counts into the first position of each chunk in each bucket.
+        uint64_t position = 0;
+        for (size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            for (size_t chunk = 0; chunk < number_of_chunks; ++chunk) {
+                uint64_t count = build->histograms[chunk * RADIX_BUCKETS + bucket];
+                build->histograms[chunk * RADIX_BUCKETS + bucket] = position;
+                position += count;
+            }
+        }
+        las_parallel_for(number_of_chunks, threads, grid_scatter_chunk, build);
+
+        uint64_t * swap = build->keys;
+        build->keys = build->keys_out;
+        build->keys_out = swap;
+        swap = build->values;
+        build->values = build->values_out;
+        build->values_out = swap;
+    }
+}
+
+/**
+ * @brief Pick the origin, cell size and dimensions from the bounds of the points.
+ */
+static void grid_layout(LASGridHeader * header, const double low[3], const double high[3], double cell_size) {
+    double extents[3];
+    double largest = 0.0;
+    double second = 0.0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        header->origin[axis] = low[axis] <= high[axis] ? low[axis] : 0.0;
+        extents[axis] = low[axis] <= high[axis] ? high[axis] - low[axis] : 0.0;
+        if (extents[axis] > largest) {
+            second = largest;
+            largest = extents[axis];
+        } else if (extents[axis] > second) {
+            second = extents[axis];
+        }
+    }
+
+    if (cell_size <= 0.0 && header->number_of_points > 0) {
+        // survey points lie on surfaces, so the cell size is set from the two largest extents.
+        if (second > 0.0) {
+            cell_size = sqrt(largest * second * GRID_POINTS_PER_CELL / (double)header->number_of_points);
+        } else {
+            cell_size = largest * GRID_POINTS_PER_CELL / (double)header->number_of_points;
+        }
+    }
+    if (cell_size < largest / (GRID_MAX_CELLS_PER_AXIS - 1)) {
+        cell_size = largest / (GRID_MAX_CELLS_PER_AXIS - 1);
+    }
+    if (!(cell_size > 0.0)) {
+        cell_size = 1.0;
+    }
+
+    header->cell_size = cell_size;
+    for (int axis = 0; axis < 3; ++axis) {
+        double cells = floor(extents[axis] / cell_size) + 1.0;
+        header->dimensions[axis] = cells < GRID_MAX_CELLS_PER_AXIS ? (uint32_t)cells : GRID_MAX_CELLS_PER_AXIS;
+    }
+}
+
+int build_grid(const double * x, const double * y, const double * z, const uint64_t * offsets,
+               size_t number_of_profiles, double cell_size, int threads, LASGrid * grid) {
+    GridBuild build;
+    int ret = -1;
+
+    memset(grid, 0, sizeof(LASGrid));
+    memset(&build, 0, sizeof(GridBuild));
+    if (cell_size < 0.0 || number_of_profiles > UINT32_MAX) {
+        return -1;
+    }
+
+    LASGridHeader * header = &grid->header;
+    memcpy(header->signature, GRID_SIGNATURE, sizeof(header->signature));
+    header->version = GRID_VERSION;
+    header->point_size = sizeof(LASGridPoint);
+    header->number_of_profiles = number_of_profiles;
+    header->number_of_points = offsets[number_of_profiles];
+
+    build.coordinates[0] = x;
+    build.coordinates[1] = y;
+    build.coordinates[2] = z;
+    build.offsets = offsets;
+    build.number_of_profiles = number_of_profiles;
+    build.number_of_points = header->number_of_points;
+    build.header = header;
+
+    uint64_t number_of_points = header->number_of_points;
+    size_t number_of_chunks = (size_t)((number_of_points + GRID_CHUNK_POINTS - 1) / GRID_CHUNK_POINTS);
+    size_t allocated_chunks = number_of_chunks > 0 ? number_of_chunks : 1;
+    size_t allocated_points = number_of_points > 0 ? (size_t)number_of_points : 1;
+
+    build.bounds = (double *)malloc(allocated_chunks * 6 * sizeof(double));
+    build.histograms = (uint64_t *)malloc(allocated_chunks * RADIX_BUCKETS * sizeof(uint64_t));
+    build.keys = (uint64_t *)malloc(allocated_points * sizeof(uint64_t));
+    build.values = (uint64_t *)malloc(allocated_points * sizeof(uint64_t));
+    build.keys_out = (uint64_t *)malloc(allocated_points * sizeof(uint64_t));
+    build.values_out = (uint64_t *)malloc(allocated_points * sizeof(uint64_t));
+    if (!build.bounds || !build.histograms || !build.keys || !build.values || !build.keys_out || !build.values_out) {
+        goto cleanup;
+    }
+    las_stats_allocation(allocated_points * 4 * sizeof(uint64_t));
+
+    las_parallel_for(number_of_chunks, threads, grid_bounds_chunk, &build);
+    double low[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+    double high[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    for (size_t chunk = 0; chunk < number_of_chunks; ++chunk) {
+        for (int axis = 0; axis < 3; ++axis) {
+            low[axis] = build.bounds[chunk * 6 + axis] < low[axis] ? build.bounds[chunk * 6 + axis] : low[axis];
+            high[axis] = build.bounds[chunk * 6 + axis + 3] > high[axis] ? build.bounds[chunk * 6 + axis + 3] : high[axis];
+        }
+    }
+    grid_layout(header, low, high, cell_size);
+
+    las_parallel_for(number_of_chunks, threads, grid_code_chunk, &build);
+
+    // only the bits a cell code can use are sorted.
+    uint32_t largest = header->dimensions[0];
+    largest = header->dimensions[1] > largest ? header->dimensions[1] : largest;
+    largest = header->dimensions[2] > largest ? header->dimensions[2] : largest;
+    unsigned bits_per_axis = 1;
+    while (bits_per_axis < 21 && (1u << bits_per_axis) < largest) {
+        bits_per_axis += 1;
+    }
+    grid_radix_sort(&build, 3 * bits_per_axis, number_of_chunks, threads);
+
+    uint64_t number_of_cells = 0;
+    for (uint64_t i = 0; i < number_of_points; ++i) {
+        if (i == 0 || build.keys[i] != build.keys[i - 1]) {
+            number_of_cells += 1;
+        }
+    }
+    header->number_of_cells = number_of_cells;
+
+    grid->block_size = grid_block_size(header);
+    grid->block = (uint8_t *)malloc((size_t)grid->block_size);
+    if (!grid->block) {
+        goto cleanup;
+    }
+    las_stats_allocation(grid->block_size);
+    set_grid_arrays(grid, grid->block);
+
+    uint64_t * cell_codes = (uint64_t *)grid->cell_codes;
+    uint64_t * cell_starts = (uint64_t *)grid->cell_starts;
+    uint64_t cell = 0;
+    for (uint64_t i = 0; i < number_of_points; ++i) {
+        if (i == 0 || build.keys[i] != build.keys[i - 1]) {
+            cell_codes[cell] = build.keys[i];
+            cell_starts[cell] = i;
+            cell += 1;
+        }
+    }
+    cell_starts[number_of_cells] = number_of_points;
+
+    build.points = (LASGridPoint *)grid->points;
+    las_parallel_for(number_of_chunks, threads, grid_fill_chunk, &build);
+    memcpy((uint64_t *)grid->profile_offsets, offsets, (number_of_profiles + 1) * sizeof(uint64_t));
+    ret = 0;
+
+cleanup:
+    free(build.bounds);
+    free(build.histograms);
+    free(build.keys);
+    free(build.values);
+    free(build.keys_out);
+    free(build.values_out);
+    if (ret < 0) {
+        free_grid(grid);
+    }
+    return ret;
+}
+
+//-----------------------------------------------------------------
+// File Definitions
+//-----------------------------------------------------------------
+
+int write_grid(const char * filename, const LASGrid * grid) {
+    FILE * fid;
+
+    size_t length = strlen(filename);
+    char * temp_filename = (char *)malloc(length + 5);
+    if (!temp_filename) {
+        return -1;
+    }
+    memcpy(temp_filename, filename, length);
+    memcpy(temp_filename + length, ".tmp", 5);
+
+    // write next to the destination and rename, so a reader never maps a half written grid.
+    fid = fopen(temp_filename, "wb");
+    if (fid == NULL) {
+        free(temp_filename);
+        return -1;
+    }
+    size_t block_size = (size_t)grid->block_size;
+    int ok = fwrite(&grid->header, sizeof(LASGridHeader), 1, fid) == 1 &&
+             fwrite(grid->cell_codes, 1, block_size, fid) == block_size;
+    ok = (fclose(fid) == 0) && ok;
+
+#ifdef _WIN32
+    remove(filename);
+#endif
+    if (!ok || rename(temp_filename, filename) != 0) {
+        remove(temp_filename);
+        free(temp_filename);
+        return -1;
+    }
+
+    free(temp_filename);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, sizeof(LASGridHeader) + block_size);
+    return 0;
+}
+
+/**
+ * @brief Check the cell arrays of a mapped grid once, so the queries can search and walk
+ * them without bounds checks: codes strictly ascending, starts from 0 to the number of
+ * points without going back.
+ *
+ * @return int 1 if the arrays are consistent, 0 otherwise.
+ */
+static int grid_cells_valid(const LASGrid * grid) {
+    uint64_t number_of_cells = grid->header.number_of_cells;
+
+    if (grid->cell_starts[0] != 0 || grid->cell_starts[number_of_cells] != grid->header.number_of_points) {
+        return 0;
+    }
+    for (uint64_t cell = 0; cell < number_of_cells; ++cell) {
+        if (grid->cell_starts[cell + 1] < grid->cell_starts[cell] ||
+            (cell > 0 && grid->cell_codes[cell] <= grid->cell_codes[cell - 1])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int map_grid(const char * filename, LASGrid * grid) {
+    memset(grid, 0, sizeof(LASGrid));
+    if (map_file(filename, &grid->mapped) < 0) {
+        return -1;
+    }
+
+    const LASMappedFile * mapped = &grid->mapped;
+    LASGridHeader * header = &grid->header;
+    if (mapped->size < sizeof(LASGridHeader)) {
+        unmap_file(&grid->mapped);
+        return -1;
+    }
+    memcpy(header, mapped->data, sizeof(LASGridHeader));
+
+    // the counts are bounded by the file size before the block size is computed from them.
+    uint64_t body = mapped->size - sizeof(LASGridHeader);
+    if (memcmp(header->signature, GRID_SIGNATURE, sizeof(header->signature)) != 0 ||
+        header->version != GRID_VERSION ||
+        header->point_size != sizeof(LASGridPoint) ||
+        header->number_of_cells > body / sizeof(uint64_t) ||
+        header->number_of_points > body / sizeof(LASGridPoint) ||
+        header->number_of_profiles > body / sizeof(uint64_t) ||
+        !(header->cell_size > 0.0) ||
+        grid_block_size(header) != body) {
+        unmap_file(&grid->mapped);
+        return -1;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if (header->dimensions[axis] == 0 || header->dimensions[axis] > GRID_MAX_CELLS_PER_AXIS) {
+            unmap_file(&grid->mapped);
+            return -1;
+        }
+    }
+
+    grid->block_size = body;
+    set_grid_arrays(grid, mapped->data + sizeof(LASGridHeader));
+    if (!grid_cells_valid(grid)) {
+        unmap_file(&grid->mapped);
+        return -1;
+    }
+    grid->is_mapped = 1;
+    return 0;
+}
+
+void free_grid(LASGrid * grid) {
+    if (grid->is_mapped) {
+        unmap_file(&grid->mapped);
+        grid->is_mapped = 0;
+    }
+    free(grid->block);
+    grid->block = NULL;
+    grid->cell_codes = NULL;
+    grid->cell_starts = NULL;
+    grid->points = NULL;
+    grid->profile_offsets = NULL;
+}
+
+//-----------------------------------------------------------------
+// Query Definitions
+//-----------------------------------------------------------------
+
+void init_grid_result(LASGridResult * result) {
+    memset(result, 0, sizeof(LASGridResult));
+}
+
+void free_grid_result(LASGridResult * result) {
+    free(result->profiles);
+    free(result->points);
+    free(result->distances);
+    init_grid_result(result);
+}
+
+static int reserve_grid_result(LASGridResult * result, size_t capacity) {
+    if (capacity <= result->capacity) {
+        return 0;
+    }
+    uint32_t * profiles = (uint32_t *)realloc(result->profiles, capacity * sizeof(uint32_t));
+    if (!profiles) {
+        return -1;
+    }
+    result->profiles = profiles;
+    uint32_t * points = (uint32_t *)realloc(result->points, capacity * sizeof(uint32_t));
+    if (!points) {
+        return -1;
+    }
+    result->points = points;
+    double * distances = (double *)realloc(result->distances, capacity * sizeof(double));
+    if (!distances) {
+        return -1;
+    }
+    result->distances = distances;
+    result->capacity = capacity;
+    return 0;
+}
+
+static int push_grid_result(LASGridResult * result, const LASGridPoint * point, double distance) {
+    if (result->count == result->capacity &&
+        reserve_grid_result(result, result->capacity > 0 ? result->capacity * 2 : 256) < 0) {
+        return -1;
+    }
+    result->profiles[result->count] = point->profile;
+    result->points[result->count] = point->point;
+    result->distances[result->count] = distance;
+    result->count += 1;
+    return 0;
+}
+
+/**
+ * @brief A box, optionally cut down to a sphere, for grid_query_range.
+ *
+ */
+typedef struct {
+    double min[3];
+    double max[3];
+    int has_sphere;
+    double centre[3];
+    double radius_squared;
+} GridRange;
+
+static int grid_range_cell(const LASGrid * grid, size_t cell, const GridRange * range, LASGridResult * result) {
+    for (uint64_t i = grid->cell_starts[cell]; i < grid->cell_starts[cell + 1]; ++i) {
+        const LASGridPoint * point = &grid->points[i];
+        if (!(point->x >= range->min[0] && point->x <= range->max[0] &&
+              point->y >= range->min[1] && point->y <= range->max[1] &&
+              point->z >= range->min[2] && point->z <= range->max[2])) {
+            continue;
+        }
+        double distance = 0.0;
+        if (range->has_sphere) {
+            double dx = point->x - range->centre[0];
+            double dy = point->y - range->centre[1];
+            double dz = point->z - range->centre[2];
+            double distance_squared = dx * dx + dy * dy + dz * dz;
+            if (distance_squared > range->radius_squared) {
+                continue;
+            }
+            distance = sqrt(distance_squared);
+        }
+        if (push_grid_result(result, point, distance) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Visit the occupied cells overlapping a box. Small boxes look up each of their
+ * cells, large ones walk the occupied cells instead.
+ */
+static int grid_query_range(const LASGrid * grid, const GridRange * range, LASGridResult * result) {
+    uint32_t low[3];
+    uint32_t high[3];
+    uint64_t count = 1;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (!(range->min[axis] <= range->max[axis])) {
+            return 0;
+        }
+        low[axis] = grid_cell(&grid->header, axis, range->min[axis]);
+        high[axis] = grid_cell(&grid->header, axis, range->max[axis]);
+        count *= (uint64_t)(high[axis] - low[axis] + 1);
+    }
+
+    if (count <= grid->header.number_of_cells) {
+        uint32_t cell[3];
+        for (cell[2] = low[2]; cell[2] <= high[2]; ++cell[2]) {
+            for (cell[1] = low[1]; cell[1] <= high[1]; ++cell[1]) {
+                for (cell[0] = low[0]; cell[0] <= high[0]; ++cell[0]) {
+                    size_t index = find_cell(grid, morton_code(cell));
+                    if (index < grid->header.number_of_cells && grid_range_cell(grid, index, range, result) < 0) {
+                        return -1;
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+
+    for (size_t index = 0; index < grid->header.number_of_cells; ++index) {
+        uint32_t cell[3];
+        morton_decode(grid->cell_codes[index], cell);
+        if (cell[0] >= low[0] && cell[0] <= high[0] && cell[1] >= low[1] && cell[1] <= high[1] &&
+            cell[2] >= low[2] && cell[2] <= high[2] && grid_range_cell(grid, index, range, result) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int grid_query_box(const LASGrid * grid, const double min[3], const double max[3], LASGridResult * result) {
+    GridRange range;
+
+    memset(&range, 0, sizeof(GridRange));
+    memcpy(range.min, min, sizeof(range.min));
+    memcpy(range.max, max, sizeof(range.max));
+    return grid_query_range(grid, &range, result);
+}
+
+int grid_query_radius(const LASGrid * grid, const double position[3], double radius, LASGridResult * result) {
+    GridRange range;
+
+    if (!(radius >= 0.0)) {
+        return 0;
+    }
+    range.has_sphere = 1;
+    range.radius_squared = radius * radius;
+    for (int axis = 0; axis < 3; ++axis) {
+        range.centre[axis] = position[axis];
+        range.min[axis] = position[axis] - radius;
+        range.max[axis] = position[axis] + radius;
+    }
+    return grid_query_range(grid, &range, result);
+}
+
+/**
+ * @brief Candidate of a nearest neighbour search, kept in a max heap on the distance.
+ *
+ */
+typedef struct {
+    double distance_squared;
+    uint64_t point;
+} GridNeighbour;
+
+static void sift_down(GridNeighbour * heap, size_t size, size_t i) {
+    for (;;) {
+        size_t largest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < size && heap[left].distance_squared > heap[largest].distance_squared) {
+            largest = left;
+        }
+        if (right < size && heap[right].distance_squared > heap[largest].distance_squared) {
+            largest = right;
+        }
+        if (largest == i) {
+            return;
+        }
+        GridNeighbour swap = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = swap;
+        i = largest;
+    }
+}
+
+/**
+ * @brief k nearest points seen so far.
+ *
+ */
+typedef struct {
+    GridNeighbour * heap;
+    size_t size;
+    size_t k;
+    double position[3];
+} GridNearest;
+
+static void grid_nearest_cell(const LASGrid * grid, size_t cell, GridNearest * nearest) {
+    for (uint64_t i = grid->cell_starts[cell]; i < grid->cell_starts[cell + 1]; ++i) {
+        const LASGridPoint * point = &grid->points[i];
+        double dx = point->x - nearest->position[0];
+        double dy = point->y - nearest->position[1];
+        double dz = point->z - nearest->position[2];
+        double distance_squared = dx * dx + dy * dy + dz * dz;
+        if (!(distance_squared == distance_squared)) {
+            continue; // NaN coordinates are never near
+        }
+
+        if (nearest->size < nearest->k) {
+            size_t child = nearest->size++;
+            nearest->heap[child].distance_squared = distance_squared;
+            nearest->heap[child].point = i;
+            while (child > 0 && nearest->heap[(child - 1) / 2].distance_squared < nearest->heap[child].distance_squared) {
+                GridNeighbour swap = nearest->heap[child];
+                nearest->heap[child] = nearest->heap[(child - 1) / 2];
+                nearest->heap[(child - 1) / 2] = swap;
+                child = (child - 1) / 2;
+            }
+        } else if (distance_squared < nearest->heap[0].distance_squared) {
+            nearest->heap[0].distance_squared = distance_squared;
+            nearest->heap[0].point = i;
+            sift_down(nearest->heap, nearest->size, 0);
+        }
+    }
+}
+
+static void grid_nearest_lookup(const LASGrid * grid, const uint32_t cell[3], GridNearest * nearest) {
+    size_t index = find_cell(grid, morton_code(cell));
+    if (index < grid->header.number_of_cells) {
+        grid_nearest_cell(grid, index, nearest);
+    }
+}
+
+/**
+ * @brief Smallest squared distance from a position to any point of a cell.
+ */
+static double cell_distance_squared(const LASGridHeader * header, const uint32_t cell[3], const double position[3]) {
+    double distance_squared = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+        double low = header->origin[axis] + cell[axis] * header->cell_size;
+        double high = low + header->cell_size;
+        double gap = position[axis] < low ? low - position[axis] : (position[axis] > high ? position[axis] - high : 0.0);
+        distance_squared += gap * gap;
+    }
+    return distance_squared;
+}
+
+int grid_query_nearest(const LASGrid * grid, const double position[3], size_t k, LASGridResult * result) {
+    const LASGridHeader * header = &grid->header;
+    GridNearest nearest;
+    uint32_t centre[3];
+    uint32_t last_ring = 0;
+
+    if (k == 0 || header->number_of_points == 0) {
+        return 0;
+    }
+    if (k > header->number_of_points) {
+        k = (size_t)header->number_of_points;
+    }
+    nearest.heap = (GridNeighbour *)malloc(k * sizeof(GridNeighbour));
+    if (!nearest.heap) {
+        return -1;
+    }
+    nearest.size = 0;
+    nearest.k = k;
+    for (int axis = 0; axis < 3; ++axis) {
+        nearest.position[axis] = position[axis];
+        centre[axis] = grid_cell(header, axis, position[axis]);
+        uint32_t reach = centre[axis] > header->dimensions[axis] - 1 - centre[axis] ? centre[axis] : header->dimensions[axis] - 1 - centre[axis];
+        last_ring = reach > last_ring ? reach : last_ring;
+    }
+
+    // visit shells of cells at a growing Chebyshev distance from the centre cell. Once the k
+    // nearest are closer than the next shell can be, the search is over.
+    uint64_t visited = 0;
+    uint32_t ring = 0;
+    for (;;) {
+        uint32_t low[3];
+        uint32_t high[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            low[axis] = centre[axis] > ring ? centre[axis] - ring : 0;
+            high[axis] = header->dimensions[axis] - 1 - centre[axis] > ring ? centre[axis] + ring : header->dimensions[axis] - 1;
+        }
+
+        uint32_t cell[3];
+        for (cell[2] = low[2]; cell[2] <= high[2]; ++cell[2]) {
+            int z_edge = cell[2] + ring == centre[2] || cell[2] == centre[2] + ring;
+            for (cell[1] = low[1]; cell[1] <= high[1]; ++cell[1]) {
+                int y_edge = cell[1] + ring == centre[1] || cell[1] == centre[1] + ring;
+                if (z_edge || y_edge) {
+                    for (cell[0] = low[0]; cell[0] <= high[0]; ++cell[0]) {
+                        grid_nearest_lookup(grid, cell, &nearest);
+                    }
+                    visited += high[0] - low[0] + 1;
+                    continue;
+                }
+                if (centre[0] >= ring) {
+                    cell[0] = centre[0] - ring;
+                    grid_nearest_lookup(grid, cell, &nearest);
+                    visited += 1;
+                }
+                if (ring > 0 && header->dimensions[0] - 1 - centre[0] >= ring) {
+                    cell[0] = centre[0] + ring;
+                    grid_nearest_lookup(grid, cell, &nearest);
+                    visited += 1;
+                }
+            }
+        }
+
+        // cells outside this shell are at least ring cells away, less a margin for rounding.
+        double reach = ring > 0 ? (ring - 1e-6) * header->cell_size : 0.0;
+        if ((nearest.size == k && ring > 0 && nearest.heap[0].distance_squared <= reach * reach) || ring >= last_ring) {
+            break;
+        }
+
+        if (visited > header->number_of_cells) {
+            // the shells are mostly empty, so the remaining occupied cells are walked instead.
+            for (size_t index = 0; index < header->number_of_cells; ++index) {
+                morton_decode(grid->cell_codes[index], cell);
+                uint32_t distance = 0;
+                for (int axis = 0; axis < 3; ++axis) {
+                    uint32_t offset = cell[axis] > centre[axis] ? cell[axis] - centre[axis] : centre[axis] - cell[axis];
+                    distance = offset > distance ? offset : distance;
+                }
+                if (distance <= ring ||
+                    (nearest.size == k && cell_distance_squared(header, cell, position) > nearest.heap[0].distance_squared)) {
+                    continue;
+                }
+                grid_nearest_cell(grid, index, &nearest);
+            }
+            break;
+        }
+        ring += 1;
+    }
+
+    if (reserve_grid_result(result, nearest.size) < 0) {
+        free(nearest.heap);
+        return -1;
+    }
+    // pop the heap from the back, so the nearest point comes first.
+    for (size_t size = nearest.size; size > 0; --size) {
+        const LASGridPoint * point = &grid->points[nearest.heap[0].point];
+        result->profiles[size - 1] = point->profile;
+        result->points[size - 1] = point->point;
+        result->distances[size - 1] = sqrt(nearest.heap[0].distance_squared);
+        nearest.heap[0] = nearest.heap[size - 1];
+        sift_down(nearest.heap, size - 1, 0);
+    }
+    result->count = nearest.size;
+    free(nearest.heap);
+    return 0;
+}
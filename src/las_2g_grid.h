@@ -0,0 +1,172 @@
+#ifndef LAS_2G_GRID_H
+#define LAS_2G_GRID_H
+
+/**
+ * @brief Spatial index over the points of a loaded survey. Space is cut into cubic cells
+ * and the occupied cells are kept sorted by their Morton (z-order) code, with the points
+ * of each cell stored next to each other, so cells that are close in space are mostly
+ * close in memory. The grid is one block laid out exactly as its file, so a saved grid
+ * is memory mapped and queried without being read.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define GRID_SIGNATURE "LAS2GGRD"
+#define GRID_VERSION 1
+#define GRID_MAX_CELLS_PER_AXIS (1u << 21) // 21 bits of each axis fit in a 63 bit Morton code
+#define GRID_POINTS_PER_CELL 8 // aimed for by the default cell size
+
+/**
+ * @brief Fixed header at the start of a grid file.
+ *
+ */
+typedef struct {
+    char signature[8];
+    uint32_t version;
+    uint32_t point_size; /// sizeof(LASGridPoint) when the grid was written
+    uint64_t number_of_points;
+    uint64_t number_of_profiles;
+    uint64_t number_of_cells; /// occupied cells
+    double cell_size;
+    double origin[3]; /// minimum corner of cell (0, 0, 0)
+    uint32_t dimensions[3]; /// cells along x, y and z
+    uint32_t reserved;
+} LASGridHeader;
+
+/**
+ * @brief A point of the grid, with its position copied so queries never touch the survey.
+ *
+ */
+typedef struct {
+    double x;
+    double y;
+    double z;
+    uint32_t profile; /// index of the profile in the survey
+    uint32_t point; /// index of the point in its profile
+} LASGridPoint;
+
+/**
+ * @brief A grid built in memory or mapped from a file. The arrays follow the header in
+ * one block: cell_codes, cell_starts, points and profile_offsets.
+ *
+ */
+typedef struct {
+    LASGridHeader header;
+    const uint64_t * cell_codes; /// Morton code of each occupied cell, ascending
+    const uint64_t * cell_starts; /// number_of_cells + 1 entries, the points of cell i are [cell_starts[i], cell_starts[i+1])
+    const LASGridPoint * points;
+    const uint64_t * profile_offsets; /// number_of_profiles + 1 entries, first point of each profile in the survey
+    uint8_t * block; /// owned arrays of a built grid, NULL when mapped
+    uint64_t block_size;
+    LASMappedFile mapped;
+    int is_mapped;
+} LASGrid;
+
+/**
+ * @brief Points found by a query, as parallel arrays.
+ *
+ */
+typedef struct {
+    uint32_t * profiles;
+    uint32_t * points;
+    double * distances; /// distance to the query point, 0 for box queries
+    size_t count;
+    size_t capacity;
+} LASGridResult;
+
+/**
+ * @brief Build a grid from point columns with las_parallel_for: the bounds, cell codes and
+ * radix sort passes are split into chunks of points shared between the workers.
+ *
+ * @param x
+ * @param y
+ * @param z
+ * @param offsets number_of_profiles + 1 entries, the points of profile i are [offsets[i], offsets[i+1])
+ * @param number_of_profiles at most UINT32_MAX
+ * @param cell_size edge of a cell, 0 to pick one giving about GRID_POINTS_PER_CELL points
+ * per cell on a surface. Raised if the grid would have more than GRID_MAX_CELLS_PER_AXIS
+ * cells along an axis.
+ * @param threads number of workers, 0 for las_cpu_count()
+ * @param grid filled on success, release with free_grid.
+ * @return int 0 on success, -1 if memory could not be allocated or the cell size is negative.
+ */
+int build_grid(const double * x, const double * y, const double * z, const uint64_t * offsets,
+               size_t number_of_profiles, double cell_size, int threads, LASGrid * grid);
+
+/**
+ * @brief Write a grid file, replacing any existing one.
+ *
+ * @param filename
+ * @param grid
+ * @return int 0 on success, -1 on failure.
+ */
+int write_grid(const char * filename, const LASGrid * grid);
+
+/**
+ * @brief Memory map a grid file. Only the header and the file size are checked; the
+ * arrays are paged in as queries touch them.
+ *
+ * @param filename
+ * @param grid filled on success, release with free_grid.
+ * @return int 0 on success, -1 if the file is missing, truncated, from another version or
+ * its cell codes or cell starts are out of order.
+ */
+int map_grid(const char * filename, LASGrid * grid);
+
+/**
+ * @brief Release a built or mapped grid.
+ *
+ * @param grid
+ */
+void free_grid(LASGrid * grid);
+
+/**
+ * @brief Find the points inside an axis aligned box, bounds included.
+ *
+ * @param grid
+ * @param min minimum x, y and z
+ * @param max maximum x, y and z
+ * @param result empty result, release with free_grid_result. Points come in cell order.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int grid_query_box(const LASGrid * grid, const double min[3], const double max[3], LASGridResult * result);
+
+/**
+ * @brief Find the points within a distance of a position, with their distances.
+ *
+ * @param grid
+ * @param position x, y and z
+ * @param radius
+ * @param result empty result, release with free_grid_result. Points come in cell order.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int grid_query_radius(const LASGrid * grid, const double position[3], double radius, LASGridResult * result);
+
+/**
+ * @brief Find the k points nearest to a position. Cells are searched in growing shells
+ * around the position until no unvisited cell can hold a nearer point.
+ *
+ * @param grid
+ * @param position x, y and z
+ * @param k
+ * @param result empty result, release with free_grid_result. Points come nearest first.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int grid_query_nearest(const LASGrid * grid, const double position[3], size_t k, LASGridResult * result);
+
+/**
+ * @brief Initialise an empty query result.
+ *
+ * @param result
+ */
+void init_grid_result(LASGridResult * result);
+
+/**
+ * @brief Release the arrays of a query result.
+ *
+ * @param result
+ */
+void free_grid_result(LASGridResult * result);
+
+#endif
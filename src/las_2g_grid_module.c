@@ -0,0 +1,370 @@
+/**
+ * @file las_2g_grid_module.c
+ * @author Ryan Wicks
+ * @brief Python type for the spatial grid index.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_grid.h"
+
+/**
+ * @brief A spatial grid built from a survey or mapped from a file.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    LASGrid grid;
+    int is_built; /// grid holds a built or mapped grid
+    int building; /// a thread is in __init__, possibly without the GIL
+} LASGridPython;
+
+//-----------------------------------------------------------------
+// LASGrid Definitions
+//-----------------------------------------------------------------
+
+static void LASGrid_dealloc(LASGridPython * self) {
+    if (self->is_built) {
+        free_grid(&self->grid);
+    }
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Get the point columns of a survey, decoding only x, y and z of a LASDataset.
+ *
+ * @return LASColumnsPython* new reference, or NULL with an exception set.
+ */
+static LASColumnsPython * LASGrid_SurveyColumns(PyObject * survey, int threads) {
+    if (PyObject_TypeCheck(survey, &LASColumnsPythonType)) {
+        Py_INCREF(survey);
+        return (LASColumnsPython *) survey;
+    }
+    if (!PyObject_TypeCheck(survey, &LASDatasetPythonType)) {
+        PyErr_SetString(PyExc_TypeError, "survey must be a LASColumns or a LASDataset.");
+        return NULL;
+    }
+
+    PyObject * method = PyObject_GetAttrString(survey, "columns");
+    PyObject * call_args = PyTuple_New(0);
+    PyObject * call_kwargs = Py_BuildValue("{s:[sss],s:i}", "fields", "x", "y", "z", "threads", threads);
+    PyObject * columns = NULL;
+    if (method && call_args && call_kwargs) {
+        columns = PyObject_Call(method, call_args, call_kwargs);
+    }
+    Py_XDECREF(method);
+    Py_XDECREF(call_args);
+    Py_XDECREF(call_kwargs);
+    return (LASColumnsPython *) columns;
+}
+
+static int LASGrid_init(LASGridPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"survey", "cell_size", "threads", NULL};
+    PyObject * survey;
+    double cell_size = 0.0;
+    int threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|di", keywords, &survey, &cell_size, &threads)) {
+        return -1;
+    }
+    if (cell_size < 0.0 || threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "cell_size and threads must not be negative.");
+        return -1;
+    }
+    // queries read the grid without the GIL, so it is never replaced once built.
+    if (self->is_built) {
+        PyErr_SetString(PyExc_RuntimeError, "LASGrid is already built.");
+        return -1;
+    }
+    if (self->building) {
+        PyErr_SetString(PyExc_RuntimeError, "LASGrid is being built by another thread.");
+        return -1;
+    }
+    self->building = 1;
+
+    LASColumnsPython * columns = LASGrid_SurveyColumns(survey, threads);
+    if (!columns) {
+        self->building = 0;
+        return -1;
+    }
+    if (!PyObject_TypeCheck(columns->x, &LASColumnPythonType) ||
+        !PyObject_TypeCheck(columns->y, &LASColumnPythonType) ||
+        !PyObject_TypeCheck(columns->z, &LASColumnPythonType)) {
+        PyErr_SetString(PyExc_ValueError, "survey must have x, y and z columns.");
+        Py_DECREF(columns);
+        self->building = 0;
+        return -1;
+    }
+    LASColumnPython * offsets = (LASColumnPython *) columns->offsets;
+    if (offsets->length - 1 > (Py_ssize_t)UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "survey has too many profiles for a grid.");
+        Py_DECREF(columns);
+        self->building = 0;
+        return -1;
+    }
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = build_grid((const double *)((LASColumnPython *) columns->x)->data,
+                     (const double *)((LASColumnPython *) columns->y)->data,
+                     (const double *)((LASColumnPython *) columns->z)->data,
+                     (const uint64_t *)offsets->data, (size_t)(offsets->length - 1), cell_size, threads, &self->grid);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(columns);
+    self->building = 0;
+    if (ret < 0) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the grid.");
+        return -1;
+    }
+    self->is_built = 1;
+    return 0;
+}
+
+/**
+ * @brief Check the grid is usable, i.e. __init__ succeeded.
+ */
+static int LASGrid_CheckBuilt(LASGridPython * self) {
+    if (!self->is_built) {
+        PyErr_SetString(PyExc_ValueError, "The grid has not been built.");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Convert a query result to a (profiles, points) or (profiles, points, distances)
+ * tuple of LASColumns. The result is released.
+ */
+static PyObject * LASGrid_ResultToPython(LASGridResult * result, int with_distances) {
+    Py_ssize_t count = (Py_ssize_t)result->count;
+    LASColumnPython * profiles = LASColumn_New('I', count);
+    LASColumnPython * points = LASColumn_New('I', count);
+    LASColumnPython * distances = with_distances ? LASColumn_New('d', count) : NULL;
+    PyObject * tuple = NULL;
+
+    if (profiles && points && (distances || !with_distances)) {
+        if (count > 0) {
+            memcpy(profiles->data, result->profiles, count * sizeof(uint32_t));
+            memcpy(points->data, result->points, count * sizeof(uint32_t));
+            if (with_distances) {
+                memcpy(distances->data, result->distances, count * sizeof(double));
+            }
+        }
+        tuple = with_distances ? PyTuple_Pack(3, profiles, points, distances) : PyTuple_Pack(2, profiles, points);
+    }
+    Py_XDECREF(profiles);
+    Py_XDECREF(points);
+    Py_XDECREF(distances);
+    free_grid_result(result);
+    return tuple;
+}
+
+static PyObject * LASGrid_box(LASGridPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"bbox", NULL};
+    PyObject * bbox;
+    LASProfileFilter filter;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keywords, &bbox)) {
+        return NULL;
+    }
+    if (LASGrid_CheckBuilt(self) < 0 || LASProfileFilter_FromPython(bbox, Py_None, &filter) < 0) {
+        return NULL;
+    }
+
+    double min[3] = {filter.min_x, filter.min_y, filter.min_z};
+    double max[3] = {filter.max_x, filter.max_y, filter.max_z};
+    LASGridResult result;
+    int ret;
+    init_grid_result(&result);
+    Py_BEGIN_ALLOW_THREADS
+    ret = grid_query_box(&self->grid, min, max, &result);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        free_grid_result(&result);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the query.");
+        return NULL;
+    }
+    return LASGrid_ResultToPython(&result, 0);
+}
+
+static PyObject * LASGrid_radius(LASGridPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"x", "y", "z", "radius", NULL};
+    double position[3];
+    double radius;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dddd", keywords, &position[0], &position[1], &position[2], &radius)) {
+        return NULL;
+    }
+    if (LASGrid_CheckBuilt(self) < 0) {
+        return NULL;
+    }
+
+    LASGridResult result;
+    int ret;
+    init_grid_result(&result);
+    Py_BEGIN_ALLOW_THREADS
+    ret = grid_query_radius(&self->grid, position, radius, &result);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        free_grid_result(&result);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the query.");
+        return NULL;
+    }
+    return LASGrid_ResultToPython(&result, 1);
+}
+
+static PyObject * LASGrid_nearest(LASGridPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"x", "y", "z", "k", NULL};
+    double position[3];
+    Py_ssize_t k = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ddd|n", keywords, &position[0], &position[1], &position[2], &k)) {
+        return NULL;
+    }
+    if (k < 0) {
+        PyErr_SetString(PyExc_ValueError, "k must not be negative.");
+        return NULL;
+    }
+    if (LASGrid_CheckBuilt(self) < 0) {
+        return NULL;
+    }
+
+    LASGridResult result;
+    int ret;
+    init_grid_result(&result);
+    Py_BEGIN_ALLOW_THREADS
+    ret = grid_query_nearest(&self->grid, position, (size_t)k, &result);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        free_grid_result(&result);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for the query.");
+        return NULL;
+    }
+    return LASGrid_ResultToPython(&result, 1);
+}
+
+static PyObject * LASGrid_save(LASGridPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", NULL};
+    char * filename;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords, &filename)) {
+        return NULL;
+    }
+    if (LASGrid_CheckBuilt(self) < 0) {
+        return NULL;
+    }
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = write_grid(filename, &self->grid);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open output file.\n");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASGrid_get_cell_size(LASGridPython * self, void * closure) {
+    return PyFloat_FromDouble(self->grid.header.cell_size);
+}
+
+static PyObject * LASGrid_get_number_of_cells(LASGridPython * self, void * closure) {
+    return PyLong_FromUnsignedLongLong(self->grid.header.number_of_cells);
+}
+
+static PyObject * LASGrid_get_number_of_points(LASGridPython * self, void * closure) {
+    return PyLong_FromUnsignedLongLong(self->grid.header.number_of_points);
+}
+
+static PyObject * LASGrid_get_number_of_profiles(LASGridPython * self, void * closure) {
+    return PyLong_FromUnsignedLongLong(self->grid.header.number_of_profiles);
+}
+
+static PyObject * LASGrid_get_is_mapped(LASGridPython * self, void * closure) {
+    return PyBool_FromLong(self->grid.is_mapped);
+}
+
+static PyMethodDef LASGrid_methods[] = {
+    {"box", (PyCFunction) LASGrid_box, METH_VARARGS | METH_KEYWORDS,
+        "box(bbox) -> (profiles, points)\n\n"
+        "Points inside bbox, (min_x, min_y, max_x, max_y) or (min_x, min_y, min_z, max_x, max_y, max_z)."},
+    {"radius", (PyCFunction) LASGrid_radius, METH_VARARGS | METH_KEYWORDS,
+        "radius(x, y, z, radius) -> (profiles, points, distances)\n\n"
+        "Points within radius of (x, y, z)."},
+    {"nearest", (PyCFunction) LASGrid_nearest, METH_VARARGS | METH_KEYWORDS,
+        "nearest(x, y, z, k=1) -> (profiles, points, distances)\n\n"
+        "The k points nearest to (x, y, z), nearest first."},
+    {"save", (PyCFunction) LASGrid_save, METH_VARARGS | METH_KEYWORDS,
+        "save(filename)\n\n"
+        "Write the grid to a file that load_grid memory maps."},
+    {NULL} //sentinel
+};
+
+static PyGetSetDef LASGrid_getset[] = {
+    {"cell_size", (getter) LASGrid_get_cell_size, NULL, "Edge of a cell.", NULL},
+    {"number_of_cells", (getter) LASGrid_get_number_of_cells, NULL, "Number of cells holding points.", NULL},
+    {"number_of_points", (getter) LASGrid_get_number_of_points, NULL, "Number of points in the grid.", NULL},
+    {"number_of_profiles", (getter) LASGrid_get_number_of_profiles, NULL, "Number of profiles in the survey.", NULL},
+    {"is_mapped", (getter) LASGrid_get_is_mapped, NULL, "True if the grid was memory mapped by load_grid.", NULL},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASGridPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASGrid",
+    .tp_doc = "LASGrid(survey, cell_size=0.0, threads=0)\n\n"
+              "Spatial index over the points of a LASColumns or LASDataset, built in parallel. Points\n"
+              "are grouped in cubic cells stored in Morton order. Queries return LASColumns of\n"
+              "profile and point indices, so point i of a result is\n"
+              "survey.offsets[profiles[i]] + points[i]. A cell_size of 0 picks one giving about 8\n"
+              "points per cell.",
+    .tp_basicsize = sizeof(LASGridPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) LASGrid_init,
+    .tp_dealloc = (destructor) LASGrid_dealloc,
+    .tp_methods = LASGrid_methods,
+    .tp_getset = LASGrid_getset,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * load_grid_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", NULL};
+    char * filename;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords, &filename)) {
+        return NULL;
+    }
+
+    LASGridPython * grid = (LASGridPython *) LASGridPythonType.tp_alloc(&LASGridPythonType, 0);
+    if (!grid) {
+        return NULL;
+    }
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_grid(filename, &grid->grid);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open grid file.\n");
+        Py_DECREF(grid);
+        return NULL;
+    }
+    grid->is_built = 1;
+    return (PyObject *) grid;
+}
+
+PyObject * load_grid_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "load_grid", load_grid_call(self, args, kwargs));
+}
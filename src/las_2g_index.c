@@ -0,0 +1,344 @@
+/**
+ * @file las_2g_index.c
+ * @author Ryan Wicks
+ * @brief Sidecar profile index for LAS surveys.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_index.h"
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+static const uint64_t fnv_offset_basis = 14695981039346656037ull;
+static const uint64_t fnv_prime = 1099511628211ull;
+
+static uint64_t fnv1a(uint64_t hash, const void * data, size_t size) {
+    const uint8_t * bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+static uint64_t index_checksum(const LASIndex * index) {
+    LASIndexHeader header = index->header;
+    header.checksum = 0;
+
+    uint64_t hash = fnv1a(fnv_offset_basis, &header, sizeof(header));
+    return fnv1a(hash, index->entries, (size_t)index->header.number_of_profiles * sizeof(LASIndexEntry));
+}
+
+static void summarise_profile(const LASHeader * header, const LASEntry * entries, LASIndexEntry * entry) {
+    entry->number_of_points = header->number_of_point_records;
+    entry->reserved = 0;
+    entry->header_time = header->guid_data_4;
+    entry->min_time = 0;
+    entry->max_time = 0;
+    entry->min_x = entry->max_x = 0.0;
+    entry->min_y = entry->max_y = 0.0;
+    entry->min_z = entry->max_z = 0.0;
+
+    for (uint32_t point = 0; point < header->number_of_point_records; ++point) {
+        double x = header->x_scale_factor * (double)entries[point].x;
+        double y = header->y_scale_factor * (double)entries[point].y;
+        double z = header->z_scale_factor * (double)entries[point].z;
+        uint64_t utc_time = AdjustedGPSTimeusToUTCTimeus((uint64_t)(entries[point].gps_time*1E6));
+
+        if (point == 0) {
+            entry->min_x = entry->max_x = x;
+            entry->min_y = entry->max_y = y;
+            entry->min_z = entry->max_z = z;
+            entry->min_time = entry->max_time = utc_time;
+            continue;
+        }
+        if (x < entry->min_x) entry->min_x = x;
+        if (x > entry->max_x) entry->max_x = x;
+        if (y < entry->min_y) entry->min_y = y;
+        if (y > entry->max_y) entry->max_y = y;
+        if (z < entry->min_z) entry->min_z = z;
+        if (z > entry->max_z) entry->max_z = z;
+        if (utc_time < entry->min_time) entry->min_time = utc_time;
+        if (utc_time > entry->max_time) entry->max_time = utc_time;
+    }
+}
+
+int build_index(const uint8_t * data, uint64_t size, LASIndex * index) {
+    LASProfileTable table;
+    LASHeader header;
+
+    memset(&index->header, 0, sizeof(index->header));
+    index->entries = NULL;
+
+    if (scan_profiles_mapped(data, size, &table) < 0) {
+        return -1;
+    }
+
+    index->entries = (LASIndexEntry *)malloc((table.number_of_profiles > 0 ? table.number_of_profiles : 1) * sizeof(LASIndexEntry));
+    if (!index->entries) {
+        free_profile_table(&table);
+        return -1;
+    }
+
+    memcpy(index->header.signature, INDEX_SIGNATURE, sizeof(index->header.signature));
+    index->header.version = INDEX_VERSION;
+    index->header.entry_size = sizeof(LASIndexEntry);
+    index->header.number_of_profiles = table.number_of_profiles;
+    index->header.number_of_points = table.number_of_points;
+    index->header.flags = INDEX_TIME_SORTED;
+
+    for (size_t i = 0; i < table.number_of_profiles; ++i) {
+        const uint8_t * profile = data + table.offsets[i];
+        memcpy(&header, profile, sizeof(LASHeader));
+
+        index->entries[i].offset = table.offsets[i];
+        summarise_profile(&header, (const LASEntry *)(profile + sizeof(LASHeader)), &index->entries[i]);
+
+        if (i > 0 && (index->entries[i].min_time < index->entries[i-1].min_time ||
+                      index->entries[i].max_time < index->entries[i-1].max_time)) {
+            index->header.flags &= ~INDEX_TIME_SORTED;
+        }
+    }
+
+    free_profile_table(&table);
+    return (int)index->header.number_of_profiles;
+}
+
+int read_index(const char * filename, LASIndex * index) {
+    FILE * fid;
+
+    index->entries = NULL;
+
+    fid = fopen(filename, "rb");
+    if (fid == NULL) {
+        return -1;
+    }
+
+    if (fread(&index->header, sizeof(LASIndexHeader), 1, fid) != 1 ||
+        memcmp(index->header.signature, INDEX_SIGNATURE, sizeof(index->header.signature)) != 0 ||
+        index->header.version != INDEX_VERSION ||
+        index->header.entry_size != sizeof(LASIndexEntry) ||
+        index->header.number_of_profiles > SIZE_MAX / sizeof(LASIndexEntry)) {
+        fclose(fid);
+        return -1;
+    }
+
+    size_t number_of_profiles = (size_t)index->header.number_of_profiles;
+    index->entries = (LASIndexEntry *)malloc((number_of_profiles > 0 ? number_of_profiles : 1) * sizeof(LASIndexEntry));
+    if (!index->entries) {
+        fclose(fid);
+        return -1;
+    }
+    if (fread(index->entries, sizeof(LASIndexEntry), number_of_profiles, fid) != number_of_profiles ||
+        index_checksum(index) != index->header.checksum) {
+        free_index(index);
+        fclose(fid);
+        return -1;
+    }
+
+    fclose(fid);
+    return 0;
+}
+
+int write_index(const char * filename, LASIndex * index) {
+    FILE * fid;
+
+    size_t length = strlen(filename);
+    char * temp_filename = (char *)malloc(length + 5);
+    if (!temp_filename) {
+        return -1;
+    }
+    memcpy(temp_filename, filename, length);
+    memcpy(temp_filename + length, ".tmp", 5);
+
+    index->header.checksum = index_checksum(index);
+
+    // write next to the destination and rename, so a reader never sees a half written index.
+    fid = fopen(temp_filename, "wb");
+    if (fid == NULL) {
+        free(temp_filename);
+        return -1;
+    }
+    size_t number_of_profiles = (size_t)index->header.number_of_profiles;
+    int ok = fwrite(&index->header, sizeof(LASIndexHeader), 1, fid) == 1 &&
+             fwrite(index->entries, sizeof(LASIndexEntry), number_of_profiles, fid) == number_of_profiles;
+    ok = (fclose(fid) == 0) && ok;
+
+#ifdef _WIN32
+    remove(filename);
+#endif
+    if (!ok || rename(temp_filename, filename) != 0) {
+        remove(temp_filename);
+        free(temp_filename);
+        return -1;
+    }
+
+    free(temp_filename);
+    return 0;
+}
+
+int index_source_identity(const char * filename, uint64_t * size, int64_t * mtime) {
+#ifdef _WIN32
+    struct _stat64 file_stat;
+    if (_stat64(filename, &file_stat) != 0) {
+        return -1;
+    }
+    *mtime = (int64_t)file_stat.st_mtime * 1000000000;
+#else
+    struct stat file_stat;
+    if (stat(filename, &file_stat) != 0) {
+        return -1;
+    }
+#if defined(__APPLE__)
+    *mtime = (int64_t)file_stat.st_mtimespec.tv_sec * 1000000000 + file_stat.st_mtimespec.tv_nsec;
+#else
+    *mtime = (int64_t)file_stat.st_mtim.tv_sec * 1000000000 + file_stat.st_mtim.tv_nsec;
+#endif
+#endif
+    *size = (uint64_t)file_stat.st_size;
+    return 0;
+}
+
+/**
+ * @brief Check that every entry of an index points at a whole profile of the mapped file,
+ * so a sidecar that is current by size and mtime but does not describe the file is rebuilt.
+ *
+ * @return int 1 if every entry starts at a header holding its number of points, 0 otherwise.
+ */
+static int index_matches_file(const LASIndex * index, const LASMappedFile * mapped) {
+    for (uint64_t i = 0; i < index->header.number_of_profiles; ++i) {
+        const LASIndexEntry * entry = &index->entries[i];
+        if (entry->offset > mapped->size ||
+            mapped->size - entry->offset < sizeof(LASHeader) + (uint64_t)entry->number_of_points * sizeof(LASEntry)) {
+            return 0;
+        }
+
+        LASHeader header;
+        memcpy(&header, mapped->data + entry->offset, sizeof(LASHeader));
+        if (memcmp(header.file_signature, "LASF", 4) != 0 || header.number_of_point_records != entry->number_of_points) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int open_index(const char * filename, const LASMappedFile * mapped, LASIndex * index, int rebuild) {
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    int have_identity = index_source_identity(filename, &source_size, &source_mtime) == 0;
+
+    size_t length = strlen(filename);
+    char * index_filename = (char *)malloc(length + sizeof(INDEX_EXTENSION));
+    if (!index_filename) {
+        return -1;
+    }
+    memcpy(index_filename, filename, length);
+    memcpy(index_filename + length, INDEX_EXTENSION, sizeof(INDEX_EXTENSION));
+
+    if (!rebuild && have_identity && read_index(index_filename, index) == 0) {
+        if (index->header.source_size == source_size &&
+            index->header.source_mtime == source_mtime &&
+            source_size == mapped->size &&
+            index_matches_file(index, mapped)) {
+            free(index_filename);
+            return 0;
+        }
+        free_index(index);
+    }
+
+    if (build_index(mapped->data, mapped->size, index) < 0) {
+        free(index_filename);
+        return -1;
+    }
+
+    int ret = 2;
+    if (have_identity && source_size == mapped->size) {
+        index->header.source_size = source_size;
+        index->header.source_mtime = source_mtime;
+        ret = write_index(index_filename, index) == 0 ? 1 : 2;
+    }
+
+    free(index_filename);
+    return ret;
+}
+
+void free_index(LASIndex * index) {
+    free(index->entries);
+    index->entries = NULL;
+}
+
+int index_to_profile_table(const LASIndex * index, LASProfileTable * table) {
+    size_t number_of_profiles = (size_t)index->header.number_of_profiles;
+    size_t capacity = number_of_profiles > 0 ? number_of_profiles : 1;
+
+    table->offsets = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+    table->point_counts = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (!table->offsets || !table->point_counts) {
+        free(table->offsets);
+        free(table->point_counts);
+        table->offsets = NULL;
+        table->point_counts = NULL;
+        return -1;
+    }
+
+    table->number_of_profiles = number_of_profiles;
+    table->capacity = capacity;
+    table->number_of_points = 0;
+    for (size_t i = 0; i < number_of_profiles; ++i) {
+        table->offsets[i] = index->entries[i].offset;
+        table->point_counts[i] = index->entries[i].number_of_points;
+        table->number_of_points += index->entries[i].number_of_points;
+    }
+    return 0;
+}
+
+size_t index_find_time_range(const LASIndex * index, uint64_t start_time, uint64_t end_time, uint64_t * profiles) {
+    size_t number_of_profiles = (size_t)index->header.number_of_profiles;
+    size_t first = 0;
+    size_t last = number_of_profiles;
+    size_t count = 0;
+
+    if (index->header.flags & INDEX_TIME_SORTED) {
+        // first profile that ends at or after start_time
+        size_t low = 0, high = number_of_profiles;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (index->entries[middle].max_time < start_time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        first = low;
+
+        // one past the last profile that starts at or before end_time
+        high = number_of_profiles;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (index->entries[middle].min_time <= end_time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        last = low;
+    }
+
+    for (size_t i = first; i < last; ++i) {
+        if (index->entries[i].number_of_points > 0 &&
+            index->entries[i].max_time >= start_time &&
+            index->entries[i].min_time <= end_time) {
+            profiles[count++] = i;
+        }
+    }
+    return count;
+}
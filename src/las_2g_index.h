@@ -0,0 +1,137 @@
+#ifndef LAS_2G_INDEX_H
+#define LAS_2G_INDEX_H
+
+#include "las_2g_python.h"
+
+#define INDEX_EXTENSION ".lasidx" // appended to the LAS filename to get the sidecar filename
+#define INDEX_SIGNATURE "LAS2GIDX"
+#define INDEX_VERSION 1
+#define INDEX_TIME_SORTED 0x1 // profile time spans never go backwards, so time lookups can bisect
+
+/**
+ * @brief Fixed header at the start of a sidecar index file.
+ *
+ */
+typedef struct {
+    char signature[8];
+    uint32_t version;
+    uint32_t entry_size; /// sizeof(LASIndexEntry) when the index was written
+    uint64_t source_size; /// size of the LAS file in bytes
+    int64_t source_mtime; /// modification time of the LAS file in ns
+    uint64_t number_of_profiles;
+    uint64_t number_of_points;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t checksum; /// FNV-1a of this header (with checksum = 0) and every entry
+} LASIndexHeader;
+
+/**
+ * @brief Summary of one profile in the sidecar index.
+ *
+ */
+typedef struct {
+    uint64_t offset; /// byte offset of the profile header in the LAS file
+    uint32_t number_of_points;
+    uint32_t reserved;
+    uint64_t header_time; /// guid_data_4 of the profile header, adjusted GPS seconds
+    uint64_t min_time; /// utc time in us from the Unix epoch
+    uint64_t max_time;
+    double min_x;
+    double max_x;
+    double min_y;
+    double max_y;
+    double min_z;
+    double max_z;
+} LASIndexEntry;
+
+/**
+ * @brief A sidecar index held in memory.
+ *
+ */
+typedef struct {
+    LASIndexHeader header;
+    LASIndexEntry * entries;
+} LASIndex;
+
+/**
+ * @brief Build an index by walking the header chain of a memory mapped file and
+ * summarising the points of every profile.
+ *
+ * @param data start of the mapping
+ * @param size size of the mapping in bytes
+ * @param index filled on success, release with free_index. The source size and mtime are left 0.
+ * @return int number of profiles, or -1 if a profile runs past the end of the file or
+ * memory could not be allocated.
+ */
+int build_index(const uint8_t * data, uint64_t size, LASIndex * index);
+
+/**
+ * @brief Read and validate an index file. Does not check it against the LAS file, see index_is_current.
+ *
+ * @param filename sidecar filename
+ * @param index filled on success, release with free_index.
+ * @return int 0 on success, -1 if the file is missing, truncated, from another version or fails its checksum.
+ */
+int read_index(const char * filename, LASIndex * index);
+
+/**
+ * @brief Write an index file, replacing any existing one.
+ *
+ * @param filename sidecar filename
+ * @param index the checksum is computed while writing.
+ * @return int 0 on success, -1 on failure.
+ */
+int write_index(const char * filename, LASIndex * index);
+
+/**
+ * @brief Get the size and modification time used to detect a stale index.
+ *
+ * @param filename LAS filename
+ * @param size in bytes
+ * @param mtime in ns
+ * @return int 0 on success, -1 if the file could not be inspected.
+ */
+int index_source_identity(const char * filename, uint64_t * size, int64_t * mtime);
+
+/**
+ * @brief Load the sidecar index of a LAS file, rebuilding and rewriting it if it is
+ * missing, corrupt or stale (the LAS file size or mtime changed), or if any entry does not
+ * point at a profile header with its number of points inside the mapping.
+ *
+ * @param filename LAS filename, the sidecar is filename + INDEX_EXTENSION
+ * @param mapped mapping of the LAS file, used when the index has to be rebuilt
+ * @param index filled on success, release with free_index.
+ * @param rebuild if non zero always rebuild, even if the sidecar is current.
+ * @return int 0 if the sidecar was current, 1 if it was rebuilt and written, 2 if it was rebuilt
+ * but could not be written (e.g. a read only directory), or -1 if the LAS file could not be indexed.
+ */
+int open_index(const char * filename, const LASMappedFile * mapped, LASIndex * index, int rebuild);
+
+/**
+ * @brief Release the entries of an index.
+ *
+ * @param index
+ */
+void free_index(LASIndex * index);
+
+/**
+ * @brief Copy the profile offsets and point counts of an index into a profile table.
+ *
+ * @param index
+ * @param table empty table, release with free_profile_table.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int index_to_profile_table(const LASIndex * index, LASProfileTable * table);
+
+/**
+ * @brief Find the profiles whose time span overlaps [start_time, end_time].
+ *
+ * @param index
+ * @param start_time utc time in us from the Unix epoch
+ * @param end_time utc time in us from the Unix epoch
+ * @param profiles output array with room for every profile in the index
+ * @return size_t number of profiles written to profiles, in file order.
+ */
+size_t index_find_time_range(const LASIndex * index, uint64_t start_time, uint64_t end_time, uint64_t * profiles);
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * @file las_2g_iter_module.c
+ * @author Ryan Wicks
+ * @brief Streaming, bounded memory iteration over the profiles of a LAS survey.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+
+//-----------------------------------------------------------------
+// LAS Iterator Definitions
+//-----------------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    FILE * fid;
+    LASProfileBuffer buffer; /// staging buffer, reused for every profile
+    LASProfileFilter filter;
+    int fields; /// mask of the LAS_FIELD_ values the profiles expose
+    Py_ssize_t batch_profiles; /// 0 to yield single LASFiles
+    int in_use; /// a __next__ call is reading the file, possibly without the GIL
+    int close_pending; /// close() was called during that call, the file is closed when it returns
+} LASIteratorPython;
+
+static void LASIterator_close_file(LASIteratorPython * self) {
+    if (self->fid != NULL) {
+        fclose(self->fid);
+        self->fid = NULL;
+    }
+    free_profile_buffer(&self->buffer);
+}
+
+static void LASIterator_dealloc(LASIteratorPython * self) {
+    LASIterator_close_file(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject * LASIterator_file(LASIteratorPython * self, const LASHeader * header) {
+    return LASFile_FromRecords(header, self->buffer.entries, self->fields);
+}
+
+/**
+ * @brief Read the next profile into the staging buffer.
+ *
+ * @return int 1 if a profile was read, 0 at the end of the file, -1 with an exception set.
+ */
+static int LASIterator_read_profile(LASIteratorPython * self, LASHeader * header) {
+    int ret;
+
+    if (self->fid == NULL) {
+        return 0;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = read_next_profile(self->fid, &self->filter, header, &self->buffer);
+    Py_END_ALLOW_THREADS
+
+    if (ret == 1) {
+        LASIterator_close_file(self);
+        return 0;
+    } else if (ret == -2) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for entries.");
+        LASIterator_close_file(self);
+        return -1;
+    } else if (ret == -1) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+        LASIterator_close_file(self);
+        return -1;
+    }
+    return 1;
+}
+
+static PyObject * LASIterator_next_profiles(LASIteratorPython * self) {
+    LASHeader header;
+
+    if (self->batch_profiles == 0) {
+        if (LASIterator_read_profile(self, &header) <= 0) {
+            return NULL; // no exception set means StopIteration
+        }
+        return LASIterator_file(self, &header);
+    }
+
+    PyObject * batch = PyList_New(0);
+    if (!batch) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < self->batch_profiles; ++i) {
+        int ret = LASIterator_read_profile(self, &header);
+        if (ret < 0) {
+            Py_DECREF(batch);
+            return NULL;
+        }
+        if (ret == 0) {
+            break;
+        }
+
+        PyObject * file_entry = LASIterator_file(self, &header);
+        if (!file_entry) {
+            Py_DECREF(batch);
+            return NULL;
+        }
+        ret = PyList_Append(batch, file_entry);
+        Py_DECREF(file_entry);
+        if (ret < 0) {
+            Py_DECREF(batch);
+            return NULL;
+        }
+    }
+
+    if (PyList_GET_SIZE(batch) == 0) {
+        Py_DECREF(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+static PyObject * LASIterator_next(LASIteratorPython * self) {
+    // the file position and staging buffer are shared, so calls from two threads cannot overlap.
+    if (self->in_use) {
+        PyErr_SetString(PyExc_ValueError, "LASIterator already executing.");
+        return NULL;
+    }
+
+    self->in_use = 1;
+    PyObject * result = LASIterator_next_profiles(self);
+    self->in_use = 0;
+    if (self->close_pending) {
+        self->close_pending = 0;
+        LASIterator_close_file(self);
+    }
+    return result;
+}
+
+static PyObject * LASIterator_close(LASIteratorPython * self, PyObject * Py_UNUSED(ignored)) {
+    if (self->in_use) {
+        self->close_pending = 1;
+    } else {
+        LASIterator_close_file(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef LASIterator_methods[] = {
+    {"close", (PyCFunction) LASIterator_close, METH_NOARGS, "Close the file, ending the iteration. A __next__ running on another thread returns first."},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASIteratorPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASIterator",
+    .tp_doc = "Iterator over the profiles of a LAS file, created by iter_las.",
+    .tp_basicsize = sizeof(LASIteratorPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) LASIterator_dealloc,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) LASIterator_next,
+    .tp_methods = LASIterator_methods,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+PyObject * iter_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "batch_profiles", "bbox", "time_range", "fields", NULL};
+    char * filename;
+    PyObject * batch_profiles = Py_None;
+    PyObject * bbox = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * fields_object = Py_None;
+    LASProfileFilter filter;
+    int fields;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|OOOO", keywords, &filename, &batch_profiles, &bbox, &time_range, &fields_object)) {
+        return NULL;
+    }
+    if (LASProfileFilter_FromPython(bbox, time_range, &filter) < 0 ||
+        LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+
+    Py_ssize_t batch = 0;
+    if (batch_profiles != Py_None) {
+        batch = PyNumber_AsSsize_t(batch_profiles, PyExc_OverflowError);
+        if (batch == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (batch < 1) {
+            PyErr_SetString(PyExc_ValueError, "batch_profiles must be at least 1.");
+            return NULL;
+        }
+    }
+
+    LASIteratorPython * iterator = (LASIteratorPython *) LASIteratorPythonType.tp_alloc(&LASIteratorPythonType, 0);
+    if (!iterator) {
+        return NULL;
+    }
+    iterator->batch_profiles = batch;
+    iterator->filter = filter;
+    iterator->fields = fields;
+
+    iterator->fid = fopen(filename, "rb");
+    if (iterator->fid == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        Py_DECREF(iterator);
+        return NULL;
+    }
+
+    return (PyObject *) iterator;
+}
@@ -10,27 +10,49 @@
  */
 
 #include "las_2g_python.h"
+#include "las_2g_simd.h"
+#include "las_2g_stats.h"
+#include "las_2g_thread.h"
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 const double header_scale = 0.000001;
 const double point_scale = 1000000.;
 const uint64_t diff_to_gps_epoch = (uint64_t)315964800 *(uint64_t)1000000;
 
 size_t read_header(FILE * fid, LASHeader * header) {
-    return fread((void *)header, sizeof(LASHeader), 1, fid);
+    size_t count = fread((void *)header, sizeof(LASHeader), 1, fid);
+    las_stats_add(LAS_COUNTER_BYTES_READ, count * sizeof(LASHeader));
+    return count;
 }
 
 size_t read_entry(FILE * fid, LASEntry * entries, size_t number_of_entries) {
-    return fread((void *)entries, sizeof(LASEntry), number_of_entries, fid);
+    size_t count = fread((void *)entries, sizeof(LASEntry), number_of_entries, fid);
+    las_stats_add(LAS_COUNTER_BYTES_READ, count * sizeof(LASEntry));
+    return count;
 }
 
 size_t write_header(FILE * fid, LASHeader * header) {
-    return fwrite((void *)header, sizeof(LASHeader), 1, fid);
+    size_t count = fwrite((void *)header, sizeof(LASHeader), 1, fid);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, count * sizeof(LASHeader));
+    las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, count);
+    return count;
 }
 
 size_t write_entries(FILE * fid, LASEntry * entries, size_t number_of_entries) {
-    return fwrite((void *)(entries), sizeof(LASEntry), number_of_entries, fid);
+    size_t count = fwrite((void *)(entries), sizeof(LASEntry), number_of_entries, fid);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, count * sizeof(LASEntry));
+    las_stats_add(LAS_COUNTER_POINTS_WRITTEN, count);
+    return count;
 }
 
 int write_las( const char * filename, LASFile las_files[], size_t number_of_file_entries) {
@@ -54,92 +76,748 @@ int write_las( const char * filename, LASFile las_files[], size_t number_of_file
 }
 
 int read_las( const char * filename, LASFile *** las_files){
-    FILE * fid;
+    LASDataset dataset;
 
     *las_files = NULL;
 
-    LASFile * temp_files[1024];
-    int temp_count = 0;
-    int number_of_files = 0;
-    size_t return_value;
+    int number_of_files = read_las_dataset(filename, &dataset);
+    if (number_of_files < 0) {
+        printf("Failed to read file %s\n", filename);
+        return -1;
+    }
+
+    *las_files = (LASFile**)malloc((number_of_files > 0 ? number_of_files : 1) * sizeof(LASFile*));
+    if (*las_files == NULL) {
+        free_las_dataset(&dataset);
+        return -1;
+    }
+
+    for (int i = 0; i < number_of_files; ++i) {
+        uint32_t number_of_entries = dataset.headers[i].number_of_point_records;
+        LASFile * file = (LASFile*)malloc(sizeof(LASFile));
+        if (file) {
+            file->header = (LASHeader*)malloc(sizeof(LASHeader));
+            file->entries = (LASEntry*)malloc((number_of_entries > 0 ? number_of_entries : 1) * sizeof(LASEntry));
+        }
+        if (!file || !file->header || !file->entries) {
+            if (file) {
+                free(file->header);
+                free(file->entries);
+                free(file);
+            }
+            for (int j = 0; j < i; ++j) {
+                free((*las_files)[j]->header);
+                free((*las_files)[j]->entries);
+                free((*las_files)[j]);
+            }
+            free(*las_files);
+            *las_files = NULL;
+            free_las_dataset(&dataset);
+            return -1;
+        }
+
+        *file->header = dataset.headers[i];
+        memcpy(file->entries, dataset.entries + dataset.offsets[i], number_of_entries * sizeof(LASEntry));
+        (*las_files)[i] = file;
+    }
+
+    free_las_dataset(&dataset);
+    return number_of_files;
+}
+
+void init_las_dataset(LASDataset * dataset) {
+    dataset->headers = NULL;
+    dataset->offsets = NULL;
+    dataset->entries = NULL;
+    dataset->number_of_profiles = 0;
+    dataset->profile_capacity = 0;
+    dataset->number_of_points = 0;
+    dataset->point_capacity = 0;
+    dataset->truncated = 0;
+}
+
+int reserve_las_dataset(LASDataset * dataset, size_t number_of_profiles, uint64_t number_of_points) {
+    if (number_of_profiles > dataset->profile_capacity || dataset->offsets == NULL) {
+        size_t capacity = dataset->profile_capacity ? dataset->profile_capacity : 64;
+        while (capacity < number_of_profiles) {
+            capacity *= 2;
+        }
+        LASHeader * headers = (LASHeader *)realloc(dataset->headers, capacity * sizeof(LASHeader));
+        if (!headers) {
+            return -1;
+        }
+        las_stats_allocation(capacity * sizeof(LASHeader));
+        dataset->headers = headers;
+        uint64_t * offsets = (uint64_t *)realloc(dataset->offsets, (capacity + 1) * sizeof(uint64_t));
+        if (!offsets) {
+            return -1;
+        }
+        las_stats_allocation((capacity + 1) * sizeof(uint64_t));
+        if (dataset->offsets == NULL) {
+            offsets[0] = 0;
+        }
+        dataset->offsets = offsets;
+        dataset->profile_capacity = capacity;
+    }
+
+    if (number_of_points > dataset->point_capacity) {
+        uint64_t capacity = dataset->point_capacity ? dataset->point_capacity : 4096;
+        while (capacity < number_of_points) {
+            capacity *= 2;
+        }
+        if (capacity > SIZE_MAX / sizeof(LASEntry)) {
+            return -1;
+        }
+        LASEntry * entries = (LASEntry *)realloc(dataset->entries, (size_t)capacity * sizeof(LASEntry));
+        if (!entries) {
+            return -1;
+        }
+        las_stats_allocation(capacity * sizeof(LASEntry));
+        dataset->entries = entries;
+        dataset->point_capacity = capacity;
+    }
+    return 0;
+}
+
+int append_las_profile(LASDataset * dataset, const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries) {
+    if (reserve_las_dataset(dataset, dataset->number_of_profiles + 1, dataset->number_of_points + number_of_entries) < 0) {
+        return -1;
+    }
+
+    size_t profile = dataset->number_of_profiles;
+    dataset->headers[profile] = *header;
+    dataset->headers[profile].number_of_point_records = number_of_entries;
+    memcpy(dataset->entries + dataset->number_of_points, entries, (size_t)number_of_entries * sizeof(LASEntry));
+    dataset->number_of_points += number_of_entries;
+    dataset->number_of_profiles += 1;
+    dataset->offsets[dataset->number_of_profiles] = dataset->number_of_points;
+    return 0;
+}
+
+int read_las_dataset(const char * filename, LASDataset * dataset) {
+    FILE * fid;
+
+    init_las_dataset(dataset);
+
     fid = fopen(filename, "rb");
     if (fid == NULL) {
-        printf("Failed to open file %s\n", filename);
         return -1;
     }
-    while (!feof(fid)){
-        temp_files[temp_count] = (LASFile*)malloc(sizeof(LASFile));
-        temp_files[temp_count]->header = (LASHeader * )malloc(sizeof(LASHeader));
-        return_value = read_header(fid, temp_files[temp_count]->header);
-        if (return_value != 1) { //fread returns the number of HEADER_SIZE read.
-            free(temp_files[temp_count]->header);
-            free(temp_files[temp_count]);
-            //printf("File smaller than header.\n");
+
+    // the records can never take more room than the file, so the entry block is sized once.
+    int64_t file_size = -1;
+    if (las_fseek(fid, 0, SEEK_END) == 0) {
+        file_size = las_ftell(fid);
+    }
+    if (file_size < 0 || las_fseek(fid, 0, SEEK_SET) != 0 ||
+        reserve_las_dataset(dataset, 0, (uint64_t)file_size / sizeof(LASEntry)) < 0) {
+        fclose(fid);
+        return -1;
+    }
+
+    for (;;) {
+        if (reserve_las_dataset(dataset, dataset->number_of_profiles + 1, dataset->number_of_points) < 0) {
             break;
         }
+        LASHeader * header = dataset->headers + dataset->number_of_profiles;
+        int64_t position = las_ftell(fid);
+        uint64_t start = las_stats_clock();
+        if (read_header(fid, header) != 1) {
+            las_stats_phase(LAS_PHASE_READ, start);
+            dataset->truncated = position != file_size;
+            fclose(fid);
+            return (int)dataset->number_of_profiles;
+        }
 
-        int number_of_entries = temp_files[temp_count]->header->number_of_point_records;
-        if (number_of_entries > 2048) {
-            printf("Too many entries is header, corrupted file.");
-            free(temp_files[temp_count]->header);
-            free(temp_files[temp_count]);
+        uint32_t number_of_entries = header->number_of_point_records;
+        if (reserve_las_dataset(dataset, dataset->number_of_profiles + 1, dataset->number_of_points + number_of_entries) < 0) {
             break;
         }
-        temp_files[temp_count]->entries = (LASEntry*)malloc(number_of_entries*sizeof(LASEntry));
-        for (int i = 0; i < number_of_entries; ++i) {
-            return_value = fread(&(temp_files[temp_count]->entries[i]), sizeof(LASEntry), 1, fid);
-            if (return_value != 1) {
-                free(temp_files[temp_count]->entries);
-                free(temp_files[temp_count]->header);
-                free(temp_files[temp_count]);
-                if (*las_files != NULL) {
-                    free (*las_files);
-                }
-                //printf("File too small.\n");
-                break;
-            }
+        if (read_entry(fid, dataset->entries + dataset->number_of_points, number_of_entries) != number_of_entries) {
+            // like a short header, a short profile ends the survey. The ones before it are kept.
+            las_stats_phase(LAS_PHASE_READ, start);
+            dataset->truncated = 1;
+            fclose(fid);
+            return (int)dataset->number_of_profiles;
         }
-        temp_count += 1;
-        number_of_files += 1;
+        las_stats_phase(LAS_PHASE_READ, start);
+        las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+        las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+        dataset->number_of_points += number_of_entries;
+        dataset->number_of_profiles += 1;
+        dataset->offsets[dataset->number_of_profiles] = dataset->number_of_points;
+    }
 
-        if (temp_count  >= 1024) {
-            LASFile ** temp;
-            temp = (LASFile**)malloc(number_of_files*sizeof(LASFile*));
-            if (*las_files != NULL) {
-                memcpy(temp, *las_files, (number_of_files - temp_count) * sizeof(LASFile**));
-            }
-            memcpy(&(temp[number_of_files-temp_count]), temp_files, temp_count * sizeof(LASFile**));
-            temp_count = 0;
-            if (*las_files != NULL) {
-                free (*las_files);
-            }
-            *las_files = temp;
+    fclose(fid);
+    free_las_dataset(dataset);
+    return -1;
+}
+
+int write_las_dataset(const char * filename, const LASDataset * dataset) {
+    FILE * fid;
+
+    fid = fopen(filename, "wb");
+    if (fid == NULL) {
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < dataset->number_of_profiles && ret == 0; ++i) {
+        LASHeader header = dataset->headers[i];
+        size_t number_of_entries = (size_t)(dataset->offsets[i+1] - dataset->offsets[i]);
+        uint64_t start = las_stats_clock();
+        if (write_header(fid, &header) != 1 ||
+            write_entries(fid, dataset->entries + dataset->offsets[i], number_of_entries) != number_of_entries) {
+            ret = -1;
         }
+        las_stats_phase(LAS_PHASE_WRITE, start);
     }
-    LASFile ** temp;
-    temp = (LASFile**)malloc(number_of_files*sizeof(LASFile*));
-    if (*las_files != NULL) {
-        memcpy(temp, *las_files, (number_of_files - temp_count) * sizeof(LASFile**));
+
+    if (fclose(fid) != 0) {
+        ret = -1;
     }
-    memcpy(&(temp[number_of_files - temp_count]), temp_files, temp_count * sizeof(LASFile**));
-    if (*las_files != NULL) {
-        free (*las_files);
+    return ret;
+}
+
+void free_las_dataset(LASDataset * dataset) {
+    free(dataset->headers);
+    free(dataset->offsets);
+    free(dataset->entries);
+    init_las_dataset(dataset);
+}
+
+void init_profile_table(LASProfileTable * table) {
+    table->offsets = NULL;
+    table->point_counts = NULL;
+    table->number_of_profiles = 0;
+    table->capacity = 0;
+    table->number_of_points = 0;
+}
+
+int append_profile(LASProfileTable * table, uint64_t offset, uint32_t number_of_points) {
+    if (table->number_of_profiles == table->capacity) {
+        size_t capacity = table->capacity ? 2 * table->capacity : 64;
+        uint64_t * offsets = (uint64_t *)realloc(table->offsets, capacity * sizeof(uint64_t));
+        if (!offsets) {
+            return -1;
+        }
+        table->offsets = offsets;
+        uint32_t * point_counts = (uint32_t *)realloc(table->point_counts, capacity * sizeof(uint32_t));
+        if (!point_counts) {
+            return -1;
+        }
+        las_stats_allocation(capacity * (sizeof(uint64_t) + sizeof(uint32_t)));
+        table->point_counts = point_counts;
+        table->capacity = capacity;
     }
-    *las_files = temp;
 
-    fclose(fid);
-    return number_of_files;
+    table->offsets[table->number_of_profiles] = offset;
+    table->point_counts[table->number_of_profiles] = number_of_points;
+    table->number_of_profiles += 1;
+    table->number_of_points += number_of_points;
+    return 0;
 }
 
-LASHeader * initLASHeader (uint64_t utc_time_us, uint32_t number_of_points) {
+static int scan_profiles_file(FILE * fid, LASProfileTable * table) {
+    LASHeader header;
 
-    LASHeader * return_header = (LASHeader *) malloc(sizeof (LASHeader));
+    init_profile_table(table);
 
-    if (!return_header) {
-        return NULL;
+    int64_t position = las_ftell(fid);
+    if (las_fseek(fid, 0, SEEK_END) != 0) {
+        return -1;
+    }
+    int64_t file_size = las_ftell(fid);
+    if (position < 0 || file_size < 0 || las_fseek(fid, position, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    while (position + (int64_t)sizeof(LASHeader) <= file_size) {
+        if (read_header(fid, &header) != 1) {
+            break;
+        }
+
+        int64_t next = position + (int64_t)sizeof(LASHeader) + (int64_t)header.number_of_point_records * (int64_t)sizeof(LASEntry);
+        if (next > file_size) {
+            free_profile_table(table);
+            return -1;
+        }
+
+        if (append_profile(table, (uint64_t)position, header.number_of_point_records) < 0) {
+            free_profile_table(table);
+            return -1;
+        }
+
+        position = next;
+        if (las_fseek(fid, position, SEEK_SET) != 0) {
+            free_profile_table(table);
+            return -1;
+        }
+    }
+
+    return (int)table->number_of_profiles;
+}
+
+int scan_profiles(FILE * fid, LASProfileTable * table) {
+    uint64_t start = las_stats_clock();
+    int ret = scan_profiles_file(fid, table);
+    las_stats_phase(LAS_PHASE_PARSE, start);
+    return ret;
+}
+
+int scan_profiles_mapped(const uint8_t * data, uint64_t size, LASProfileTable * table) {
+    LASHeader header;
+    uint64_t position = 0;
+    uint64_t start = las_stats_clock();
+
+    init_profile_table(table);
+
+    while (position + sizeof(LASHeader) <= size) {
+        memcpy(&header, data + position, sizeof(LASHeader));
+
+        uint64_t next = position + sizeof(LASHeader) + (uint64_t)header.number_of_point_records * sizeof(LASEntry);
+        if (next > size || append_profile(table, position, header.number_of_point_records) < 0) {
+            free_profile_table(table);
+            las_stats_phase(LAS_PHASE_PARSE, start);
+            return -1;
+        }
+        position = next;
+    }
+
+    las_stats_phase(LAS_PHASE_PARSE, start);
+    return (int)table->number_of_profiles;
+}
+
+void free_profile_table(LASProfileTable * table) {
+    free(table->offsets);
+    free(table->point_counts);
+    table->offsets = NULL;
+    table->point_counts = NULL;
+    table->number_of_profiles = 0;
+    table->capacity = 0;
+    table->number_of_points = 0;
+}
+
+void decode_entries(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                    double * x, double * y, double * z,
+                    uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    uint64_t start = las_stats_clock();
+    switch (las_simd_level()) {
+        case LAS_SIMD_AVX2:
+            decode_entries_avx2(header, entries, number_of_entries, x, y, z, intensity, quality, utc_time);
+            break;
+        case LAS_SIMD_SSE41:
+            decode_entries_sse41(header, entries, number_of_entries, x, y, z, intensity, quality, utc_time);
+            break;
+        default:
+            decode_entries_scalar(header, entries, number_of_entries, x, y, z, intensity, quality, utc_time);
+            break;
+    }
+    las_stats_phase(LAS_PHASE_DECODE, start);
+}
+
+void decode_entries_scalar(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                           double * x, double * y, double * z,
+                           uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    const double x_scale = header->x_scale_factor;
+    const double y_scale = header->y_scale_factor;
+    const double z_scale = header->z_scale_factor;
+
+    for (size_t point = 0; point < number_of_entries; ++point) {
+        x[point] = x_scale * (double)entries[point].x;
+        y[point] = y_scale * (double)entries[point].y;
+        z[point] = z_scale * (double)entries[point].z;
+        intensity[point] = entries[point].intensity;
+        quality[point] = entries[point].user_data;
+        utc_time[point] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(entries[point].gps_time*1E6));
+    }
+}
+
+void select_fields(LASColumnArrays * columns, int fields) {
+    if (!(fields & LAS_FIELD_X)) {
+        columns->x = NULL;
+    }
+    if (!(fields & LAS_FIELD_Y)) {
+        columns->y = NULL;
+    }
+    if (!(fields & LAS_FIELD_Z)) {
+        columns->z = NULL;
+    }
+    if (!(fields & LAS_FIELD_INTENSITY)) {
+        columns->intensity = NULL;
+    }
+    if (!(fields & LAS_FIELD_QUALITY)) {
+        columns->quality = NULL;
+    }
+    if (!(fields & LAS_FIELD_UTC_TIME)) {
+        columns->utc_time = NULL;
+    }
+}
+
+void decode_profile(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                    const LASColumnArrays * columns, uint64_t point_offset) {
+    if (columns->x && columns->y && columns->z && columns->intensity && columns->quality && columns->utc_time) {
+        decode_entries(header, entries, number_of_entries,
+                       columns->x + point_offset, columns->y + point_offset, columns->z + point_offset,
+                       columns->intensity + point_offset, columns->quality + point_offset,
+                       columns->utc_time + point_offset);
+        return;
+    }
+
+    // one strided pass over the records per requested field.
+    uint64_t start = las_stats_clock();
+    if (columns->x) {
+        const double x_scale = header->x_scale_factor;
+        double * x = columns->x + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            x[point] = x_scale * (double)entries[point].x;
+        }
+    }
+    if (columns->y) {
+        const double y_scale = header->y_scale_factor;
+        double * y = columns->y + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            y[point] = y_scale * (double)entries[point].y;
+        }
+    }
+    if (columns->z) {
+        const double z_scale = header->z_scale_factor;
+        double * z = columns->z + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            z[point] = z_scale * (double)entries[point].z;
+        }
+    }
+    if (columns->intensity) {
+        uint16_t * intensity = columns->intensity + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            intensity[point] = entries[point].intensity;
+        }
+    }
+    if (columns->quality) {
+        uint8_t * quality = columns->quality + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            quality[point] = entries[point].user_data;
+        }
+    }
+    if (columns->utc_time) {
+        uint64_t * utc_time = columns->utc_time + point_offset;
+        for (size_t point = 0; point < number_of_entries; ++point) {
+            utc_time[point] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(entries[point].gps_time*1E6));
+        }
+    }
+    las_stats_phase(LAS_PHASE_DECODE, start);
+}
+
+int read_columns(FILE * fid, const LASProfileTable * table, LASColumnArrays * columns) {
+    if (read_columns_at(fid, table, columns, 0) < 0) {
+        return -1;
+    }
+    columns->offsets[table->number_of_profiles] = table->number_of_points;
+    return 0;
+}
+
+int read_columns_at(FILE * fid, const LASProfileTable * table, LASColumnArrays * columns, uint64_t first_point) {
+    LASHeader header;
+    LASEntry * entries = NULL;
+    uint32_t size_entries = 0;
+
+    for (size_t i = 0; i < table->number_of_profiles; ++i) {
+        if (table->point_counts[i] > size_entries) {
+            size_entries = table->point_counts[i];
+        }
+    }
+    if (size_entries > 0) {
+        entries = (LASEntry *)malloc(size_entries * sizeof(LASEntry));
+        if (!entries) {
+            return -1;
+        }
+        las_stats_allocation(size_entries * sizeof(LASEntry));
+    }
+
+    uint64_t point_offset = 0;
+    for (size_t i = 0; i < table->number_of_profiles; ++i) {
+        uint32_t number_of_entries = table->point_counts[i];
+
+        uint64_t start = las_stats_clock();
+        if (las_fseek(fid, (int64_t)table->offsets[i], SEEK_SET) != 0 ||
+            read_header(fid, &header) != 1 ||
+            read_entry(fid, entries, number_of_entries) != number_of_entries) {
+            free(entries);
+            return -1;
+        }
+        las_stats_phase(LAS_PHASE_READ, start);
+
+        las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+        las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+        columns->offsets[i] = first_point + point_offset;
+        columns->profile_time[i] = AdjustedGPSTimeToUTCTimeus(header.guid_data_4);
+        decode_profile(&header, entries, number_of_entries, columns, point_offset);
+        point_offset += number_of_entries;
+    }
+
+    free(entries);
+    return 0;
+}
+
+typedef struct {
+    const uint8_t * data;
+    const LASProfileTable * table;
+    LASColumnArrays * columns;
+} MappedDecode;
+
+static void decode_mapped_profile(void * context, size_t profile) {
+    MappedDecode * decode = (MappedDecode *)context;
+    LASColumnArrays * columns = decode->columns;
+    const uint8_t * record = decode->data + decode->table->offsets[profile];
+    uint64_t point_offset = columns->offsets[profile];
+    LASHeader header;
+
+    uint32_t number_of_entries = decode->table->point_counts[profile];
+
+    memcpy(&header, record, sizeof(LASHeader));
+    columns->profile_time[profile] = AdjustedGPSTimeToUTCTimeus(header.guid_data_4);
+    decode_profile(&header, (const LASEntry *)(record + sizeof(LASHeader)), number_of_entries, columns, point_offset);
+    las_stats_add(LAS_COUNTER_BYTES_READ, sizeof(LASHeader) + (uint64_t)number_of_entries * sizeof(LASEntry));
+    las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+    las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+}
+
+void read_columns_mapped(const uint8_t * data, const LASProfileTable * table, LASColumnArrays * columns, int threads) {
+    uint64_t point_offset = 0;
+    for (size_t i = 0; i < table->number_of_profiles; ++i) {
+        columns->offsets[i] = point_offset;
+        point_offset += table->point_counts[i];
+    }
+    columns->offsets[table->number_of_profiles] = point_offset;
+
+    MappedDecode decode;
+    decode.data = data;
+    decode.table = table;
+    decode.columns = columns;
+    las_parallel_for(table->number_of_profiles, threads, decode_mapped_profile, &decode);
+}
+
+#ifdef _WIN32
+int map_file(const char * filename, LASMappedFile * mapped) {
+    LARGE_INTEGER size;
+
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->file_handle = NULL;
+    mapped->mapping_handle = NULL;
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return -1;
+    }
+    mapped->file_handle = file;
+    mapped->size = (uint64_t)size.QuadPart;
+    if (mapped->size == 0) {
+        return 0; // an empty file cannot be mapped, but it is a valid (empty) survey.
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        unmap_file(mapped);
+        return -1;
+    }
+    mapped->mapping_handle = mapping;
+
+    mapped->data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mapped->data == NULL) {
+        unmap_file(mapped);
+        return -1;
+    }
+    return 0;
+}
+
+void unmap_file(LASMappedFile * mapped) {
+    if (mapped->data) {
+        UnmapViewOfFile((LPCVOID)mapped->data);
+    }
+    if (mapped->mapping_handle) {
+        CloseHandle((HANDLE)mapped->mapping_handle);
+    }
+    if (mapped->file_handle) {
+        CloseHandle((HANDLE)mapped->file_handle);
+    }
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->file_handle = NULL;
+    mapped->mapping_handle = NULL;
+}
+#else
+int map_file(const char * filename, LASMappedFile * mapped) {
+    struct stat file_stat;
+
+    mapped->data = NULL;
+    mapped->size = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return -1;
+    }
+    mapped->size = (uint64_t)file_stat.st_size;
+    if (mapped->size == 0) {
+        close(fd);
+        return 0; // an empty file cannot be mapped, but it is a valid (empty) survey.
     }
 
-    uint64_t adj_pps_time = (uint64_t)(UTCTimeusToAdjustedGPSTime(utc_time_us));
+    void * data = mmap(NULL, (size_t)mapped->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file.
+    if (data == MAP_FAILED) {
+        mapped->size = 0;
+        return -1;
+    }
+    mapped->data = (const uint8_t *)data;
+    return 0;
+}
+
+void unmap_file(LASMappedFile * mapped) {
+    if (mapped->data) {
+        munmap((void *)mapped->data, (size_t)mapped->size);
+    }
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+#endif
+
+#ifdef _WIN32
+int open_pread_file(const char * filename, LASPreadFile * file) {
+    LARGE_INTEGER size;
+
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return -1;
+    }
+    file->handle = handle;
+    file->size = (uint64_t)size.QuadPart;
+    return 0;
+}
+
+void close_pread_file(LASPreadFile * file) {
+    if (file->handle) {
+        CloseHandle((HANDLE)file->handle);
+    }
+    file->handle = NULL;
+    file->size = 0;
+}
+
+int pread_file(const LASPreadFile * file, void * data, size_t size, uint64_t offset) {
+    uint8_t * bytes = (uint8_t *)data;
+    while (size > 0) {
+        OVERLAPPED position = {0};
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD done = 0;
+        position.Offset = (DWORD)offset;
+        position.OffsetHigh = (DWORD)(offset >> 32);
+        if (!ReadFile((HANDLE)file->handle, bytes, chunk, &done, &position) || done == 0) {
+            return -1;
+        }
+        bytes += done;
+        size -= done;
+        offset += done;
+    }
+    return 0;
+}
+#else
+int open_pread_file(const char * filename, LASPreadFile * file) {
+    struct stat file_stat;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return -1;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    file->fd = fd;
+    file->size = (uint64_t)file_stat.st_size;
+    return 0;
+}
+
+void close_pread_file(LASPreadFile * file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    file->fd = -1;
+    file->size = 0;
+}
+
+int pread_file(const LASPreadFile * file, void * data, size_t size, uint64_t offset) {
+    uint8_t * bytes = (uint8_t *)data;
+    while (size > 0) {
+        ssize_t done = pread(file->fd, bytes, size, (off_t)offset);
+        if (done <= 0) {
+            return -1;
+        }
+        bytes += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 0;
+}
+#endif
+
+int read_profile_at(const LASPreadFile * file, uint64_t * offset, const LASProfileFilter * filter,
+                    LASHeader * header, LASProfileBuffer * buffer) {
+    for (;;) {
+        uint64_t start = las_stats_clock();
+        if (*offset + sizeof(LASHeader) > file->size) {
+            return 1; // like read_next_profile, a partial header at the end is the end of the file.
+        }
+        if (pread_file(file, header, sizeof(LASHeader), *offset) < 0) {
+            return -1;
+        }
+        las_stats_add(LAS_COUNTER_BYTES_READ, sizeof(LASHeader));
+
+        uint32_t number_of_entries = header->number_of_point_records;
+        uint64_t records = *offset + sizeof(LASHeader);
+        *offset = records + (uint64_t)number_of_entries * sizeof(LASEntry);
+
+        int keep = filter ? filter_profile_header(filter, header) : 1;
+        if (keep == 0) {
+            continue;
+        }
+
+        if (reserve_profile_buffer(buffer, number_of_entries) < 0) {
+            return -2;
+        }
+        if (*offset > file->size ||
+            pread_file(file, buffer->entries, (size_t)number_of_entries * sizeof(LASEntry), records) < 0) {
+            return -1;
+        }
+        las_stats_add(LAS_COUNTER_BYTES_READ, (uint64_t)number_of_entries * sizeof(LASEntry));
+        las_stats_phase(LAS_PHASE_READ, start);
+        if (keep < 0 && !filter_profile_entries(filter, header, buffer->entries, number_of_entries)) {
+            continue;
+        }
+        las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+        las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+        return 0;
+    }
+}
+
+void fillLASHeader (LASHeader * return_header, uint64_t utc_time_us, uint32_t number_of_points) {
+
+    uint64_t adj_pps_time = (uint64_t)(UTCTimeusToAdjustedGPSTime(utc_time_us)); // read back with AdjustedGPSTimeToUTCTimeus
 
     return_header->file_signature[0] = 'L';
     return_header->file_signature[1] = 'A';
@@ -164,6 +842,7 @@ LASHeader * initLASHeader (uint64_t utc_time_us, uint32_t number_of_points) {
     return_header->point_data_record_length = (uint16_t)(ENTRY_SIZE);
     return_header->number_of_point_records = number_of_points;
     memset(return_header->number_of_points_by_return, 0, sizeof(return_header->number_of_points_by_return));
+    return_header->number_of_points_by_return[0] = number_of_points; // every point is a single return
     return_header->x_scale_factor = header_scale;
     return_header->y_scale_factor = header_scale;
     return_header->z_scale_factor = header_scale;
@@ -176,7 +855,203 @@ LASHeader * initLASHeader (uint64_t utc_time_us, uint32_t number_of_points) {
     return_header->min_y = 0.0;
     return_header->max_z = 0.0;
     return_header->min_z = 0.0;
+}
+
+void set_header_bounds(LASHeader * header, const LASEntry * entries, size_t number_of_entries) {
+    if (number_of_entries == 0) {
+        return;
+    }
+
+    int32_t min_x = entries[0].x, max_x = entries[0].x;
+    int32_t min_y = entries[0].y, max_y = entries[0].y;
+    int32_t min_z = entries[0].z, max_z = entries[0].z;
+    for (size_t point = 1; point < number_of_entries; ++point) {
+        const LASEntry * entry = entries + point;
+        min_x = entry->x < min_x ? entry->x : min_x;
+        max_x = entry->x > max_x ? entry->x : max_x;
+        min_y = entry->y < min_y ? entry->y : min_y;
+        max_y = entry->y > max_y ? entry->y : max_y;
+        min_z = entry->z < min_z ? entry->z : min_z;
+        max_z = entry->z > max_z ? entry->z : max_z;
+    }
+
+    // scaled the same way decode_entries does, so the bounds hold the decoded points exactly.
+    header->min_x = header->x_scale_factor * (double)min_x;
+    header->max_x = header->x_scale_factor * (double)max_x;
+    header->min_y = header->y_scale_factor * (double)min_y;
+    header->max_y = header->y_scale_factor * (double)max_y;
+    header->min_z = header->z_scale_factor * (double)min_z;
+    header->max_z = header->z_scale_factor * (double)max_z;
+}
+
+static int header_has_bounds(const LASHeader * header) {
+    return header->min_x != 0.0 || header->max_x != 0.0 || header->min_y != 0.0 ||
+           header->max_y != 0.0 || header->min_z != 0.0 || header->max_z != 0.0;
+}
+
+static int bounds_intersect(const LASProfileFilter * filter, const LASHeader * header) {
+    return header->max_x >= filter->min_x && header->min_x <= filter->max_x &&
+           header->max_y >= filter->min_y && header->min_y <= filter->max_y &&
+           header->max_z >= filter->min_z && header->min_z <= filter->max_z;
+}
+
+static int header_has_time(const LASHeader * header) {
+    return header->guid_data_4 != 0;
+}
 
+static int time_in_range(const LASProfileFilter * filter, uint64_t utc_time) {
+    return utc_time >= filter->start_time && utc_time <= filter->end_time;
+}
+
+/**
+ * @brief The header only holds whole seconds, so the profile is matched if any part of the
+ * second after its header time lies in the range.
+ *
+ */
+static int header_time_in_range(const LASProfileFilter * filter, const LASHeader * header) {
+    uint64_t first = AdjustedGPSTimeToUTCTimeus(header->guid_data_4);
+    uint64_t last = first + HEADER_TIME_RESOLUTION_US - 1;
+
+    return last >= filter->start_time && first <= filter->end_time;
+}
+
+int filter_profile_header(const LASProfileFilter * filter, const LASHeader * header) {
+    int keep = 1;
+
+    if (filter->has_time) {
+        if (header_has_time(header)) {
+            keep = header_time_in_range(filter, header);
+        } else {
+            keep = -1;
+        }
+    }
+    if (keep != 0 && filter->has_bbox) {
+        if (header_has_bounds(header)) {
+            if (!bounds_intersect(filter, header)) {
+                keep = 0;
+            }
+        } else {
+            keep = -1;
+        }
+    }
+    return keep;
+}
+
+int filter_profile_entries(const LASProfileFilter * filter, const LASHeader * header,
+                           const LASEntry * entries, size_t number_of_entries) {
+    if (number_of_entries == 0) {
+        return 0; // no time stamp and no extent to match
+    }
+    if (filter->has_time && !header_has_time(header) &&
+        !time_in_range(filter, AdjustedGPSTimeusToUTCTimeus((uint64_t)(entries[0].gps_time*1E6)))) {
+        return 0;
+    }
+    if (filter->has_bbox && !header_has_bounds(header)) {
+        LASHeader bounds = *header;
+        set_header_bounds(&bounds, entries, number_of_entries);
+        return bounds_intersect(filter, &bounds);
+    }
+    return 1;
+}
+
+void filter_profile_table_mapped(const uint8_t * data, LASProfileTable * table, const LASProfileFilter * filter) {
+    size_t kept = 0;
+    LASHeader header;
+
+    table->number_of_points = 0;
+    for (size_t i = 0; i < table->number_of_profiles; ++i) {
+        memcpy(&header, data + table->offsets[i], sizeof(LASHeader));
+        int keep = filter_profile_header(filter, &header);
+        if (keep < 0) {
+            keep = filter_profile_entries(filter, &header, (const LASEntry *)(data + table->offsets[i] + sizeof(LASHeader)),
+                                          table->point_counts[i]);
+        }
+        if (keep) {
+            table->offsets[kept] = table->offsets[i];
+            table->point_counts[kept] = table->point_counts[i];
+            table->number_of_points += table->point_counts[i];
+            kept += 1;
+        }
+    }
+    table->number_of_profiles = kept;
+}
+
+int read_next_profile(FILE * fid, const LASProfileFilter * filter, LASHeader * header, LASProfileBuffer * buffer) {
+    for (;;) {
+        uint64_t start = las_stats_clock();
+        if (feof(fid) || !read_header(fid, header)) {
+            return 1; //special case, at the end of the file, sometimes we get a header misread rather than a feof.
+        }
+
+        uint32_t number_of_entries = header->number_of_point_records;
+        int keep = filter ? filter_profile_header(filter, header) : 1;
+        if (keep == 0) {
+            if (las_fseek(fid, (int64_t)number_of_entries * (int64_t)sizeof(LASEntry), SEEK_CUR) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (reserve_profile_buffer(buffer, number_of_entries) < 0) {
+            return -2;
+        }
+        if (read_entry(fid, buffer->entries, number_of_entries) != number_of_entries) {
+            return -1;
+        }
+        las_stats_phase(LAS_PHASE_READ, start);
+        if (keep < 0 && !filter_profile_entries(filter, header, buffer->entries, number_of_entries)) {
+            continue;
+        }
+        las_stats_add(LAS_COUNTER_PROFILES_READ, 1);
+        las_stats_add(LAS_COUNTER_POINTS_READ, number_of_entries);
+        return 0;
+    }
+}
+
+int reserve_profile_buffer(LASProfileBuffer * buffer, size_t number_of_points) {
+    if (number_of_points <= buffer->capacity && buffer->entries != NULL) {
+        return 0;
+    }
+
+    free_profile_buffer(buffer);
+    size_t capacity = number_of_points > 0 ? number_of_points : 1;
+    buffer->entries = (LASEntry *)malloc(capacity * sizeof(LASEntry));
+    buffer->columns.x = (double *)malloc(capacity * sizeof(double));
+    buffer->columns.y = (double *)malloc(capacity * sizeof(double));
+    buffer->columns.z = (double *)malloc(capacity * sizeof(double));
+    buffer->columns.intensity = (uint16_t *)malloc(capacity * sizeof(uint16_t));
+    buffer->columns.quality = (uint8_t *)malloc(capacity * sizeof(uint8_t));
+    buffer->columns.utc_time = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+    if (!buffer->entries || !buffer->columns.x || !buffer->columns.y || !buffer->columns.z ||
+        !buffer->columns.intensity || !buffer->columns.quality || !buffer->columns.utc_time) {
+        free_profile_buffer(buffer);
+        return -1;
+    }
+    las_stats_allocation(capacity * (sizeof(LASEntry) + 3 * sizeof(double) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint64_t)));
+    buffer->capacity = capacity;
+    return 0;
+}
+
+void free_profile_buffer(LASProfileBuffer * buffer) {
+    free(buffer->entries);
+    free(buffer->columns.x);
+    free(buffer->columns.y);
+    free(buffer->columns.z);
+    free(buffer->columns.intensity);
+    free(buffer->columns.quality);
+    free(buffer->columns.utc_time);
+    memset(buffer, 0, sizeof(LASProfileBuffer));
+}
+
+LASHeader * initLASHeader (uint64_t utc_time_us, uint32_t number_of_points) {
+
+    LASHeader * return_header = (LASHeader *) malloc(sizeof (LASHeader));
+
+    if (!return_header) {
+        return NULL;
+    }
+
+    fillLASHeader(return_header, utc_time_us, number_of_points);
 
     return return_header;
 }
@@ -199,6 +1074,87 @@ LASEntry initLASEntry (uint64_t utc_time, double x, double y, double z, uint16_t
     return new_entry;
 }
 
+void encode_entries(const double * x, const double * y, const double * z,
+                    const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                    size_t number_of_entries, LASEntry * entries) {
+    uint64_t start = las_stats_clock();
+    switch (las_simd_level()) {
+        case LAS_SIMD_AVX2:
+            encode_entries_avx2(x, y, z, intensity, quality, utc_time, number_of_entries, entries);
+            break;
+        case LAS_SIMD_SSE41:
+            encode_entries_sse41(x, y, z, intensity, quality, utc_time, number_of_entries, entries);
+            break;
+        default:
+            encode_entries_scalar(x, y, z, intensity, quality, utc_time, number_of_entries, entries);
+            break;
+    }
+    las_stats_phase(LAS_PHASE_ENCODE, start);
+}
+
+void encode_entries_scalar(const double * x, const double * y, const double * z,
+                           const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                           size_t number_of_entries, LASEntry * entries) {
+    for (size_t point = 0; point < number_of_entries; ++point) {
+        entries[point] = initLASEntry(utc_time[point], x[point], y[point], z[point], intensity[point], quality[point]);
+    }
+}
+
+static int write_block(FILE * fid, const uint8_t * block, size_t size) {
+    uint64_t start = las_stats_clock();
+    size_t written = fwrite(block, 1, size, fid);
+    las_stats_phase(LAS_PHASE_WRITE, start);
+    las_stats_add(LAS_COUNTER_BYTES_WRITTEN, written);
+    return written == size ? 0 : -1;
+}
+
+int write_columns(FILE * fid, const LASColumnArrays * columns, size_t number_of_profiles) {
+    size_t capacity = WRITE_BLOCK_SIZE;
+    for (size_t i = 0; i < number_of_profiles; ++i) {
+        size_t profile_size = sizeof(LASHeader) + (size_t)(columns->offsets[i+1] - columns->offsets[i]) * sizeof(LASEntry);
+        if (profile_size > capacity) {
+            capacity = profile_size;
+        }
+    }
+
+    uint8_t * block = (uint8_t *)malloc(capacity);
+    if (!block) {
+        return -1;
+    }
+    las_stats_allocation(capacity);
+
+    size_t used = 0;
+    for (size_t i = 0; i < number_of_profiles; ++i) {
+        uint64_t first = columns->offsets[i];
+        uint32_t number_of_points = (uint32_t)(columns->offsets[i+1] - first);
+        size_t profile_size = sizeof(LASHeader) + (size_t)number_of_points * sizeof(LASEntry);
+
+        if (used + profile_size > capacity) {
+            if (write_block(fid, block, used) < 0) {
+                free(block);
+                return -1;
+            }
+            used = 0;
+        }
+
+        fillLASHeader((LASHeader *)(block + used), columns->profile_time[i], number_of_points);
+        encode_entries(columns->x + first, columns->y + first, columns->z + first,
+                       columns->intensity + first, columns->quality + first, columns->utc_time + first,
+                       number_of_points, (LASEntry *)(block + used + sizeof(LASHeader)));
+        set_header_bounds((LASHeader *)(block + used), (LASEntry *)(block + used + sizeof(LASHeader)), number_of_points);
+        las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, 1);
+        las_stats_add(LAS_COUNTER_POINTS_WRITTEN, number_of_points);
+        used += profile_size;
+    }
+
+    if (write_block(fid, block, used) < 0) {
+        free(block);
+        return -1;
+    }
+
+    free(block);
+    return 0;
+}
 
 uint64_t AdjustedGPSTimeusToUTCTimeus(uint64_t adj_pps_time) {
     const uint64_t gps_offset = (uint64_t)(18*1E6); // 2017 value
@@ -210,6 +1166,10 @@ uint64_t AdjustedGPSTimeusToUTCTimeus(uint64_t adj_pps_time) {
     return utc_time;
 }
 
+uint64_t AdjustedGPSTimeToUTCTimeus(uint64_t adj_pps_time) {
+    return AdjustedGPSTimeusToUTCTimeus(adj_pps_time * 1000000ull);
+}
+
 double UTCTimeusToAdjustedGPSTime(uint64_t utc_time) {
 
     uint32_t offsetSeconds = 18;
@@ -223,5 +1183,7 @@ double UTCTimeusToAdjustedGPSTime(uint64_t utc_time) {
     return adjusted_time;
 }
 
-
-
+uint64_t UTCTimeusToAdjustedGPSTimeus(uint64_t utc_time) {
+    // exact inverse of AdjustedGPSTimeusToUTCTimeus, which only adds a constant.
+    return utc_time - AdjustedGPSTimeusToUTCTimeus(0);
+}
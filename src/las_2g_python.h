@@ -10,6 +10,29 @@
 #define ENTRY_SIZE 28
 #define HEADER_SIZE 0xE3 // the header size
 #define HEADER_STRING_SIZE 32 // the size of the strings for the system identifier and generating software
+#define WRITE_BLOCK_SIZE (4 * 1024 * 1024) // bytes of headers and entries gathered before each fwrite
+#define HEADER_TIME_RESOLUTION_US 1000000 // the header time is stored in truncated adjusted GPS seconds
+
+// point fields a reader can be asked to decode
+#define LAS_FIELD_X 0x01
+#define LAS_FIELD_Y 0x02
+#define LAS_FIELD_Z 0x04
+#define LAS_FIELD_INTENSITY 0x08
+#define LAS_FIELD_QUALITY 0x10
+#define LAS_FIELD_UTC_TIME 0x20
+#define LAS_FIELDS_ALL 0x3F
+
+#ifdef _WIN32
+#define las_fseek _fseeki64
+#define las_ftell _ftelli64
+#else
+#define las_fseek fseeko
+#define las_ftell ftello
+#endif
+
+extern const double header_scale;
+extern const double point_scale; /// points per m in the records
+extern const uint64_t diff_to_gps_epoch; /// us between the Unix and GPS epochs
 
 #pragma pack (push)
 #pragma pack(1)
@@ -84,6 +107,105 @@ typedef struct {
     LASEntry * entries;
 } LASFile;
 
+/**
+ * @brief A whole survey held in a growable arena: every header in one contiguous block and
+ * every entry in another, so loading does no allocation per profile and free_las_dataset
+ * releases everything at once. The header of profile i is headers[i] and its entries
+ * start at entries + offsets[i].
+ * 
+ */
+typedef struct {
+    LASHeader * headers;
+    uint64_t * offsets; /// number_of_profiles + 1 entries, offsets[i] is the first entry of profile i
+    LASEntry * entries;
+    size_t number_of_profiles;
+    size_t profile_capacity;
+    uint64_t number_of_points;
+    uint64_t point_capacity;
+    int truncated; /// set by read_las_dataset when the file ends inside a profile
+} LASDataset;
+
+/**
+ * @brief Location of every profile in a concatenated file, found by hopping from
+ * header to header using number_of_point_records.
+ * 
+ */
+typedef struct {
+    uint64_t * offsets; /// byte offset of each profile header
+    uint32_t * point_counts; /// number of point records in each profile
+    size_t number_of_profiles;
+    size_t capacity;
+    uint64_t number_of_points; /// sum of point_counts
+} LASProfileTable;
+
+/**
+ * @brief A read only memory mapping of a whole file.
+ * 
+ */
+typedef struct {
+    const uint8_t * data; /// NULL for an empty file
+    uint64_t size;
+#ifdef _WIN32
+    void * file_handle;
+    void * mapping_handle;
+#endif
+} LASMappedFile;
+
+/**
+ * @brief A file read with positioned reads (pread), so it can be read from any thread
+ * without sharing a file position.
+ * 
+ */
+typedef struct {
+#ifdef _WIN32
+    void * handle;
+#else
+    int fd;
+#endif
+    uint64_t size;
+} LASPreadFile;
+
+/**
+ * @brief Destination arrays for a columnar read, point arrays sized for every point of the
+ * profile table and profile arrays sized for every profile.
+ * 
+ */
+typedef struct {
+    double * x;
+    double * y;
+    double * z;
+    uint16_t * intensity;
+    uint8_t * quality;
+    uint64_t * utc_time;
+    uint64_t * offsets; /// number_of_profiles + 1 entries, offsets[i] is the first point of profile i
+    uint64_t * profile_time; /// header time of each profile in us from the Unix epoch, whole seconds
+} LASColumnArrays;
+
+/**
+ * @brief Profile selection checked against the headers before the point records are
+ * decoded. A profile is kept if its bounding box intersects the box and its header time, to
+ * the second, lies in the time range. Profiles without a header time use their first point.
+ * 
+ */
+typedef struct {
+    int has_bbox;
+    double min_x, min_y, min_z;
+    double max_x, max_y, max_z;
+    int has_time;
+    uint64_t start_time; /// inclusive utc time in us from the Unix epoch
+    uint64_t end_time; /// inclusive
+} LASProfileFilter;
+
+/**
+ * @brief Reusable staging area for one profile: the raw records and their decoded columns.
+ * 
+ */
+typedef struct {
+    LASEntry * entries;
+    LASColumnArrays columns; /// only the point arrays are used
+    size_t capacity; /// number of points every array has room for
+} LASProfileBuffer;
+
 /**
  * @brief Create an empty LAS header
  * 
@@ -94,6 +216,25 @@ typedef struct {
  */
 LASHeader * initLASHeader (uint64_t utc_time, uint32_t number_of_points);
 
+/**
+ * @brief Fill in an existing header the same way as initLASHeader.
+ * 
+ * @param header header to fill, e.g. inside an output buffer
+ * @param utc_time time in us since unix epoch
+ * @param number_of_points number of entries.
+ */
+void fillLASHeader (LASHeader * header, uint64_t utc_time, uint32_t number_of_points);
+
+/**
+ * @brief Set the bounding box of a header from the profile's encoded entries. A profile
+ * without points keeps zero bounds, which readers treat as unknown.
+ * 
+ * @param header header of the profile, with its scale factors filled in
+ * @param entries 
+ * @param number_of_entries 
+ */
+void set_header_bounds(LASHeader * header, const LASEntry * entries, size_t number_of_entries);
+
 /**
  * @brief Create an empty LASEntry.
  * 
@@ -154,12 +295,354 @@ size_t write_entries(FILE * fid, LASEntry * entries, size_t number_of_entries);
 /**
  * @brief Read a LAS file from the hard drive
  * 
+ * Every profile is allocated separately so the caller can free them one by one, prefer
+ * read_las_dataset which needs no allocation per profile.
+ * 
  * @param filename 
  * @param las_files Array to pointers to las files. Caller gets ownership of every file pointer and their contained headers and entries.
  * @return int number of las files read, or -1 for error.
  */
 int read_las( const char * filename, LASFile *** las_files);
 
+/**
+ * @brief Make an empty dataset.
+ * 
+ * @param dataset 
+ */
+void init_las_dataset(LASDataset * dataset);
+
+/**
+ * @brief Make sure a dataset has room for more profiles and points, growing each block
+ * geometrically so repeated appends stay amortised O(1).
+ * 
+ * @param dataset 
+ * @param number_of_profiles total number of profiles needed
+ * @param number_of_points total number of points needed
+ * @return int 0 on success, -1 if memory could not be allocated (the dataset is unchanged).
+ */
+int reserve_las_dataset(LASDataset * dataset, size_t number_of_profiles, uint64_t number_of_points);
+
+/**
+ * @brief Copy a profile onto the end of a dataset.
+ * 
+ * @param dataset 
+ * @param header copied, number_of_point_records is set to number_of_entries
+ * @param entries 
+ * @param number_of_entries 
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int append_las_profile(LASDataset * dataset, const LASHeader * header, const LASEntry * entries, uint32_t number_of_entries);
+
+/**
+ * @brief Read every profile of a LAS file into a dataset. The entry block is sized from the
+ * file size up front, so the records are read straight into place.
+ * 
+ * @param filename 
+ * @param dataset empty dataset, filled on success. Release with free_las_dataset. If the
+ * file ends inside a profile, the complete profiles before it are returned and truncated is set.
+ * @return int number of profiles read, or -1 if the file could not be opened or read or
+ * memory could not be allocated.
+ */
+int read_las_dataset(const char * filename, LASDataset * dataset);
+
+/**
+ * @brief Write every profile of a dataset to a LAS file.
+ * 
+ * @param filename 
+ * @param dataset 
+ * @return int 0 on success, -1 if the file could not be written.
+ */
+int write_las_dataset(const char * filename, const LASDataset * dataset);
+
+/**
+ * @brief Release the blocks of a dataset and reset it to empty.
+ * 
+ * @param dataset 
+ */
+void free_las_dataset(LASDataset * dataset);
+
+/**
+ * @brief Make an empty profile table.
+ * 
+ * @param table 
+ */
+void init_profile_table(LASProfileTable * table);
+
+/**
+ * @brief Add a profile to the end of a table.
+ * 
+ * @param table 
+ * @param offset byte offset of the profile header
+ * @param number_of_points 
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+int append_profile(LASProfileTable * table, uint64_t offset, uint32_t number_of_points);
+
+/**
+ * @brief Walk the header chain of a file without reading any point records.
+ * 
+ * @param fid open fid, positioned at the first header. Left at an unspecified position.
+ * @param table empty table, filled on success. Release with free_profile_table.
+ * @return int number of profiles found, or -1 if a profile runs past the end of the file
+ * or memory could not be allocated.
+ */
+int scan_profiles(FILE * fid, LASProfileTable * table);
+
+/**
+ * @brief Walk the header chain of a memory mapped file, the same way as scan_profiles.
+ * 
+ * @param data start of the mapping
+ * @param size size of the mapping in bytes
+ * @param table empty table, filled on success. Release with free_profile_table.
+ * @return int number of profiles found, or -1 if a profile runs past the end of the file
+ * or memory could not be allocated.
+ */
+int scan_profiles_mapped(const uint8_t * data, uint64_t size, LASProfileTable * table);
+
+/**
+ * @brief Release the arrays held by a profile table and reset it to empty.
+ * 
+ * @param table 
+ */
+void free_profile_table(LASProfileTable * table);
+
+/**
+ * @brief Check a profile against a filter using its header alone.
+ * 
+ * @param filter 
+ * @param header 
+ * @return int 1 to keep the profile, 0 to skip it, -1 if the header holds no bounds or time
+ * to decide with and filter_profile_entries has to look at the records.
+ */
+int filter_profile_header(const LASProfileFilter * filter, const LASHeader * header);
+
+/**
+ * @brief Check a profile the header could not decide on against its records, taking the
+ * missing bounds from the points and the missing time from the first point.
+ * 
+ * @param filter 
+ * @param header 
+ * @param entries 
+ * @param number_of_entries 
+ * @return int 1 to keep the profile, 0 to skip it.
+ */
+int filter_profile_entries(const LASProfileFilter * filter, const LASHeader * header,
+                           const LASEntry * entries, size_t number_of_entries);
+
+/**
+ * @brief Drop the profiles of a table that do not pass a filter.
+ * 
+ * @param data mapped file the table was built from
+ * @param table updated in place, number_of_points included
+ * @param filter 
+ */
+void filter_profile_table_mapped(const uint8_t * data, LASProfileTable * table, const LASProfileFilter * filter);
+
+/**
+ * @brief Convert packed point records into separate columns, applying the header scale
+ * and converting the GPS time to UTC, the same way read_las_wrapper does per point. Uses
+ * the vector kernels of las_simd_level().
+ * 
+ * @param header header of the profile the entries belong to
+ * @param entries packed records
+ * @param number_of_entries 
+ * @param x,y,z output coordinates in m
+ * @param intensity output intensity
+ * @param quality output quality (user_data)
+ * @param utc_time output time in us from the Unix epoch
+ */
+void decode_entries(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                    double * x, double * y, double * z,
+                    uint16_t * intensity, uint8_t * quality, uint64_t * utc_time);
+
+/**
+ * @brief Clear the point arrays of the fields that are not requested.
+ * 
+ * @param columns 
+ * @param fields mask of LAS_FIELD_ values to keep
+ */
+void select_fields(LASColumnArrays * columns, int fields);
+
+/**
+ * @brief Decode the records of one profile into columns starting at point_offset. Point
+ * arrays left NULL are not decoded, and every requested field costs one strided pass over
+ * the records. With every field requested this is decode_entries.
+ * 
+ * @param header header of the profile the entries belong to
+ * @param entries packed records
+ * @param number_of_entries 
+ * @param columns output, only the point arrays are used
+ * @param point_offset index the profile's first point is written to
+ */
+void decode_profile(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                    const LASColumnArrays * columns, uint64_t point_offset);
+
+/**
+ * @brief decode_entries one point at a time, the reference the vector kernels match.
+ * 
+ */
+void decode_entries_scalar(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                           double * x, double * y, double * z,
+                           uint16_t * intensity, uint8_t * quality, uint64_t * utc_time);
+
+/**
+ * @brief Read every profile of a scanned file straight into columns.
+ * 
+ * @param fid open fid the table was built from
+ * @param table result of scan_profiles on fid
+ * @param columns arrays large enough for table->number_of_points points and table->number_of_profiles profiles
+ * @return int 0 on success, -1 if the file could not be read or memory could not be allocated.
+ */
+int read_columns(FILE * fid, const LASProfileTable * table, LASColumnArrays * columns);
+
+/**
+ * @brief Read every profile of a scanned file into a slice of larger columns, as when
+ * several files share one result. Only offsets[0] to offsets[number_of_profiles-1] are
+ * written so neighbouring slices can be filled concurrently.
+ * 
+ * @param fid open fid the table was built from
+ * @param table result of scan_profiles on fid
+ * @param columns arrays pointing at the first point and first profile of the slice
+ * @param first_point index of the slice's first point in the whole result, added to every offset
+ * @return int 0 on success, -1 if the file could not be read or memory could not be allocated.
+ */
+int read_columns_at(FILE * fid, const LASProfileTable * table, LASColumnArrays * columns, uint64_t first_point);
+
+/**
+ * @brief Decode every profile of a mapped file into columns, spreading the profiles over
+ * a work stealing pool of threads. Each profile is written straight into its own slice
+ * of the columns.
+ * 
+ * @param data mapped file the table was built from
+ * @param table result of scan_profiles_mapped on data
+ * @param columns arrays large enough for table->number_of_points points and table->number_of_profiles
+ * profiles, point arrays left NULL are not decoded
+ * @param threads number of threads, 0 for one per processor
+ */
+void read_columns_mapped(const uint8_t * data, const LASProfileTable * table, LASColumnArrays * columns, int threads);
+
+/**
+ * @brief Map a whole file read only into memory.
+ * 
+ * @param filename 
+ * @param mapped filled on success. Release with unmap_file.
+ * @return int 0 on success, -1 if the file could not be opened or mapped.
+ */
+int map_file(const char * filename, LASMappedFile * mapped);
+
+/**
+ * @brief Open a file for read_profile_at, hinting the OS to read ahead sequentially.
+ * 
+ * @param filename 
+ * @param file filled on success. Release with close_pread_file.
+ * @return int 0 on success, -1 if the file could not be opened.
+ */
+int open_pread_file(const char * filename, LASPreadFile * file);
+
+/**
+ * @brief Close a file opened with open_pread_file.
+ * 
+ * @param file 
+ */
+void close_pread_file(LASPreadFile * file);
+
+/**
+ * @brief Read bytes at an offset of a file opened with open_pread_file.
+ * 
+ * @param file 
+ * @param data 
+ * @param size 
+ * @param offset 
+ * @return int 0 on success, -1 if the bytes could not all be read.
+ */
+int pread_file(const LASPreadFile * file, void * data, size_t size, uint64_t offset);
+
+/**
+ * @brief Read the next profile that passes a filter with positioned reads, the same way as
+ * read_next_profile.
+ * 
+ * @param file 
+ * @param offset byte offset of the next header, advanced past every profile read or skipped
+ * @param filter NULL to read every profile
+ * @param header filled with the profile header
+ * @param buffer receives the records of the profile in buffer->entries
+ * @return int 0 on success, 1 at the end of the file, -1 if the records could not be read,
+ * -2 if memory could not be allocated.
+ */
+int read_profile_at(const LASPreadFile * file, uint64_t * offset, const LASProfileFilter * filter,
+                    LASHeader * header, LASProfileBuffer * buffer);
+
+/**
+ * @brief Release a mapping created by map_file.
+ * 
+ * @param mapped 
+ */
+void unmap_file(LASMappedFile * mapped);
+
+/**
+ * @brief Convert columns into packed point records, the same way as initLASEntry. Uses the
+ * vector kernels of las_simd_level().
+ * 
+ * @param x,y,z coordinates in m
+ * @param intensity 
+ * @param quality 
+ * @param utc_time time in us from the Unix epoch
+ * @param number_of_entries 
+ * @param entries output records
+ */
+void encode_entries(const double * x, const double * y, const double * z,
+                    const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                    size_t number_of_entries, LASEntry * entries);
+
+/**
+ * @brief encode_entries one point at a time, the reference the vector kernels match.
+ * 
+ */
+void encode_entries_scalar(const double * x, const double * y, const double * z,
+                           const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                           size_t number_of_entries, LASEntry * entries);
+
+/**
+ * @brief Write columns as concatenated profiles, gathering headers and entries into
+ * large blocks before writing them.
+ * 
+ * @param fid open fid
+ * @param columns offsets and profile_time describe the profiles, offsets[number_of_profiles]
+ * is the number of points.
+ * @param number_of_profiles 
+ * @return int 0 on success, -1 if memory could not be allocated or the write failed.
+ */
+int write_columns(FILE * fid, const LASColumnArrays * columns, size_t number_of_profiles);
+
+/**
+ * @brief Make sure a profile buffer has room for a number of points. Existing contents are not kept.
+ * 
+ * @param buffer zero initialised before first use
+ * @param number_of_points 
+ * @return int 0 on success, -1 if memory could not be allocated (the buffer is then empty).
+ */
+int reserve_profile_buffer(LASProfileBuffer * buffer, size_t number_of_points);
+
+/**
+ * @brief Read the records of the next profile of a file that passes a filter. Profiles the
+ * header rules out are skipped with a seek, without reading their records.
+ * 
+ * @param fid open fid positioned at a header
+ * @param filter NULL to read every profile
+ * @param header filled with the profile header
+ * @param buffer receives the records of the profile in buffer->entries
+ * @return int 0 on success, 1 at the end of the file, -1 if the records could not be read,
+ * -2 if memory could not be allocated.
+ */
+int read_next_profile(FILE * fid, const LASProfileFilter * filter, LASHeader * header, LASProfileBuffer * buffer);
+
+/**
+ * @brief Release the arrays of a profile buffer.
+ * 
+ * @param buffer 
+ */
+void free_profile_buffer(LASProfileBuffer * buffer);
+
 /**
  * @brief Convert Adjusted GPS to UTC time.
  * 
@@ -175,4 +658,20 @@ uint64_t AdjustedGPSTimeusToUTCTimeus(uint64_t adj_pps_time);
  */
 double UTCTimeusToAdjustedGPSTime(uint64_t utc_time);
 
+/**
+ * @brief Convert the adjusted GPS seconds stored in the header guid_data_4 to UTC time.
+ * 
+ * @param adj_pps_time in s
+ * @return uint64_t in us
+ */
+uint64_t AdjustedGPSTimeToUTCTimeus(uint64_t adj_pps_time);
+
+/**
+ * @brief Convert UTC time to adjusted GPS time in us.
+ * 
+ * @param utc_time in us
+ * @return uint64_t in us
+ */
+uint64_t UTCTimeusToAdjustedGPSTimeus(uint64_t utc_time);
+
 #endif
\ No newline at end of file
@@ -8,10 +8,9 @@
  * @copyright 2G Robotics Inc., Copyright (c) 2020
  * 
  */
-#define PY_SSIZE_T_CLEAN
-#include <Python.h>
-#include "structmember.h"
-#include "las_2g_python.h"
+#include "las_2g_python_module.h"
+#include "las_2g_simd.h"
+#include "las_2g_compress.h"
 
 //-----------------------------------------------------------------
 // LAS types definitions
@@ -19,17 +18,6 @@
 
 // LAS Header Definitions
 //-----------------------------------------------------------------
-typedef struct {
-    PyObject_HEAD
-    uint32_t number_of_point_records;
-    double x_scale;
-    double y_scale;
-    double z_scale;
-    double x_offset;
-    double y_offset;
-    double z_offset;
-    uint64_t utc_time;
-} LASHeaderPython;
 
 static void LASHeader_dealloc(LASHeaderPython * self) {
     Py_TYPE(self)->tp_free((PyObject *) self);
@@ -48,6 +36,30 @@ static int LASHeader_init (LASHeaderPython * self, PyObject * args, PyObject *kw
     return 0;
 }
 
+static PyObject * LASHeader_reduce(LASHeaderPython * self, PyObject * Py_UNUSED(ignored)) {
+    return Py_BuildValue("(O()(IddddddK))", Py_TYPE(self), self->number_of_point_records,
+                         self->x_scale, self->y_scale, self->z_scale,
+                         self->x_offset, self->y_offset, self->z_offset,
+                         (unsigned long long) self->utc_time);
+}
+
+static PyObject * LASHeader_setstate(LASHeaderPython * self, PyObject * state) {
+    unsigned long long utc_time;
+    if (!PyArg_ParseTuple(state, "IddddddK", &self->number_of_point_records,
+                          &self->x_scale, &self->y_scale, &self->z_scale,
+                          &self->x_offset, &self->y_offset, &self->z_offset, &utc_time)) {
+        return NULL;
+    }
+    self->utc_time = utc_time;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef LASHeader_methods[] = {
+    {"__reduce__", (PyCFunction) LASHeader_reduce, METH_NOARGS, NULL},
+    {"__setstate__", (PyCFunction) LASHeader_setstate, METH_O, NULL},
+    {NULL} //sentinel
+};
+
 static PyMemberDef LASHeader_members[] = {
     {"number_of_points", T_UINT, offsetof(LASHeaderPython, number_of_point_records), 0, "Number of points"},
     {"x_scale", T_DOUBLE, offsetof(LASHeaderPython, x_scale), 0, "x scale factor."},
@@ -56,12 +68,12 @@ static PyMemberDef LASHeader_members[] = {
     {"x_offset", T_DOUBLE, offsetof(LASHeaderPython, x_offset), 0, "x offset factor."},
     {"y_offset", T_DOUBLE, offsetof(LASHeaderPython, y_offset), 0, "y offset factor."},
     {"z_offset", T_DOUBLE, offsetof(LASHeaderPython, z_offset), 0, "z offset factor."},
-    {"utc_time", T_DOUBLE, offsetof(LASHeaderPython, utc_time), 0, "utc_time in us from epoch"},
+    {"utc_time", T_ULONGLONG, offsetof(LASHeaderPython, utc_time), 0, "utc_time in us from epoch, whole seconds"},
 
     {NULL} //sentinel
 };
 
-static PyTypeObject LASHeaderPythonType = {
+PyTypeObject LASHeaderPythonType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "las_2g.LASHeader",
     .tp_doc = "A LAS header.",
@@ -72,80 +84,11 @@ static PyTypeObject LASHeaderPythonType = {
     .tp_init = (initproc) LASHeader_init,
     .tp_dealloc = (destructor) LASHeader_dealloc,
     .tp_members = LASHeader_members,
-    //.tg_methods = LASEntry_methods,
-};
-
-// LAS Entry Definitions
-//-----------------------------------------------------------------
-typedef struct {
-    PyObject_HEAD
-    double x;
-    double y;
-    double z;
-    uint16_t intensity;
-    uint8_t quality;
-    uint64_t utc_time;
-} LASEntryPython;
-
-static void LASEntry_dealloc(LASEntryPython * self) {
-    Py_TYPE(self)->tp_free((PyObject *) self);
-}
-
-static int LASEntry_init (LASEntryPython * self, PyObject * args, PyObject *kwargs) {
-    
-    double x = 0.0;
-    double y = 0.0;
-    double z = 0.0;
-    uint16_t intensity = 0;
-    uint8_t quality = 0;
-    uint64_t utc_time = 0;
-
-    if (!PyArg_ParseTuple (args, "dddHbK", &x, &y, &z, &intensity, &quality, &utc_time)) {
-        printf ("failed parse.");
-        return -1;
-    }
-
-    self->x = x;
-    self->y = y; 
-    self->z = z;
-    self->intensity = intensity;
-    self->quality = quality;
-    self->utc_time = utc_time;
-    return 0;
-}
-
-static PyMemberDef LASEntry_members[] = {
-    {"x", T_DOUBLE, offsetof(LASEntryPython, x), 0, "x co-ordinate in m."},
-    {"y", T_DOUBLE, offsetof(LASEntryPython, y), 0, "y co-ordinate in m."},
-    {"z", T_DOUBLE, offsetof(LASEntryPython, z), 0, "z co-ordinate in m."},
-    {"intensity", T_SHORT, offsetof(LASEntryPython, intensity), 0, "intensity"},
-    {"quality", T_BYTE, offsetof(LASEntryPython, quality), 0, "quality"},
-    {"utc_time", T_ULONGLONG, offsetof(LASEntryPython, utc_time), 0, "utc time in microseconds from the unix epoch epoch"},
-    {NULL} //sentinel
-};
-
-static PyTypeObject LASEntryPythonType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "las_2g.LASEntry",
-    .tp_doc = "A single LAS entry/point.",
-    .tp_basicsize = sizeof(LASEntryPython),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc) LASEntry_init,
-    .tp_dealloc = (destructor) LASEntry_dealloc,
-    .tp_members = LASEntry_members,
-    //.tg_methods = LASEntry_methods,
+    .tp_methods = LASHeader_methods,
 };
 
-
 // LAS File Definitions
 //-----------------------------------------------------------------
-typedef struct {
-    PyObject_HEAD
-    PyObject * header; //LASHeaderPython object
-    PyObject * entries; //List of LASEntryPython objects
-} LASFilePython;
 
 static void LASFile_dealloc(LASFilePython * self) {
     Py_XDECREF(self->header);
@@ -163,7 +106,13 @@ static PyObject * LASFile_new(PyTypeObject * type, PyObject * args, PyObject * k
             return NULL;
         }
 
-        self->entries = PyList_New(0);
+        // the same type the readers give, empty and with the scale of the writers.
+        LASHeader header;
+        memset(&header, 0, sizeof(LASHeader));
+        header.x_scale_factor = header_scale;
+        header.y_scale_factor = header_scale;
+        header.z_scale_factor = header_scale;
+        self->entries = (PyObject *) LASEntryList_New(&header, NULL, 0, LAS_FIELDS_ALL);
         if (!self->entries) {
             Py_DECREF(self);
             return NULL;
@@ -180,13 +129,37 @@ static int LASFile_init (LASFilePython * self, PyObject * args, PyObject *kwargs
     return 0;
 }
 
+static PyObject * LASFile_reduce(LASFilePython * self, PyObject * Py_UNUSED(ignored)) {
+    // the entries of a LASEntryList pickle as one buffer of packed records.
+    return Py_BuildValue("(O()(OO))", Py_TYPE(self), self->header, self->entries);
+}
+
+static PyObject * LASFile_setstate(LASFilePython * self, PyObject * state) {
+    PyObject * header;
+    PyObject * entries;
+    if (!PyArg_ParseTuple(state, "OO", &header, &entries)) {
+        return NULL;
+    }
+    Py_INCREF(header);
+    Py_SETREF(self->header, header);
+    Py_INCREF(entries);
+    Py_SETREF(self->entries, entries);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef LASFile_methods[] = {
+    {"__reduce__", (PyCFunction) LASFile_reduce, METH_NOARGS, NULL},
+    {"__setstate__", (PyCFunction) LASFile_setstate, METH_O, NULL},
+    {NULL} //sentinel
+};
+
 static PyMemberDef LASFile_members[] = {
     {"header", T_OBJECT_EX, offsetof(LASFilePython, header), 0, "File Header"},
-    {"entries", T_OBJECT_EX, offsetof(LASFilePython, entries), 0, "List of Entries"},
+    {"entries", T_OBJECT_EX, offsetof(LASFilePython, entries), 0, "Entries, a LASEntryList or a list of LASEntry"},
     {NULL} //sentinel
 };
 
-static PyTypeObject LASFilePythonType = {
+PyTypeObject LASFilePythonType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "las_2g.LASFile",
     .tp_doc = "A single LAS File containing a header and multiple entries",
@@ -197,25 +170,199 @@ static PyTypeObject LASFilePythonType = {
     .tp_new = LASFile_new,
     .tp_dealloc = (destructor) LASFile_dealloc,
     .tp_members = LASFile_members,
-    //.tg_methods = LASFile_methods,
+    .tp_methods = LASFile_methods,
 };
 
 //-----------------------------------------------------------------
 // Methods definitions
 //-----------------------------------------------------------------
 
-static PyObject * read_las_wrapper(PyObject * self, PyObject * args) {
+PyObject * LASFile_FromRecords(const LASHeader * header, const LASEntry * entries, int fields) {
+    uint64_t start = las_stats_clock();
+    LASFilePython * file_entry =  (LASFilePython *) PyObject_CallObject((PyObject *) &LASFilePythonType, NULL);
+    if (!file_entry){
+        PyErr_SetString(PyExc_RuntimeError, "Failed to create LASFile Object");
+        return NULL;
+    }
+
+    uint32_t header_entries = header->number_of_point_records;
+
+    ((LASHeaderPython *)file_entry->header)->number_of_point_records = header_entries;
+    ((LASHeaderPython *)file_entry->header)->x_scale = header->x_scale_factor;
+    ((LASHeaderPython *)file_entry->header)->y_scale = header->y_scale_factor;
+    ((LASHeaderPython *)file_entry->header)->z_scale = header->z_scale_factor;
+    ((LASHeaderPython *)file_entry->header)->x_offset = header->x_offset;
+    ((LASHeaderPython *)file_entry->header)->y_offset = header->y_offset;
+    ((LASHeaderPython *)file_entry->header)->z_offset = header->z_offset;
+    ((LASHeaderPython *)file_entry->header)->utc_time = AdjustedGPSTimeToUTCTimeus(header->guid_data_4);
+
+    PyObject * entry_list = (PyObject *) LASEntryList_New(header, entries, header_entries, fields);
+    if (!entry_list){
+        Py_DECREF(file_entry);
+        return NULL;
+    }
+    Py_SETREF(file_entry->entries, entry_list);
+
+    las_stats_phase(LAS_PHASE_OBJECTS, start);
+    return (PyObject *) file_entry;
+}
+
+int LASFields_FromPython(PyObject * fields, int * mask) {
+    static const char * names[] = {"x", "y", "z", "intensity", "quality", "utc_time"};
+
+    *mask = LAS_FIELDS_ALL;
+    if (fields == Py_None) {
+        return 0;
+    }
+    if (PyUnicode_Check(fields)) {
+        PyErr_SetString(PyExc_TypeError, "fields must be a sequence of field names, e.g. (\"z\", \"intensity\").");
+        return -1;
+    }
+
+    PyObject * sequence = PySequence_Fast(fields, "fields must be a sequence of field names, e.g. (\"z\", \"intensity\").");
+    if (!sequence) {
+        return -1;
+    }
+    *mask = 0;
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(sequence); ++i) {
+        const char * name = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(sequence, i));
+        if (!name) {
+            Py_DECREF(sequence);
+            return -1;
+        }
+        int field = 0;
+        for (int j = 0; j < 6; ++j) {
+            if (strcmp(name, names[j]) == 0) {
+                field = 1 << j;
+            }
+        }
+        if (field == 0) {
+            PyErr_Format(PyExc_ValueError, "Unknown field '%s', expected x, y, z, intensity, quality or utc_time.", name);
+            Py_DECREF(sequence);
+            return -1;
+        }
+        *mask |= field;
+    }
+    Py_DECREF(sequence);
+    return 0;
+}
+
+PyObject * LASFields_ToPython(int mask) {
+    static const char * names[] = {"x", "y", "z", "intensity", "quality", "utc_time"};
+
+    if ((mask & LAS_FIELDS_ALL) == LAS_FIELDS_ALL) {
+        Py_RETURN_NONE;
+    }
+    Py_ssize_t count = 0;
+    for (int j = 0; j < 6; ++j) {
+        count += (mask >> j) & 1;
+    }
+    PyObject * fields = PyTuple_New(count);
+    for (int j = 0, i = 0; fields && j < 6; ++j) {
+        if (!(mask & (1 << j))) {
+            continue;
+        }
+        PyObject * name = PyUnicode_FromString(names[j]);
+        if (!name) {
+            Py_CLEAR(fields);
+            break;
+        }
+        PyTuple_SET_ITEM(fields, i++, name);
+    }
+    return fields;
+}
+
+int LASProfileFilter_FromPython(PyObject * bbox, PyObject * time_range, LASProfileFilter * filter) {
+    memset(filter, 0, sizeof(LASProfileFilter));
+
+    if (bbox != Py_None) {
+        double bounds[6];
+        PyObject * sequence = PySequence_Fast(bbox, "bbox must be a sequence of 4 or 6 numbers.");
+        if (!sequence) {
+            return -1;
+        }
+        Py_ssize_t length = PySequence_Fast_GET_SIZE(sequence);
+        if (length != 4 && length != 6) {
+            PyErr_SetString(PyExc_ValueError, "bbox must be (min_x, min_y, max_x, max_y) or (min_x, min_y, min_z, max_x, max_y, max_z).");
+            Py_DECREF(sequence);
+            return -1;
+        }
+        for (Py_ssize_t i = 0; i < length; ++i) {
+            bounds[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(sequence, i));
+            if (bounds[i] == -1.0 && PyErr_Occurred()) {
+                Py_DECREF(sequence);
+                return -1;
+            }
+        }
+        Py_DECREF(sequence);
+
+        filter->has_bbox = 1;
+        if (length == 4) {
+            filter->min_x = bounds[0];
+            filter->min_y = bounds[1];
+            filter->min_z = -Py_HUGE_VAL;
+            filter->max_x = bounds[2];
+            filter->max_y = bounds[3];
+            filter->max_z = Py_HUGE_VAL;
+        } else {
+            filter->min_x = bounds[0];
+            filter->min_y = bounds[1];
+            filter->min_z = bounds[2];
+            filter->max_x = bounds[3];
+            filter->max_y = bounds[4];
+            filter->max_z = bounds[5];
+        }
+    }
+
+    if (time_range != Py_None) {
+        PyObject * start = NULL;
+        PyObject * end = NULL;
+        if (!PyArg_ParseTuple(time_range, "OO", &start, &end)) {
+            PyErr_Clear();
+            PyErr_SetString(PyExc_TypeError, "time_range must be a (start, end) tuple.");
+            return -1;
+        }
+        filter->has_time = 1;
+        filter->start_time = 0;
+        filter->end_time = UINT64_MAX;
+        if (start != Py_None) {
+            filter->start_time = PyLong_AsUnsignedLongLong(start);
+        }
+        if (!PyErr_Occurred() && end != Py_None) {
+            filter->end_time = PyLong_AsUnsignedLongLong(end);
+        }
+        if (PyErr_Occurred()) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static PyObject * read_las_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "bbox", "time_range", "fields", NULL};
     char * filename;
+    PyObject * bbox = Py_None;
+    PyObject * time_range = Py_None;
+    PyObject * fields_object = Py_None;
+    LASProfileFilter filter;
+    int fields;
 
     //parse arguments
-    if (!PyArg_ParseTuple(args, "s", &filename)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|OOO", keywords, &filename, &bbox, &time_range, &fields_object)) {
+        return NULL;
+    }
+    if (LASProfileFilter_FromPython(bbox, time_range, &filter) < 0 ||
+        LASFields_FromPython(fields_object, &fields) < 0) {
         return NULL;
     }
 
+    if (LASCompressed_Check(filename)) {
+        return LASCompressed_ReadFiles(filename, &filter, fields);
+    }
+
     //run the function
     LASHeader header;
-    LASEntry *entries = NULL;
-    Py_ssize_t size_entries = 0;
+    LASProfileBuffer buffer = {0};
 
     FILE * fid;
     fid = fopen(filename, "rb");
@@ -231,143 +378,59 @@ static PyObject * read_las_wrapper(PyObject * self, PyObject * args) {
         return NULL;
     }
 
-    while (!feof(fid)) {
-        LASFilePython * file_entry =  (LASFilePython *) PyObject_CallObject((PyObject *) &LASFilePythonType, NULL);
-        if (!file_entry){
-            PyErr_SetString(PyExc_RuntimeError, "Failed to create LASFile Object");
-            Py_DECREF (data_list);
-            if (entries != NULL) {
-                free (entries);
-            }
-            fclose(fid);
-            return NULL;
-        }
-        
-        if (!read_header(fid, &header)) {
-            //PyErr_SetString(PyExc_RuntimeError, "Failed to read header from file.");
-            Py_DECREF(file_entry);
-            break; //special case, at the end of the file, sometimes we get a header misread rather than a feof.
-        }
+    for (;;) {
+        // the records are read into buffer without the GIL, they are decoded only when
+        // a point is accessed.
+        int ret = 0;
+        Py_BEGIN_ALLOW_THREADS
+        ret = read_next_profile(fid, &filter, &header, &buffer);
+        Py_END_ALLOW_THREADS
 
-        uint32_t header_entries = header.number_of_point_records;
-
-        ((LASHeaderPython *)file_entry->header)->number_of_point_records = header_entries;
-        ((LASHeaderPython *)file_entry->header)->x_scale = header.x_scale_factor;
-        ((LASHeaderPython *)file_entry->header)->y_scale = header.y_scale_factor;
-        ((LASHeaderPython *)file_entry->header)->z_scale = header.z_scale_factor;
-        ((LASHeaderPython *)file_entry->header)->x_offset = header.x_offset;
-        ((LASHeaderPython *)file_entry->header)->y_offset = header.y_offset;
-        ((LASHeaderPython *)file_entry->header)->z_offset = header.z_offset;
-        ((LASHeaderPython *)file_entry->header)->utc_time = AdjustedGPSTimeusToUTCTimeus(header.guid_data_4);
-        
-        PyObject * temp = file_entry->entries;
-        file_entry->entries = PyList_New( ((LASHeaderPython *)file_entry->header)->number_of_point_records );
-        if (!file_entry->entries){
-            PyErr_SetString(PyExc_RuntimeError, "Could not create list for LAS Entries.");
-            Py_DECREF(file_entry);
+        if (ret == 1) {
+            break;
+        }
+        if (ret < 0) {
+            PyErr_SetString(PyExc_RuntimeError, ret == -1 ? "Could not load entry from file." : "Failed to allocate memory for entries.");
             Py_DECREF(data_list);
-            if (entries != NULL) {
-                free (entries);
-            }
+            free_profile_buffer(&buffer);
             fclose(fid);
             return NULL;
         }
-        Py_DECREF (temp);
 
-        if (size_entries != header_entries) {
-            if (entries != NULL) {
-                free (entries);
-            }
-            entries = (LASEntry *)malloc(header_entries * sizeof(LASEntry));
-            size_entries = header_entries;
-        }
-        size_t num_entries = read_entry(fid, entries, header_entries);
-        if (num_entries != (Py_ssize_t)header_entries) {
-            PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
-            Py_DECREF(file_entry);
+        PyObject * file_entry = LASFile_FromRecords(&header, buffer.entries, fields);
+        if (!file_entry) {
             Py_DECREF(data_list);
-            if (entries != NULL) {
-                free (entries);
-            }
+            free_profile_buffer(&buffer);
             fclose(fid);
             return NULL;
         }
 
-        for (unsigned int point = 0; point < ((LASHeaderPython *)file_entry->header)->number_of_point_records; ++point) {
-            PyObject * point_init = Py_BuildValue("dddHbK", 
-                                                    ((LASHeaderPython *)file_entry->header)->x_scale * (double)entries[point].x, 
-                                                    ((LASHeaderPython *)file_entry->header)->y_scale * (double)entries[point].y, 
-                                                    ((LASHeaderPython *)file_entry->header)->z_scale * (double)entries[point].z, 
-                                                    entries[point].intensity, 
-                                                    entries[point].user_data, 
-                                                    AdjustedGPSTimeusToUTCTimeus((uint64_t)(entries[point].gps_time*1E6)));
-            if (!point_init){
-                PyErr_SetString(PyExc_RuntimeError, "Failed to build value for setting up LASEntries");
-                Py_DECREF(file_entry);
-                Py_DECREF(data_list);
-                if (entries != NULL) {
-                    free (entries);
-                }
-                fclose(fid);
-                return NULL;
-            }
-            LASEntryPython * point_entry = (LASEntryPython * ) PyObject_CallObject((PyObject *) &LASEntryPythonType, (PyObject *)point_init);
-            if (!point_entry){
-               PyErr_SetString(PyExc_RuntimeError, "Failed to create a LASEntry.");
-               Py_DECREF(file_entry);
-               Py_DECREF(data_list);
-               if (entries != NULL) {
-                    free (entries);
-                }
-                fclose(fid);
-               return NULL;
-            }
-            Py_DECREF(point_init);
-
-            //PyList_Append(file_entry->entries, (PyObject *) point_entry );
-            //Py_DECREF(point_entry);
-            if (PyList_SetItem(file_entry->entries,  point, (PyObject *) point_entry ) < 0) {
-                PyErr_SetString(PyExc_RuntimeError, "Failed to add LASEntry to LASFile entries list.");
-                Py_DECREF(point_entry);
-                Py_DECREF(file_entry);
-                Py_DECREF(data_list);
-                if (entries != NULL) {
-                    free (entries);
-                }
-                fclose(fid);
-                return NULL;
-            }   
-        }
-
-        int ret = PyList_Append(data_list, (PyObject *)file_entry);
+        ret = PyList_Append(data_list, file_entry);
         Py_DECREF (file_entry); 
 
         if (ret<0) {
             PyErr_SetString(PyExc_RuntimeError, "Unable to add LASFile to list.");
-            Py_DECREF(file_entry);
             Py_DECREF(data_list);
-            if (entries != NULL) {
-                free (entries);
-            }
+            free_profile_buffer(&buffer);
             fclose(fid);
             return NULL;
         }
     }
 
-    if (entries != NULL) {
-        free (entries);
-    }
+    free_profile_buffer(&buffer);
     fclose(fid);
 
     return data_list;
 
 };
 
-static PyObject * write_las_wrapper(PyObject * self, PyObject * args) {
+static PyObject * write_las_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "las_files", "compress", NULL};
     char * filename;
     PyObject * las_files = NULL;
+    PyObject * compress_object = Py_None;
     //parse arguments
-    if (!PyArg_ParseTuple(args, "sO", &filename, &las_files)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|O", keywords, &filename, &las_files, &compress_object)) {
         return NULL;
     }
     Py_INCREF(las_files);
@@ -385,110 +448,339 @@ static PyObject * write_las_wrapper(PyObject * self, PyObject * args) {
         return NULL;
     }
 
-    FILE * fid;
+    int compress = LASCompressed_ExtensionMatches(filename);
+    if (compress_object != Py_None) {
+        compress = PyObject_IsTrue(compress_object);
+        if (compress < 0) {
+            Py_DECREF(las_files);
+            return NULL;
+        }
+    }
 
-    fid = fopen(filename, "wb");
-    if (fid == NULL) {
+    FILE * fid = NULL;
+    LASCompressedWriter writer;
+    int opened;
+
+    if (compress) {
+        opened = open_compressed_writer(&writer, filename) == 0;
+    } else {
+        fid = fopen(filename, "wb");
+        opened = fid != NULL;
+    }
+    if (!opened) {
         PyErr_SetString(PyExc_RuntimeError, "Failed to open output file.\n");
         Py_DECREF(las_files);
         return NULL;
     }
 
-    for (Py_ssize_t i = 0; i < num_of_files; ++i) {
+    LASProfileBuffer buffer = {0};
+    int ret = 0;
+    for (Py_ssize_t i = 0; i < num_of_files && ret == 0; ++i) {
         LASFilePython * las_file = (LASFilePython* )PyList_GetItem( (PyObject *)las_files, i);
         if (!las_file) {
             PyErr_SetString(PyExc_RuntimeError, "Failed to read LASFile from list.");
-            Py_DECREF(las_files);
-            fclose(fid);
-            return NULL;
+            ret = -3;
+            break;
         }
 
-        Py_ssize_t number_of_points = ((LASHeaderPython *)((LASFilePython*)las_file)->header)->number_of_point_records;
-
-        LASHeader *header;
-        header = initLASHeader( ((LASHeaderPython *)((LASFilePython*)las_file)->header)->utc_time, 
-                                            (uint32_t)number_of_points);
-        if (!header) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for header.");
-            Py_DECREF(las_files);
-            free(header);
-            fclose(fid);
-            return NULL;
+        uint32_t number_of_points = ((LASHeaderPython *)((LASFilePython*)las_file)->header)->number_of_point_records;
+        uint64_t utc_time = ((LASHeaderPython *)((LASFilePython*)las_file)->header)->utc_time;
+        Py_ssize_t number_of_entries = LASEntries_Encode(las_file->entries, &buffer);
+        if (number_of_entries < 0) {
+            ret = -3;
+            break;
         }
 
-        LASEntry *entries = (LASEntry *) malloc (number_of_points * sizeof (LASEntry));
-        if (!entries) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for entries.");
-            Py_DECREF(las_files);
-            free(header);
-            fclose(fid);
-            return NULL;
-        }
-        for (Py_ssize_t point = 0; point < PyList_Size(las_file->entries); ++point) {
-            LASEntryPython * entry = (LASEntryPython *)PyList_GetItem(las_file->entries, point);
-            if (!entry) {
-                PyErr_SetString(PyExc_RuntimeError, "Failed to get LASEntry for entry list.");
-                free(header);
-                free(entries);
-                Py_DECREF(las_files);
-                fclose(fid);
-                return NULL;
+        LASHeader header;
+        Py_BEGIN_ALLOW_THREADS
+        fillLASHeader(&header, utc_time, number_of_points);
+        set_header_bounds(&header, buffer.entries, number_of_entries);
+        if (compress) {
+            if (compressed_writer_append(&writer, &header, buffer.entries, (uint32_t)number_of_entries) < 0) {
+                ret = -2;
             }
-
-            entries[point] = initLASEntry( entry->utc_time,
-                                            entry->x,
-                                            entry->y,
-                                            entry->z,
-                                            entry->intensity,
-                                            entry->quality );
+        } else {
+            uint64_t start = las_stats_clock();
+            if (!write_header(fid, &header)) {
+                ret = -1;
+            } else if (number_of_entries > 0 && !write_entries(fid, buffer.entries, number_of_entries)) {
+                ret = -2;
+            }
+            las_stats_phase(LAS_PHASE_WRITE, start);
         }
+        Py_END_ALLOW_THREADS
+    }
 
-        if (!write_header(fid, header)) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to save LASheader.");
-            free(header);
-            free(entries);
-            Py_DECREF(las_files);
-            fclose(fid);
-            return NULL;
+    free_profile_buffer(&buffer);
+    if (compress) {
+        if (close_compressed_writer(&writer) < 0 && ret == 0) {
+            ret = -2;
         }
-        if (!write_entries(fid, entries, PyList_Size(las_file->entries))) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to save LASEntry.");
-            free(header);
-            free(entries);
-            Py_DECREF(las_files);
-            fclose(fid);
-            return NULL;
-        }
-        free(header);
-        free(entries);
+    } else {
+        fclose(fid);
     }
-
-    fclose(fid);
-
     Py_DECREF(las_files);
+
+    if (ret == -1 || ret == -2) {
+        PyErr_SetString(PyExc_RuntimeError, ret == -1 ? "Failed to save LASheader." : "Failed to save LASEntry.");
+    }
+    if (ret < 0) {
+        return NULL;
+    }
     Py_INCREF (Py_None);
     return Py_None;
 };
 
+static PyObject * simd_level_wrapper(PyObject * self, PyObject * Py_UNUSED(ignored)) {
+    return PyUnicode_FromString(las_simd_name(las_simd_level()));
+}
+
+static PyObject * write_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "write_las", write_las_call(self, args, kwargs));
+}
+
+static PyObject * read_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "read_las", read_las_call(self, args, kwargs));
+}
+
+static PyObject * set_simd_level_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"level", NULL};
+    const char * name = NULL;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "z", keywords, &name)) {
+        return NULL;
+    }
+
+    int level = las_simd_supported();
+    if (name != NULL) {
+        for (level = LAS_SIMD_AVX2; level >= LAS_SIMD_SCALAR; --level) {
+            if (strcmp(name, las_simd_name(level)) == 0) {
+                break;
+            }
+        }
+        if (level < LAS_SIMD_SCALAR) {
+            PyErr_Format(PyExc_ValueError, "Unknown SIMD level '%s', expected 'scalar', 'sse4.1' or 'avx2'.", name);
+            return NULL;
+        }
+    }
+    if (las_simd_set_level(level) < 0) {
+        PyErr_Format(PyExc_ValueError, "SIMD level '%s' is not supported by this CPU.", name);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
 
 //-----------------------------------------------------------------
 // Module setup
 //-----------------------------------------------------------------
 
 PyDoc_STRVAR(read_las_doc,
-	"read_las(filename) -> List of Files\n\n"
-	"Reads in a LAS File and returns a list of every individual LAS \n"
-    "file/profile in the set.\n"
-	"Returns a list of LASFiles\n");
+    "read_las(filename, bbox=None, time_range=None, fields=None) -> List of Files\n\n"
+    "Reads in a LAS File, plain or compressed by write_las or compress_las, \n"
+    "and returns a list of every individual LAS file/profile in the set.\n"
+    "bbox=(min_x, min_y, max_x, max_y) or (min_x, min_y, min_z, max_x, max_y, \n"
+    "max_z) keeps the profiles whose bounds intersect the box, and \n"
+    "time_range=(start, end) the profiles whose header time lies in the range \n"
+    "(utc us, inclusive). Both are checked against the profile headers and \n"
+    "skipped profiles are never decoded; profiles written without bounds or \n"
+    "time fall back to their points.\n"
+    "fields=(\"z\", \"intensity\") decodes only the named point fields out of \n"
+    "x, y, z, intensity, quality and utc_time, the others are left 0.\n"
+    "Returns a list of LASFiles\n");
 
 PyDoc_STRVAR(write_las_doc,
-    "write_las(filename, list_of_LASFiles)\n\n"
+    "write_las(filename, list_of_LASFiles, compress=None)\n\n"
     "Write a las file to the hard drive given the filename and \n"
-    "a list of LASFiles.");
+    "a list of LASFiles. With compress=True, or by default when filename \n"
+    "ends in .las2gz, the profiles are written to a compressed container \n"
+    "that read_las recognises.");
+
+PyDoc_STRVAR(compress_las_doc,
+    "compress_las(source, destination, threads=0) -> number of profiles\n\n"
+    "Convert a LAS File into the compressed container, every profile being \n"
+    "compressed on its own so it can be read back independently. The \n"
+    "profiles are compressed on threads threads, 0 for one per processor.\n");
+
+PyDoc_STRVAR(decompress_las_doc,
+    "decompress_las(source, destination, threads=0) -> number of profiles\n\n"
+    "Convert a compressed container back into the LAS File it was made \n"
+    "from, byte for byte.\n");
+
+PyDoc_STRVAR(read_las_columns_doc,
+    "read_las_columns(filename, threads=0, bbox=None, time_range=None, \n"
+    "                 fields=None) -> LASColumns\n\n"
+    "Reads in a LAS File and returns every point of every profile as \n"
+    "contiguous x, y, z, intensity, quality and utc_time columns, plus the \n"
+    "offset of the first point of each profile. The columns support the \n"
+    "buffer protocol, e.g. numpy.frombuffer(columns.z). The profiles are \n"
+    "decoded on threads threads, 0 for one per processor. bbox and \n"
+    "time_range select profiles as in read_las. With fields, only the named \n"
+    "columns are decoded and the others are None.\n");
+
+PyDoc_STRVAR(read_many_doc,
+    "read_many(filenames, threads=0) -> (LASColumns, file_offsets, errors)\n\n"
+    "Reads a list of LAS Files on a pool of threads (0 for one per processor) \n"
+    "into one set of columns, in the order of filenames. file_offsets[i] is the \n"
+    "first profile of filenames[i]. Files that cannot be read contribute no \n"
+    "profiles and are reported in errors, a dict of index into filenames to \n"
+    "message, instead of failing the whole batch.\n");
+
+PyDoc_STRVAR(write_las_columns_doc,
+    "write_las_columns(filename, x, y, z, intensity, quality, utc_time, \n"
+    "                  offsets=None, counts=None, profile_time=None)\n\n"
+    "Write a las file from contiguous point columns (float64 x/y/z, uint16 \n"
+    "intensity, uint8 quality, uint64 utc_time), e.g. the columns of \n"
+    "read_las_columns or numpy arrays. The profiles are given either by \n"
+    "offsets (first point of each profile plus the number of points) or by \n"
+    "counts (points per profile). Each header is stamped with profile_time, \n"
+    "or the time of the first point of the profile.");
+
+PyDoc_STRVAR(build_index_doc,
+    "build_index(filename) -> number of profiles\n\n"
+    "Writes the sidecar index filename.lasidx holding the offset, point count, \n"
+    "header time, time span and bounds of every profile. LASDataset(filename, \n"
+    "use_index=True) uses it instead of walking the file.\n");
+
+PyDoc_STRVAR(iter_las_doc,
+    "iter_las(filename, batch_profiles=None, bbox=None, time_range=None, \n"
+    "         fields=None) -> iterator\n\n"
+    "Iterates over the profiles of a LAS File without loading the whole \n"
+    "file. Yields one LASFile at a time, or lists of up to batch_profiles \n"
+    "LASFiles when batch_profiles is given. bbox, time_range and fields \n"
+    "work as in read_las.\n");
+
+PyDoc_STRVAR(read_las_async_doc,
+    "read_las_async(filename, bbox=None, time_range=None, fields=None) -> Future\n\n"
+    "read_las for asyncio: reads the file on a background thread without \n"
+    "blocking the event loop. Must be called while the loop is running; await \n"
+    "the result to get the list of LASFiles.\n");
+
+PyDoc_STRVAR(write_las_async_doc,
+    "write_las_async(filename, las_files, compress=None) -> Future\n\n"
+    "write_las for asyncio. The profiles are encoded before it returns, so \n"
+    "las_files may be changed while the file is written in the background.\n");
+
+PyDoc_STRVAR(iter_las_async_doc,
+    "iter_las_async(filename, prefetch=16, bbox=None, time_range=None, \n"
+    "               fields=None) -> async iterator\n\n"
+    "Iterates over the profiles of a LAS File with async for. A background \n"
+    "thread reads up to prefetch profiles ahead of the consumer with \n"
+    "positioned reads. bbox, time_range and fields work as in read_las.\n");
+
+PyDoc_STRVAR(scan_las_doc,
+    "scan_las(filename, max_points=16777216) -> dict\n\n"
+    "Checks the signature, header size, point format, record length and point \n"
+    "count of every header, resynchronising on the next valid \"LASF\" header \n"
+    "when the chain is broken. Returns the file size, the number of intact \n"
+    "profiles and their points, good_bytes and bad_bytes, a \"good\" list of \n"
+    "(start, end) byte ranges and a \"bad\" list of (start, end, reason) ranges.\n");
+
+PyDoc_STRVAR(salvage_las_doc,
+    "salvage_las(filename, fields=None, max_points=16777216) -> list of LASFile\n\n"
+    "Reads every intact profile scan_las finds in a damaged LAS File, \n"
+    "skipping the bad byte ranges.\n");
+
+PyDoc_STRVAR(profile_stats_doc,
+    "profile_stats(source, intensity_bins=16, quality_bins=16, threads=0) -> dict\n\n"
+    "Reduces the point records of a LAS File name or LASDataset without \n"
+    "decoding them to Python objects, one pass per profile on threads \n"
+    "threads (0 for every CPU). Returns LASColumns with one element per \n"
+    "profile: points, min_z, max_z, mean_z, start_time and end_time (utc us), \n"
+    "and intensity_histogram and quality_histogram with intensity_bins and \n"
+    "quality_bins counts per profile, row after row. The bins are powers of \n"
+    "two splitting the 65536 intensities and 256 qualities evenly. \n"
+    "'survey' holds the same values combined over every profile.\n");
+
+PyDoc_STRVAR(share_las_doc,
+    "share_las(filename, name=None, threads=0, fields=None) -> LASSharedSurvey\n\n"
+    "Decodes a LAS File straight into the columns of a new POSIX shared \n"
+    "memory segment, named name or one made up from the process id. Other \n"
+    "processes attach to it with attach_shared(handle.name), or by being \n"
+    "passed the pickled handle. The segment is removed when the last \n"
+    "handle in every process is closed.\n");
+
+PyDoc_STRVAR(attach_shared_doc,
+    "attach_shared(name) -> LASSharedSurvey\n\n"
+    "Maps the shared survey made by share_las with the given name. The \n"
+    "columns are read only and nothing is copied.\n");
+
+PyDoc_STRVAR(load_grid_doc,
+    "load_grid(filename) -> LASGrid\n\n"
+    "Memory maps a grid written by LASGrid.save. Queries read the file as \n"
+    "they need it, so loading takes the same time for any size of grid.\n");
+
+PyDoc_STRVAR(concat_doc,
+    "concat(paths, out) -> int\n\n"
+    "Writes every profile of the LAS Files in paths, in order, to out without \n"
+    "decoding them. The bytes are moved with copy_file_range or sendfile \n"
+    "where available. Returns the number of profiles written.\n");
+
+PyDoc_STRVAR(extract_doc,
+    "extract(path, out, profiles=None, time_range=None, bbox=None) -> int\n\n"
+    "Writes the profiles of a LAS File at the given indices, in that order, \n"
+    "to out without decoding them. time_range and bbox work as in read_las \n"
+    "and are applied to the selected profiles. Returns the number of \n"
+    "profiles written.\n");
+
+PyDoc_STRVAR(simd_level_doc,
+    "simd_level() -> str\n\n"
+    "Instruction set used to convert between records and points: 'avx2', \n"
+    "'sse4.1' or 'scalar'.\n");
+
+PyDoc_STRVAR(set_simd_level_doc,
+    "set_simd_level(level)\n\n"
+    "Use the 'avx2', 'sse4.1' or 'scalar' conversions, or the best the CPU \n"
+    "supports when level is None. Every level gives identical results.\n");
+PyDoc_STRVAR(stats_doc,
+    "stats() -> dict\n\n"
+    "Counters of the bytes, profiles and points read and written and of the \n"
+    "buffers allocated since the module was loaded or reset_stats was called. \n"
+    "stats()['phases'] gives the seconds spent in, and the number of calls of, \n"
+    "the read, write, parse, decode, encode, compress and objects phases, \n"
+    "summed over threads.\n");
+PyDoc_STRVAR(reset_stats_doc,
+    "reset_stats()\n\n"
+    "Set every counter and phase timer back to zero.\n");
+PyDoc_STRVAR(set_trace_doc,
+    "set_trace(callback)\n\n"
+    "Call callback(name, seconds, stats) after every call of the module's \n"
+    "read, write, convert and index functions, with the counter changes \n"
+    "during the call in the format of stats(). Calls running at the same \n"
+    "time in other threads add to each other's counters. None turns \n"
+    "tracing off.\n");
 
 static PyMethodDef LASMethods[] = {
-    {"read_las", read_las_wrapper, METH_VARARGS, read_las_doc},
-    {"write_las", write_las_wrapper, METH_VARARGS, write_las_doc},
+    {"read_las", (PyCFunction) read_las_wrapper, METH_VARARGS | METH_KEYWORDS, read_las_doc},
+    {"iter_las", (PyCFunction) iter_las_wrapper, METH_VARARGS | METH_KEYWORDS, iter_las_doc},
+    {"read_las_columns", (PyCFunction) read_las_columns_wrapper, METH_VARARGS | METH_KEYWORDS, read_las_columns_doc},
+    {"read_many", (PyCFunction) read_many_wrapper, METH_VARARGS | METH_KEYWORDS, read_many_doc},
+    {"write_las", (PyCFunction) write_las_wrapper, METH_VARARGS | METH_KEYWORDS, write_las_doc},
+    {"compress_las", (PyCFunction) compress_las_wrapper, METH_VARARGS | METH_KEYWORDS, compress_las_doc},
+    {"decompress_las", (PyCFunction) decompress_las_wrapper, METH_VARARGS | METH_KEYWORDS, decompress_las_doc},
+    {"write_las_columns", (PyCFunction) write_las_columns_wrapper, METH_VARARGS | METH_KEYWORDS, write_las_columns_doc},
+    {"build_index", (PyCFunction) build_index_wrapper, METH_VARARGS | METH_KEYWORDS, build_index_doc},
+    {"read_las_async", (PyCFunction) read_las_async_wrapper, METH_VARARGS | METH_KEYWORDS, read_las_async_doc},
+    {"write_las_async", (PyCFunction) write_las_async_wrapper, METH_VARARGS | METH_KEYWORDS, write_las_async_doc},
+    {"iter_las_async", (PyCFunction) iter_las_async_wrapper, METH_VARARGS | METH_KEYWORDS, iter_las_async_doc},
+    {"scan_las", (PyCFunction) scan_las_wrapper, METH_VARARGS | METH_KEYWORDS, scan_las_doc},
+    {"salvage_las", (PyCFunction) salvage_las_wrapper, METH_VARARGS | METH_KEYWORDS, salvage_las_doc},
+    {"profile_stats", (PyCFunction) profile_stats_wrapper, METH_VARARGS | METH_KEYWORDS, profile_stats_doc},
+    {"share_las", (PyCFunction) share_las_wrapper, METH_VARARGS | METH_KEYWORDS, share_las_doc},
+    {"attach_shared", (PyCFunction) attach_shared_wrapper, METH_VARARGS | METH_KEYWORDS, attach_shared_doc},
+    {"load_grid", (PyCFunction) load_grid_wrapper, METH_VARARGS | METH_KEYWORDS, load_grid_doc},
+    {"concat", (PyCFunction) concat_wrapper, METH_VARARGS | METH_KEYWORDS, concat_doc},
+    {"extract", (PyCFunction) extract_wrapper, METH_VARARGS | METH_KEYWORDS, extract_doc},
+    {"simd_level", simd_level_wrapper, METH_NOARGS, simd_level_doc},
+    {"set_simd_level", (PyCFunction) set_simd_level_wrapper, METH_VARARGS | METH_KEYWORDS, set_simd_level_doc},
+    {"stats", stats_wrapper, METH_NOARGS, stats_doc},
+    {"reset_stats", reset_stats_wrapper, METH_NOARGS, reset_stats_doc},
+    {"set_trace", set_trace_wrapper, METH_VARARGS, set_trace_doc},
     {NULL, NULL, 0, NULL} //sentinel
 };
 
@@ -506,12 +798,39 @@ PyMODINIT_FUNC PyInit_las_2g_python(void) {
     if (PyType_Ready(&LASEntryPythonType) <  0) {
         return NULL;
     }
+    if (PyType_Ready(&LASEntryListPythonType) <  0) {
+        return NULL;
+    }
     if (PyType_Ready(&LASHeaderPythonType) <  0) {
         return NULL;
     }
     if (PyType_Ready(&LASFilePythonType) <  0) {
         return NULL;
     }
+    if (PyType_Ready(&LASColumnPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASColumnsPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASDatasetPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASIteratorPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASWriterPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASAsyncIteratorPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASGridPythonType) <  0) {
+        return NULL;
+    }
+    if (PyType_Ready(&LASSharedSurveyPythonType) <  0) {
+        return NULL;
+    }
 
     m = PyModule_Create(&las_2g_module);
     if (m == NULL) {
@@ -525,6 +844,13 @@ PyMODINIT_FUNC PyInit_las_2g_python(void) {
         return NULL;
     }
 
+    Py_INCREF(&LASEntryListPythonType);
+    if (PyModule_AddObject(m, "LASEntryList", (PyObject *) &LASEntryListPythonType) < 0) {
+        Py_DECREF(&LASEntryListPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
     Py_INCREF(&LASHeaderPythonType);
     if (PyModule_AddObject(m, "LASHeader", (PyObject *) &LASHeaderPythonType) < 0) {
         Py_DECREF(&LASEntryPythonType);
@@ -542,5 +868,47 @@ PyMODINIT_FUNC PyInit_las_2g_python(void) {
         return NULL;
     }
 
+    Py_INCREF(&LASColumnPythonType);
+    if (PyModule_AddObject(m, "LASColumn", (PyObject *) &LASColumnPythonType) < 0) {
+        Py_DECREF(&LASColumnPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&LASColumnsPythonType);
+    if (PyModule_AddObject(m, "LASColumns", (PyObject *) &LASColumnsPythonType) < 0) {
+        Py_DECREF(&LASColumnsPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&LASDatasetPythonType);
+    if (PyModule_AddObject(m, "LASDataset", (PyObject *) &LASDatasetPythonType) < 0) {
+        Py_DECREF(&LASDatasetPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&LASWriterPythonType);
+    if (PyModule_AddObject(m, "LASWriter", (PyObject *) &LASWriterPythonType) < 0) {
+        Py_DECREF(&LASWriterPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&LASGridPythonType);
+    if (PyModule_AddObject(m, "LASGrid", (PyObject *) &LASGridPythonType) < 0) {
+        Py_DECREF(&LASGridPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&LASSharedSurveyPythonType);
+    if (PyModule_AddObject(m, "LASSharedSurvey", (PyObject *) &LASSharedSurveyPythonType) < 0) {
+        Py_DECREF(&LASSharedSurveyPythonType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
     return m;
 };
@@ -0,0 +1,392 @@
+/**
+ * @file las_2g_python_module.h
+ * @author Ryan Wicks
+ * @brief Python object types shared between the translation units of the module.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#ifndef LAS_2G_PYTHON_MODULE_H
+#define LAS_2G_PYTHON_MODULE_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "structmember.h"
+#include "las_2g_python.h"
+#include "las_2g_index.h"
+#include "las_2g_stats.h"
+
+//-----------------------------------------------------------------
+// LAS types definitions
+//-----------------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    uint32_t number_of_point_records;
+    double x_scale;
+    double y_scale;
+    double z_scale;
+    double x_offset;
+    double y_offset;
+    double z_offset;
+    uint64_t utc_time;
+} LASHeaderPython;
+
+/**
+ * @brief A point. Entries handed out by a LASEntryList are views of one of its records,
+ * reads decode and writes encode that record. Entries made with LASEntry(...) hold their
+ * own values.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject * owner; //LASEntryListPython holding the record, NULL for a standalone entry
+    Py_ssize_t index; /// record of owner
+    double x;
+    double y;
+    double z;
+    uint16_t intensity;
+    uint8_t quality;
+    uint64_t utc_time;
+} LASEntryPython;
+
+/**
+ * @brief The points of a profile kept as packed records. LASEntry objects are only created
+ * for the points that are accessed.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    LASEntry * records;
+    Py_ssize_t length;
+    Py_ssize_t capacity; /// records allocated, never shrinks so entries past the end stay readable
+    Py_ssize_t exports; /// buffer views and GIL-free readers of records, the list is not resized while any are open
+    double x_scale; /// scale factors of the header the records were read with
+    double y_scale;
+    double z_scale;
+    int fields; /// mask of the LAS_FIELD_ values that were read, the others read as 0
+} LASEntryListPython;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject * header; //LASHeaderPython object
+    PyObject * entries; //LASEntryListPython, or a list of LASEntryPython objects
+} LASFilePython;
+
+/**
+ * @brief A contiguous, typed, one dimensional array exported through the buffer protocol.
+ * The data is either owned by the column or kept alive by owner, as for the read only
+ * columns of a shared survey.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    char * data;
+    Py_ssize_t length; /// number of elements
+    Py_ssize_t itemsize;
+    char format[2]; /// struct module format character
+    PyObject * owner; //object holding data, NULL when the column allocated it
+    int readonly;
+} LASColumnPython;
+
+/**
+ * @brief A survey held as one column per point field plus a per-profile offset array.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject * x; //LASColumnPython objects
+    PyObject * y;
+    PyObject * z;
+    PyObject * intensity;
+    PyObject * quality;
+    PyObject * utc_time;
+    PyObject * offsets; // number_of_profiles + 1 point offsets
+    PyObject * profile_time; // header utc time of each profile
+    PyObject * profile_id; // profile index of each point, NULL until first requested
+} LASColumnsPython;
+
+/**
+ * @brief A memory mapped survey with a lazily built profile offset table.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    LASMappedFile mapped;
+    LASProfileTable table;
+    LASIndex index;
+    int is_open;
+    int indexed; /// table has been built
+    int has_index; /// index holds the profile summaries (sidecar or built in memory)
+    int fields; /// mask of the LAS_FIELD_ values decoded into indexed profiles
+    int exports; /// operations reading the mapping without the GIL
+    int close_pending; /// close() was called while exports was not 0, the last one releases the mapping
+} LASDatasetPython;
+
+/**
+ * @brief Counters at the start of a traced call.
+ *
+ */
+typedef struct {
+    PyObject * callback; /// NULL when tracing was off when the call started
+    LASStats start;
+    uint64_t start_ns;
+} LASTrace;
+
+extern PyTypeObject LASHeaderPythonType;
+extern PyTypeObject LASEntryPythonType;
+extern PyTypeObject LASEntryListPythonType;
+extern PyTypeObject LASFilePythonType;
+extern PyTypeObject LASColumnPythonType;
+extern PyTypeObject LASColumnsPythonType;
+extern PyTypeObject LASDatasetPythonType;
+extern PyTypeObject LASIteratorPythonType;
+extern PyTypeObject LASWriterPythonType;
+extern PyTypeObject LASAsyncIteratorPythonType;
+extern PyTypeObject LASGridPythonType;
+extern PyTypeObject LASSharedSurveyPythonType;
+
+/**
+ * @brief Build a LASFile object from the raw records of a profile. The records are copied
+ * into a LASEntryList, nothing is decoded until a point is accessed.
+ *
+ * @param header
+ * @param entries header->number_of_point_records packed records
+ * @param fields mask of the LAS_FIELD_ values to expose, the others read as 0
+ * @return PyObject* new reference, or NULL with an exception set.
+ */
+PyObject * LASFile_FromRecords(const LASHeader * header, const LASEntry * entries, int fields);
+
+/**
+ * @brief Create a LASEntryList holding a copy of some records.
+ *
+ * @param header scale factors used to decode the records
+ * @param entries
+ * @param number_of_entries
+ * @param fields mask of the LAS_FIELD_ values to expose, the others read as 0
+ * @return LASEntryListPython* new reference, or NULL with an exception set.
+ */
+LASEntryListPython * LASEntryList_New(const LASHeader * header, const LASEntry * entries, Py_ssize_t number_of_entries, int fields);
+
+/**
+ * @brief Values of a point, decoded from its record for an entry of a LASEntryList.
+ *
+ * @param self
+ */
+void LASEntry_GetValues(LASEntryPython * self, double * x, double * y, double * z,
+                        uint16_t * intensity, uint8_t * quality, uint64_t * utc_time);
+
+/**
+ * @brief Encode the entries of a LASFile, a LASEntryList or a list of LASEntry, into the
+ * records of a profile buffer. Records of a LASEntryList are copied as they are.
+ *
+ * @param entries
+ * @param buffer zero initialised before first use, receives the records in buffer->entries
+ * @return Py_ssize_t number of records, or -1 with an exception set.
+ */
+Py_ssize_t LASEntries_Encode(PyObject * entries, LASProfileBuffer * buffer);
+
+/**
+ * @brief Convert the fields argument of the readers into a mask of LAS_FIELD_ values.
+ *
+ * @param fields None for every field, or a sequence of field names
+ * @param mask
+ * @return int 0 on success, -1 with an exception set.
+ */
+int LASFields_FromPython(PyObject * fields, int * mask);
+
+/**
+ * @brief Convert a mask of LAS_FIELD_ values back into the fields argument of the readers.
+ *
+ * @param mask
+ * @return PyObject* None for every field or a tuple of field names, NULL with an exception set.
+ */
+PyObject * LASFields_ToPython(int mask);
+
+/**
+ * @brief Fill a profile filter from the bbox and time_range arguments of the readers.
+ *
+ * @param bbox None, (min_x, min_y, max_x, max_y) or (min_x, min_y, min_z, max_x, max_y, max_z)
+ * @param time_range None or (start, end) utc times in us, either end may be None
+ * @param filter
+ * @return int 0 on success, -1 with an exception set.
+ */
+int LASProfileFilter_FromPython(PyObject * bbox, PyObject * time_range, LASProfileFilter * filter);
+
+/**
+ * @brief Build the profile offset table of a dataset if it has not been built yet.
+ *
+ * @param self
+ * @return int 0 on success, -1 with an exception set.
+ */
+int LASDataset_EnsureIndex(LASDatasetPython * self);
+
+/**
+ * @brief Build the profile offset table of a dataset and keep its mapping and table alive
+ * for an operation that releases the GIL. A close() in the meantime is deferred until
+ * LASDataset_Release is called.
+ *
+ * @param self
+ * @return int 0 on success, -1 with an exception set.
+ */
+int LASDataset_Acquire(LASDatasetPython * self);
+
+/**
+ * @brief End an operation started with LASDataset_Acquire. Call with the GIL held.
+ *
+ * @param self
+ */
+void LASDataset_Release(LASDatasetPython * self);
+
+/**
+ * @brief Create an uninitialised column.
+ *
+ * @param format struct module format character, one of d, Q, I, H or B.
+ * @param length number of elements.
+ * @return LASColumnPython* new reference, or NULL with an exception set.
+ */
+LASColumnPython * LASColumn_New(char format, Py_ssize_t length);
+
+/**
+ * @brief Create a read only column over memory kept alive by another object.
+ *
+ * @param format struct module format character, one of d, Q, I, H or B.
+ * @param data
+ * @param length number of elements.
+ * @param owner referenced by the column until it is deallocated.
+ * @return LASColumnPython* new reference, or NULL with an exception set.
+ */
+LASColumnPython * LASColumn_FromData(char format, void * data, Py_ssize_t length, PyObject * owner);
+
+/**
+ * @brief Get a one dimensional, C contiguous buffer holding elements of a column format.
+ *
+ * @param obj any object supporting the buffer protocol, e.g. a LASColumn, array.array or numpy array.
+ * @param format d, Q, H or B. Q also accepts L when it is 8 bytes.
+ * @param view released by the caller with PyBuffer_Release on success.
+ * @param name argument name used in the error message.
+ * @return int 0 on success, -1 with an exception set.
+ */
+int LASColumn_GetBuffer(PyObject * obj, char format, Py_buffer * view, const char * name);
+
+/**
+ * @brief Copy a one dimensional buffer of non negative integers of any width into a new array.
+ *
+ * @param obj any object supporting the buffer protocol
+ * @param length number of elements
+ * @param name argument name used in the error message.
+ * @return uint64_t* array owned by the caller (free), or NULL with an exception set.
+ */
+uint64_t * LASColumn_AsIndexArray(PyObject * obj, Py_ssize_t * length, const char * name);
+
+/**
+ * @brief Create a set of uninitialised columns for a survey.
+ *
+ * @param number_of_points
+ * @param number_of_profiles
+ * @param fields mask of the LAS_FIELD_ columns to allocate, the others are None
+ * @return LASColumnsPython* new reference, or NULL with an exception set.
+ */
+LASColumnsPython * LASColumns_New(Py_ssize_t number_of_points, Py_ssize_t number_of_profiles, int fields);
+
+/**
+ * @brief Point a LASColumnArrays at the storage of a column set, NULL for the point
+ * columns that are None.
+ *
+ * @param self
+ * @param arrays
+ */
+void LASColumns_GetArrays(LASColumnsPython * self, LASColumnArrays * arrays);
+
+/**
+ * @brief Get the column holding the profile index of every point, building it from the
+ * offsets the first time it is requested.
+ *
+ * @param self
+ * @return PyObject* new reference to a uint32 LASColumn, or NULL with an exception set.
+ */
+PyObject * LASColumns_GetProfileId(LASColumnsPython * self);
+
+/**
+ * @brief Arrow PyCapsule interface of LASColumns (__arrow_c_schema__, __arrow_c_array__ and
+ * __arrow_c_stream__). The exported arrays share the column storage, nothing is copied.
+ *
+ */
+PyObject * LASColumns_ArrowSchema(LASColumnsPython * self, PyObject * unused);
+PyObject * LASColumns_ArrowArray(LASColumnsPython * self, PyObject * args, PyObject * kwargs);
+PyObject * LASColumns_ArrowStream(LASColumnsPython * self, PyObject * args, PyObject * kwargs);
+
+/**
+ * @brief Check whether a file is a compressed survey.
+ *
+ * @param filename
+ * @return int 1 if it is, 0 if it is not or cannot be read.
+ */
+int LASCompressed_Check(const char * filename);
+
+/**
+ * @brief Check whether a filename has the extension write_las compresses.
+ *
+ * @param filename
+ * @return int 1 if it does, 0 otherwise.
+ */
+int LASCompressed_ExtensionMatches(const char * filename);
+
+/**
+ * @brief Read every profile of a compressed survey that passes a filter into a list of LASFiles.
+ * Profiles are decoded in batches of COMPRESS_BATCH_PROFILES on every processor.
+ *
+ * @param filename
+ * @param filter
+ * @param fields mask of the LAS_FIELD_ values the profiles expose
+ * @return PyObject* new reference, or NULL with an exception set.
+ */
+PyObject * LASCompressed_ReadFiles(const char * filename, const LASProfileFilter * filter, int fields);
+
+/**
+ * @brief Start tracing a call, a no-op unless a trace callback is set with set_trace.
+ *
+ * @param trace
+ */
+void LASTrace_Begin(LASTrace * trace);
+
+/**
+ * @brief Finish tracing a call, passing its name, duration and the counter changes to the
+ * trace callback.
+ *
+ * @param trace started with LASTrace_Begin
+ * @param name
+ * @param result result of the call, NULL if it raised
+ * @return PyObject* result, or NULL if the call or the callback raised.
+ */
+PyObject * LASTrace_End(LASTrace * trace, const char * name, PyObject * result);
+
+//-----------------------------------------------------------------
+// Methods implemented outside las_2g_python_module.c
+//-----------------------------------------------------------------
+
+PyObject * read_las_columns_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * read_many_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * write_las_columns_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * build_index_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * iter_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * read_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * write_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * iter_las_async_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * scan_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * salvage_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * profile_stats_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * share_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * attach_shared_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * load_grid_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * concat_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * extract_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * compress_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * decompress_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs);
+PyObject * stats_wrapper(PyObject * self, PyObject * Py_UNUSED(ignored));
+PyObject * reset_stats_wrapper(PyObject * self, PyObject * Py_UNUSED(ignored));
+PyObject * set_trace_wrapper(PyObject * self, PyObject * args);
+
+#endif
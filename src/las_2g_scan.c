@@ -0,0 +1,204 @@
+/**
+ * @file las_2g_scan.c
+ * @author Ryan Wicks
+ * @brief Validating header scan with resynchronisation, for salvaging damaged surveys.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_scan.h"
+#include "las_2g_simd.h"
+#include "las_2g_stats.h"
+#include <string.h>
+
+const char * const las_scan_reason_names[LAS_SCAN_NUMBER_OF_REASONS] = {
+    "good",
+    "bad signature",
+    "bad header size",
+    "bad point format",
+    "bad point count",
+    "truncated",
+    "overlapped",
+};
+
+size_t find_las_signature_scalar(const uint8_t * data, size_t size) {
+    size_t position = 0;
+    while (size - position >= 4) {
+        const uint8_t * found = (const uint8_t *)memchr(data + position, 'L', size - position - 3);
+        if (!found) {
+            break;
+        }
+        position = (size_t)(found - data);
+        if (memcmp(found, "LASF", 4) == 0) {
+            return position;
+        }
+        position += 1;
+    }
+    return size;
+}
+
+size_t find_las_signature(const uint8_t * data, size_t size) {
+    switch (las_simd_level()) {
+        case LAS_SIMD_AVX2:
+            return find_las_signature_avx2(data, size);
+        case LAS_SIMD_SSE41:
+            return find_las_signature_sse41(data, size);
+        default:
+            return find_las_signature_scalar(data, size);
+    }
+}
+
+int check_las_header(const uint8_t * data, uint64_t size, uint64_t position, uint32_t max_points, uint64_t * next) {
+    LASHeader header;
+
+    if (position + sizeof(LASHeader) > size) {
+        return LAS_SCAN_TRUNCATED;
+    }
+    memcpy(&header, data + position, sizeof(LASHeader));
+
+    if (memcmp(header.file_signature, "LASF", 4) != 0) {
+        return LAS_SCAN_BAD_SIGNATURE;
+    }
+    if (header.header_size != HEADER_SIZE || header.offset_to_point_data != HEADER_SIZE) {
+        return LAS_SCAN_BAD_HEADER_SIZE;
+    }
+    if (header.point_data_format_id != 1 || header.point_data_record_length != ENTRY_SIZE) {
+        return LAS_SCAN_BAD_FORMAT;
+    }
+    if (header.number_of_point_records > max_points) {
+        return LAS_SCAN_BAD_POINT_COUNT;
+    }
+
+    uint64_t end = position + sizeof(LASHeader) + (uint64_t)header.number_of_point_records * sizeof(LASEntry);
+    if (end > size) {
+        return LAS_SCAN_TRUNCATED;
+    }
+    *next = end;
+    return LAS_SCAN_GOOD;
+}
+
+/**
+ * @brief Offset of the first valid header starting in [from, limit), or limit if there is none.
+ */
+static uint64_t find_valid_header(const uint8_t * data, uint64_t size, uint64_t from, uint64_t limit, uint32_t max_points) {
+    uint64_t next;
+    // a signature starting just before limit ends after it.
+    uint64_t end = limit + 3 < size ? limit + 3 : size;
+
+    while (from < limit) {
+        from += find_las_signature(data + from, (size_t)(end - from));
+        if (from >= limit) {
+            break;
+        }
+        if (check_las_header(data, size, from, max_points, &next) == LAS_SCAN_GOOD) {
+            return from;
+        }
+        from += 1;
+    }
+    return limit;
+}
+
+static int has_signature(const uint8_t * data, uint64_t size, uint64_t position) {
+    return position + 4 <= size && memcmp(data + position, "LASF", 4) == 0;
+}
+
+static int add_range(LASScanReport * report, uint64_t start, uint64_t end, int reason) {
+    if (end <= start) {
+        return 0;
+    }
+    if (reason == LAS_SCAN_GOOD) {
+        report->good_bytes += end - start;
+    } else {
+        report->bad_bytes += end - start;
+    }
+
+    if (report->number_of_ranges > 0) {
+        LASByteRange * last = &report->ranges[report->number_of_ranges - 1];
+        if (last->end == start && (last->reason == LAS_SCAN_GOOD) == (reason == LAS_SCAN_GOOD)) {
+            last->end = end; // a bad range keeps the reason the chain was first lost for.
+            return 0;
+        }
+    }
+
+    if (report->number_of_ranges == report->capacity) {
+        size_t capacity = report->capacity ? 2 * report->capacity : 16;
+        LASByteRange * ranges = (LASByteRange *)realloc(report->ranges, capacity * sizeof(LASByteRange));
+        if (!ranges) {
+            return -1;
+        }
+        las_stats_allocation(capacity * sizeof(LASByteRange));
+        report->ranges = ranges;
+        report->capacity = capacity;
+    }
+    report->ranges[report->number_of_ranges].start = start;
+    report->ranges[report->number_of_ranges].end = end;
+    report->ranges[report->number_of_ranges].reason = reason;
+    report->number_of_ranges += 1;
+    return 0;
+}
+
+int scan_las_mapped(const uint8_t * data, uint64_t size, uint32_t max_points, LASScanReport * report) {
+    uint64_t position = 0;
+    uint64_t start = las_stats_clock();
+
+    init_profile_table(&report->profiles);
+    report->ranges = NULL;
+    report->number_of_ranges = 0;
+    report->capacity = 0;
+    report->good_bytes = 0;
+    report->bad_bytes = 0;
+
+    while (position < size) {
+        uint64_t next = size;
+        uint64_t found = size;
+        int reason = check_las_header(data, size, position, max_points, &next);
+
+        if (reason == LAS_SCAN_GOOD && next < size && !has_signature(data, size, next)) {
+            // the chain breaks after this profile, either its point count is wrong or it is
+            // followed by garbage.
+            found = find_valid_header(data, size, position + 1, next, max_points);
+            if (found < next) {
+                reason = LAS_SCAN_OVERLAPPED;
+            }
+        }
+
+        if (reason == LAS_SCAN_GOOD) {
+            uint32_t number_of_points = (uint32_t)((next - position - sizeof(LASHeader)) / sizeof(LASEntry));
+            if (append_profile(&report->profiles, position, number_of_points) < 0 ||
+                add_range(report, position, next, LAS_SCAN_GOOD) < 0) {
+                goto error;
+            }
+            position = next;
+            continue;
+        }
+
+        if (reason != LAS_SCAN_OVERLAPPED) {
+            found = find_valid_header(data, size, position + 1, size, max_points);
+        }
+        if (add_range(report, position, found, reason) < 0) {
+            goto error;
+        }
+        position = found;
+    }
+
+    las_stats_phase(LAS_PHASE_PARSE, start);
+    return (int)report->profiles.number_of_profiles;
+
+error:
+    free_scan_report(report);
+    las_stats_phase(LAS_PHASE_PARSE, start);
+    return -1;
+}
+
+void free_scan_report(LASScanReport * report) {
+    free_profile_table(&report->profiles);
+    free(report->ranges);
+    report->ranges = NULL;
+    report->number_of_ranges = 0;
+    report->capacity = 0;
+    report->good_bytes = 0;
+    report->bad_bytes = 0;
+}
@@ -0,0 +1,106 @@
+#ifndef LAS_2G_SCAN_H
+#define LAS_2G_SCAN_H
+
+/**
+ * @brief Validating scan of a concatenated survey. Every header is checked before it is
+ * trusted, and when the header chain is lost the scan resynchronises on the next "LASF"
+ * signature that starts a valid header, so the intact profiles of a damaged file can still
+ * be read.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define LAS_SCAN_MAX_POINTS (1u << 24) // default upper bound of a plausible point count
+
+// why a byte range is bad, LAS_SCAN_GOOD for the ranges holding intact profiles
+#define LAS_SCAN_GOOD 0
+#define LAS_SCAN_BAD_SIGNATURE 1 /// no "LASF" where a header should start
+#define LAS_SCAN_BAD_HEADER_SIZE 2 /// header_size or offset_to_point_data is not HEADER_SIZE
+#define LAS_SCAN_BAD_FORMAT 3 /// not point data format 1 with ENTRY_SIZE records
+#define LAS_SCAN_BAD_POINT_COUNT 4 /// more points than the plausible maximum
+#define LAS_SCAN_TRUNCATED 5 /// the header or its records run past the end of the file
+#define LAS_SCAN_OVERLAPPED 6 /// another valid header starts inside the records
+#define LAS_SCAN_NUMBER_OF_REASONS 7
+
+extern const char * const las_scan_reason_names[LAS_SCAN_NUMBER_OF_REASONS];
+
+/**
+ * @brief A run of bytes of the scanned file.
+ *
+ */
+typedef struct {
+    uint64_t start;
+    uint64_t end; /// exclusive
+    int reason; /// LAS_SCAN_GOOD, or the LAS_SCAN_ value of the first header check that failed
+} LASByteRange;
+
+/**
+ * @brief Result of scan_las_mapped: the intact profiles, and good and bad byte ranges that
+ * together cover the whole file in order. Neighbouring ranges of the same kind are merged.
+ *
+ */
+typedef struct {
+    LASProfileTable profiles; /// every intact profile
+    LASByteRange * ranges;
+    size_t number_of_ranges;
+    size_t capacity;
+    uint64_t good_bytes;
+    uint64_t bad_bytes;
+} LASScanReport;
+
+/**
+ * @brief Offset of the first "LASF" in a block, using the best instruction set selected by
+ * las_simd_level.
+ *
+ * @param data
+ * @param size bytes in data
+ * @return size_t offset of the signature, or size if there is none.
+ */
+size_t find_las_signature(const uint8_t * data, size_t size);
+
+/**
+ * @brief memchr based version of find_las_signature, also used by the vector kernels for
+ * the last few bytes of a block.
+ *
+ */
+size_t find_las_signature_scalar(const uint8_t * data, size_t size);
+
+/**
+ * @brief Check that a valid profile header starts at an offset of a mapped file.
+ *
+ * @param data start of the mapping
+ * @param size size of the mapping in bytes
+ * @param position offset of the header
+ * @param max_points largest plausible number_of_point_records
+ * @param next set to the offset just past the profile's records when the header is valid
+ * @return int LAS_SCAN_GOOD, or the LAS_SCAN_ value of the first check that failed.
+ */
+int check_las_header(const uint8_t * data, uint64_t size, uint64_t position, uint32_t max_points, uint64_t * next);
+
+/**
+ * @brief Walk the header chain of a mapped file, checking every header and resynchronising
+ * after corruption.
+ *
+ * A profile is intact when its header is valid and it is followed by the end of the file or
+ * by another signature. When it is followed by anything else, a valid header that starts
+ * inside its records means the point count cannot be trusted and the profile is bad; if there
+ * is none the profile is kept and the bytes after it are bad. Bad bytes are skipped up to
+ * the next valid header.
+ *
+ * @param data start of the mapping
+ * @param size size of the mapping in bytes
+ * @param max_points largest plausible number_of_point_records, e.g. LAS_SCAN_MAX_POINTS
+ * @param report filled on success. Release with free_scan_report.
+ * @return int number of intact profiles, or -1 if memory could not be allocated.
+ */
+int scan_las_mapped(const uint8_t * data, uint64_t size, uint32_t max_points, LASScanReport * report);
+
+/**
+ * @brief Release the profile table and ranges of a scan report.
+ *
+ * @param report
+ */
+void free_scan_report(LASScanReport * report);
+
+#endif
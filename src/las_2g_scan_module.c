@@ -0,0 +1,175 @@
+/**
+ * @file las_2g_scan_module.c
+ * @author Ryan Wicks
+ * @brief Python access to the validating scan, and the salvage read built on it.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_scan.h"
+
+//-----------------------------------------------------------------
+// Scan Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Map and scan a file without the GIL.
+ *
+ * @return int 0 on success, -1 with an exception set. On success the caller releases both
+ * the report and the mapping.
+ */
+static int LASScan_Run(const char * filename, unsigned long max_points, LASMappedFile * mapped, LASScanReport * report) {
+    int ret;
+
+    if (max_points > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "max_points must fit in 32 bits.");
+        return -1;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return -1;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = scan_las_mapped(mapped->data, mapped->size, (uint32_t)max_points, report);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to allocate memory for the scan.");
+        unmap_file(mapped);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Convert a scan report to a dictionary with the file size, the number of intact
+ * profiles and their points, the good and bad byte counts, a "good" list of (start, end)
+ * ranges and a "bad" list of (start, end, reason) ranges.
+ */
+static PyObject * LASScanReport_ToDict(const LASScanReport * report, uint64_t size) {
+    PyObject * good = PyList_New(0);
+    PyObject * bad = PyList_New(0);
+    if (!good || !bad) {
+        goto error;
+    }
+
+    for (size_t i = 0; i < report->number_of_ranges; ++i) {
+        const LASByteRange * range = &report->ranges[i];
+        PyObject * item;
+        int ret;
+        if (range->reason == LAS_SCAN_GOOD) {
+            item = Py_BuildValue("(KK)", (unsigned long long)range->start, (unsigned long long)range->end);
+            ret = item ? PyList_Append(good, item) : -1;
+        } else {
+            item = Py_BuildValue("(KKs)", (unsigned long long)range->start, (unsigned long long)range->end,
+                                 las_scan_reason_names[range->reason]);
+            ret = item ? PyList_Append(bad, item) : -1;
+        }
+        Py_XDECREF(item);
+        if (ret < 0) {
+            goto error;
+        }
+    }
+
+    PyObject * dict = Py_BuildValue("{s:K,s:n,s:K,s:K,s:K,s:O,s:O}",
+                                    "size", (unsigned long long)size,
+                                    "profiles", (Py_ssize_t)report->profiles.number_of_profiles,
+                                    "points", (unsigned long long)report->profiles.number_of_points,
+                                    "good_bytes", (unsigned long long)report->good_bytes,
+                                    "bad_bytes", (unsigned long long)report->bad_bytes,
+                                    "good", good,
+                                    "bad", bad);
+    Py_DECREF(good);
+    Py_DECREF(bad);
+    return dict;
+
+error:
+    Py_XDECREF(good);
+    Py_XDECREF(bad);
+    return NULL;
+}
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * scan_las_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "max_points", NULL};
+    char * filename;
+    unsigned long max_points = LAS_SCAN_MAX_POINTS;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|k", keywords, &filename, &max_points)) {
+        return NULL;
+    }
+
+    LASMappedFile mapped;
+    LASScanReport report;
+    if (LASScan_Run(filename, max_points, &mapped, &report) < 0) {
+        return NULL;
+    }
+
+    PyObject * dict = LASScanReport_ToDict(&report, mapped.size);
+    free_scan_report(&report);
+    unmap_file(&mapped);
+    return dict;
+}
+
+PyObject * scan_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "scan_las", scan_las_call(self, args, kwargs));
+}
+
+static PyObject * salvage_las_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "fields", "max_points", NULL};
+    char * filename;
+    PyObject * fields_object = Py_None;
+    unsigned long max_points = LAS_SCAN_MAX_POINTS;
+    int fields;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|Ok", keywords, &filename, &fields_object, &max_points)) {
+        return NULL;
+    }
+    if (LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+
+    LASMappedFile mapped;
+    LASScanReport report;
+    if (LASScan_Run(filename, max_points, &mapped, &report) < 0) {
+        return NULL;
+    }
+
+    PyObject * data_list = PyList_New((Py_ssize_t)report.profiles.number_of_profiles);
+    for (size_t i = 0; data_list && i < report.profiles.number_of_profiles; ++i) {
+        const uint8_t * profile = mapped.data + report.profiles.offsets[i];
+        LASHeader header;
+        memcpy(&header, profile, sizeof(LASHeader));
+
+        PyObject * file_entry = LASFile_FromRecords(&header, (const LASEntry *)(profile + sizeof(LASHeader)), fields);
+        if (!file_entry) {
+            Py_CLEAR(data_list);
+            break;
+        }
+        PyList_SET_ITEM(data_list, (Py_ssize_t)i, file_entry);
+    }
+
+    free_scan_report(&report);
+    unmap_file(&mapped);
+    return data_list;
+}
+
+PyObject * salvage_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "salvage_las", salvage_las_call(self, args, kwargs));
+}
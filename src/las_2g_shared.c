@@ -0,0 +1,499 @@
+/**
+ * @file las_2g_shared.c
+ * @author Ryan Wicks
+ * @brief Surveys held in named shared memory segments.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_shared.h"
+#include "las_2g_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const int shared_column_fields[SHARED_COLUMNS] = {
+    LAS_FIELD_X, LAS_FIELD_Y, LAS_FIELD_Z, LAS_FIELD_INTENSITY, LAS_FIELD_QUALITY, LAS_FIELD_UTC_TIME, 0, 0,
+};
+
+static const uint64_t shared_column_sizes[SHARED_COLUMNS] = {
+    sizeof(double), sizeof(double), sizeof(double), sizeof(uint16_t), sizeof(uint8_t), sizeof(uint64_t),
+    sizeof(uint64_t), sizeof(uint64_t),
+};
+
+//-----------------------------------------------------------------
+// Platform Definitions
+//-----------------------------------------------------------------
+
+static int shared_name_valid(const char * name) {
+    size_t length = strlen(name);
+    return length > 0 && length < SHARED_NAME_MAX && strchr(name, '/') == NULL && strchr(name, '\\') == NULL;
+}
+
+#ifdef _WIN32
+static uint32_t shared_process_id(void) {
+    return (uint32_t)GetCurrentProcessId();
+}
+
+static int shared_process_alive(uint32_t process_id) {
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)process_id);
+    if (process == NULL) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    int alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+}
+
+static void shared_yield(void) {
+    SwitchToThread();
+}
+
+static uint64_t shared_page_size(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint64_t)info.dwAllocationGranularity;
+}
+
+static int shared_compare_exchange(uint32_t * target, uint32_t * expected, uint32_t value) {
+    LONG seen = InterlockedCompareExchange((volatile LONG *)target, (LONG)value, (LONG)*expected);
+    if ((uint32_t)seen == *expected) {
+        return 1;
+    }
+    *expected = (uint32_t)seen;
+    return 0;
+}
+
+static uint32_t shared_load(const uint32_t * value) {
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+}
+
+static void shared_store(uint32_t * target, uint32_t value) {
+    InterlockedExchange((volatile LONG *)target, (LONG)value);
+}
+
+static uint32_t shared_fetch_increment(uint32_t * target) {
+    return (uint32_t)InterlockedIncrement((volatile LONG *)target) - 1;
+}
+
+static void shared_protect(LASSharedSurvey * shared) {
+    DWORD previous;
+    LASSharedHeader * header = shared->header;
+    if (header->size > header->data_offset) {
+        VirtualProtect((uint8_t *)header + header->data_offset, (SIZE_T)(header->size - header->data_offset),
+                       PAGE_READONLY, &previous);
+    }
+}
+
+static int shared_map(const char * name, uint64_t size, int create, LASSharedSurvey * shared) {
+    HANDLE mapping;
+    if (create) {
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                     (DWORD)(size >> 32), (DWORD)size, name);
+        if (mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS) {
+            CloseHandle(mapping);
+            return SHARED_ERROR_EXISTS;
+        }
+    } else {
+        mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+        if (mapping == NULL && GetLastError() == ERROR_FILE_NOT_FOUND) {
+            return SHARED_ERROR_MISSING;
+        }
+    }
+    if (mapping == NULL) {
+        return SHARED_ERROR_SYSTEM;
+    }
+
+    void * data = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return SHARED_ERROR_SYSTEM;
+    }
+    if (!create) {
+        MEMORY_BASIC_INFORMATION info;
+        if (VirtualQuery(data, &info, sizeof(info)) == 0 || info.RegionSize < sizeof(LASSharedHeader)) {
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+            return SHARED_ERROR_INVALID;
+        }
+    }
+    shared->header = (LASSharedHeader *)data;
+    shared->mapping_handle = mapping;
+    return 0;
+}
+
+static void shared_unmap(LASSharedSurvey * shared, int remove) {
+    // the kernel removes the segment with its last mapping handle.
+    (void)remove;
+    UnmapViewOfFile(shared->header);
+    CloseHandle((HANDLE)shared->mapping_handle);
+    shared->mapping_handle = NULL;
+}
+#else
+static uint32_t shared_process_id(void) {
+    return (uint32_t)getpid();
+}
+
+static int shared_process_alive(uint32_t process_id) {
+    return kill((pid_t)process_id, 0) == 0 || errno == EPERM;
+}
+
+static void shared_yield(void) {
+    sched_yield();
+}
+
+static uint64_t shared_page_size(void) {
+    return (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+static int shared_compare_exchange(uint32_t * target, uint32_t * expected, uint32_t value) {
+    return __atomic_compare_exchange_n(target, expected, value, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static uint32_t shared_load(const uint32_t * value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void shared_store(uint32_t * target, uint32_t value) {
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+}
+
+static uint32_t shared_fetch_increment(uint32_t * target) {
+    return __atomic_fetch_add(target, 1, __ATOMIC_RELAXED);
+}
+
+static void shared_protect(LASSharedSurvey * shared) {
+    LASSharedHeader * header = shared->header;
+    if (header->size > header->data_offset) {
+        mprotect((uint8_t *)header + header->data_offset, (size_t)(header->size - header->data_offset), PROT_READ);
+    }
+}
+
+static void shared_path(const char * name, char * path) {
+    snprintf(path, SHARED_NAME_MAX + 1, "/%s", name);
+}
+
+static int shared_map(const char * name, uint64_t size, int create, LASSharedSurvey * shared) {
+    char path[SHARED_NAME_MAX + 1];
+    struct stat segment_stat;
+
+    shared_path(name, path);
+    int fd = shm_open(path, create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            return SHARED_ERROR_EXISTS;
+        }
+        return errno == ENOENT ? SHARED_ERROR_MISSING : SHARED_ERROR_SYSTEM;
+    }
+
+    int ret = 0;
+    if (create) {
+        if (ftruncate(fd, (off_t)size) != 0) {
+            ret = SHARED_ERROR_SYSTEM;
+        }
+    } else if (fstat(fd, &segment_stat) != 0) {
+        ret = SHARED_ERROR_SYSTEM;
+    } else if ((uint64_t)segment_stat.st_size < sizeof(LASSharedHeader)) {
+        ret = SHARED_ERROR_INVALID;
+    } else {
+        size = (uint64_t)segment_stat.st_size;
+    }
+
+    void * data = MAP_FAILED;
+    if (ret == 0) {
+        data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ret = SHARED_ERROR_SYSTEM;
+        }
+    }
+    close(fd); // the mapping keeps its own reference to the segment.
+    if (ret < 0) {
+        if (create) {
+            shm_unlink(path);
+        }
+        return ret;
+    }
+
+    shared->header = (LASSharedHeader *)data;
+    if (!create && shared->header->size != size) {
+        munmap(data, (size_t)size);
+        return SHARED_ERROR_INVALID;
+    }
+    return 0;
+}
+
+static void shared_unmap(LASSharedSurvey * shared, int remove) {
+    if (remove) {
+        char path[SHARED_NAME_MAX + 1];
+        shared_path(shared->name, path);
+        shm_unlink(path);
+    }
+    munmap(shared->header, (size_t)shared->header->size);
+}
+#endif
+
+//-----------------------------------------------------------------
+// Process Table Definitions
+//-----------------------------------------------------------------
+
+static void shared_lock(LASSharedHeader * header) {
+    uint32_t process_id = shared_process_id();
+    for (;;) {
+        uint32_t holder = 0;
+        if (shared_compare_exchange(&header->lock, &holder, process_id)) {
+            return;
+        }
+        // a process killed while holding the lock never releases it.
+        if (!shared_process_alive(holder) && shared_compare_exchange(&header->lock, &holder, process_id)) {
+            return;
+        }
+        shared_yield();
+    }
+}
+
+static void shared_unlock(LASSharedHeader * header) {
+    shared_store(&header->lock, 0);
+}
+
+/**
+ * @brief Count the handles of the running processes, freeing the slots of the others.
+ * Called with the lock held.
+ */
+static uint32_t shared_count_handles(LASSharedHeader * header) {
+    uint32_t handles = 0;
+    for (int slot = 0; slot < SHARED_MAX_PROCESSES; ++slot) {
+        LASSharedProcess * process = &header->processes[slot];
+        if (process->handles == 0) {
+            continue;
+        }
+        if (!shared_process_alive(process->process_id)) {
+            process->process_id = 0;
+            process->handles = 0;
+            continue;
+        }
+        handles += process->handles;
+    }
+    return handles;
+}
+
+/**
+ * @brief Add a handle of this process. Called with the lock held, after
+ * shared_count_handles has freed the slots of exited processes.
+ */
+static int shared_add_handle(LASSharedHeader * header, uint32_t process_id) {
+    LASSharedProcess * free_slot = NULL;
+    for (int slot = 0; slot < SHARED_MAX_PROCESSES; ++slot) {
+        LASSharedProcess * process = &header->processes[slot];
+        if (process->handles != 0 && process->process_id == process_id) {
+            process->handles += 1;
+            return 0;
+        }
+        if (process->handles == 0 && free_slot == NULL) {
+            free_slot = process;
+        }
+    }
+    if (free_slot == NULL) {
+        return SHARED_ERROR_PROCESSES;
+    }
+    free_slot->process_id = process_id;
+    free_slot->handles = 1;
+    return 0;
+}
+
+static void shared_remove_handle(LASSharedHeader * header, uint32_t process_id) {
+    for (int slot = 0; slot < SHARED_MAX_PROCESSES; ++slot) {
+        LASSharedProcess * process = &header->processes[slot];
+        if (process->handles != 0 && process->process_id == process_id) {
+            process->handles -= 1;
+            if (process->handles == 0) {
+                process->process_id = 0;
+            }
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------
+// Shared Survey Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Point the columns of a handle at the segment, NULL for the columns not held.
+ */
+static void shared_set_columns(LASSharedSurvey * shared) {
+    uint8_t * base = (uint8_t *)shared->header;
+    void * columns[SHARED_COLUMNS];
+    for (int column = 0; column < SHARED_COLUMNS; ++column) {
+        uint64_t offset = shared->header->column_offsets[column];
+        columns[column] = offset != 0 ? base + offset : NULL;
+    }
+    shared->columns.x = (double *)columns[SHARED_COLUMN_X];
+    shared->columns.y = (double *)columns[SHARED_COLUMN_Y];
+    shared->columns.z = (double *)columns[SHARED_COLUMN_Z];
+    shared->columns.intensity = (uint16_t *)columns[SHARED_COLUMN_INTENSITY];
+    shared->columns.quality = (uint8_t *)columns[SHARED_COLUMN_QUALITY];
+    shared->columns.utc_time = (uint64_t *)columns[SHARED_COLUMN_UTC_TIME];
+    shared->columns.offsets = (uint64_t *)columns[SHARED_COLUMN_OFFSETS];
+    shared->columns.profile_time = (uint64_t *)columns[SHARED_COLUMN_PROFILE_TIME];
+}
+
+/**
+ * @brief Check the header of an attached segment against its size.
+ */
+static int shared_header_valid(const LASSharedHeader * header) {
+    if (memcmp(header->signature, SHARED_SIGNATURE, sizeof(header->signature)) != 0 ||
+        header->version != SHARED_VERSION ||
+        header->data_offset < sizeof(LASSharedHeader) ||
+        header->data_offset % shared_page_size() != 0 ||
+        header->number_of_points > header->size ||
+        header->number_of_profiles > header->size) {
+        return 0;
+    }
+    for (int column = 0; column < SHARED_COLUMNS; ++column) {
+        uint64_t offset = header->column_offsets[column];
+        uint64_t length = column == SHARED_COLUMN_OFFSETS ? header->number_of_profiles + 1 :
+                          column == SHARED_COLUMN_PROFILE_TIME ? header->number_of_profiles : header->number_of_points;
+        int held = shared_column_fields[column] == 0 || (header->fields & shared_column_fields[column]);
+        if (held != (offset != 0)) {
+            return 0;
+        }
+        if (held && (offset < header->data_offset || offset > header->size ||
+                     length * shared_column_sizes[column] > header->size - offset)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int create_shared_survey(const char * name, uint64_t number_of_points, uint64_t number_of_profiles,
+                         int fields, LASSharedSurvey * shared) {
+    static uint32_t counter = 0; // callers run without the GIL, so it is only changed atomically
+    if (name == NULL) {
+        // a segment left by a process that exited with the same id may hold a generated name.
+        int ret = SHARED_ERROR_EXISTS;
+        char generated[SHARED_NAME_MAX];
+        for (int attempt = 0; attempt < SHARED_NAME_ATTEMPTS && ret == SHARED_ERROR_EXISTS; ++attempt) {
+            snprintf(generated, SHARED_NAME_MAX, "las2g_%lu_%u", (unsigned long)shared_process_id(),
+                     (unsigned)shared_fetch_increment(&counter));
+            ret = create_shared_survey(generated, number_of_points, number_of_profiles, fields, shared);
+        }
+        return ret;
+    }
+
+    memset(shared, 0, sizeof(LASSharedSurvey));
+    if (!shared_name_valid(name)) {
+        return SHARED_ERROR_NAME;
+    }
+    strcpy(shared->name, name);
+
+    LASSharedHeader header;
+    memset(&header, 0, sizeof(LASSharedHeader));
+    memcpy(header.signature, SHARED_SIGNATURE, sizeof(header.signature));
+    header.version = SHARED_VERSION;
+    header.fields = (uint32_t)fields & (LAS_FIELD_X | LAS_FIELD_Y | LAS_FIELD_Z | LAS_FIELD_INTENSITY |
+                                         LAS_FIELD_QUALITY | LAS_FIELD_UTC_TIME);
+    header.number_of_points = number_of_points;
+    header.number_of_profiles = number_of_profiles;
+    shared->process_id = shared_process_id();
+    header.processes[0].process_id = shared->process_id;
+    header.processes[0].handles = 1;
+
+    // the header gets the first page to itself so only the columns are protected.
+    uint64_t page_size = shared_page_size();
+    header.data_offset = (sizeof(LASSharedHeader) + page_size - 1) / page_size * page_size;
+    uint64_t size = header.data_offset;
+    for (int column = 0; column < SHARED_COLUMNS; ++column) {
+        if (shared_column_fields[column] != 0 && !(header.fields & shared_column_fields[column])) {
+            continue;
+        }
+        uint64_t length = column == SHARED_COLUMN_OFFSETS ? number_of_profiles + 1 :
+                          column == SHARED_COLUMN_PROFILE_TIME ? number_of_profiles : number_of_points;
+        size = (size + SHARED_ALIGNMENT - 1) / SHARED_ALIGNMENT * SHARED_ALIGNMENT;
+        header.column_offsets[column] = size;
+        size += length * shared_column_sizes[column];
+    }
+    header.size = size;
+
+    int ret = shared_map(shared->name, size, 1, shared);
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(shared->header, &header, sizeof(LASSharedHeader));
+    shared_set_columns(shared);
+    las_stats_allocation(size);
+    return 0;
+}
+
+void seal_shared_survey(LASSharedSurvey * shared) {
+    shared_protect(shared);
+    shared_store(&shared->header->ready, 1);
+}
+
+int attach_shared_survey(const char * name, LASSharedSurvey * shared) {
+    memset(shared, 0, sizeof(LASSharedSurvey));
+    if (!shared_name_valid(name)) {
+        return SHARED_ERROR_NAME;
+    }
+    strcpy(shared->name, name);
+
+    int ret = shared_map(name, 0, 0, shared);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!shared_header_valid(shared->header) || !shared_load(&shared->header->ready)) {
+        shared_unmap(shared, 0);
+        return SHARED_ERROR_INVALID;
+    }
+
+    // never revive a segment whose last handle has gone, it is already being removed.
+    shared->process_id = shared_process_id();
+    shared_lock(shared->header);
+    ret = shared_count_handles(shared->header) == 0 ? SHARED_ERROR_MISSING :
+          shared_add_handle(shared->header, shared->process_id);
+    shared_unlock(shared->header);
+    if (ret < 0) {
+        shared_unmap(shared, 0);
+        return ret;
+    }
+
+    shared_protect(shared);
+    shared_set_columns(shared);
+    return 0;
+}
+
+void detach_shared_survey(LASSharedSurvey * shared) {
+    if (shared->header == NULL) {
+        return;
+    }
+    // a forked child inherits the mapping but not the handle.
+    int last = 0;
+    if (shared->process_id == shared_process_id()) {
+        shared_lock(shared->header);
+        shared_remove_handle(shared->header, shared->process_id);
+        last = shared_count_handles(shared->header) == 0;
+        shared_unlock(shared->header);
+    }
+    shared_unmap(shared, last);
+    memset(shared, 0, sizeof(LASSharedSurvey));
+}
+
+uint32_t shared_survey_handles(LASSharedSurvey * shared) {
+    shared_lock(shared->header);
+    uint32_t handles = shared_count_handles(shared->header);
+    shared_unlock(shared->header);
+    return handles;
+}
@@ -0,0 +1,131 @@
+#ifndef LAS_2G_SHARED_H
+#define LAS_2G_SHARED_H
+
+/**
+ * @brief A survey loaded once into a named shared memory segment so other processes can
+ * attach to its columns without reading the file or copying the points. The segment holds
+ * a header followed by the point columns and the profile offsets and times. The handles
+ * every process holds are counted in the header, and the segment is removed when the last
+ * one is released. Processes that exit without releasing theirs, as pool workers that are
+ * terminated do, are not counted.
+ *
+ */
+
+#include "las_2g_python.h"
+
+#define SHARED_SIGNATURE "LAS2GSHM"
+#define SHARED_VERSION 1
+#define SHARED_NAME_MAX 64 // bytes of a segment name, including the terminator
+#define SHARED_ALIGNMENT 64 // of every column in the segment
+#define SHARED_MAX_PROCESSES 256 // processes that can hold handles on a segment at once
+#define SHARED_NAME_ATTEMPTS 16 // generated names tried before create_shared_survey gives up
+
+// errors of create_shared_survey and attach_shared_survey
+#define SHARED_ERROR_SYSTEM -1 /// the segment could not be created, sized or mapped
+#define SHARED_ERROR_EXISTS -2 /// a segment with the name already exists
+#define SHARED_ERROR_MISSING -3 /// there is no segment with the name, or it is being removed
+#define SHARED_ERROR_INVALID -4 /// the segment does not hold a survey, or it is not filled yet
+#define SHARED_ERROR_NAME -5 /// the name is empty, too long or contains a '/'
+#define SHARED_ERROR_PROCESSES -6 /// SHARED_MAX_PROCESSES processes already hold handles
+
+typedef enum {
+    SHARED_COLUMN_X,
+    SHARED_COLUMN_Y,
+    SHARED_COLUMN_Z,
+    SHARED_COLUMN_INTENSITY,
+    SHARED_COLUMN_QUALITY,
+    SHARED_COLUMN_UTC_TIME,
+    SHARED_COLUMN_OFFSETS,
+    SHARED_COLUMN_PROFILE_TIME,
+    SHARED_COLUMNS
+} LASSharedColumn;
+
+/**
+ * @brief Handles one process holds on a segment.
+ *
+ */
+typedef struct {
+    uint32_t process_id; /// 0 for a free slot
+    uint32_t handles;
+} LASSharedProcess;
+
+/**
+ * @brief Fixed header at the start of a segment, alone in the first page so the columns
+ * can be protected read only while the process table stays writable.
+ *
+ */
+typedef struct {
+    char signature[8];
+    uint32_t version;
+    uint32_t fields; /// mask of the LAS_FIELD_ columns held
+    uint64_t number_of_points;
+    uint64_t number_of_profiles;
+    uint64_t size; /// bytes of the whole segment
+    uint64_t data_offset; /// start of the first column, a multiple of the page size
+    uint64_t column_offsets[SHARED_COLUMNS]; /// from the start of the segment, 0 for a column not held
+    uint32_t lock; /// process id of the process changing processes, 0 when free
+    uint32_t ready; /// set once the creator has filled the columns
+    LASSharedProcess processes[SHARED_MAX_PROCESSES];
+} LASSharedHeader;
+
+/**
+ * @brief One handle on a segment, mapped into this process.
+ *
+ */
+typedef struct {
+    LASSharedHeader * header; /// start of the mapping
+    LASColumnArrays columns; /// point columns not held are NULL
+    char name[SHARED_NAME_MAX];
+    uint32_t process_id; /// process the handle was taken by, a forked child does not own it
+#ifdef _WIN32
+    void * mapping_handle;
+#endif
+} LASSharedSurvey;
+
+/**
+ * @brief Create a segment sized for a survey and take the first handle on it. The columns
+ * are writable until seal_shared_survey is called, and other processes cannot attach before.
+ *
+ * @param name segment name, or NULL to make one up from the process id and a counter, trying
+ * the next one while a segment with the name already exists
+ * @param number_of_points
+ * @param number_of_profiles
+ * @param fields mask of the LAS_FIELD_ columns to hold
+ * @param shared filled on success, release with detach_shared_survey.
+ * @return int 0 on success, or one of the SHARED_ERROR_ values.
+ */
+int create_shared_survey(const char * name, uint64_t number_of_points, uint64_t number_of_profiles,
+                         int fields, LASSharedSurvey * shared);
+
+/**
+ * @brief Make the columns of a created segment read only and let other processes attach.
+ *
+ * @param shared
+ */
+void seal_shared_survey(LASSharedSurvey * shared);
+
+/**
+ * @brief Take a handle on an existing segment. The columns are mapped read only.
+ *
+ * @param name
+ * @param shared filled on success, release with detach_shared_survey.
+ * @return int 0 on success, or one of the SHARED_ERROR_ values.
+ */
+int attach_shared_survey(const char * name, LASSharedSurvey * shared);
+
+/**
+ * @brief Release a handle, removing the segment if it was the last one.
+ *
+ * @param shared
+ */
+void detach_shared_survey(LASSharedSurvey * shared);
+
+/**
+ * @brief Number of handles open on a segment in every running process.
+ *
+ * @param shared
+ * @return uint32_t
+ */
+uint32_t shared_survey_handles(LASSharedSurvey * shared);
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * @file las_2g_shared_module.c
+ * @author Ryan Wicks
+ * @brief Python handles on surveys held in shared memory.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_shared.h"
+
+#define SHARED_CAPSULE_NAME "las_2g.shared_survey"
+
+/**
+ * @brief A handle on a survey held in shared memory. The columns are views of the segment
+ * and each holds the mapping, so they stay valid after the handle is closed.
+ *
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject * mapping; //capsule holding the LASSharedSurvey, NULL once closed
+    PyObject * columns; //LASColumnsPython over the segment, NULL once closed
+} LASSharedSurveyPython;
+
+//-----------------------------------------------------------------
+// LASSharedSurvey Definitions
+//-----------------------------------------------------------------
+
+/**
+ * @brief Raise the exception matching a SHARED_ERROR_ value.
+ */
+static void LASShared_SetError(int error, const char * name) {
+    switch (error) {
+        case SHARED_ERROR_EXISTS:
+            PyErr_Format(PyExc_FileExistsError, "Shared survey %s already exists.", name);
+            break;
+        case SHARED_ERROR_MISSING:
+            PyErr_Format(PyExc_FileNotFoundError, "No shared survey named %s.", name);
+            break;
+        case SHARED_ERROR_INVALID:
+            PyErr_Format(PyExc_ValueError, "%s is not a shared survey.", name);
+            break;
+        case SHARED_ERROR_NAME:
+            PyErr_Format(PyExc_ValueError, "Shared survey names must be 1 to %d characters without '/'.", SHARED_NAME_MAX - 1);
+            break;
+        default:
+            PyErr_SetString(PyExc_OSError, "Failed to create or map the shared memory segment.");
+            break;
+    }
+}
+
+static void LASShared_capsule_destructor(PyObject * capsule) {
+    LASSharedSurvey * shared = (LASSharedSurvey *) PyCapsule_GetPointer(capsule, SHARED_CAPSULE_NAME);
+    detach_shared_survey(shared);
+    free(shared);
+}
+
+static PyObject * LASShared_column(char format, void * data, uint64_t length, PyObject * mapping) {
+    if (data == NULL) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return (PyObject *) LASColumn_FromData(format, data, (Py_ssize_t) length, mapping);
+}
+
+/**
+ * @brief Wrap a sealed or attached handle. The handle is detached if this fails.
+ *
+ * @return PyObject* new reference, or NULL with an exception set.
+ */
+static PyObject * LASSharedSurvey_FromHandle(LASSharedSurvey * handle) {
+    LASSharedSurvey * shared = (LASSharedSurvey *) malloc(sizeof(LASSharedSurvey));
+    if (!shared) {
+        detach_shared_survey(handle);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory for shared survey.");
+        return NULL;
+    }
+    *shared = *handle;
+
+    PyObject * mapping = PyCapsule_New(shared, SHARED_CAPSULE_NAME, LASShared_capsule_destructor);
+    if (!mapping) {
+        detach_shared_survey(shared);
+        free(shared);
+        return NULL;
+    }
+
+    const LASSharedHeader * header = shared->header;
+    const LASColumnArrays * arrays = &shared->columns;
+    LASSharedSurveyPython * self = (LASSharedSurveyPython *) LASSharedSurveyPythonType.tp_alloc(&LASSharedSurveyPythonType, 0);
+    LASColumnsPython * columns = (LASColumnsPython *) LASColumnsPythonType.tp_alloc(&LASColumnsPythonType, 0);
+    if (!self || !columns ||
+        !(columns->x = LASShared_column('d', arrays->x, header->number_of_points, mapping)) ||
+        !(columns->y = LASShared_column('d', arrays->y, header->number_of_points, mapping)) ||
+        !(columns->z = LASShared_column('d', arrays->z, header->number_of_points, mapping)) ||
+        !(columns->intensity = LASShared_column('H', arrays->intensity, header->number_of_points, mapping)) ||
+        !(columns->quality = LASShared_column('B', arrays->quality, header->number_of_points, mapping)) ||
+        !(columns->utc_time = LASShared_column('Q', arrays->utc_time, header->number_of_points, mapping)) ||
+        !(columns->offsets = LASShared_column('Q', arrays->offsets, header->number_of_profiles + 1, mapping)) ||
+        !(columns->profile_time = LASShared_column('Q', arrays->profile_time, header->number_of_profiles, mapping))) {
+        Py_XDECREF(self);
+        Py_XDECREF(columns);
+        Py_DECREF(mapping);
+        return NULL;
+    }
+
+    self->mapping = mapping;
+    self->columns = (PyObject *) columns;
+    return (PyObject *) self;
+}
+
+static LASSharedSurvey * LASSharedSurvey_handle(LASSharedSurveyPython * self) {
+    if (!self->mapping) {
+        PyErr_SetString(PyExc_ValueError, "Operation on closed LASSharedSurvey.");
+        return NULL;
+    }
+    return (LASSharedSurvey *) PyCapsule_GetPointer(self->mapping, SHARED_CAPSULE_NAME);
+}
+
+static void LASSharedSurvey_release(LASSharedSurveyPython * self) {
+    Py_CLEAR(self->columns);
+    Py_CLEAR(self->mapping);
+}
+
+static void LASSharedSurvey_dealloc(LASSharedSurveyPython * self) {
+    LASSharedSurvey_release(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject * LASSharedSurvey_get_name(LASSharedSurveyPython * self, void * closure) {
+    LASSharedSurvey * shared = LASSharedSurvey_handle(self);
+    return shared ? PyUnicode_FromString(shared->name) : NULL;
+}
+
+static PyObject * LASSharedSurvey_get_columns(LASSharedSurveyPython * self, void * closure) {
+    if (!LASSharedSurvey_handle(self)) {
+        return NULL;
+    }
+    Py_INCREF(self->columns);
+    return self->columns;
+}
+
+static PyObject * LASSharedSurvey_get_number_of_points(LASSharedSurveyPython * self, void * closure) {
+    LASSharedSurvey * shared = LASSharedSurvey_handle(self);
+    return shared ? PyLong_FromUnsignedLongLong(shared->header->number_of_points) : NULL;
+}
+
+static PyObject * LASSharedSurvey_get_number_of_profiles(LASSharedSurveyPython * self, void * closure) {
+    LASSharedSurvey * shared = LASSharedSurvey_handle(self);
+    return shared ? PyLong_FromUnsignedLongLong(shared->header->number_of_profiles) : NULL;
+}
+
+static PyObject * LASSharedSurvey_get_handles(LASSharedSurveyPython * self, void * closure) {
+    LASSharedSurvey * shared = LASSharedSurvey_handle(self);
+    return shared ? PyLong_FromUnsignedLong(shared_survey_handles(shared)) : NULL;
+}
+
+static PyObject * LASSharedSurvey_get_closed(LASSharedSurveyPython * self, void * closure) {
+    return PyBool_FromLong(self->mapping == NULL);
+}
+
+static PyObject * LASSharedSurvey_close(LASSharedSurveyPython * self, PyObject * Py_UNUSED(ignored)) {
+    LASSharedSurvey_release(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASSharedSurvey_enter(LASSharedSurveyPython * self, PyObject * Py_UNUSED(ignored)) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject * LASSharedSurvey_exit(LASSharedSurveyPython * self, PyObject * args) {
+    LASSharedSurvey_release(self);
+    Py_RETURN_FALSE;
+}
+
+static PyObject * LASSharedSurvey_reduce(LASSharedSurveyPython * self, PyObject * Py_UNUSED(ignored)) {
+    // only the name is pickled, the receiving process attaches to the segment.
+    LASSharedSurvey * shared = LASSharedSurvey_handle(self);
+    if (!shared) {
+        return NULL;
+    }
+    PyObject * module = PyImport_ImportModule("las_2g");
+    if (!module) {
+        return NULL;
+    }
+    PyObject * attach = PyObject_GetAttrString(module, "attach_shared");
+    Py_DECREF(module);
+    if (!attach) {
+        return NULL;
+    }
+    return Py_BuildValue("(N(s))", attach, shared->name);
+}
+
+static PyMethodDef LASSharedSurvey_methods[] = {
+    {"close", (PyCFunction) LASSharedSurvey_close, METH_NOARGS,
+        "Release this handle. The segment is removed once every handle in every process is\n"
+        "released; columns already taken from the handle keep it mapped until they are freed."},
+    {"__enter__", (PyCFunction) LASSharedSurvey_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction) LASSharedSurvey_exit, METH_VARARGS, NULL},
+    {"__reduce__", (PyCFunction) LASSharedSurvey_reduce, METH_NOARGS, NULL},
+    {NULL} //sentinel
+};
+
+static PyGetSetDef LASSharedSurvey_getset[] = {
+    {"name", (getter) LASSharedSurvey_get_name, NULL, "Name of the shared memory segment, passed to attach_shared.", NULL},
+    {"columns", (getter) LASSharedSurvey_get_columns, NULL, "Read only LASColumns over the segment.", NULL},
+    {"number_of_points", (getter) LASSharedSurvey_get_number_of_points, NULL, "Number of points in the survey.", NULL},
+    {"number_of_profiles", (getter) LASSharedSurvey_get_number_of_profiles, NULL, "Number of profiles in the survey.", NULL},
+    {"handles", (getter) LASSharedSurvey_get_handles, NULL, "Number of handles open on the segment in every process.", NULL},
+    {"closed", (getter) LASSharedSurvey_get_closed, NULL, "True once the handle has been closed.", NULL},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASSharedSurveyPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASSharedSurvey",
+    .tp_doc = "A handle on a survey held in a shared memory segment, made by share_las or\n"
+              "attach_shared. The columns are read only views of the segment, nothing is copied.\n"
+              "Pickling a handle pickles its name, so passing it to a multiprocessing worker\n"
+              "attaches the worker to the same segment.",
+    .tp_basicsize = sizeof(LASSharedSurveyPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) LASSharedSurvey_dealloc,
+    .tp_methods = LASSharedSurvey_methods,
+    .tp_getset = LASSharedSurvey_getset,
+};
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+static PyObject * share_las_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "name", "threads", "fields", NULL};
+    char * filename;
+    char * name = NULL;
+    int threads = 0;
+    PyObject * fields_object = Py_None;
+    int fields;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|ziO", keywords, &filename, &name, &threads, &fields_object)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative.");
+        return NULL;
+    }
+    if (LASFields_FromPython(fields_object, &fields) < 0) {
+        return NULL;
+    }
+
+    LASMappedFile mapped;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = map_file(filename, &mapped);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open LAS file.\n");
+        return NULL;
+    }
+
+    LASProfileTable table;
+    Py_BEGIN_ALLOW_THREADS
+    ret = scan_profiles_mapped(mapped.data, mapped.size, &table);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Could not load entry from file.");
+        unmap_file(&mapped);
+        return NULL;
+    }
+
+    // the points are decoded straight into the segment.
+    LASSharedSurvey shared;
+    Py_BEGIN_ALLOW_THREADS
+    ret = create_shared_survey(name, table.number_of_points, table.number_of_profiles, fields, &shared);
+    if (ret == 0) {
+        read_columns_mapped(mapped.data, &table, &shared.columns, threads);
+        seal_shared_survey(&shared);
+    }
+    Py_END_ALLOW_THREADS
+    free_profile_table(&table);
+    unmap_file(&mapped);
+    if (ret < 0) {
+        LASShared_SetError(ret, shared.name);
+        return NULL;
+    }
+
+    return LASSharedSurvey_FromHandle(&shared);
+}
+
+PyObject * share_las_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "share_las", share_las_call(self, args, kwargs));
+}
+
+static PyObject * attach_shared_call(PyObject * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"name", NULL};
+    char * name;
+
+    //parse arguments
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords, &name)) {
+        return NULL;
+    }
+
+    LASSharedSurvey shared;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    ret = attach_shared_survey(name, &shared);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        LASShared_SetError(ret, name);
+        return NULL;
+    }
+
+    return LASSharedSurvey_FromHandle(&shared);
+}
+
+PyObject * attach_shared_wrapper(PyObject * self, PyObject * args, PyObject * kwargs) {
+    LASTrace trace;
+    LASTrace_Begin(&trace);
+    return LASTrace_End(&trace, "attach_shared", attach_shared_call(self, args, kwargs));
+}
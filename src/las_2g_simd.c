@@ -0,0 +1,534 @@
+/**
+ * @file las_2g_simd.c
+ * @author Ryan Wicks
+ * @brief SSE4.1 and AVX2 kernels converting between LAS records and point columns,
+ * searching for header signatures and reducing records to profile statistics.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_simd.h"
+#include "las_2g_scan.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define LAS_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define LAS_TARGET(isa) __attribute__((target(isa)))
+/**
+ * @brief Fold the lanes of the vector reductions and the reduction of the scalar tail into
+ * one, with the same comparisons as reduce_entries_scalar.
+ */
+static void finish_reduction(const int32_t * min_z, const int32_t * max_z, size_t z_lanes, const int64_t * sum_z,
+                             const double * min_gps_time, const double * max_gps_time, size_t time_lanes,
+                             LASEntryReduction * reduction) {
+    for (size_t lane = 0; lane < z_lanes; ++lane) {
+        reduction->min_z = min_z[lane] < reduction->min_z ? min_z[lane] : reduction->min_z;
+        reduction->max_z = max_z[lane] > reduction->max_z ? max_z[lane] : reduction->max_z;
+        reduction->sum_z += sum_z[lane];
+    }
+    for (size_t lane = 0; lane < time_lanes; ++lane) {
+        reduction->min_gps_time = min_gps_time[lane] < reduction->min_gps_time ? min_gps_time[lane] : reduction->min_gps_time;
+        reduction->max_gps_time = max_gps_time[lane] > reduction->max_gps_time ? max_gps_time[lane] : reduction->max_gps_time;
+    }
+}
+
+LAS_TARGET("sse4.1")
+void reduce_entries_sse41(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                          uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    __m128i min_z = _mm_set1_epi32(INT32_MAX);
+    __m128i max_z = _mm_set1_epi32(INT32_MIN);
+    __m128i sum_low = _mm_setzero_si128();
+    __m128i sum_high = _mm_setzero_si128();
+    __m128d min_gps_time = _mm_set1_pd(HUGE_VAL);
+    __m128d max_gps_time = _mm_set1_pd(-HUGE_VAL);
+
+    size_t point = 0;
+    for (; point + 4 <= number_of_entries; point += 4) {
+        const LASEntry * e = entries + point;
+        __m128i z = _mm_setr_epi32(e[0].z, e[1].z, e[2].z, e[3].z);
+        min_z = _mm_min_epi32(min_z, z);
+        max_z = _mm_max_epi32(max_z, z);
+        sum_low = _mm_add_epi64(sum_low, _mm_cvtepi32_epi64(z));
+        sum_high = _mm_add_epi64(sum_high, _mm_cvtepi32_epi64(_mm_srli_si128(z, 8)));
+
+        // min(new, old) keeps old when new is NaN, like the scalar comparison.
+        __m128d gps_time = _mm_setr_pd(e[0].gps_time, e[1].gps_time);
+        min_gps_time = _mm_min_pd(gps_time, min_gps_time);
+        max_gps_time = _mm_max_pd(gps_time, max_gps_time);
+        gps_time = _mm_setr_pd(e[2].gps_time, e[3].gps_time);
+        min_gps_time = _mm_min_pd(gps_time, min_gps_time);
+        max_gps_time = _mm_max_pd(gps_time, max_gps_time);
+
+        for (int i = 0; i < 4; ++i) {
+            intensity_histogram[e[i].intensity >> intensity_shift] += 1;
+            quality_histogram[e[i].user_data >> quality_shift] += 1;
+        }
+    }
+
+    int32_t min_lanes[4], max_lanes[4];
+    int64_t sum_lanes[4];
+    double min_time_lanes[2], max_time_lanes[2];
+    _mm_storeu_si128((__m128i *)min_lanes, min_z);
+    _mm_storeu_si128((__m128i *)max_lanes, max_z);
+    _mm_storeu_si128((__m128i *)sum_lanes, sum_low);
+    _mm_storeu_si128((__m128i *)(sum_lanes + 2), sum_high);
+    _mm_storeu_pd(min_time_lanes, min_gps_time);
+    _mm_storeu_pd(max_time_lanes, max_gps_time);
+
+    reduce_entries_scalar(entries + point, number_of_entries - point, intensity_shift, quality_shift,
+                          intensity_histogram, quality_histogram, reduction);
+    finish_reduction(min_lanes, max_lanes, 4, sum_lanes, min_time_lanes, max_time_lanes, 2, reduction);
+}
+
+LAS_TARGET("avx2")
+void reduce_entries_avx2(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                         uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    // gather 8 z values a step, a record is 7 int32 or 28 bytes.
+    const __m256i record_ints = _mm256_setr_epi32(0, 7, 14, 21, 28, 35, 42, 49);
+    const __m128i record_bytes = _mm_setr_epi32(0, 28, 56, 84);
+    __m256i min_z = _mm256_set1_epi32(INT32_MAX);
+    __m256i max_z = _mm256_set1_epi32(INT32_MIN);
+    __m256i sum_low = _mm256_setzero_si256();
+    __m256i sum_high = _mm256_setzero_si256();
+    __m256d min_gps_time = _mm256_set1_pd(HUGE_VAL);
+    __m256d max_gps_time = _mm256_set1_pd(-HUGE_VAL);
+
+    size_t point = 0;
+    for (; point + 8 <= number_of_entries; point += 8) {
+        const LASEntry * e = entries + point;
+        __m256i z = _mm256_i32gather_epi32((const int *)e + 2, record_ints, 4);
+        min_z = _mm256_min_epi32(min_z, z);
+        max_z = _mm256_max_epi32(max_z, z);
+        sum_low = _mm256_add_epi64(sum_low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(z)));
+        sum_high = _mm256_add_epi64(sum_high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(z, 1)));
+
+        const char * times = (const char *)e + offsetof(LASEntry, gps_time);
+        __m256d gps_time = _mm256_i32gather_pd((const double *)times, record_bytes, 1);
+        min_gps_time = _mm256_min_pd(gps_time, min_gps_time);
+        max_gps_time = _mm256_max_pd(gps_time, max_gps_time);
+        gps_time = _mm256_i32gather_pd((const double *)(times + 4 * sizeof(LASEntry)), record_bytes, 1);
+        min_gps_time = _mm256_min_pd(gps_time, min_gps_time);
+        max_gps_time = _mm256_max_pd(gps_time, max_gps_time);
+
+        for (int i = 0; i < 8; ++i) {
+            intensity_histogram[e[i].intensity >> intensity_shift] += 1;
+            quality_histogram[e[i].user_data >> quality_shift] += 1;
+        }
+    }
+
+    int32_t min_lanes[8], max_lanes[8];
+    int64_t sum_lanes[8];
+    double min_time_lanes[4], max_time_lanes[4];
+    _mm256_storeu_si256((__m256i *)min_lanes, min_z);
+    _mm256_storeu_si256((__m256i *)max_lanes, max_z);
+    _mm256_storeu_si256((__m256i *)sum_lanes, sum_low);
+    _mm256_storeu_si256((__m256i *)(sum_lanes + 4), sum_high);
+    _mm256_storeu_pd(min_time_lanes, min_gps_time);
+    _mm256_storeu_pd(max_time_lanes, max_gps_time);
+
+    reduce_entries_scalar(entries + point, number_of_entries - point, intensity_shift, quality_shift,
+                          intensity_histogram, quality_histogram, reduction);
+    finish_reduction(min_lanes, max_lanes, 8, sum_lanes, min_time_lanes, max_time_lanes, 4, reduction);
+}
+
+#else
+#define LAS_TARGET(isa)
+#endif
+
+static int simd_level = -1;
+
+int las_simd_supported(void) {
+#if defined(LAS_SIMD_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return LAS_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return LAS_SIMD_SSE41;
+    }
+#elif defined(LAS_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    int sse41 = (info[2] >> 19) & 1;
+    int avx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, OS saves ymm
+    __cpuidex(info, 7, 0);
+    if (avx && ((info[1] >> 5) & 1)) {
+        return LAS_SIMD_AVX2;
+    }
+    if (sse41) {
+        return LAS_SIMD_SSE41;
+    }
+#endif
+    return LAS_SIMD_SCALAR;
+}
+
+int las_simd_level(void) {
+    if (simd_level < 0) {
+        simd_level = las_simd_supported();
+    }
+    return simd_level;
+}
+
+int las_simd_set_level(int level) {
+    if (level < LAS_SIMD_SCALAR || level > las_simd_supported()) {
+        return -1;
+    }
+    simd_level = level;
+    return 0;
+}
+
+const char * las_simd_name(int level) {
+    switch (level) {
+        case LAS_SIMD_AVX2:
+            return "avx2";
+        case LAS_SIMD_SSE41:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
+
+/**
+ * @brief Store one record the way initLASEntry builds it, from already converted fields.
+ *
+ */
+static void store_entry(LASEntry * entry, int32_t x, int32_t y, int32_t z,
+                        uint16_t intensity, uint8_t quality, double gps_time) {
+    entry->x = x;
+    entry->y = y;
+    entry->z = z;
+    entry->intensity = intensity;
+    entry->bit_field = 0;
+    entry->classification = 0;
+    entry->scan_angle = 0;
+    entry->user_data = quality;
+    entry->point_source_id = 0;
+    entry->gps_time = gps_time;
+}
+
+#ifdef LAS_SIMD_X86
+
+// 2^52, adding it to an integral double in [0, 2^52) leaves the integer in the mantissa bits.
+#define MAGIC_2_52 4503599627370496.0
+#define MAGIC_2_52_BITS 0x4330000000000000ll
+
+// coordinates inside (-2^31 - 1, 2^31) truncate to int32, which cvttpd gives exactly.
+#define INT32_LOWER -2147483649.0
+#define INT32_UPPER 2147483648.0
+
+//-----------------------------------------------------------------
+// SSE4.1 Definitions
+//-----------------------------------------------------------------
+
+LAS_TARGET("sse4.1")
+void decode_entries_sse41(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                          double * x, double * y, double * z,
+                          uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    const __m128d x_scale = _mm_set1_pd(header->x_scale_factor);
+    const __m128d y_scale = _mm_set1_pd(header->y_scale_factor);
+    const __m128d z_scale = _mm_set1_pd(header->z_scale_factor);
+    const __m128d to_us = _mm_set1_pd(1E6);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d magic = _mm_set1_pd(MAGIC_2_52);
+    const __m128i magic_bits = _mm_set1_epi64x(MAGIC_2_52_BITS);
+    // AdjustedGPSTimeusToUTCTimeus only adds a constant (modulo 2^64).
+    const __m128i utc_offset = _mm_set1_epi64x((long long)AdjustedGPSTimeusToUTCTimeus(0));
+
+    size_t point = 0;
+    for (; point + 2 <= number_of_entries; point += 2) {
+        const LASEntry * e = entries + point;
+
+        _mm_storeu_pd(x + point, _mm_mul_pd(x_scale, _mm_cvtepi32_pd(_mm_setr_epi32(e[0].x, e[1].x, 0, 0))));
+        _mm_storeu_pd(y + point, _mm_mul_pd(y_scale, _mm_cvtepi32_pd(_mm_setr_epi32(e[0].y, e[1].y, 0, 0))));
+        _mm_storeu_pd(z + point, _mm_mul_pd(z_scale, _mm_cvtepi32_pd(_mm_setr_epi32(e[0].z, e[1].z, 0, 0))));
+        intensity[point] = e[0].intensity;
+        intensity[point + 1] = e[1].intensity;
+        quality[point] = e[0].user_data;
+        quality[point + 1] = e[1].user_data;
+
+        __m128d gps_us = _mm_round_pd(_mm_mul_pd(_mm_setr_pd(e[0].gps_time, e[1].gps_time), to_us),
+                                      _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        int in_range = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(gps_us, zero), _mm_cmplt_pd(gps_us, magic)));
+        if (in_range == 0x3) {
+            __m128i gps = _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(gps_us, magic)), magic_bits);
+            _mm_storeu_si128((__m128i *)(utc_time + point), _mm_add_epi64(gps, utc_offset));
+        } else {
+            utc_time[point] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(e[0].gps_time*1E6));
+            utc_time[point + 1] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(e[1].gps_time*1E6));
+        }
+    }
+    if (point < number_of_entries) {
+        decode_entries_scalar(header, entries + point, number_of_entries - point,
+                              x + point, y + point, z + point, intensity + point, quality + point, utc_time + point);
+    }
+}
+
+LAS_TARGET("sse4.1")
+void encode_entries_sse41(const double * x, const double * y, const double * z,
+                          const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                          size_t number_of_entries, LASEntry * entries) {
+    const __m128d to_points = _mm_set1_pd(point_scale);
+    const __m128d lower = _mm_set1_pd(INT32_LOWER);
+    const __m128d upper = _mm_set1_pd(INT32_UPPER);
+    const __m128d magic = _mm_set1_pd(MAGIC_2_52);
+    const __m128i magic_bits = _mm_set1_epi64x(MAGIC_2_52_BITS);
+    const __m128i gps_epoch = _mm_set1_epi64x((long long)diff_to_gps_epoch);
+    // the same steps as UTCTimeusToAdjustedGPSTime
+    const __m128d to_seconds = _mm_set1_pd(1000000);
+    const __m128d leap_seconds = _mm_set1_pd(18);
+    const __m128d adjustment = _mm_set1_pd(1000000000);
+
+    size_t point = 0;
+    for (; point + 2 <= number_of_entries; point += 2) {
+        __m128d px = _mm_mul_pd(_mm_loadu_pd(x + point), to_points);
+        __m128d py = _mm_mul_pd(_mm_loadu_pd(y + point), to_points);
+        __m128d pz = _mm_mul_pd(_mm_loadu_pd(z + point), to_points);
+        __m128d in_range = _mm_and_pd(_mm_and_pd(_mm_cmpgt_pd(px, lower), _mm_cmplt_pd(px, upper)),
+                                      _mm_and_pd(_mm_cmpgt_pd(py, lower), _mm_cmplt_pd(py, upper)));
+        in_range = _mm_and_pd(in_range, _mm_and_pd(_mm_cmpgt_pd(pz, lower), _mm_cmplt_pd(pz, upper)));
+
+        __m128i since_epoch = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(utc_time + point)), gps_epoch);
+        if (_mm_movemask_pd(in_range) != 0x3 || !_mm_testz_si128(_mm_srli_epi64(since_epoch, 52), _mm_set1_epi64x(-1))) {
+            for (size_t i = point; i < point + 2; ++i) {
+                entries[i] = initLASEntry(utc_time[i], x[i], y[i], z[i], intensity[i], quality[i]);
+            }
+            continue;
+        }
+
+        __m128d gps = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(since_epoch, magic_bits)), magic);
+        gps = _mm_sub_pd(_mm_add_pd(_mm_div_pd(gps, to_seconds), leap_seconds), adjustment);
+
+        int32_t ix[4], iy[4], iz[4];
+        double gps_time[2];
+        _mm_storeu_si128((__m128i *)ix, _mm_cvttpd_epi32(px));
+        _mm_storeu_si128((__m128i *)iy, _mm_cvttpd_epi32(py));
+        _mm_storeu_si128((__m128i *)iz, _mm_cvttpd_epi32(pz));
+        _mm_storeu_pd(gps_time, gps);
+        for (int i = 0; i < 2; ++i) {
+            store_entry(entries + point + i, ix[i], iy[i], iz[i], intensity[point + i], quality[point + i], gps_time[i]);
+        }
+    }
+    if (point < number_of_entries) {
+        encode_entries_scalar(x + point, y + point, z + point, intensity + point, quality + point, utc_time + point,
+                              number_of_entries - point, entries + point);
+    }
+}
+
+//-----------------------------------------------------------------
+// AVX2 Definitions
+//-----------------------------------------------------------------
+
+LAS_TARGET("avx2")
+void decode_entries_avx2(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                         double * x, double * y, double * z,
+                         uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    const __m256d x_scale = _mm256_set1_pd(header->x_scale_factor);
+    const __m256d y_scale = _mm256_set1_pd(header->y_scale_factor);
+    const __m256d z_scale = _mm256_set1_pd(header->z_scale_factor);
+    const __m256d to_us = _mm256_set1_pd(1E6);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d magic = _mm256_set1_pd(MAGIC_2_52);
+    const __m256i magic_bits = _mm256_set1_epi64x(MAGIC_2_52_BITS);
+    const __m256i utc_offset = _mm256_set1_epi64x((long long)AdjustedGPSTimeusToUTCTimeus(0));
+    // gather 4 records at a time, a record is 7 int32 or 28 bytes.
+    const __m128i record_ints = _mm_setr_epi32(0, 7, 14, 21);
+    const __m128i record_bytes = _mm_setr_epi32(0, 28, 56, 84);
+
+    size_t point = 0;
+    for (; point + 4 <= number_of_entries; point += 4) {
+        const LASEntry * e = entries + point;
+        const int * fields = (const int *)e;
+
+        _mm256_storeu_pd(x + point, _mm256_mul_pd(x_scale, _mm256_cvtepi32_pd(_mm_i32gather_epi32(fields, record_ints, 4))));
+        _mm256_storeu_pd(y + point, _mm256_mul_pd(y_scale, _mm256_cvtepi32_pd(_mm_i32gather_epi32(fields + 1, record_ints, 4))));
+        _mm256_storeu_pd(z + point, _mm256_mul_pd(z_scale, _mm256_cvtepi32_pd(_mm_i32gather_epi32(fields + 2, record_ints, 4))));
+        for (int i = 0; i < 4; ++i) {
+            intensity[point + i] = e[i].intensity;
+            quality[point + i] = e[i].user_data;
+        }
+
+        __m256d gps_time = _mm256_i32gather_pd((const double *)((const char *)e + offsetof(LASEntry, gps_time)), record_bytes, 1);
+        __m256d gps_us = _mm256_round_pd(_mm256_mul_pd(gps_time, to_us), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        __m256d in_range = _mm256_and_pd(_mm256_cmp_pd(gps_us, zero, _CMP_GE_OQ), _mm256_cmp_pd(gps_us, magic, _CMP_LT_OQ));
+        if (_mm256_movemask_pd(in_range) == 0xF) {
+            __m256i gps = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(gps_us, magic)), magic_bits);
+            _mm256_storeu_si256((__m256i *)(utc_time + point), _mm256_add_epi64(gps, utc_offset));
+        } else {
+            for (int i = 0; i < 4; ++i) {
+                utc_time[point + i] = AdjustedGPSTimeusToUTCTimeus((uint64_t)(e[i].gps_time*1E6));
+            }
+        }
+    }
+    if (point < number_of_entries) {
+        decode_entries_scalar(header, entries + point, number_of_entries - point,
+                              x + point, y + point, z + point, intensity + point, quality + point, utc_time + point);
+    }
+}
+
+LAS_TARGET("avx2")
+void encode_entries_avx2(const double * x, const double * y, const double * z,
+                         const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                         size_t number_of_entries, LASEntry * entries) {
+    const __m256d to_points = _mm256_set1_pd(point_scale);
+    const __m256d lower = _mm256_set1_pd(INT32_LOWER);
+    const __m256d upper = _mm256_set1_pd(INT32_UPPER);
+    const __m256d magic = _mm256_set1_pd(MAGIC_2_52);
+    const __m256i magic_bits = _mm256_set1_epi64x(MAGIC_2_52_BITS);
+    const __m256i gps_epoch = _mm256_set1_epi64x((long long)diff_to_gps_epoch);
+    const __m256d to_seconds = _mm256_set1_pd(1000000);
+    const __m256d leap_seconds = _mm256_set1_pd(18);
+    const __m256d adjustment = _mm256_set1_pd(1000000000);
+
+    size_t point = 0;
+    for (; point + 4 <= number_of_entries; point += 4) {
+        __m256d px = _mm256_mul_pd(_mm256_loadu_pd(x + point), to_points);
+        __m256d py = _mm256_mul_pd(_mm256_loadu_pd(y + point), to_points);
+        __m256d pz = _mm256_mul_pd(_mm256_loadu_pd(z + point), to_points);
+        __m256d in_range = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(px, lower, _CMP_GT_OQ), _mm256_cmp_pd(px, upper, _CMP_LT_OQ)),
+                                         _mm256_and_pd(_mm256_cmp_pd(py, lower, _CMP_GT_OQ), _mm256_cmp_pd(py, upper, _CMP_LT_OQ)));
+        in_range = _mm256_and_pd(in_range, _mm256_and_pd(_mm256_cmp_pd(pz, lower, _CMP_GT_OQ), _mm256_cmp_pd(pz, upper, _CMP_LT_OQ)));
+
+        __m256i since_epoch = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(utc_time + point)), gps_epoch);
+        if (_mm256_movemask_pd(in_range) != 0xF || !_mm256_testz_si256(_mm256_srli_epi64(since_epoch, 52), _mm256_set1_epi64x(-1))) {
+            for (size_t i = point; i < point + 4; ++i) {
+                entries[i] = initLASEntry(utc_time[i], x[i], y[i], z[i], intensity[i], quality[i]);
+            }
+            continue;
+        }
+
+        __m256d gps = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(since_epoch, magic_bits)), magic);
+        gps = _mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(gps, to_seconds), leap_seconds), adjustment);
+
+        int32_t ix[4], iy[4], iz[4];
+        double gps_time[4];
+        _mm_storeu_si128((__m128i *)ix, _mm256_cvttpd_epi32(px));
+        _mm_storeu_si128((__m128i *)iy, _mm256_cvttpd_epi32(py));
+        _mm_storeu_si128((__m128i *)iz, _mm256_cvttpd_epi32(pz));
+        _mm256_storeu_pd(gps_time, gps);
+        for (int i = 0; i < 4; ++i) {
+            store_entry(entries + point + i, ix[i], iy[i], iz[i], intensity[point + i], quality[point + i], gps_time[i]);
+        }
+    }
+    if (point < number_of_entries) {
+        encode_entries_scalar(x + point, y + point, z + point, intensity + point, quality + point, utc_time + point,
+                              number_of_entries - point, entries + point);
+    }
+}
+
+static unsigned lowest_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// "LASF" is found by comparing four loads, each shifted by one byte, against one letter each,
+// so bit i of the combined mask is set when the signature starts at byte i.
+
+LAS_TARGET("sse4.1")
+size_t find_las_signature_sse41(const uint8_t * data, size_t size) {
+    const __m128i l = _mm_set1_epi8('L');
+    const __m128i a = _mm_set1_epi8('A');
+    const __m128i s = _mm_set1_epi8('S');
+    const __m128i f = _mm_set1_epi8('F');
+    size_t position = 0;
+
+    for (; position + 19 <= size; position += 16) {
+        const uint8_t * block = data + position;
+        __m128i match = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)block), l),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 1)), a)),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 2)), s),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 3)), f)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(match);
+        if (mask) {
+            return position + lowest_bit(mask);
+        }
+    }
+    return position + find_las_signature_scalar(data + position, size - position);
+}
+
+LAS_TARGET("avx2")
+size_t find_las_signature_avx2(const uint8_t * data, size_t size) {
+    const __m256i l = _mm256_set1_epi8('L');
+    const __m256i a = _mm256_set1_epi8('A');
+    const __m256i s = _mm256_set1_epi8('S');
+    const __m256i f = _mm256_set1_epi8('F');
+    size_t position = 0;
+
+    for (; position + 35 <= size; position += 32) {
+        const uint8_t * block = data + position;
+        __m256i match = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)block), l),
+                             _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block + 1)), a)),
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block + 2)), s),
+                             _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(block + 3)), f)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(match);
+        if (mask) {
+            return position + lowest_bit(mask);
+        }
+    }
+    return position + find_las_signature_scalar(data + position, size - position);
+}
+
+#else
+
+// no vector kernels on this architecture, las_simd_supported never selects them.
+
+void decode_entries_sse41(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                          double * x, double * y, double * z,
+                          uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    decode_entries_scalar(header, entries, number_of_entries, x, y, z, intensity, quality, utc_time);
+}
+
+void decode_entries_avx2(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                         double * x, double * y, double * z,
+                         uint16_t * intensity, uint8_t * quality, uint64_t * utc_time) {
+    decode_entries_scalar(header, entries, number_of_entries, x, y, z, intensity, quality, utc_time);
+}
+
+void encode_entries_sse41(const double * x, const double * y, const double * z,
+                          const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                          size_t number_of_entries, LASEntry * entries) {
+    (void)store_entry;
+    encode_entries_scalar(x, y, z, intensity, quality, utc_time, number_of_entries, entries);
+}
+
+void encode_entries_avx2(const double * x, const double * y, const double * z,
+                         const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                         size_t number_of_entries, LASEntry * entries) {
+    encode_entries_scalar(x, y, z, intensity, quality, utc_time, number_of_entries, entries);
+}
+
+size_t find_las_signature_sse41(const uint8_t * data, size_t size) {
+    return find_las_signature_scalar(data, size);
+}
+
+size_t find_las_signature_avx2(const uint8_t * data, size_t size) {
+    return find_las_signature_scalar(data, size);
+}
+
+void reduce_entries_sse41(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                          uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    reduce_entries_scalar(entries, number_of_entries, intensity_shift, quality_shift, intensity_histogram, quality_histogram, reduction);
+}
+
+void reduce_entries_avx2(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                         uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction) {
+    reduce_entries_scalar(entries, number_of_entries, intensity_shift, quality_shift, intensity_histogram, quality_histogram, reduction);
+}
+
+#endif
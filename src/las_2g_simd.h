@@ -0,0 +1,72 @@
+#ifndef LAS_2G_SIMD_H
+#define LAS_2G_SIMD_H
+
+/**
+ * @brief Vectorised versions of decode_entries, encode_entries, find_las_signature and
+ * reduce_entries with runtime CPU dispatch.
+ * Every kernel gives bit for bit the same result as the scalar loops, points that the vector
+ * conversions cannot handle exactly fall back to the scalar conversion.
+ *
+ */
+
+#include "las_2g_python.h"
+#include "las_2g_aggregate.h"
+
+#define LAS_SIMD_SCALAR 0
+#define LAS_SIMD_SSE41 1
+#define LAS_SIMD_AVX2 2
+
+/**
+ * @brief Best instruction set the CPU running the module supports.
+ *
+ * @return int one of the LAS_SIMD_ levels
+ */
+int las_simd_supported(void);
+
+/**
+ * @brief Instruction set used by decode_entries and encode_entries, the best supported
+ * one unless changed with las_simd_set_level.
+ *
+ * @return int one of the LAS_SIMD_ levels
+ */
+int las_simd_level(void);
+
+/**
+ * @brief Force an instruction set, e.g. LAS_SIMD_SCALAR to compare against the vector kernels.
+ *
+ * @param level one of the LAS_SIMD_ levels
+ * @return int 0 on success, -1 if the CPU does not support level.
+ */
+int las_simd_set_level(int level);
+
+/**
+ * @brief Name of a level, "scalar", "sse4.1" or "avx2".
+ *
+ * @param level
+ * @return const char*
+ */
+const char * las_simd_name(int level);
+
+void decode_entries_sse41(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                          double * x, double * y, double * z,
+                          uint16_t * intensity, uint8_t * quality, uint64_t * utc_time);
+void decode_entries_avx2(const LASHeader * header, const LASEntry * entries, size_t number_of_entries,
+                         double * x, double * y, double * z,
+                         uint16_t * intensity, uint8_t * quality, uint64_t * utc_time);
+
+void encode_entries_sse41(const double * x, const double * y, const double * z,
+                          const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                          size_t number_of_entries, LASEntry * entries);
+void encode_entries_avx2(const double * x, const double * y, const double * z,
+                         const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                         size_t number_of_entries, LASEntry * entries);
+
+size_t find_las_signature_sse41(const uint8_t * data, size_t size);
+size_t find_las_signature_avx2(const uint8_t * data, size_t size);
+
+void reduce_entries_sse41(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                          uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction);
+void reduce_entries_avx2(const LASEntry * entries, size_t number_of_entries, unsigned intensity_shift, unsigned quality_shift,
+                         uint32_t * intensity_histogram, uint32_t * quality_histogram, LASEntryReduction * reduction);
+
+#endif
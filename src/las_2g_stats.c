@@ -0,0 +1,119 @@
+/**
+ * @file las_2g_stats.c
+ * @author Ryan Wicks
+ * @brief Performance counters and phase timers.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_stats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static LASStats las_stats;
+
+const char * const las_counter_names[LAS_NUMBER_OF_COUNTERS] = {
+    "bytes_read",
+    "bytes_written",
+    "profiles_read",
+    "profiles_written",
+    "points_read",
+    "points_written",
+    "allocations",
+    "allocated_bytes",
+};
+
+const char * const las_phase_names[LAS_NUMBER_OF_PHASES] = {
+    "read",
+    "write",
+    "parse",
+    "decode",
+    "encode",
+    "compress",
+    "objects",
+};
+
+#ifdef _MSC_VER
+static void atomic_add(uint64_t * target, uint64_t value) {
+    InterlockedExchangeAdd64((volatile LONG64 *)target, (LONG64)value);
+}
+
+static uint64_t atomic_load(uint64_t * target) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)target, 0, 0);
+}
+
+static void atomic_store(uint64_t * target, uint64_t value) {
+    InterlockedExchange64((volatile LONG64 *)target, (LONG64)value);
+}
+#else
+static void atomic_add(uint64_t * target, uint64_t value) {
+    __atomic_fetch_add(target, value, __ATOMIC_RELAXED);
+}
+
+static uint64_t atomic_load(uint64_t * target) {
+    return __atomic_load_n(target, __ATOMIC_RELAXED);
+}
+
+static void atomic_store(uint64_t * target, uint64_t value) {
+    __atomic_store_n(target, value, __ATOMIC_RELAXED);
+}
+#endif
+
+void las_stats_add(LASCounter counter, uint64_t value) {
+    atomic_add(&las_stats.counters[counter], value);
+}
+
+void las_stats_allocation(uint64_t size) {
+    atomic_add(&las_stats.counters[LAS_COUNTER_ALLOCATIONS], 1);
+    atomic_add(&las_stats.counters[LAS_COUNTER_ALLOCATED_BYTES], size);
+}
+
+#ifdef _WIN32
+uint64_t las_stats_clock(void) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1E9 / (double)frequency.QuadPart);
+}
+#else
+uint64_t las_stats_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+#endif
+
+void las_stats_phase(LASPhase phase, uint64_t start) {
+    atomic_add(&las_stats.phase_ns[phase], las_stats_clock() - start);
+    atomic_add(&las_stats.phase_calls[phase], 1);
+}
+
+void las_stats_snapshot(LASStats * stats) {
+    for (int i = 0; i < LAS_NUMBER_OF_COUNTERS; ++i) {
+        stats->counters[i] = atomic_load(&las_stats.counters[i]);
+    }
+    for (int i = 0; i < LAS_NUMBER_OF_PHASES; ++i) {
+        stats->phase_ns[i] = atomic_load(&las_stats.phase_ns[i]);
+        stats->phase_calls[i] = atomic_load(&las_stats.phase_calls[i]);
+    }
+}
+
+void las_stats_reset(void) {
+    for (int i = 0; i < LAS_NUMBER_OF_COUNTERS; ++i) {
+        atomic_store(&las_stats.counters[i], 0);
+    }
+    for (int i = 0; i < LAS_NUMBER_OF_PHASES; ++i) {
+        atomic_store(&las_stats.phase_ns[i], 0);
+        atomic_store(&las_stats.phase_calls[i], 0);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef LAS_2G_STATS_H
+#define LAS_2G_STATS_H
+
+/**
+ * @brief Process wide performance counters and phase timers. They are always compiled in and
+ * updated with relaxed atomic adds, at most a few per profile, so they are cheap enough to
+ * leave on in production.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    LAS_COUNTER_BYTES_READ, /// bytes read with fread, or decoded from a mapped file
+    LAS_COUNTER_BYTES_WRITTEN,
+    LAS_COUNTER_PROFILES_READ,
+    LAS_COUNTER_PROFILES_WRITTEN,
+    LAS_COUNTER_POINTS_READ,
+    LAS_COUNTER_POINTS_WRITTEN,
+    LAS_COUNTER_ALLOCATIONS, /// buffers allocated for profiles, columns and tables
+    LAS_COUNTER_ALLOCATED_BYTES,
+    LAS_NUMBER_OF_COUNTERS
+} LASCounter;
+
+typedef enum {
+    LAS_PHASE_READ, /// fread, timed per profile
+    LAS_PHASE_WRITE, /// fwrite, timed per profile or block
+    LAS_PHASE_PARSE, /// scanning headers and building profile tables
+    LAS_PHASE_DECODE, /// records to values
+    LAS_PHASE_ENCODE, /// values to records
+    LAS_PHASE_COMPRESS, /// compressing and decompressing chunks
+    LAS_PHASE_OBJECTS, /// building Python objects
+    LAS_NUMBER_OF_PHASES
+} LASPhase;
+
+/**
+ * @brief Totals since the module was loaded or the last las_stats_reset.
+ *
+ */
+typedef struct {
+    uint64_t counters[LAS_NUMBER_OF_COUNTERS];
+    uint64_t phase_ns[LAS_NUMBER_OF_PHASES]; /// time spent in each phase, summed over threads
+    uint64_t phase_calls[LAS_NUMBER_OF_PHASES];
+} LASStats;
+
+extern const char * const las_counter_names[LAS_NUMBER_OF_COUNTERS];
+extern const char * const las_phase_names[LAS_NUMBER_OF_PHASES];
+
+/**
+ * @brief Add to a counter.
+ *
+ * @param counter
+ * @param value
+ */
+void las_stats_add(LASCounter counter, uint64_t value);
+
+/**
+ * @brief Count one allocation.
+ *
+ * @param size bytes allocated
+ */
+void las_stats_allocation(uint64_t size);
+
+/**
+ * @brief Monotonic clock.
+ *
+ * @return uint64_t ns from an arbitrary origin
+ */
+uint64_t las_stats_clock(void);
+
+/**
+ * @brief Close a timed phase, adding the time since start to it.
+ *
+ * @param phase
+ * @param start las_stats_clock when the phase began
+ */
+void las_stats_phase(LASPhase phase, uint64_t start);
+
+/**
+ * @brief Copy the current totals.
+ *
+ * @param stats
+ */
+void las_stats_snapshot(LASStats * stats);
+
+/**
+ * @brief Set every counter and timer back to zero.
+ *
+ */
+void las_stats_reset(void);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file las_2g_stats_module.c
+ * @author Ryan Wicks
+ * @brief Python access to the performance counters, and the per call trace callback.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+
+static PyObject * trace_callback = NULL; /// called after every traced call, NULL when tracing is off
+
+//-----------------------------------------------------------------
+// Stats Definitions
+//-----------------------------------------------------------------
+
+static int set_item(PyObject * dict, const char * key, PyObject * value) {
+    if (!value) {
+        return -1;
+    }
+    int ret = PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+    return ret;
+}
+
+/**
+ * @brief Convert totals to a dictionary of the counters, plus a "phases" dictionary giving
+ * the seconds spent in and the number of calls of every phase.
+ */
+static PyObject * LASStats_ToDict(const LASStats * stats) {
+    PyObject * dict = PyDict_New();
+    PyObject * phases = PyDict_New();
+    if (!dict || !phases) {
+        goto error;
+    }
+
+    for (int i = 0; i < LAS_NUMBER_OF_COUNTERS; ++i) {
+        if (set_item(dict, las_counter_names[i], PyLong_FromUnsignedLongLong(stats->counters[i])) < 0) {
+            goto error;
+        }
+    }
+    for (int i = 0; i < LAS_NUMBER_OF_PHASES; ++i) {
+        PyObject * phase = Py_BuildValue("{s:d,s:K}", "seconds", (double)stats->phase_ns[i] * 1E-9,
+                                         "calls", (unsigned long long)stats->phase_calls[i]);
+        if (set_item(phases, las_phase_names[i], phase) < 0) {
+            goto error;
+        }
+    }
+    if (PyDict_SetItemString(dict, "phases", phases) < 0) {
+        goto error;
+    }
+    Py_DECREF(phases);
+    return dict;
+
+error:
+    Py_XDECREF(dict);
+    Py_XDECREF(phases);
+    return NULL;
+}
+
+void LASTrace_Begin(LASTrace * trace) {
+    trace->callback = trace_callback;
+    if (trace->callback == NULL) {
+        return;
+    }
+    Py_INCREF(trace->callback);
+    las_stats_snapshot(&trace->start);
+    trace->start_ns = las_stats_clock();
+}
+
+PyObject * LASTrace_End(LASTrace * trace, const char * name, PyObject * result) {
+    if (trace->callback == NULL) {
+        return result;
+    }
+
+    LASStats delta;
+    las_stats_snapshot(&delta);
+    double seconds = (double)(las_stats_clock() - trace->start_ns) * 1E-9;
+    for (int i = 0; i < LAS_NUMBER_OF_COUNTERS; ++i) {
+        delta.counters[i] -= trace->start.counters[i];
+    }
+    for (int i = 0; i < LAS_NUMBER_OF_PHASES; ++i) {
+        delta.phase_ns[i] -= trace->start.phase_ns[i];
+        delta.phase_calls[i] -= trace->start.phase_calls[i];
+    }
+
+    // a failed call is traced too, with its exception kept aside while the callback runs.
+    PyObject * type, * value, * traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+
+    PyObject * stats = LASStats_ToDict(&delta);
+    PyObject * ret = stats ? PyObject_CallFunction(trace->callback, "sdO", name, seconds, stats) : NULL;
+    Py_XDECREF(stats);
+    Py_DECREF(trace->callback);
+    trace->callback = NULL;
+
+    if (result == NULL) {
+        if (ret == NULL) {
+            PyErr_WriteUnraisable(NULL);
+        }
+        PyErr_Restore(type, value, traceback);
+    } else if (ret == NULL) {
+        // the callback raised, its exception replaces the result.
+        Py_DECREF(result);
+        result = NULL;
+    }
+    Py_XDECREF(ret);
+    return result;
+}
+
+//-----------------------------------------------------------------
+// Methods definitions
+//-----------------------------------------------------------------
+
+PyObject * stats_wrapper(PyObject * self, PyObject * Py_UNUSED(ignored)) {
+    LASStats stats;
+    las_stats_snapshot(&stats);
+    return LASStats_ToDict(&stats);
+}
+
+PyObject * reset_stats_wrapper(PyObject * self, PyObject * Py_UNUSED(ignored)) {
+    las_stats_reset();
+    Py_RETURN_NONE;
+}
+
+PyObject * set_trace_wrapper(PyObject * self, PyObject * args) {
+    PyObject * callback;
+
+    //parse arguments
+    if (!PyArg_ParseTuple(args, "O", &callback)) {
+        return NULL;
+    }
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable or None.");
+        return NULL;
+    }
+
+    if (callback == Py_None) {
+        Py_CLEAR(trace_callback);
+    } else {
+        Py_INCREF(callback);
+        Py_XSETREF(trace_callback, callback);
+    }
+    Py_RETURN_NONE;
+}
@@ -0,0 +1,411 @@
+/**
+ * @file las_2g_thread.c
+ * @author Ryan Wicks
+ * @brief Portable thread primitives.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_thread.h"
+#include <stdlib.h>
+
+typedef struct {
+    void (*function)(void *);
+    void * argument;
+} ThreadStart;
+
+#ifdef _WIN32
+#include <process.h>
+
+static unsigned __stdcall thread_main(void * start) {
+    ThreadStart thread_start = *(ThreadStart *)start;
+    free(start);
+    thread_start.function(thread_start.argument);
+    return 0;
+}
+
+int las_thread_create(las_thread * thread, void (*function)(void *), void * argument) {
+    ThreadStart * start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (!start) {
+        return -1;
+    }
+    start->function = function;
+    start->argument = argument;
+
+    *thread = (HANDLE)_beginthreadex(NULL, 0, thread_main, start, 0, NULL);
+    if (*thread == 0) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void las_thread_join(las_thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+void las_thread_detach(las_thread thread) {
+    CloseHandle(thread);
+}
+
+void las_mutex_init(las_mutex * mutex) { InitializeSRWLock(mutex); }
+void las_mutex_destroy(las_mutex * mutex) { (void)mutex; }
+void las_mutex_lock(las_mutex * mutex) { AcquireSRWLockExclusive(mutex); }
+void las_mutex_unlock(las_mutex * mutex) { ReleaseSRWLockExclusive(mutex); }
+
+void las_cond_init(las_cond * cond) { InitializeConditionVariable(cond); }
+void las_cond_destroy(las_cond * cond) { (void)cond; }
+void las_cond_wait(las_cond * cond, las_mutex * mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+void las_cond_signal(las_cond * cond) { WakeConditionVariable(cond); }
+void las_cond_broadcast(las_cond * cond) { WakeAllConditionVariable(cond); }
+
+int las_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+#else
+#include <unistd.h>
+
+static void * thread_main(void * start) {
+    ThreadStart thread_start = *(ThreadStart *)start;
+    free(start);
+    thread_start.function(thread_start.argument);
+    return NULL;
+}
+
+int las_thread_create(las_thread * thread, void (*function)(void *), void * argument) {
+    ThreadStart * start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (!start) {
+        return -1;
+    }
+    start->function = function;
+    start->argument = argument;
+
+    if (pthread_create(thread, NULL, thread_main, start) != 0) {
+        free(start);
+        return -1;
+    }
+    return 0;
+}
+
+void las_thread_join(las_thread thread) {
+    pthread_join(thread, NULL);
+}
+
+void las_thread_detach(las_thread thread) {
+    pthread_detach(thread);
+}
+
+void las_mutex_init(las_mutex * mutex) { pthread_mutex_init(mutex, NULL); }
+void las_mutex_destroy(las_mutex * mutex) { pthread_mutex_destroy(mutex); }
+void las_mutex_lock(las_mutex * mutex) { pthread_mutex_lock(mutex); }
+void las_mutex_unlock(las_mutex * mutex) { pthread_mutex_unlock(mutex); }
+
+void las_cond_init(las_cond * cond) { pthread_cond_init(cond, NULL); }
+void las_cond_destroy(las_cond * cond) { pthread_cond_destroy(cond); }
+void las_cond_wait(las_cond * cond, las_mutex * mutex) { pthread_cond_wait(cond, mutex); }
+void las_cond_signal(las_cond * cond) { pthread_cond_signal(cond); }
+void las_cond_broadcast(las_cond * cond) { pthread_cond_broadcast(cond); }
+
+int las_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+#endif
+
+/**
+ * @brief The items still owned by one worker, [next, end). The owner takes from the front,
+ * thieves take the back half.
+ *
+ */
+typedef struct {
+    las_mutex mutex;
+    size_t next;
+    size_t end;
+} WorkRange;
+
+/**
+ * @brief One run of las_parallel_for. Helpers run as tasks on the pool and may start after
+ * the caller has finished every item, so the run is freed by whoever releases it last.
+ *
+ */
+typedef struct {
+    WorkRange * ranges;
+    int number_of_workers;
+    void (*work)(void * context, size_t item);
+    void * context;
+    las_mutex mutex; /// protects the counts below
+    las_cond cond;
+    int references; /// the caller and every queued or running helper
+    int running; /// helpers taking items
+    int finished; /// the caller ran out of items, helpers starting later return at once
+} ParallelFor;
+
+typedef struct {
+    ParallelFor * parallel;
+    int worker;
+} ParallelWorker;
+
+static int take_item(WorkRange * range, size_t * item) {
+    int taken = 0;
+    las_mutex_lock(&range->mutex);
+    if (range->next < range->end) {
+        *item = range->next++;
+        taken = 1;
+    }
+    las_mutex_unlock(&range->mutex);
+    return taken;
+}
+
+/**
+ * @brief Move the back half of another worker's items into an empty range.
+ *
+ * @return int 1 if work was stolen, 0 once every range is empty.
+ */
+static int steal_items(ParallelFor * parallel, int worker) {
+    for (int i = 1; i < parallel->number_of_workers; ++i) {
+        WorkRange * victim = &parallel->ranges[(worker + i) % parallel->number_of_workers];
+        size_t begin = 0;
+        size_t end = 0;
+
+        las_mutex_lock(&victim->mutex);
+        if (victim->next < victim->end) {
+            size_t remaining = victim->end - victim->next;
+            end = victim->end;
+            begin = end - (remaining + 1) / 2;
+            victim->end = begin;
+        }
+        las_mutex_unlock(&victim->mutex);
+
+        if (begin < end) {
+            WorkRange * own = &parallel->ranges[worker];
+            las_mutex_lock(&own->mutex);
+            own->next = begin;
+            own->end = end;
+            las_mutex_unlock(&own->mutex);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void parallel_for_main(ParallelWorker * worker) {
+    ParallelFor * parallel = worker->parallel;
+    size_t item;
+
+    do {
+        while (take_item(&parallel->ranges[worker->worker], &item)) {
+            parallel->work(parallel->context, item);
+        }
+    } while (steal_items(parallel, worker->worker));
+}
+
+static void parallel_for_release(ParallelFor * parallel) {
+    las_mutex_lock(&parallel->mutex);
+    int last = --parallel->references == 0;
+    las_mutex_unlock(&parallel->mutex);
+    if (!last) {
+        return;
+    }
+
+    for (int i = 0; i < parallel->number_of_workers; ++i) {
+        las_mutex_destroy(&parallel->ranges[i].mutex);
+    }
+    las_cond_destroy(&parallel->cond);
+    las_mutex_destroy(&parallel->mutex);
+    free(parallel);
+}
+
+static void parallel_for_helper(void * argument) {
+    ParallelWorker * worker = (ParallelWorker *)argument;
+    ParallelFor * parallel = worker->parallel;
+
+    las_mutex_lock(&parallel->mutex);
+    int start = !parallel->finished;
+    if (start) {
+        parallel->running += 1;
+    }
+    las_mutex_unlock(&parallel->mutex);
+
+    if (start) {
+        parallel_for_main(worker);
+        las_mutex_lock(&parallel->mutex);
+        if (--parallel->running == 0) {
+            las_cond_broadcast(&parallel->cond);
+        }
+        las_mutex_unlock(&parallel->mutex);
+    }
+    parallel_for_release(parallel);
+}
+
+void las_parallel_for(size_t count, int threads, void (*work)(void * context, size_t item), void * context) {
+    if (threads <= 0) {
+        threads = las_cpu_count();
+    }
+    if ((size_t)threads > count) {
+        threads = (int)count;
+    }
+
+    // the run, its ranges and its workers in one block, so late helpers free it in one go.
+    ParallelFor * parallel = NULL;
+    if (threads > 1) {
+        parallel = (ParallelFor *)malloc(sizeof(ParallelFor) + (size_t)threads * (sizeof(WorkRange) + sizeof(ParallelWorker)));
+    }
+    if (!parallel) {
+        for (size_t item = 0; item < count; ++item) {
+            work(context, item);
+        }
+        return;
+    }
+
+    // every worker starts with an equal contiguous share and steals once it runs dry.
+    WorkRange * ranges = (WorkRange *)(parallel + 1);
+    ParallelWorker * workers = (ParallelWorker *)(ranges + threads);
+    parallel->ranges = ranges;
+    parallel->number_of_workers = threads;
+    parallel->work = work;
+    parallel->context = context;
+    las_mutex_init(&parallel->mutex);
+    las_cond_init(&parallel->cond);
+    parallel->references = 1;
+    parallel->running = 0;
+    parallel->finished = 0;
+    for (int i = 0; i < threads; ++i) {
+        las_mutex_init(&ranges[i].mutex);
+        ranges[i].next = count * (size_t)i / (size_t)threads;
+        ranges[i].end = count * (size_t)(i + 1) / (size_t)threads;
+        workers[i].parallel = parallel;
+        workers[i].worker = i;
+    }
+
+    // helpers run on the pool instead of threads started for this call. Those that never
+    // start, or start late, have their ranges stolen by the caller.
+    for (int i = 1; i < threads; ++i) {
+        las_mutex_lock(&parallel->mutex);
+        parallel->references += 1;
+        las_mutex_unlock(&parallel->mutex);
+        if (las_pool_submit(parallel_for_helper, &workers[i]) < 0) {
+            parallel_for_release(parallel);
+            break;
+        }
+    }
+
+    parallel_for_main(&workers[0]);
+
+    las_mutex_lock(&parallel->mutex);
+    parallel->finished = 1;
+    while (parallel->running > 0) {
+        las_cond_wait(&parallel->cond, &parallel->mutex);
+    }
+    las_mutex_unlock(&parallel->mutex);
+    parallel_for_release(parallel);
+}
+
+typedef struct PoolTask {
+    void (*work)(void * context);
+    void * context;
+    struct PoolTask * next;
+} PoolTask;
+
+static las_mutex pool_mutex = LAS_MUTEX_INITIALIZER; /// protects the queue and the worker counts
+static las_cond pool_cond = LAS_COND_INITIALIZER;
+static PoolTask * pool_head = NULL;
+static PoolTask * pool_tail = NULL;
+static int pool_workers = 0;
+static int pool_idle = 0; /// workers waiting for a task
+
+#ifndef _WIN32
+static pthread_once_t pool_fork_once = PTHREAD_ONCE_INIT;
+
+static void pool_fork_prepare(void) { las_mutex_lock(&pool_mutex); }
+static void pool_fork_parent(void) { las_mutex_unlock(&pool_mutex); }
+
+/**
+ * @brief Only the thread that called fork() exists in the child, so the workers are
+ * forgotten and the queued tasks, which belong to the parent's callers, are dropped.
+ *
+ */
+static void pool_fork_child(void) {
+    while (pool_head) {
+        PoolTask * task = pool_head;
+        pool_head = task->next;
+        free(task);
+    }
+    pool_tail = NULL;
+    pool_workers = 0;
+    pool_idle = 0;
+    las_cond_init(&pool_cond);
+    las_mutex_unlock(&pool_mutex);
+}
+
+static void pool_register_fork(void) {
+    pthread_atfork(pool_fork_prepare, pool_fork_parent, pool_fork_child);
+}
+#endif
+
+static void pool_main(void * unused) {
+    (void)unused;
+    las_mutex_lock(&pool_mutex);
+    for (;;) {
+        while (pool_head == NULL) {
+            pool_idle += 1;
+            las_cond_wait(&pool_cond, &pool_mutex);
+            pool_idle -= 1;
+        }
+        PoolTask * task = pool_head;
+        pool_head = task->next;
+        if (pool_head == NULL) {
+            pool_tail = NULL;
+        }
+        las_mutex_unlock(&pool_mutex);
+
+        task->work(task->context);
+        free(task);
+
+        las_mutex_lock(&pool_mutex);
+    }
+}
+
+int las_pool_submit(void (*work)(void * context), void * context) {
+    PoolTask * task = (PoolTask *)malloc(sizeof(PoolTask));
+    if (!task) {
+        return -1;
+    }
+    task->work = work;
+    task->context = context;
+    task->next = NULL;
+
+    int max_workers = las_cpu_count() > 2 ? las_cpu_count() : 2;
+
+#ifndef _WIN32
+    pthread_once(&pool_fork_once, pool_register_fork);
+#endif
+    las_mutex_lock(&pool_mutex);
+    if (pool_idle == 0 && pool_workers < max_workers) {
+        las_thread thread;
+        if (las_thread_create(&thread, pool_main, NULL) == 0) {
+            las_thread_detach(thread);
+            pool_workers += 1;
+        } else if (pool_workers == 0) {
+            las_mutex_unlock(&pool_mutex);
+            free(task);
+            return -1; // nothing would ever run the task.
+        }
+    }
+    if (pool_tail) {
+        pool_tail->next = task;
+    } else {
+        pool_head = task;
+    }
+    pool_tail = task;
+    las_cond_signal(&pool_cond);
+    las_mutex_unlock(&pool_mutex);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef LAS_2G_THREAD_H
+#define LAS_2G_THREAD_H
+
+/**
+ * @brief Minimal portable threads, mutexes and condition variables (pthreads or Win32).
+ *
+ */
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE las_thread;
+typedef SRWLOCK las_mutex;
+typedef CONDITION_VARIABLE las_cond;
+#define LAS_MUTEX_INITIALIZER SRWLOCK_INIT
+#define LAS_COND_INITIALIZER CONDITION_VARIABLE_INIT
+#else
+#include <pthread.h>
+typedef pthread_t las_thread;
+typedef pthread_mutex_t las_mutex;
+typedef pthread_cond_t las_cond;
+#define LAS_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define LAS_COND_INITIALIZER PTHREAD_COND_INITIALIZER
+#endif
+
+/**
+ * @brief Start a thread running function(argument).
+ *
+ * @param thread
+ * @param function
+ * @param argument
+ * @return int 0 on success, -1 on failure.
+ */
+int las_thread_create(las_thread * thread, void (*function)(void *), void * argument);
+
+/**
+ * @brief Wait for a thread to finish and release it.
+ *
+ * @param thread
+ */
+void las_thread_join(las_thread thread);
+
+/**
+ * @brief Let a thread run on its own, its resources are released when it finishes.
+ *
+ * @param thread
+ */
+void las_thread_detach(las_thread thread);
+
+void las_mutex_init(las_mutex * mutex);
+void las_mutex_destroy(las_mutex * mutex);
+void las_mutex_lock(las_mutex * mutex);
+void las_mutex_unlock(las_mutex * mutex);
+
+void las_cond_init(las_cond * cond);
+void las_cond_destroy(las_cond * cond);
+void las_cond_wait(las_cond * cond, las_mutex * mutex);
+void las_cond_signal(las_cond * cond);
+void las_cond_broadcast(las_cond * cond);
+
+/**
+ * @brief Number of online processors, at least 1.
+ *
+ * @return int
+ */
+int las_cpu_count(void);
+
+/**
+ * @brief Run work(context, item) for every item in [0, count) with work stealing. Each
+ * worker starts on its own contiguous share of the items and, once done, steals half of the
+ * remaining items of another worker, so uneven items balance out. The calling thread is one
+ * of the workers, the others are tasks on the las_pool_submit pool, so no thread is started
+ * per call. Helpers the pool has not started by the time the caller runs out of items are
+ * not waited for, and the call returns once every item is done.
+ *
+ * @param count number of items
+ * @param threads number of workers, 0 for las_cpu_count()
+ * @param work called once per item, from any worker
+ * @param context passed to work
+ */
+void las_parallel_for(size_t count, int threads, void (*work)(void * context, size_t item), void * context);
+
+/**
+ * @brief Queue work(context) on the process wide pool of background threads. Workers are
+ * started as tasks arrive, up to las_cpu_count() (at least two), and run until the process
+ * exits. Tasks start in the order they were submitted. A child made by fork() starts with an
+ * empty pool.
+ *
+ * @param work
+ * @param context passed to work
+ * @return int 0 on success, -1 if the task could not be queued.
+ */
+int las_pool_submit(void (*work)(void * context), void * context);
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file las_2g_writer.c
+ * @author Ryan Wicks
+ * @brief Double buffered LAS writer with a background flush thread.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+
+#include "las_2g_writer.h"
+#include "las_2g_stats.h"
+#include <string.h>
+
+static void flush_main(void * argument) {
+    LASBlockWriter * writer = (LASBlockWriter *)argument;
+
+    las_mutex_lock(&writer->mutex);
+    for (;;) {
+        while (!writer->flushing && !writer->closing) {
+            las_cond_wait(&writer->cond, &writer->mutex);
+        }
+        if (!writer->flushing) {
+            break;
+        }
+
+        const uint8_t * block = writer->blocks[writer->flush_block];
+        size_t size = writer->flush_size;
+        las_mutex_unlock(&writer->mutex);
+
+        uint64_t start = las_stats_clock();
+        size_t written = fwrite(block, 1, size, writer->fid);
+        las_stats_phase(LAS_PHASE_WRITE, start);
+        las_stats_add(LAS_COUNTER_BYTES_WRITTEN, written);
+        int ok = written == size;
+
+        las_mutex_lock(&writer->mutex);
+        if (!ok) {
+            writer->error = 1;
+        }
+        writer->flushing = 0;
+        las_cond_broadcast(&writer->cond);
+    }
+    las_mutex_unlock(&writer->mutex);
+}
+
+/**
+ * @brief Hand the active block to the flush thread once it has finished the previous one.
+ */
+static int submit_block(LASBlockWriter * writer) {
+    las_mutex_lock(&writer->mutex);
+    while (writer->flushing) {
+        las_cond_wait(&writer->cond, &writer->mutex);
+    }
+    int error = writer->error;
+    if (!error && writer->used > 0) {
+        writer->flush_block = writer->active;
+        writer->flush_size = writer->used;
+        writer->flushing = 1;
+        las_cond_broadcast(&writer->cond);
+
+        writer->active = 1 - writer->active;
+        writer->used = 0;
+    }
+    las_mutex_unlock(&writer->mutex);
+
+    return error ? -1 : 0;
+}
+
+/**
+ * @brief Get room for size bytes at the end of the active block.
+ */
+static uint8_t * reserve(LASBlockWriter * writer, size_t size) {
+    if (writer->used + size > writer->capacity[writer->active]) {
+        if (submit_block(writer) < 0) {
+            return NULL;
+        }
+        // the block that is now active is not being flushed, so it can grow.
+        if (size > writer->capacity[writer->active]) {
+            uint8_t * block = (uint8_t *)realloc(writer->blocks[writer->active], size);
+            if (!block) {
+                return NULL;
+            }
+            las_stats_allocation(size);
+            writer->blocks[writer->active] = block;
+            writer->capacity[writer->active] = size;
+        }
+    }
+
+    uint8_t * position = writer->blocks[writer->active] + writer->used;
+    writer->used += size;
+    return position;
+}
+
+int open_block_writer(LASBlockWriter * writer, const char * filename, size_t block_size) {
+    memset(writer, 0, sizeof(LASBlockWriter));
+
+    writer->blocks[0] = (uint8_t *)malloc(block_size);
+    writer->blocks[1] = (uint8_t *)malloc(block_size);
+    if (!writer->blocks[0] || !writer->blocks[1]) {
+        free(writer->blocks[0]);
+        free(writer->blocks[1]);
+        return -1;
+    }
+    las_stats_allocation(2 * block_size);
+    writer->capacity[0] = block_size;
+    writer->capacity[1] = block_size;
+
+    writer->fid = fopen(filename, "wb");
+    if (writer->fid == NULL) {
+        free(writer->blocks[0]);
+        free(writer->blocks[1]);
+        return -1;
+    }
+
+    las_mutex_init(&writer->mutex);
+    las_mutex_init(&writer->producer);
+    las_cond_init(&writer->cond);
+    if (las_thread_create(&writer->thread, flush_main, writer) < 0) {
+        las_cond_destroy(&writer->cond);
+        las_mutex_destroy(&writer->producer);
+        las_mutex_destroy(&writer->mutex);
+        fclose(writer->fid);
+        free(writer->blocks[0]);
+        free(writer->blocks[1]);
+        return -1;
+    }
+
+    return 0;
+}
+
+int block_writer_append_columns(LASBlockWriter * writer, uint64_t profile_time,
+                                const double * x, const double * y, const double * z,
+                                const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                                uint32_t number_of_points) {
+    las_mutex_lock(&writer->producer);
+    uint8_t * position = reserve(writer, sizeof(LASHeader) + (size_t)number_of_points * sizeof(LASEntry));
+    if (position) {
+        fillLASHeader((LASHeader *)position, profile_time, number_of_points);
+        encode_entries(x, y, z, intensity, quality, utc_time, number_of_points,
+                       (LASEntry *)(position + sizeof(LASHeader)));
+        set_header_bounds((LASHeader *)position, (LASEntry *)(position + sizeof(LASHeader)), number_of_points);
+        writer->number_of_profiles += 1;
+        las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, 1);
+        las_stats_add(LAS_COUNTER_POINTS_WRITTEN, number_of_points);
+    }
+    las_mutex_unlock(&writer->producer);
+
+    return position ? 0 : -1;
+}
+
+int block_writer_append_entries(LASBlockWriter * writer, uint64_t profile_time,
+                                const LASEntry * entries, uint32_t number_of_points) {
+    las_mutex_lock(&writer->producer);
+    uint8_t * position = reserve(writer, sizeof(LASHeader) + (size_t)number_of_points * sizeof(LASEntry));
+    if (position) {
+        fillLASHeader((LASHeader *)position, profile_time, number_of_points);
+        memcpy(position + sizeof(LASHeader), entries, (size_t)number_of_points * sizeof(LASEntry));
+        set_header_bounds((LASHeader *)position, entries, number_of_points);
+        writer->number_of_profiles += 1;
+        las_stats_add(LAS_COUNTER_PROFILES_WRITTEN, 1);
+        las_stats_add(LAS_COUNTER_POINTS_WRITTEN, number_of_points);
+    }
+    las_mutex_unlock(&writer->producer);
+
+    return position ? 0 : -1;
+}
+
+int close_block_writer(LASBlockWriter * writer) {
+    las_mutex_lock(&writer->producer);
+    submit_block(writer);
+
+    las_mutex_lock(&writer->mutex);
+    writer->closing = 1;
+    las_cond_broadcast(&writer->cond);
+    las_mutex_unlock(&writer->mutex);
+
+    las_thread_join(writer->thread);
+    las_mutex_unlock(&writer->producer);
+
+    int error = writer->error;
+    if (fclose(writer->fid) != 0) {
+        error = 1;
+    }
+
+    las_cond_destroy(&writer->cond);
+    las_mutex_destroy(&writer->producer);
+    las_mutex_destroy(&writer->mutex);
+    free(writer->blocks[0]);
+    free(writer->blocks[1]);
+    writer->blocks[0] = NULL;
+    writer->blocks[1] = NULL;
+    writer->fid = NULL;
+
+    return error ? -1 : 0;
+}
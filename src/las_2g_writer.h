@@ -0,0 +1,79 @@
+#ifndef LAS_2G_WRITER_H
+#define LAS_2G_WRITER_H
+
+#include "las_2g_python.h"
+#include "las_2g_thread.h"
+
+/**
+ * @brief Incremental writer that encodes profiles into one of two blocks while a
+ * background thread writes the other one to disk.
+ *
+ */
+typedef struct {
+    FILE * fid;
+    uint8_t * blocks[2];
+    size_t capacity[2];
+    int active; /// block being filled by the producer
+    size_t used; /// bytes used in the active block
+    int flushing; /// the other block is queued for, or being written by, the flush thread
+    int flush_block;
+    size_t flush_size;
+    int error; /// a write failed, the file is incomplete
+    int closing;
+    uint64_t number_of_profiles;
+    las_mutex mutex; /// protects the flush and error state shared with the flush thread
+    las_cond cond;
+    las_mutex producer; /// serialises callers appending from several threads
+    las_thread thread;
+} LASBlockWriter;
+
+/**
+ * @brief Create the output file and start the flush thread.
+ *
+ * @param writer
+ * @param filename
+ * @param block_size bytes gathered before a block is handed to the flush thread
+ * @return int 0 on success, -1 if the file could not be created or memory could not be allocated.
+ */
+int open_block_writer(LASBlockWriter * writer, const char * filename, size_t block_size);
+
+/**
+ * @brief Encode a profile from columns, with the header made the same way as initLASHeader
+ * and the entries the same way as initLASEntry.
+ *
+ * @param writer
+ * @param profile_time header time in us since unix epoch
+ * @param x,y,z coordinates in m
+ * @param intensity
+ * @param quality
+ * @param utc_time time of each point in us from the Unix epoch
+ * @param number_of_points
+ * @return int 0 on success, -1 if an earlier write failed or memory could not be allocated.
+ */
+int block_writer_append_columns(LASBlockWriter * writer, uint64_t profile_time,
+                                const double * x, const double * y, const double * z,
+                                const uint16_t * intensity, const uint8_t * quality, const uint64_t * utc_time,
+                                uint32_t number_of_points);
+
+/**
+ * @brief Append a profile from already encoded entries, with the header made the same way
+ * as initLASHeader.
+ *
+ * @param writer
+ * @param profile_time header time in us since unix epoch
+ * @param entries
+ * @param number_of_points
+ * @return int 0 on success, -1 if an earlier write failed or memory could not be allocated.
+ */
+int block_writer_append_entries(LASBlockWriter * writer, uint64_t profile_time,
+                                const LASEntry * entries, uint32_t number_of_points);
+
+/**
+ * @brief Write the remaining data, stop the flush thread and close the file.
+ *
+ * @param writer
+ * @return int 0 if every block was written, -1 otherwise.
+ */
+int close_block_writer(LASBlockWriter * writer);
+
+#endif
@@ -0,0 +1,256 @@
+/**
+ * @file las_2g_writer_module.c
+ * @author Ryan Wicks
+ * @brief Incremental LAS writer flushing on a background thread.
+ * @version 0.1
+ * @date 2020-03-07
+ *
+ * @copyright 2G Robotics Inc., Copyright (c) 2020
+ *
+ */
+#include "las_2g_python_module.h"
+#include "las_2g_writer.h"
+
+//-----------------------------------------------------------------
+// LAS Writer Definitions
+//-----------------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    LASBlockWriter writer;
+    int is_open; /// changed only while holding lock
+    las_mutex lock; /// held while the writer is used without the GIL, so close waits for a running append
+    int has_lock; /// lock is initialised
+} LASWriterPython;
+
+#define WRITER_CLOSED -3 // returned by the appends when the writer was closed while waiting for the lock
+
+static int LASWriter_close_file(LASWriterPython * self) {
+    int ret = 0;
+    if (!self->has_lock) {
+        return 0;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    las_mutex_lock(&self->lock);
+    if (self->is_open) {
+        self->is_open = 0;
+        ret = close_block_writer(&self->writer);
+    }
+    las_mutex_unlock(&self->lock);
+    Py_END_ALLOW_THREADS
+    return ret;
+}
+
+static void LASWriter_dealloc(LASWriterPython * self) {
+    LASWriter_close_file(self);
+    if (self->has_lock) {
+        las_mutex_destroy(&self->lock);
+    }
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int LASWriter_init(LASWriterPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"filename", "block_size", NULL};
+    char * filename;
+    Py_ssize_t block_size = WRITE_BLOCK_SIZE;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|n", keywords, &filename, &block_size)) {
+        return -1;
+    }
+    if (block_size < (Py_ssize_t)sizeof(LASHeader)) {
+        PyErr_SetString(PyExc_ValueError, "block_size is smaller than a LAS header.");
+        return -1;
+    }
+
+    if (!self->has_lock) {
+        las_mutex_init(&self->lock);
+        self->has_lock = 1;
+    }
+    LASWriter_close_file(self);
+
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    las_mutex_lock(&self->lock);
+    ret = self->is_open ? -1 : open_block_writer(&self->writer, filename, (size_t)block_size);
+    if (ret == 0) {
+        self->is_open = 1;
+    }
+    las_mutex_unlock(&self->lock);
+    Py_END_ALLOW_THREADS
+    if (ret < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to open output file.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int LASWriter_append_file(LASWriterPython * self, LASFilePython * las_file) {
+    LASProfileBuffer buffer = {0};
+    Py_ssize_t number_of_points = LASEntries_Encode(las_file->entries, &buffer);
+    if (number_of_points < 0) {
+        free_profile_buffer(&buffer);
+        return -2;
+    }
+
+    uint64_t profile_time = ((LASHeaderPython *)las_file->header)->utc_time;
+    int ret;
+    Py_BEGIN_ALLOW_THREADS
+    las_mutex_lock(&self->lock);
+    ret = self->is_open ? block_writer_append_entries(&self->writer, profile_time, buffer.entries, (uint32_t)number_of_points)
+                        : WRITER_CLOSED;
+    las_mutex_unlock(&self->lock);
+    Py_END_ALLOW_THREADS
+    free_profile_buffer(&buffer);
+
+    return ret;
+}
+
+static int LASWriter_append_columns(LASWriterPython * self, PyObject * args, PyObject * kwargs) {
+    static char * keywords[] = {"x", "y", "z", "intensity", "quality", "utc_time", "profile_time", NULL};
+    static const char * point_names[] = {"x", "y", "z", "intensity", "quality", "utc_time"};
+    static const char point_formats[] = {'d', 'd', 'd', 'H', 'B', 'Q'};
+    PyObject * point_objects[6];
+    PyObject * profile_time_object = Py_None;
+    Py_buffer views[6];
+    int number_of_views = 0;
+    int ret = -2;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOOO|O", keywords,
+                                     &point_objects[0], &point_objects[1], &point_objects[2],
+                                     &point_objects[3], &point_objects[4], &point_objects[5],
+                                     &profile_time_object)) {
+        return -2;
+    }
+
+    for (; number_of_views < 6; ++number_of_views) {
+        if (LASColumn_GetBuffer(point_objects[number_of_views], point_formats[number_of_views],
+                                &views[number_of_views], point_names[number_of_views]) < 0) {
+            goto cleanup;
+        }
+    }
+
+    Py_ssize_t number_of_points = views[0].shape[0];
+    for (int i = 1; i < 6; ++i) {
+        if (views[i].shape[0] != number_of_points) {
+            PyErr_SetString(PyExc_ValueError, "All point columns must have the same length.");
+            goto cleanup;
+        }
+    }
+    if ((uint64_t)number_of_points > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "Profile point counts must be between 0 and 2^32-1.");
+        goto cleanup;
+    }
+
+    uint64_t profile_time = number_of_points > 0 ? ((uint64_t *)views[5].buf)[0] : 0;
+    if (profile_time_object != Py_None) {
+        profile_time = PyLong_AsUnsignedLongLong(profile_time_object);
+        if (PyErr_Occurred()) {
+            goto cleanup;
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    las_mutex_lock(&self->lock);
+    ret = self->is_open ? block_writer_append_columns(&self->writer, profile_time,
+                                                      (double *)views[0].buf, (double *)views[1].buf, (double *)views[2].buf,
+                                                      (uint16_t *)views[3].buf, (uint8_t *)views[4].buf, (uint64_t *)views[5].buf,
+                                                      (uint32_t)number_of_points)
+                        : WRITER_CLOSED;
+    las_mutex_unlock(&self->lock);
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    for (int i = 0; i < number_of_views; ++i) {
+        PyBuffer_Release(&views[i]);
+    }
+    return ret;
+}
+
+static PyObject * LASWriter_append_profile(LASWriterPython * self, PyObject * args, PyObject * kwargs) {
+    if (!self->is_open) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed LASWriter.");
+        return NULL;
+    }
+
+    int ret;
+    if (PyTuple_GET_SIZE(args) == 1 && (kwargs == NULL || PyDict_Size(kwargs) == 0) &&
+        PyObject_TypeCheck(PyTuple_GET_ITEM(args, 0), &LASFilePythonType)) {
+        ret = LASWriter_append_file(self, (LASFilePython *)PyTuple_GET_ITEM(args, 0));
+    } else {
+        ret = LASWriter_append_columns(self, args, kwargs);
+    }
+
+    if (ret == WRITER_CLOSED) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed LASWriter.");
+    } else if (ret == -1 && !PyErr_Occurred()) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to save LAS file.");
+    }
+    if (ret < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASWriter_close(LASWriterPython * self, PyObject * Py_UNUSED(ignored)) {
+    if (LASWriter_close_file(self) < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to save LAS file.");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * LASWriter_enter(LASWriterPython * self, PyObject * Py_UNUSED(ignored)) {
+    if (!self->is_open) {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed LASWriter.");
+        return NULL;
+    }
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject * LASWriter_exit(LASWriterPython * self, PyObject * args) {
+    if (LASWriter_close_file(self) < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to save LAS file.");
+        return NULL;
+    }
+    Py_RETURN_FALSE;
+}
+
+static PyObject * LASWriter_get_number_of_profiles(LASWriterPython * self, void * closure) {
+    return PyLong_FromUnsignedLongLong(self->writer.number_of_profiles);
+}
+
+static PyMethodDef LASWriter_methods[] = {
+    {"append_profile", (PyCFunction) LASWriter_append_profile, METH_VARARGS | METH_KEYWORDS,
+        "append_profile(las_file)\n"
+        "append_profile(x, y, z, intensity, quality, utc_time, profile_time=None)\n\n"
+        "Encode one profile, either a LASFile or point columns (float64 x/y/z, uint16 intensity,\n"
+        "uint8 quality, uint64 utc_time). The header is stamped with profile_time, or the time\n"
+        "of the first point."},
+    {"close", (PyCFunction) LASWriter_close, METH_NOARGS, "Write the remaining profiles and close the file, after an append running on another thread."},
+    {"__enter__", (PyCFunction) LASWriter_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction) LASWriter_exit, METH_VARARGS, NULL},
+    {NULL} //sentinel
+};
+
+static PyGetSetDef LASWriter_getset[] = {
+    {"number_of_profiles", (getter) LASWriter_get_number_of_profiles, NULL, "Number of profiles appended.", NULL},
+    {NULL} //sentinel
+};
+
+PyTypeObject LASWriterPythonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "las_2g.LASWriter",
+    .tp_doc = "LASWriter(filename, block_size=4 MiB)\n\n"
+              "Writes a LAS file one profile at a time. Profiles are encoded into one block while\n"
+              "a background thread writes the previous block to disk.",
+    .tp_basicsize = sizeof(LASWriterPython),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) LASWriter_init,
+    .tp_dealloc = (destructor) LASWriter_dealloc,
+    .tp_methods = LASWriter_methods,
+    .tp_getset = LASWriter_getset,
+};
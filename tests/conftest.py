@@ -0,0 +1,38 @@
+import os
+import pytest
+
+data_directory = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data")
+
+# one profile of 1400 points each, all with the same header time.
+survey_files = [os.path.join(data_directory, "data_2014_255_80517711.427000.las"),
+                os.path.join(data_directory, "data_2015_256_80517712.427000.las"),
+                os.path.join(data_directory, "data_2016_257_80517713.427000.las")
+                ]
+
+
+def survey_bytes(filenames):
+    data = b""
+    for filename in filenames:
+        with open(filename, "rb") as fid:
+            data += fid.read()
+    return data
+
+
+@pytest.fixture
+def filenames_in():
+    return list(survey_files)
+
+
+@pytest.fixture
+def make_survey(tmp_path):
+    """make_survey(filenames=None, name="survey.las") -> path of the files concatenated in tmp_path."""
+    def make(filenames=None, name="survey.las"):
+        path = tmp_path / name
+        path.write_bytes(survey_bytes(survey_files if filenames is None else filenames))
+        return str(path)
+    return make
+
+
+@pytest.fixture
+def concatenated_survey(make_survey):
+    return make_survey()
@@ -0,0 +1,117 @@
+import las_2g
+import array
+import ctypes
+import os
+import sys
+import pytest
+
+
+# the Arrow C data interface structures, read through ctypes so pyarrow is not needed.
+class ArrowSchema(ctypes.Structure):
+    pass
+
+
+ArrowSchema._fields_ = [("format", ctypes.c_char_p), ("name", ctypes.c_char_p),
+                        ("metadata", ctypes.c_char_p), ("flags", ctypes.c_int64),
+                        ("n_children", ctypes.c_int64),
+                        ("children", ctypes.POINTER(ctypes.POINTER(ArrowSchema))),
+                        ("dictionary", ctypes.c_void_p), ("release", ctypes.c_void_p),
+                        ("private_data", ctypes.c_void_p)]
+
+
+class ArrowArray(ctypes.Structure):
+    pass
+
+
+ArrowArray._fields_ = [("length", ctypes.c_int64), ("null_count", ctypes.c_int64),
+                       ("offset", ctypes.c_int64), ("n_buffers", ctypes.c_int64),
+                       ("n_children", ctypes.c_int64),
+                       ("buffers", ctypes.POINTER(ctypes.c_void_p)),
+                       ("children", ctypes.POINTER(ctypes.POINTER(ArrowArray))),
+                       ("dictionary", ctypes.c_void_p), ("release", ctypes.c_void_p),
+                       ("private_data", ctypes.c_void_p)]
+
+
+class ArrowArrayStream(ctypes.Structure):
+    _fields_ = [("get_schema", ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.POINTER(ArrowSchema))),
+                ("get_next", ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.POINTER(ArrowArray))),
+                ("get_last_error", ctypes.c_void_p),
+                ("release", ctypes.CFUNCTYPE(None, ctypes.c_void_p)),
+                ("private_data", ctypes.c_void_p)]
+
+
+def capsule_pointer(capsule, name, structure):
+    get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+    get_pointer.restype = ctypes.c_void_p
+    get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+    return ctypes.cast(get_pointer(capsule, name), ctypes.POINTER(structure)).contents
+
+
+def column_address(column):
+    return ctypes.addressof(ctypes.c_char.from_buffer(column))
+
+
+def test_arrow_array_shares_columns(filenames_in):
+    columns = las_2g.read_las_columns(filenames_in[0], fields=["x", "quality"])
+    schema_capsule, array_capsule = columns.__arrow_c_array__()
+    schema = capsule_pointer(schema_capsule, b"arrow_schema", ArrowSchema)
+    exported = capsule_pointer(array_capsule, b"arrow_array", ArrowArray)
+
+    children = [schema.children[i].contents for i in range(schema.n_children)]
+    assert (schema.format == b"+s")
+    assert ([(child.name, child.format) for child in children] ==
+            [(b"x", b"g"), (b"quality", b"C"), (b"profile_id", b"I")])
+
+    assert (exported.length == 1400)
+    assert (exported.n_children == 3)
+    arrays = [exported.children[i].contents for i in range(exported.n_children)]
+    assert ([child.buffers[1] for child in arrays] ==
+            [column_address(columns.x), column_address(columns.quality), column_address(columns.profile_id)])
+    assert (list(columns.profile_id) == [0] * 1400)
+
+    # the capsules keep the columns alive on their own.
+    x = columns.x[17]
+    del columns
+    assert (ctypes.cast(arrays[0].buffers[1], ctypes.POINTER(ctypes.c_double))[17] == x)
+
+
+def test_arrow_stream_batches_whole_profiles():
+    counts = [40000, 40000, 10000]
+    number_of_points = sum(counts)
+    x = array.array("d", [i * 0.001 for i in range(number_of_points)])
+    las_2g.write_las_columns("test_arrow.las", x, x, x, array.array("H", [7]) * number_of_points,
+                             array.array("B", [1]) * number_of_points,
+                             array.array("Q", [1585756253000000 + i for i in range(number_of_points)]),
+                             counts=array.array("I", counts))
+    columns = las_2g.read_las_columns("test_arrow.las")
+    os.remove("test_arrow.las")
+
+    references = sys.getrefcount(columns)
+    stream_capsule = columns.__arrow_c_stream__()
+    stream = capsule_pointer(stream_capsule, b"arrow_array_stream", ArrowArrayStream)
+    stream_address = ctypes.addressof(stream)
+
+    schema = ArrowSchema()
+    assert (stream.get_schema(stream_address, ctypes.byref(schema)) == 0)
+    assert (schema.n_children == 7)
+    assert (schema.children[5].contents.format == b"tsu:UTC")
+
+    batches = []
+    while True:
+        batch = ArrowArray()
+        assert (stream.get_next(stream_address, ctypes.byref(batch)) == 0)
+        if not batch.release:
+            break
+        profile_id = batch.children[6].contents
+        ids = ctypes.cast(profile_id.buffers[1], ctypes.POINTER(ctypes.c_uint32))
+        batches.append((batch.length, profile_id.offset, ids[profile_id.offset]))
+        ctypes.CFUNCTYPE(None, ctypes.c_void_p)(batch.release)(ctypes.addressof(batch))
+
+    assert (batches == [(80000, 0, 0), (10000, 80000, 2)])
+    ctypes.CFUNCTYPE(None, ctypes.c_void_p)(schema.release)(ctypes.addressof(schema))
+    del stream_capsule
+    assert (sys.getrefcount(columns) == references)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
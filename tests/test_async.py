@@ -0,0 +1,68 @@
+import asyncio
+import las_2g
+import multiprocessing
+import pytest
+
+
+def test_read_write_async(filenames_in, tmp_path):
+    temp_file = str(tmp_path / "async_write.las")
+
+    async def main():
+        data = await las_2g.read_las_async(filenames_in[0])
+        await las_2g.write_las_async(temp_file, data)
+        return data, await las_2g.read_las_async(temp_file, fields=["x", "utc_time"])
+
+    data, data_out = asyncio.run(main())
+    assert (len(data_out) == len(data) == 1)
+    assert (data_out[0].header.utc_time == data[0].header.utc_time)
+    assert (data_out[0].entries[1399].x == data[0].entries[1399].x)
+    assert (data_out[0].entries[1399].y == 0.0)
+
+    async def missing():
+        try:
+            await las_2g.read_las_async("does_not_exist.las")
+        except RuntimeError:
+            return True
+        return False
+
+    assert (asyncio.run(missing()))
+
+
+def test_iter_las_async(filenames_in, make_survey):
+    temp_file = make_survey(filenames_in * 4)
+    expected = las_2g.read_las(temp_file)
+
+    async def main(prefetch):
+        profiles = []
+        async for las_file in las_2g.iter_las_async(temp_file, prefetch=prefetch):
+            await asyncio.sleep(0)
+            profiles.append(las_file)
+        return profiles
+
+    for prefetch in [1, 3, 16]:
+        profiles = asyncio.run(main(prefetch))
+        assert (len(profiles) == 12)
+        for las_file, expected_file in zip(profiles, expected):
+            assert (las_file.header.utc_time == expected_file.header.utc_time)
+            assert (las_file.entries[700].z == expected_file.entries[700].z)
+
+
+def read_async(filename):
+    async def main():
+        data = await las_2g.read_las_async(filename)
+        profiles = [las_file async for las_file in las_2g.iter_las_async(filename, prefetch=2)]
+        return [las_file.entries[700].z for las_file in data + profiles]
+
+    return asyncio.run(main())
+
+
+def test_async_after_fork(filenames_in, make_survey):
+    # the pool running the parent's reads is not carried into the forked children.
+    temp_file = make_survey(filenames_in * 2)
+    expected = read_async(temp_file)
+    with multiprocessing.get_context("fork").Pool(2) as pool:
+        assert (pool.map_async(read_async, [temp_file] * 4).get(timeout=60) == [expected] * 4)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
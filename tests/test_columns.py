@@ -0,0 +1,132 @@
+import las_2g
+import array
+import multiprocessing
+import os
+import pytest
+
+
+def assert_quantised_equal(a, b):
+    # initLASEntry truncates to the 1e-6 m point scale
+    assert (abs(a - b) < 2e-6)
+
+
+def test_read_columns_matches_read_las(filenames_in):
+    data = las_2g.read_las(filenames_in[0])
+    columns = las_2g.read_las_columns(filenames_in[0])
+
+    assert (columns.number_of_profiles == 1)
+    assert (columns.number_of_points == 1400)
+    assert (list(columns.offsets) == [0, 1400])
+
+    x = memoryview(columns.x)
+    intensity = memoryview(columns.intensity)
+    utc_time = memoryview(columns.utc_time)
+    assert (x.format == "d" and intensity.format == "H" and utc_time.format == "Q")
+    for i, point in enumerate(data[0].entries):
+        assert (x[i] == point.x)
+        assert (columns.y[i] == point.y)
+        assert (columns.z[i] == point.z)
+        assert (intensity[i] == point.intensity)
+        assert (columns.quality[i] == point.quality)
+        assert (utc_time[i] == point.utc_time)
+
+
+def test_read_columns_concatenated(concatenated_survey):
+    columns = las_2g.read_las_columns(concatenated_survey)
+    data = las_2g.read_las(concatenated_survey)
+
+    assert (columns.number_of_profiles == 3)
+    assert (list(columns.offsets) == [0, 1400, 2800, 4200])
+    assert (columns.z[2800] == data[2].entries[0].z)
+
+
+def test_write_columns_round_trip(concatenated_survey):
+    temp_file = concatenated_survey
+    columns = las_2g.read_las_columns(temp_file)
+
+    las_2g.write_las_columns(temp_file, columns.x, columns.y, columns.z, columns.intensity,
+                             columns.quality, columns.utc_time, offsets=columns.offsets)
+    data = las_2g.read_las(temp_file)
+    assert (len(data) == 3)
+    assert_quantised_equal(data[1].entries[500].x, columns.x[1900])
+    assert (data[2].entries[5].utc_time == columns.utc_time[2805])
+
+    counts = array.array("I", [1000, 3200])
+    las_2g.write_las_columns(temp_file, columns.x, columns.y, columns.z, columns.intensity,
+                             columns.quality, columns.utc_time, counts=counts)
+    written = las_2g.read_las_columns(temp_file)
+
+    assert (list(written.offsets) == [0, 1000, 4200])
+    for i in [0, 999, 1000, 4199]:
+        assert_quantised_equal(written.z[i], columns.z[i])
+        assert (written.intensity[i] == columns.intensity[i])
+        assert (written.quality[i] == columns.quality[i])
+
+
+def test_write_columns_rejects_bad_input():
+    x = array.array("d", [1.0, 2.0])
+    intensity = array.array("H", [1, 2])
+    quality = array.array("B", [1, 2])
+    utc_time = array.array("Q", [1585756253000000, 1585756253000001])
+    try:
+        las_2g.write_las_columns("unused.las", x, x, x, quality, quality, utc_time, counts=array.array("I", [2]))
+        assert (False)
+    except TypeError:
+        pass
+    try:
+        las_2g.write_las_columns("unused.las", x, x, x, intensity, quality, utc_time, counts=array.array("I", [3]))
+        assert (False)
+    except ValueError:
+        pass
+    assert (not os.path.exists("unused.las"))
+
+
+def test_read_columns_threads(filenames_in, make_survey):
+    temp_file = make_survey(filenames_in * 7)
+    serial = las_2g.read_las_columns(temp_file, threads=1)
+    threaded = las_2g.read_las_columns(temp_file, threads=4)
+
+    assert (threaded.number_of_profiles == 21)
+    assert (list(threaded.offsets) == list(serial.offsets))
+    assert (list(threaded.profile_time) == list(serial.profile_time))
+    for name in ["x", "y", "z", "intensity", "quality", "utc_time"]:
+        assert (bytes(memoryview(getattr(serial, name))) == bytes(memoryview(getattr(threaded, name))))
+
+
+def read_columns_z(filename):
+    return bytes(memoryview(las_2g.read_las_columns(filename, threads=4).z))
+
+
+def test_read_columns_threads_after_fork(filenames_in, make_survey):
+    # the pool's workers are running when the children fork, they must start their own.
+    temp_file = make_survey(filenames_in * 7)
+    expected = read_columns_z(temp_file)
+    with multiprocessing.get_context("fork").Pool(2) as pool:
+        assert (pool.map_async(read_columns_z, [temp_file] * 4).get(timeout=60) == [expected] * 4)
+
+
+def test_read_many(filenames_in, concatenated_survey):
+    names = [filenames_in[0], "does_not_exist.las", concatenated_survey, filenames_in[2]]
+    columns, file_offsets, errors = las_2g.read_many(names, threads=3)
+    single = las_2g.read_las_columns(concatenated_survey)
+
+    assert (list(errors.keys()) == [1])
+    assert (list(file_offsets) == [0, 1, 1, 4, 5])
+    assert (columns.number_of_points == 7000)
+    assert (list(columns.offsets) == [0, 1400, 2800, 4200, 5600, 7000])
+    for i in [0, 1399, 2800, 4199]:
+        assert (columns.z[1400 + i] == single.z[i])
+        assert (columns.utc_time[1400 + i] == single.utc_time[i])
+    assert (columns.profile_time[4] == single.profile_time[2])
+
+
+def test_read_many_serial_matches_threaded(filenames_in):
+    serial, _, _ = las_2g.read_many(filenames_in, threads=1)
+    threaded, _, errors = las_2g.read_many(filenames_in)
+    assert (not errors)
+    assert (bytes(memoryview(serial.x)) == bytes(memoryview(threaded.x)))
+    assert (bytes(memoryview(serial.utc_time)) == bytes(memoryview(threaded.utc_time)))
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,65 @@
+import las_2g
+import array
+import os
+import pytest
+
+
+def test_compress_round_trip(concatenated_survey, tmp_path):
+    compressed_file = str(tmp_path / "survey.las2gz")
+    restored_file = str(tmp_path / "restored.las")
+    assert (las_2g.compress_las(concatenated_survey, compressed_file, threads=2) == 3)
+    assert (las_2g.decompress_las(compressed_file, restored_file) == 3)
+
+    with open(concatenated_survey, "rb") as f:
+        original = f.read()
+    with open(restored_file, "rb") as f:
+        restored = f.read()
+
+    assert (restored == original)
+    assert (os.path.getsize(compressed_file) * 4 < len(original))
+
+
+def test_read_write_compressed(concatenated_survey, tmp_path):
+    compressed_file = str(tmp_path / "survey.las2gz")
+    data = las_2g.read_las(concatenated_survey)
+    las_2g.write_las(compressed_file, data)
+    with open(compressed_file, "rb") as f:
+        signature = f.read(8)
+    compressed = las_2g.read_las(compressed_file)
+
+    # ten profiles of 100 points, profile i spans x in [10 i, 10 i + 9.9].
+    grid_file = str(tmp_path / "grid.las")
+    x = array.array("d", [(i // 100) * 10.0 + (i % 100) * 0.1 for i in range(1000)])
+    quality = array.array("B", [i // 100 for i in range(1000)])
+    las_2g.write_las_columns(grid_file, x, x, x, array.array("H", [7] * 1000), quality,
+                             array.array("Q", [1585756253000000 + i for i in range(1000)]),
+                             counts=array.array("I", [100] * 10))
+    las_2g.compress_las(grid_file, grid_file + "2gz")
+    selected = las_2g.read_las(grid_file + "2gz", bbox=(25.0, 25.0, 41.0, 41.0))
+
+    assert (signature == b"LAS2GCMP")
+    assert (len(compressed) == 3)
+    for a, b in zip(data, compressed):
+        assert (a.header.utc_time == b.header.utc_time)
+        assert (a.entries[1234].x == b.entries[1234].x)
+        assert (a.entries[1234].utc_time == b.entries[1234].utc_time)
+    assert ([las_file.entries[0].quality for las_file in selected] == [2, 3, 4])
+
+
+def test_corrupt_compressed_file(concatenated_survey, tmp_path):
+    compressed_file = str(tmp_path / "survey.las2gz")
+    las_2g.compress_las(concatenated_survey, compressed_file)
+    with open(compressed_file, "rb") as f:
+        contents = f.read()
+    with open(compressed_file, "wb") as f:
+        f.write(contents[:len(contents) // 2])
+
+    try:
+        las_2g.read_las(compressed_file)
+        assert False
+    except RuntimeError:
+        pass
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,50 @@
+import las_2g
+import os
+import pytest
+
+
+def file_bytes(filename):
+    with open(filename, "rb") as fid:
+        return fid.read()
+
+
+def test_concat(filenames_in):
+    temp_file = "test_concat.las"
+    assert (las_2g.concat(filenames_in, temp_file) == 3)
+    assert (file_bytes(temp_file) == b"".join(file_bytes(f) for f in filenames_in))
+
+    try:
+        las_2g.concat([filenames_in[0], temp_file], temp_file)
+        assert (False)
+    except ValueError:
+        pass
+    os.remove(temp_file)
+
+
+def test_extract(filenames_in):
+    source_file = "test_extract_source.las"
+    temp_file = "test_extract.las"
+    las_2g.concat(filenames_in, source_file)
+    data = file_bytes(source_file)
+    size = len(data) // 3
+    times = [las_file.header.utc_time for las_file in las_2g.read_las(source_file)]
+
+    assert (las_2g.extract(source_file, temp_file, profiles=[2, 0]) == 2)
+    assert (file_bytes(temp_file) == data[2 * size:] + data[:size])
+
+    assert (las_2g.extract(source_file, temp_file, time_range=(times[1], None)) == 3)
+    assert (file_bytes(temp_file) == data)
+    assert (las_2g.extract(source_file, temp_file, profiles=[1], time_range=(None, 1)) == 0)
+    assert (file_bytes(temp_file) == b"")
+
+    try:
+        las_2g.extract(source_file, temp_file, profiles=[3])
+        assert (False)
+    except IndexError:
+        pass
+    os.remove(source_file)
+    os.remove(temp_file)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
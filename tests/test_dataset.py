@@ -0,0 +1,64 @@
+import las_2g
+import pytest
+import threading
+
+
+def test_dataset_matches_read_las(concatenated_survey):
+    data = las_2g.read_las(concatenated_survey)
+
+    with las_2g.LASDataset(concatenated_survey) as dataset:
+        assert (len(dataset) == 3)
+        assert (dataset.number_of_points == 4200)
+        last = dataset[-1]
+        sliced = dataset[0:3:2]
+
+    assert (last.header.number_of_points == 1400)
+    assert (len(sliced) == 2)
+    for a, b in [(last, data[2]), (sliced[0], data[0]), (sliced[1], data[2])]:
+        assert (a.entries[700].x == b.entries[700].x)
+        assert (a.entries[700].utc_time == b.entries[700].utc_time)
+
+
+def test_dataset_closed(filenames_in):
+    dataset = las_2g.LASDataset(filenames_in[0])
+    dataset.close()
+    try:
+        len(dataset)
+        assert (False)
+    except ValueError:
+        pass
+
+
+def test_close_while_decoding(filenames_in, make_survey):
+    # close() while other threads decode columns waits for them, later calls see a closed dataset.
+    dataset = las_2g.LASDataset(make_survey(filenames_in * 10))
+    lengths = []
+    decoding = threading.Event()
+
+    def decode():
+        try:
+            while True:
+                lengths.append(len(dataset.columns(threads=2).x))
+                las_2g.profile_stats(dataset)
+                decoding.set()
+        except ValueError:
+            pass
+
+    threads = [threading.Thread(target=decode) for i in range(3)]
+    for thread in threads:
+        thread.start()
+    decoding.wait()
+    dataset.close()
+    for thread in threads:
+        thread.join()
+    assert (set(lengths) == {30 * 1400})
+
+    # the deferred close has run, so the dataset can be opened again.
+    dataset.__init__(filenames_in[0])
+    assert (len(dataset) == 1)
+    assert (len(dataset.columns().x) == 1400)
+    dataset.close()
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
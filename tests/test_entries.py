@@ -0,0 +1,92 @@
+import las_2g
+import os
+import pytest
+
+
+def test_entry_list(filenames_in):
+    entries = las_2g.read_las(filenames_in[0])[0].entries
+    assert (isinstance(entries, las_2g.LASEntryList))
+    assert (len(entries) == 1400)
+    assert (entries[-1].utc_time == entries[1399].utc_time)
+    assert ([entry.x for entry in entries[10:13]] == [entries[i].x for i in range(10, 13)])
+    assert (sum(1 for _ in entries) == 1400)
+
+    # entries are views of the records, writes show through every view.
+    entry = entries[500]
+    entry.intensity = 234
+    entry.z = 3.0
+    assert (entries[500].intensity == 234)
+    assert (round(entries[500].z, 6) == 3.0)
+
+    entries[501] = las_2g.LASEntry(1.0, 2.0, 3.0, 7, 8, 1585756253000000)
+    assert (entries[501].quality == 8)
+    assert (entries[501].utc_time == 1585756253000000)
+
+
+def test_write_entry_lists_and_lists(filenames_in):
+    data = las_2g.read_las(filenames_in[1])
+    standalone = las_2g.LASFile()
+    standalone.entries.append(las_2g.LASEntry(1.0, 2.0, 3.0, 4, 5, 1585756253000000))
+    standalone.header.number_of_points = 1
+    data.append(standalone)
+
+    temp_file = "test_output_entries.las"
+    las_2g.write_las(temp_file, data)
+    with open(temp_file, "rb") as f:
+        written = f.read()
+    read_back = las_2g.read_las(temp_file)
+    os.remove(temp_file)
+
+    # records read from a file are written back as they are.
+    with open(filenames_in[1], "rb") as f:
+        original = f.read()
+    assert (written[227:len(original)] == original[227:])
+    assert (read_back[1].entries[0].intensity == 4)
+    assert (read_back[1].entries[0].utc_time == 1585756253000000)
+
+
+def test_fields_not_read(filenames_in):
+    entries = las_2g.read_las(filenames_in[2], fields=("z",))[0].entries
+    assert (entries[3].x == 0.0)
+    entries[3].z = 1.5
+    try:
+        entries[3].x = 1.0
+        assert False
+    except AttributeError:
+        pass
+
+
+def test_entry_list_changes_like_a_list(filenames_in):
+    assert (isinstance(las_2g.LASFile().entries, las_2g.LASEntryList))
+
+    entries = las_2g.read_las(filenames_in[0])[0].entries
+    first, second, last = entries[0].x, entries[1].x, entries[1399].x
+    entries.append(las_2g.LASEntry(1.0, 2.0, 3.0, 4, 5, 1585756253000000))
+    entries.insert(0, entries[1400])
+    entries.extend([las_2g.LASEntry(6.0, 7.0, 8.0, 9, 10, 1585756254000000)] * 2)
+    assert (len(entries) == 1404)
+    assert (entries[0].intensity == 4 and entries[1].x == first)
+    assert (entries[1400].x == last)
+
+    popped = entries.pop()
+    assert (popped.intensity == 9 and len(entries) == 1403)
+    entries.pop(0).intensity = 11
+    del entries[0]
+    assert (len(entries) == 1401 and entries[0].x == second)
+    assert (entries[1400].utc_time == 1585756254000000)
+
+    view = memoryview(entries)
+    with pytest.raises(BufferError):
+        entries.append(popped)
+    view.release()
+    entries.append(popped)
+    assert (entries[-1].intensity == 9)
+
+
+def test_entry_bad_arguments():
+    with pytest.raises(TypeError):
+        las_2g.LASEntry(1.0, 2.0)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,51 @@
+import las_2g
+import pytest
+
+
+def test_read_las_fields(filenames_in):
+    full = las_2g.read_las(filenames_in[0])
+    data = las_2g.read_las(filenames_in[0], fields=("z", "intensity"))
+
+    assert (len(data[0].entries) == 1400)
+    for a, b in zip(full[0].entries, data[0].entries):
+        assert (a.z == b.z and a.intensity == b.intensity)
+        assert (b.x == 0.0 and b.y == 0.0 and b.quality == 0 and b.utc_time == 0)
+
+    profiles = list(las_2g.iter_las(filenames_in[1], fields=["utc_time"]))
+    assert (profiles[0].entries[7].utc_time == las_2g.read_las(filenames_in[1])[0].entries[7].utc_time)
+    assert (profiles[0].entries[7].z == 0.0)
+
+
+def test_read_columns_fields(filenames_in):
+    full = las_2g.read_las_columns(filenames_in[0])
+    columns = las_2g.read_las_columns(filenames_in[0], fields=("utc_time",))
+
+    assert (columns.x is None and columns.z is None and columns.quality is None)
+    assert (columns.number_of_points == 1400)
+    assert (bytes(memoryview(columns.utc_time)) == bytes(memoryview(full.utc_time)))
+
+    try:
+        las_2g.read_las_columns(filenames_in[0], fields=("z", "colour"))
+        assert (False)
+    except ValueError:
+        pass
+
+
+def test_dataset_fields(concatenated_survey):
+    temp_file = concatenated_survey
+    full = las_2g.read_las_columns(temp_file)
+
+    with las_2g.LASDataset(temp_file, fields=("x",)) as dataset:
+        assert (dataset[2].entries[3].x == full.x[2803])
+        assert (dataset[2].entries[3].y == 0.0)
+
+        columns = dataset.columns(1, 3, fields=("y", "quality"))
+        assert (list(columns.offsets) == [0, 1400, 2800])
+        assert (columns.x is None)
+        assert (bytes(memoryview(columns.y)) == bytes(memoryview(full.y)[1400:]))
+        assert (columns.quality[5] == full.quality[1405])
+        assert (dataset.columns().x[4199] == full.x[4199])
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,91 @@
+import las_2g
+import array
+import os
+import pytest
+
+start_time = 1585756253000000
+
+
+def write_grid(path):
+    # ten profiles of 100 points, profile i spans x in [10 i, 10 i + 9.9] and starts at start_time + i s.
+    number_of_points = 1000
+    x = array.array("d", [(i // 100) * 10.0 + (i % 100) * 0.1 for i in range(number_of_points)])
+    y = array.array("d", [1.0 + (i % 100) * 0.01 for i in range(number_of_points)])
+    z = array.array("d", [-2.0] * number_of_points)
+    intensity = array.array("H", [i % 100 for i in range(number_of_points)])
+    quality = array.array("B", [i // 100 for i in range(number_of_points)])
+    utc_time = array.array("Q", [start_time + (i // 100) * 1000000 + (i % 100) * 100 for i in range(number_of_points)])
+    las_2g.write_las_columns(path, x, y, z, intensity, quality, utc_time, counts=array.array("I", [100] * 10))
+
+
+def test_header_bounds_and_time():
+    temp_file = "test_filter_header.las"
+    write_grid(temp_file)
+    data = las_2g.read_las(temp_file)
+    with open(temp_file, "rb") as fid:
+        fid.seek(16)
+        header_time = int.from_bytes(fid.read(8), "little")
+    os.remove(temp_file)
+
+    # guid_data_4 holds adjusted GPS seconds.
+    assert (header_time == start_time // 1000000 - 315964800 + 18 - 1000000000)
+
+    assert ([las_file.header.utc_time for las_file in data] == [start_time + i * 1000000 for i in range(10)])
+
+
+def test_filters_use_headers():
+    temp_file = "test_filter.las"
+    write_grid(temp_file)
+
+    data = las_2g.read_las(temp_file, bbox=(25.0, 0.0, 41.0, 5.0))
+    assert ([las_file.entries[0].quality for las_file in data] == [2, 3, 4])
+    data = las_2g.read_las(temp_file, bbox=(25.0, 0.0, -1.0, 41.0, 5.0, 0.0))
+    assert (len(data) == 0)
+
+    columns = las_2g.read_las_columns(temp_file, time_range=(start_time + 6000000, None))
+    assert (list(columns.offsets) == [0, 100, 200, 300, 400])
+    assert (columns.quality[0] == 6)
+
+    batches = list(las_2g.iter_las(temp_file, batch_profiles=4,
+                                   bbox=(0.0, 0.0, 100.0, 100.0), time_range=(start_time, start_time + 4500000)))
+    os.remove(temp_file)
+    assert ([len(batch) for batch in batches] == [4, 1])
+
+
+def test_filters_fall_back_to_points(concatenated_survey):
+    # the sample files carry neither bounds nor a header time.
+    temp_file = concatenated_survey
+    columns = las_2g.read_las_columns(temp_file)
+
+    x, y = columns.x[1400 + 700], columns.y[1400 + 700]
+    selected = las_2g.read_las_columns(temp_file, bbox=(x, y, x, y))
+    assert (columns.utc_time[1400] in list(selected.utc_time))
+
+    first_time = columns.utc_time[2800]
+    data = las_2g.read_las(temp_file, time_range=(first_time, first_time))
+    assert (len(data) == 1)
+    assert (data[0].entries[0].utc_time == first_time)
+
+
+def test_filters_use_header_seconds(concatenated_survey):
+    # the header time is the truncated adjusted GPS second, matched with a second of tolerance.
+    temp_file = concatenated_survey
+    columns = las_2g.read_las_columns(temp_file)
+    with open(temp_file, "r+b") as fid:
+        for profile in range(3):
+            fid.seek(profile * 39427 + 16)
+            fid.write((80517711 + profile).to_bytes(8, "little"))
+
+    header_times = [las_file.header.utc_time for las_file in las_2g.read_las(temp_file)]
+    assert (header_times == [columns.utc_time[0] // 1000000 * 1000000 + i * 1000000 for i in range(3)])
+
+    first_time = columns.utc_time[1400]
+    data = las_2g.read_las(temp_file, time_range=(first_time, first_time))
+    assert (len(data) == 1)
+    assert (data[0].entries[0].utc_time == first_time)
+    data = las_2g.read_las(temp_file, time_range=(header_times[1], header_times[2] + 999999))
+    assert ([las_file.entries[0].utc_time for las_file in data] == [columns.utc_time[1400], columns.utc_time[2800]])
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,90 @@
+import las_2g
+import math
+import os
+import pytest
+import threading
+
+
+def survey_points(columns):
+    offsets = list(columns.offsets)
+    points = {}
+    for profile in range(len(offsets) - 1):
+        for point in range(offsets[profile], offsets[profile + 1]):
+            points[(profile, point - offsets[profile])] = (columns.x[point], columns.y[point], columns.z[point])
+    return points
+
+
+def test_grid_queries(filenames_in):
+    columns = las_2g.read_las_columns(filenames_in[0])
+    points = survey_points(columns)
+    grid = las_2g.LASGrid(columns, threads=2)
+    assert (grid.number_of_points == len(points) == 1400)
+
+    x, y, z = points[(0, 700)]
+    profiles, indices = grid.box((x - 0.5, y - 0.5, x + 0.5, y + 0.5))
+    expected = sorted(key for key, p in points.items() if abs(p[0] - x) <= 0.5 and abs(p[1] - y) <= 0.5)
+    assert (sorted(zip(profiles, indices)) == expected)
+
+    profiles, indices, distances = grid.radius(x, y, z, 0.25)
+    expected = sorted(key for key, p in points.items() if math.dist(p, (x, y, z)) <= 0.25)
+    assert (sorted(zip(profiles, indices)) == expected)
+
+    profiles, indices, distances = grid.nearest(x, y, z, k=5)
+    expected = sorted(math.dist(p, (x, y, z)) for p in points.values())[:5]
+    assert (all(abs(a - b) < 1e-9 for a, b in zip(distances, expected)) and len(distances) == 5)
+    assert ((profiles[0], indices[0]) == (0, 700))
+
+
+def test_grid_save_load(filenames_in):
+    temp_file = "test_grid.lasgrid"
+    dataset = las_2g.LASDataset(filenames_in[1])
+    grid = las_2g.LASGrid(dataset, cell_size=0.1)
+    grid.save(temp_file)
+
+    loaded = las_2g.load_grid(temp_file)
+    assert (loaded.is_mapped and loaded.cell_size == 0.1)
+    assert (loaded.number_of_cells == grid.number_of_cells)
+    for query in [(0.0, 0.0, 0.0, 3), (1.0, -2.0, 0.5, 10)]:
+        assert ([list(c) for c in loaded.nearest(*query)] == [list(c) for c in grid.nearest(*query)])
+    del loaded
+
+    with pytest.raises(RuntimeError):
+        grid.__init__(dataset)
+
+    # a grid file whose cells are out of order is rejected when it is loaded.
+    with open(temp_file, "rb") as fid:
+        data = bytearray(fid.read())
+    header_size = 88
+    data[header_size:header_size + 8], data[header_size + 8:header_size + 16] = \
+        data[header_size + 8:header_size + 16], data[header_size:header_size + 8]
+    with open(temp_file, "wb") as fid:
+        fid.write(data)
+    with pytest.raises(RuntimeError):
+        las_2g.load_grid(temp_file)
+    os.remove(temp_file)
+
+
+def test_grid_built_once_across_threads(filenames_in, make_survey):
+    # only one of the threads racing through __init__ builds the grid, the others raise.
+    dataset = las_2g.LASDataset(make_survey(filenames_in * 10))
+    grid = las_2g.LASGrid.__new__(las_2g.LASGrid)
+    results = []
+
+    def build():
+        try:
+            grid.__init__(dataset, cell_size=0.1, threads=2)
+            results.append(True)
+        except RuntimeError:
+            results.append(False)
+
+    threads = [threading.Thread(target=build) for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert (sorted(results) == [False, False, False, True])
+    assert (grid.number_of_cells > 0)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
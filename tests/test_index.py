@@ -0,0 +1,54 @@
+import las_2g
+import array
+import os
+import pytest
+
+
+def test_index_time_range(concatenated_survey):
+    temp_file = concatenated_survey
+    assert (las_2g.build_index(temp_file) == 3)
+    assert (os.path.exists(temp_file + ".lasidx"))
+
+    data = las_2g.read_las(temp_file)
+    with las_2g.LASDataset(temp_file, use_index=True) as dataset:
+        assert (len(dataset) == 3)
+        t = data[1].entries[0].utc_time
+        assert (dataset.profiles_between(t, t) == [1])
+        assert (dataset.profiles_between(0, t) == [0, 1])
+        assert (dataset.profiles_between(t + 10**7, 2**63) == [])
+        assert (dataset[1].entries[0].utc_time == t)
+
+
+def test_stale_index_rebuilt(filenames_in, make_survey):
+    temp_file = make_survey(filenames_in[:2])
+    las_2g.build_index(temp_file)
+
+    make_survey(filenames_in)
+    with las_2g.LASDataset(temp_file, use_index=True) as dataset:
+        assert (len(dataset) == 3)
+
+    with open(temp_file + ".lasidx", "r+b") as fid:
+        fid.seek(100)
+        fid.write(b"\xff")
+    with las_2g.LASDataset(temp_file, use_index=True) as dataset:
+        assert (len(dataset) == 3)
+        assert (dataset[2].header.number_of_points == 1400)
+
+
+def test_index_checked_against_file(concatenated_survey):
+    # the same size and mtime, but the profiles no longer start where the index says.
+    temp_file = concatenated_survey
+    las_2g.build_index(temp_file)
+    columns = las_2g.read_las_columns(temp_file)
+    status = os.stat(temp_file)
+    las_2g.write_las_columns(temp_file, columns.x, columns.y, columns.z, columns.intensity, columns.quality,
+                             columns.utc_time, counts=array.array("I", [1000, 1400, 1800]))
+    os.utime(temp_file, ns=(status.st_atime_ns, status.st_mtime_ns))
+    assert (os.path.getsize(temp_file) == status.st_size)
+
+    with las_2g.LASDataset(temp_file, use_index=True) as dataset:
+        assert ([dataset[i].header.number_of_points for i in range(3)] == [1000, 1400, 1800])
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
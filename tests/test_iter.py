@@ -0,0 +1,60 @@
+import las_2g
+import pytest
+import threading
+
+
+def test_iter_profiles(concatenated_survey):
+    data = las_2g.read_las(concatenated_survey)
+
+    profiles = list(las_2g.iter_las(concatenated_survey))
+    batches = list(las_2g.iter_las(concatenated_survey, batch_profiles=2))
+
+    assert (len(profiles) == 3)
+    assert ([len(batch) for batch in batches] == [2, 1])
+    for a, b in [(profiles[1], data[1]), (batches[1][0], data[2])]:
+        assert (a.header.number_of_points == b.header.number_of_points)
+        assert (a.entries[10].z == b.entries[10].z)
+        assert (a.entries[10].utc_time == b.entries[10].utc_time)
+
+
+def test_iter_truncated(concatenated_survey):
+    with open(concatenated_survey, "r+b") as fid:
+        fid.truncate(39427 + 1000)
+
+    iterator = las_2g.iter_las(concatenated_survey)
+    next(iterator)
+    try:
+        next(iterator)
+        assert (False)
+    except RuntimeError:
+        pass
+
+
+def test_iter_shared_between_threads(filenames_in, make_survey):
+    # overlapping __next__ calls raise instead of sharing the file, every profile is read once.
+    iterator = las_2g.iter_las(make_survey(filenames_in * 20))
+    counts = []
+
+    def read():
+        while True:
+            try:
+                counts.append(next(iterator).header.number_of_points)
+            except StopIteration:
+                return
+            except ValueError:
+                pass
+
+    threads = [threading.Thread(target=read) for i in range(3)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert (counts == [1400] * 60)
+
+    iterator.close()
+    with pytest.raises(StopIteration):
+        next(iterator)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,37 @@
+import las_2g
+import pickle
+import pytest
+
+
+def points(las_file):
+    return [(entry.x, entry.y, entry.z, entry.intensity, entry.quality, entry.utc_time) for entry in las_file.entries]
+
+
+def test_pickle_protocols(filenames_in):
+    las_files = las_2g.read_las(filenames_in[0])
+    for protocol in range(2, pickle.HIGHEST_PROTOCOL + 1):
+        copies = pickle.loads(pickle.dumps(las_files, protocol=protocol))
+        assert (isinstance(copies[0].entries, las_2g.LASEntryList))
+        assert (copies[0].header.utc_time == las_files[0].header.utc_time)
+        assert (copies[0].header.number_of_points == las_files[0].header.number_of_points)
+        assert (points(copies[0]) == points(las_files[0]))
+
+    # an entry of a list unpickles as a standalone entry holding its values.
+    entry = pickle.loads(pickle.dumps(las_files[0].entries[10]))
+    assert ((entry.x, entry.utc_time) == (las_files[0].entries[10].x, las_files[0].entries[10].utc_time))
+
+
+def test_pickle_out_of_band(filenames_in):
+    las_file = las_2g.read_las(filenames_in[1], fields=["z", "utc_time"])[0]
+    buffers = []
+    data = pickle.dumps(las_file, protocol=5, buffer_callback=buffers.append)
+    assert (len(buffers) == 1 and buffers[0].raw().nbytes == 1400 * 28)
+    assert (len(data) < 1024)
+
+    copy = pickle.loads(data, buffers=buffers)
+    assert (points(copy) == points(las_file))
+    assert (copy.entries[0].x == 0.0)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,40 @@
+import las_2g
+import pytest
+
+
+def test_profile_stats(filenames_in):
+    columns = las_2g.read_las_columns(filenames_in[0])
+    stats = las_2g.profile_stats(filenames_in[0], intensity_bins=4, quality_bins=256)
+
+    assert (list(stats["points"]) == [1400])
+    assert (stats["min_z"][0] == min(columns.z) and stats["max_z"][0] == max(columns.z))
+    assert (abs(stats["mean_z"][0] - sum(columns.z) / 1400) < 1e-9)
+    assert (stats["start_time"][0] == min(columns.utc_time) and stats["end_time"][0] == max(columns.utc_time))
+
+    expected = [0] * 4
+    for intensity in columns.intensity:
+        expected[intensity >> 14] += 1
+    assert (list(stats["intensity_histogram"]) == expected)
+    quality = list(stats["quality_histogram"])
+    assert (all(quality[value] == list(columns.quality).count(value) for value in set(columns.quality)))
+
+
+def test_profile_stats_levels(filenames_in):
+    dataset = las_2g.LASDataset(filenames_in[1])
+    results = []
+    for level in ["scalar", "sse4.1", "avx2"]:
+        try:
+            las_2g.set_simd_level(level)
+        except ValueError:
+            continue
+        stats = las_2g.profile_stats(dataset, threads=2)
+        results.append({key: list(value) if key != "survey" else value for key, value in stats.items()})
+    las_2g.set_simd_level(None)
+
+    assert (all(result == results[0] for result in results))
+    assert (results[0]["survey"]["points"] == 1400)
+    assert (sum(results[0]["survey"]["intensity_histogram"]) == 1400)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
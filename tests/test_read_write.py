@@ -1,5 +1,6 @@
 import las_2g
 import os
+import threading
 
 filenames_in = ["tests/data/data_2014_255_80517711.427000.las",
                 "tests/data/data_2015_256_80517712.427000.las",
@@ -53,6 +54,29 @@ def test_write_file():
     assert(data[1].entries[500].utc_time == 1585756253000000)
 
 
+def test_read_write_threads():
+    results = [None] * len(filenames_in)
+
+    def round_trip(i):
+        temp_file = "test_output_%d.las" % i
+        las_2g.write_las(temp_file, las_2g.read_las(filenames_in[i]))
+        results[i] = las_2g.read_las(temp_file)
+        os.remove(temp_file)
+
+    threads = [threading.Thread(target=round_trip, args=(i,)) for i in range(len(filenames_in))]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    for i, filename in enumerate(filenames_in):
+        expected = las_2g.read_las(filename)
+        assert (len(results[i]) == 1)
+        assert_float_equal(results[i][0].entries[42].x, expected[0].entries[42].x, 5)
+        assert (results[i][0].entries[42].utc_time == expected[0].entries[42].utc_time)
+
+
 if __name__ == "__main__":
     test_read_file()
     test_write_file()
+    test_read_write_threads()
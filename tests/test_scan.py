@@ -0,0 +1,58 @@
+import las_2g
+import pytest
+
+PROFILE_SIZE = 39427
+
+
+def test_scan_intact(concatenated_survey):
+    temp_file = concatenated_survey
+    report = las_2g.scan_las(temp_file)
+    assert (report["size"] == 3 * PROFILE_SIZE)
+    assert (report["profiles"] == 3)
+    assert (report["points"] == 3 * 1400)
+    assert (report["good"] == [(0, 3 * PROFILE_SIZE)])
+    assert (report["bad"] == [])
+    assert (report["bad_bytes"] == 0)
+
+
+def test_scan_corrupt_header_and_garbage(filenames_in, concatenated_survey):
+    temp_file = concatenated_survey
+    with open(temp_file, "rb") as fid:
+        data = bytearray(fid.read())
+    data[PROFILE_SIZE:PROFILE_SIZE + 4] = b"XXXX"  # second signature destroyed
+    garbage = b"LAS" + b"\x00LASF" * 7  # false starts between the second and third profile
+    data = data[:2 * PROFILE_SIZE] + garbage + data[2 * PROFILE_SIZE:]
+    with open(temp_file, "wb") as fid:
+        fid.write(data)
+
+    report = las_2g.scan_las(temp_file)
+    assert (report["profiles"] == 2)
+    third = 2 * PROFILE_SIZE + len(garbage)
+    assert (report["good"] == [(0, PROFILE_SIZE), (third, third + PROFILE_SIZE)])
+    assert (report["bad"] == [(PROFILE_SIZE, third, "bad signature")])
+
+    salvaged = las_2g.salvage_las(temp_file)
+    expected = las_2g.read_las(filenames_in[2])[0]
+    assert (len(salvaged) == 2)
+    assert (salvaged[1].header.utc_time == expected.header.utc_time)
+    assert (salvaged[1].entries[1399].x == expected.entries[1399].x)
+
+
+def test_scan_wrong_count_and_truncated(concatenated_survey):
+    temp_file = concatenated_survey
+    with open(temp_file, "rb") as fid:
+        data = bytearray(fid.read())
+    data[107:111] = (3000).to_bytes(4, "little")  # first point count runs into the third profile
+    data = data[:-100]
+    with open(temp_file, "wb") as fid:
+        fid.write(data)
+
+    report = las_2g.scan_las(temp_file)
+    assert (report["profiles"] == 1)
+    assert (report["good"] == [(PROFILE_SIZE, 2 * PROFILE_SIZE)])
+    assert (report["bad"] == [(0, PROFILE_SIZE, "overlapped"), (2 * PROFILE_SIZE, len(data), "truncated")])
+    assert (len(las_2g.salvage_las(temp_file, fields=["x"])) == 1)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,107 @@
+import las_2g
+import multiprocessing
+import pickle
+import pytest
+import threading
+import uuid
+
+
+@pytest.fixture
+def segment_name():
+    # a name of its own per test, so concurrent runs and leftovers of failed ones do not collide.
+    return "las2g_test_" + uuid.uuid4().hex[:16]
+
+
+def sum_z(handle):
+    return (handle.number_of_points, sum(handle.columns.z))
+
+
+def test_share_attach(filenames_in):
+    columns = las_2g.read_las_columns(filenames_in[0])
+    with las_2g.share_las(filenames_in[0]) as shared:
+        name = shared.name
+        assert (shared.number_of_points == 1400 and shared.number_of_profiles == 1)
+        attached = las_2g.attach_shared(shared.name)
+        assert (shared.handles == 2)
+        for field in ["x", "y", "z", "intensity", "quality", "utc_time", "offsets", "profile_time"]:
+            assert (list(getattr(attached.columns, field)) == list(getattr(columns, field)))
+        assert (memoryview(attached.columns.x).readonly)
+
+        copy = pickle.loads(pickle.dumps(shared))
+        assert (copy.name == shared.name and shared.handles == 3)
+        copy.close()
+        attached.close()
+        assert (shared.handles == 1 and copy.closed)
+
+    # the segment is removed with its last handle.
+    try:
+        las_2g.attach_shared(name)
+        assert (False)
+    except FileNotFoundError:
+        pass
+
+
+def test_share_workers(filenames_in, segment_name):
+    shared = las_2g.share_las(filenames_in[1], name=segment_name, fields=["z"])
+    assert (shared.columns.x is None and len(shared.columns.z) == 1400)
+
+    with multiprocessing.get_context("spawn").Pool(2) as pool:
+        results = pool.map(sum_z, [shared, shared])
+    assert (results == [(1400, sum(shared.columns.z))] * 2)
+
+    # columns taken from a closed handle keep the segment mapped.
+    z = shared.columns.z
+    shared.close()
+    assert (len(z) == 1400)
+
+
+def test_share_generated_names(filenames_in):
+    first = las_2g.share_las(filenames_in[0], fields=["z"])
+    prefix, number = first.name.rsplit("_", 1)
+    # a segment already holding the next generated name is skipped over.
+    taken = las_2g.share_las(filenames_in[0], name="%s_%d" % (prefix, int(number) + 1), fields=["z"])
+
+    shared = []
+    threads = [threading.Thread(target=lambda: shared.append(las_2g.share_las(filenames_in[0], fields=["z"])))
+               for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    names = [handle.name for handle in shared]
+    assert (len(set(names + [first.name, taken.name])) == 6)
+
+    for handle in shared + [first, taken]:
+        handle.close()
+
+
+def test_share_forked_child(filenames_in, segment_name):
+    shared = las_2g.share_las(filenames_in[2], name=segment_name, fields=["z"])
+    expected = sum(shared.columns.z)
+    results = multiprocessing.get_context("fork").Queue()
+
+    def child():
+        # the inherited handle reads the parent's mapping, but only the child's own count.
+        attached = las_2g.attach_shared(segment_name)
+        results.put((sum(shared.columns.z), sum(attached.columns.z), shared.handles))
+        attached.close()
+        results.put(shared.handles)
+        shared.close()
+        # a handle left open by an exiting child is not counted once it is gone.
+        las_2g.attach_shared(segment_name)
+
+    process = multiprocessing.get_context("fork").Process(target=child)
+    process.start()
+    assert (results.get(timeout=60) == (expected, expected, 2))
+    assert (results.get(timeout=60) == 1)
+    process.join()
+    assert (process.exitcode == 0)
+
+    assert (shared.handles == 1)
+    shared.close()
+    with pytest.raises(FileNotFoundError):
+        las_2g.attach_shared(segment_name)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
@@ -0,0 +1,75 @@
+import las_2g
+import array
+import os
+
+filename_in = "tests/data/data_2014_255_80517711.427000.las"
+levels = ["scalar", "sse4.1", "avx2"]
+
+
+def supported_levels():
+    best = las_2g.simd_level()
+    return levels[:levels.index(best) + 1]
+
+
+def synthetic_columns(number_of_points):
+    # include points outside the vector conversion ranges so the scalar fallbacks are covered too.
+    x = array.array("d", [(i * 7919 % 10007) * 0.37 - 1850.0 for i in range(number_of_points)])
+    y = array.array("d", [-0.5e-6 * i for i in range(number_of_points)])
+    z = array.array("d", [2500.0 + i if i % 13 == 0 else 12.345678 * i for i in range(number_of_points)])
+    intensity = array.array("H", [i * 31 % 65536 for i in range(number_of_points)])
+    quality = array.array("B", [i % 256 for i in range(number_of_points)])
+    utc_time = array.array("Q", [0 if i == 5 else 1585756253000000 + 997 * i for i in range(number_of_points)])
+    return x, y, z, intensity, quality, utc_time
+
+
+def test_simd_decode_matches_scalar():
+    results = {}
+    try:
+        for level in supported_levels():
+            las_2g.set_simd_level(level)
+            assert (las_2g.simd_level() == level)
+            columns = las_2g.read_las_columns(filename_in, threads=1)
+            results[level] = [bytes(memoryview(getattr(columns, name)))
+                              for name in ["x", "y", "z", "intensity", "quality", "utc_time"]]
+    finally:
+        las_2g.set_simd_level(None)
+
+    for level in results:
+        assert (results[level] == results["scalar"])
+
+
+def test_simd_encode_matches_scalar():
+    columns = synthetic_columns(1003)
+    written = {}
+    read_back = {}
+    try:
+        for level in supported_levels():
+            las_2g.set_simd_level(level)
+            temp_file = "test_simd_%s.las" % level
+            las_2g.write_las_columns(temp_file, *columns, counts=array.array("I", [1000, 3]))
+            with open(temp_file, "rb") as fid:
+                written[level] = fid.read()
+            read = las_2g.read_las_columns(temp_file)
+            read_back[level] = [bytes(memoryview(getattr(read, name))) for name in ["x", "z", "utc_time"]]
+            os.remove(temp_file)
+    finally:
+        las_2g.set_simd_level(None)
+
+    for level in written:
+        assert (written[level] == written["scalar"])
+        assert (read_back[level] == read_back["scalar"])
+
+
+def test_set_simd_level_rejects_unknown():
+    try:
+        las_2g.set_simd_level("neon")
+        assert (False)
+    except ValueError:
+        pass
+    assert (las_2g.simd_level() in levels)
+
+
+if __name__ == "__main__":
+    test_simd_decode_matches_scalar()
+    test_simd_encode_matches_scalar()
+    test_set_simd_level_rejects_unknown()
@@ -0,0 +1,63 @@
+import las_2g
+import os
+import pytest
+
+
+def test_stats_count_reads_and_writes(filenames_in):
+    las_2g.reset_stats()
+    data = las_2g.read_las(filenames_in[0])
+    after_read = las_2g.stats()
+    las_2g.write_las("test_stats.las", data)
+    after_write = las_2g.stats()
+    columns = las_2g.read_las_columns("test_stats.las")
+    after_columns = las_2g.stats()
+    size = os.path.getsize("test_stats.las")
+    os.remove("test_stats.las")
+
+    assert (after_read["bytes_read"] == size)
+    assert (after_read["profiles_read"] == 1)
+    assert (after_read["points_read"] == 1400)
+    assert (after_read["phases"]["objects"]["calls"] == 1)
+    assert (after_write["bytes_written"] == size)
+    assert (after_write["points_written"] == 1400)
+    assert (after_write["phases"]["write"]["calls"] == 1)
+    assert (after_columns["points_read"] == 1400 + columns.number_of_points)
+    assert (after_columns["phases"]["decode"]["calls"] >= 1)
+    assert (after_columns["phases"]["decode"]["seconds"] > 0.0)
+
+    las_2g.reset_stats()
+    stats = las_2g.stats()
+    assert (stats["bytes_read"] == 0 and stats["allocations"] == 0)
+    assert (all(phase["calls"] == 0 for phase in stats["phases"].values()))
+
+
+def test_trace_callback(filenames_in):
+    calls = []
+    las_2g.set_trace(lambda name, seconds, stats: calls.append((name, seconds, stats)))
+    try:
+        las_2g.read_las_columns(filenames_in[1])
+        las_2g.read_las(filenames_in[2], fields=["z"])
+    finally:
+        las_2g.set_trace(None)
+    las_2g.read_las(filenames_in[0])
+
+    assert ([name for name, _, _ in calls] == ["read_las_columns", "read_las"])
+    assert (all(seconds > 0.0 for _, seconds, _ in calls))
+    assert (calls[0][2]["points_read"] == 1400)
+    assert (calls[0][2]["profiles_read"] == 1)
+
+    def failing(name, seconds, stats):
+        raise ValueError(name)
+
+    las_2g.set_trace(failing)
+    try:
+        las_2g.read_las(filenames_in[0])
+        assert False
+    except ValueError as error:
+        assert (str(error) == "read_las")
+    finally:
+        las_2g.set_trace(None)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])
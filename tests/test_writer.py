@@ -0,0 +1,81 @@
+import las_2g
+import os
+import pytest
+import threading
+
+
+def test_writer_matches_write_las(filenames_in):
+    data = [las_2g.read_las(filename)[0] for filename in filenames_in]
+
+    expected_file = "test_writer_expected.las"
+    temp_file = "test_writer.las"
+    las_2g.write_las(expected_file, data)
+    with las_2g.LASWriter(temp_file, block_size=50000) as writer:
+        for las_file in data:
+            writer.append_profile(las_file)
+        assert (writer.number_of_profiles == 3)
+
+    with open(expected_file, "rb") as a, open(temp_file, "rb") as b:
+        assert (a.read() == b.read())
+    os.remove(expected_file)
+    os.remove(temp_file)
+
+
+def test_writer_columns(filenames_in):
+    columns = las_2g.read_las_columns(filenames_in[0])
+    temp_file = "test_writer_columns.las"
+    writer = las_2g.LASWriter(temp_file)
+    for start in range(0, 1400, 700):
+        writer.append_profile(memoryview(columns.x)[start:start + 700],
+                              memoryview(columns.y)[start:start + 700],
+                              memoryview(columns.z)[start:start + 700],
+                              memoryview(columns.intensity)[start:start + 700],
+                              memoryview(columns.quality)[start:start + 700],
+                              memoryview(columns.utc_time)[start:start + 700])
+    writer.close()
+
+    data = las_2g.read_las(temp_file)
+    os.remove(temp_file)
+    assert (len(data) == 2)
+    assert (data[1].entries[0].intensity == columns.intensity[700])
+    assert (data[1].entries[0].utc_time == columns.utc_time[700])
+
+    try:
+        writer.append_profile(columns.x, columns.y, columns.z, columns.intensity, columns.quality, columns.utc_time)
+        assert (False)
+    except ValueError:
+        pass
+
+
+def test_writer_close_while_appending(filenames_in, tmp_path):
+    # close() waits for a running append, appends after it raise.
+    las_file = las_2g.read_las(filenames_in[0])[0]
+    temp_file = str(tmp_path / "writer_threads.las")
+    writer = las_2g.LASWriter(temp_file, block_size=50000)
+    appended = []
+    appending = threading.Event()
+
+    def append():
+        try:
+            while True:
+                writer.append_profile(las_file)
+                appended.append(1)
+                appending.set()
+        except ValueError:
+            pass
+
+    threads = [threading.Thread(target=append) for i in range(3)]
+    for thread in threads:
+        thread.start()
+    appending.wait()
+    writer.close()
+    for thread in threads:
+        thread.join()
+
+    written = las_2g.read_las(temp_file)
+    assert (len(written) == len(appended) == writer.number_of_profiles)
+    assert (written[-1].entries[1399].x == las_file.entries[1399].x)
+
+
+if __name__ == "__main__":
+    pytest.main([__file__])